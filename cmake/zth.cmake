@@ -33,6 +33,7 @@ else()
 	set(ZTH_THREADS_DEFAULT OFF)
 endif()
 option(ZTH_THREADS "Make libzth thread-aware" ${ZTH_THREADS_DEFAULT})
+option(ZTH_TIME_NS "Store zth::Timestamp and zth::TimeInterval as 64-bit nanoseconds" OFF)
 
 # ##################################################################################################
 # libzth
@@ -76,6 +77,7 @@ add_library(
 	${ZTH_SOURCE_DIR}/src/perf.cpp
 	${ZTH_SOURCE_DIR}/src/poller.cpp
 	${ZTH_SOURCE_DIR}/src/time.cpp
+	${ZTH_SOURCE_DIR}/src/uring.cpp
 	${ZTH_SOURCE_DIR}/src/util.cpp
 	${ZTH_SOURCE_DIR}/src/waiter.cpp
 	${ZTH_SOURCE_DIR}/src/worker.cpp
@@ -233,6 +235,10 @@ else()
 	target_compile_options(libzth PUBLIC -DZTH_THREADS=0)
 endif()
 
+if(ZTH_TIME_NS)
+	target_compile_definitions(libzth PUBLIC -DZTH_TIME_NS=1)
+endif()
+
 if(UNIX OR MINGW)
 	# Still compile/link with pthread, as it provides more than threads...
 	set(CMAKE_THREAD_PREFER_PTHREAD TRUE)
@@ -0,0 +1,105 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2026 Jochem Rutgers
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <zth>
+
+#include <cstdio>
+#include <cstdlib>
+
+// A periodic task, which has to do some work within every period.
+struct Task {
+	char const* name;
+	double period_ms;
+	double work_ms;
+	unsigned int jobs;
+	unsigned int misses;
+};
+
+static Task tasks[] = {
+	{"A", 10, 4, 0, 0},
+	{"B", 25, 7.5, 0, 0},
+	{"C", 50, 10, 0, 0},
+};
+
+static bool stop_flag = false;
+
+// Spin for the given amount of time, while giving others the chance to preempt us.
+static void busy(zth::TimeInterval const& work)
+{
+	static zth::TimeInterval const chunk(50e-6);
+
+	for(zth::TimeInterval left = work; left.isPositive(); left -= chunk) {
+		zth::Timestamp end = zth::Timestamp::now() + (left < chunk ? left : chunk);
+		while(zth::Timestamp::now() < end)
+			;
+
+		zth::yield();
+	}
+}
+
+static void task(Task* t)
+{
+	zth::PeriodicWakeUp w(t->period_ms * 1e-3);
+	zth::TimeInterval work(t->work_ms * 1e-3);
+
+	// Set the first deadline, such that w() tracks it, even without EDF scheduling.
+	zth::currentWorker().setDeadline(zth::currentFiber(), w.t() + w.interval());
+
+	while(!stop_flag) {
+		busy(work);
+		t->jobs++;
+		w();
+	}
+
+	t->misses = zth::currentFiber().deadlineMisses();
+}
+
+static void run(bool edf, double duration)
+{
+	zth::currentWorker().setEdf(edf);
+	stop_flag = false;
+
+	zth::Gate gate(sizeof(tasks) / sizeof(tasks[0]) + 1);
+	for(size_t i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++) {
+		tasks[i].jobs = tasks[i].misses = 0;
+		zth::fiber(task, &tasks[i]) << zth::passOnExit(gate);
+	}
+
+	// Under EDF, fibers without a deadline only run when no fiber with a deadline is runnable.
+	// Set one for ourselves too, to make sure we get to stop the tasks when overloaded.
+	zth::Timestamp end = zth::Timestamp::now() + duration;
+	zth::currentWorker().setDeadline(zth::currentFiber(), end);
+	zth::nap(end);
+	stop_flag = true;
+	zth::currentWorker().setDeadline(zth::currentFiber(), zth::Timestamp::null());
+	gate.wait();
+
+	printf("%s:\n", edf ? "earliest deadline first" : "round-robin");
+	for(size_t i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++) {
+		Task const& t = tasks[i];
+		printf("  task %s  period %2.0f ms  work %4.1f ms  jobs %5u  missed %5u (%5.1f %%)\n",
+		       t.name, t.period_ms, t.work_ms, t.jobs, t.misses,
+		       t.jobs ? 100.0 * t.misses / t.jobs : 0.0);
+	}
+
+	zth::currentWorker().setEdf(false);
+}
+
+int main_fiber(int argc, char** argv)
+{
+	double duration = argc > 1 ? strtod(argv[1], nullptr) : 2;
+
+	double u = 0;
+	for(size_t i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++)
+		u += tasks[i].work_ms / tasks[i].period_ms;
+
+	printf("Utilization %.0f %%, run for %g s per scheduler\n\n", u * 100, duration);
+
+	// The tasks would be schedulable with EDF, as the utilization is below 100 %.
+	run(false, duration);
+	run(true, duration);
+	return 0;
+}
@@ -6,7 +6,22 @@
 
 #include <zth>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#ifdef ZTH_HAVE_EPOLL
+#  include <sys/resource.h>
+#endif
+#ifdef __GLIBC__
+#  include <malloc.h>
+#endif
+#ifdef ZTH_HAVE_POLLER
+#  include <unistd.h>
+#endif
 
 /////////////////////////////////////////////////
 // Tests
@@ -18,6 +33,51 @@ void testNow()
 	zth::Timestamp::now();
 }
 
+void testNowMonotonic()
+{
+	zth::Timestamp::now(zth::Config::ClockMonotonic);
+}
+
+void testNowTsc()
+{
+	zth::Timestamp::now(zth::Config::ClockTsc);
+}
+
+void testNowCoarse()
+{
+	zth::Timestamp::now(zth::Config::ClockCoarse);
+}
+
+static char const* clockName(zth::Config::ClockSource source)
+{
+	switch(source) {
+	case zth::Config::ClockTsc:
+		return "tsc";
+	case zth::Config::ClockCoarse:
+		return "coarse";
+	case zth::Config::ClockMonotonic:
+	default:
+		return "monotonic";
+	}
+}
+
+// Context switching approach, as selected when building Zth. Build with -DZTH_CONTEXT=... to
+// compare them.
+static char const* const contextApproach =
+#if defined(ZTH_CONTEXT_NATIVE)
+	"native";
+#elif defined(ZTH_CONTEXT_UCONTEXT)
+	"ucontext";
+#elif defined(ZTH_CONTEXT_SIGALTSTACK)
+	"sigaltstack";
+#elif defined(ZTH_CONTEXT_SJLJ)
+	"sjlj";
+#elif defined(ZTH_CONTEXT_WINFIBER)
+	"winfiber";
+#else
+	"unknown";
+#endif
+
 static zth::Context* context1;
 static zth::Context* context2;
 
@@ -92,6 +152,15 @@ void testFiberCreate()
 	zth::yield(nullptr, true); // Make sure to clean up old fibers.
 }
 
+void testFiberCreateBatch()
+{
+	// Fiber-per-message style: a burst of short-living fibers.
+	for(int i = 0; i < 16; i++)
+		zth::fiber(testFiberCreateEntry);
+
+	zth::yield(nullptr, true);
+}
+
 void testCurrentFiber()
 {
 	zth::Fiber const& f __attribute__((unused)) = zth::currentFiber();
@@ -107,6 +176,572 @@ void testNap100ms()
 	zth::nap(0.1);
 }
 
+static constexpr int testGroupBatch = 16;
+static std::atomic<int> testGroupPending{0};
+static zth::WorkerGroup* testGroupPtr = nullptr;
+
+void testGroupWork()
+{
+	// Some CPU-bound work, like handling a request.
+	unsigned int volatile x = 0;
+	for(unsigned int i = 0; i < 10000U; i++)
+		x = x + i;
+
+	testGroupPending--;
+}
+
+static void testGroupBatchRun(bool share)
+{
+	testGroupPending += testGroupBatch;
+
+	for(int i = 0; i < testGroupBatch; i++) {
+		if(share)
+			zth::fiber(testGroupWork) << zth::stealable();
+		else
+			zth::fiber(testGroupWork);
+	}
+
+	while(testGroupPending > 0)
+		zth::yield(nullptr, true);
+}
+
+void testGroupIsolated()
+{
+	testGroupBatchRun(false);
+}
+
+void testGroupShared()
+{
+	testGroupBatchRun(true);
+}
+
+void testGroupWorker()
+{
+	testGroupPtr->join();
+}
+
+static void testGroupInit(unsigned int workers)
+{
+	testGroupPtr = new zth::WorkerGroup();
+	testGroupPtr->join();
+
+	for(unsigned int i = 1; i < workers; i++)
+		zth::startWorkerThread(&testGroupWorker);
+
+	while(testGroupPtr->size() < workers)
+		zth::mnap(1);
+}
+
+static void testGroupCleanup()
+{
+	testGroupPtr->stop();
+	testGroupPtr->leave();
+
+	while(testGroupPtr->size() > 0)
+		zth::mnap(1);
+
+	delete testGroupPtr;
+	testGroupPtr = nullptr;
+}
+
+static std::atomic<int> testPostRequest{0};
+static zth::Signal* testPostSignal = nullptr;
+static std::thread testPostThread;
+
+static void testPostCallback(void* /*unused*/)
+{
+	testPostSignal->signal();
+}
+
+void testPost()
+{
+	// Let the other thread post to us, while we are sleeping.
+	testPostRequest = 1;
+	testPostSignal->wait();
+}
+
+static void testPostInit()
+{
+	testPostSignal = new zth::Signal();
+	zth::Worker* w = &zth::currentWorker();
+	w->keepAlive();
+
+	testPostThread = std::thread([w]() {
+		while(true) {
+			int req = 0;
+			while(!(req = testPostRequest.exchange(0)))
+				std::this_thread::yield();
+
+			if(req < 0)
+				break;
+
+			w->post(&testPostCallback);
+		}
+	});
+}
+
+static void testPostCleanup()
+{
+	testPostRequest = -1;
+	testPostThread.join();
+	zth::currentWorker().keepAlive(false);
+	delete testPostSignal;
+	testPostSignal = nullptr;
+}
+
+static zth::mt::Mutex* testMtMutexPtr = nullptr;
+static std::atomic<bool> testMtStop{false};
+static std::atomic<int> testMtRunning{0};
+
+void testMtMutex()
+{
+	zth::mt::Locked l{*testMtMutexPtr};
+}
+
+void testMtContender()
+{
+	testMtRunning++;
+
+	while(!testMtStop) {
+		zth::mt::Locked l{*testMtMutexPtr};
+	}
+
+	testMtRunning--;
+}
+
+static void testMtInit(unsigned int contenders)
+{
+	testMtMutexPtr = new zth::mt::Mutex();
+	testMtStop = false;
+
+	for(unsigned int i = 0; i < contenders; i++)
+		zth::startWorkerThread(&testMtContender);
+
+	while(testMtRunning < (int)contenders)
+		zth::mnap(1);
+}
+
+static void testMtCleanup()
+{
+	testMtStop = true;
+
+	while(testMtRunning > 0)
+		zth::mnap(1);
+
+	delete testMtMutexPtr;
+	testMtMutexPtr = nullptr;
+}
+
+static zth::Mutex* testLockMutex = nullptr;
+static zth::LightMutex* testLockLight = nullptr;
+static zth::Gate* testLockGate = nullptr;
+static bool testLockStop = false;
+
+static void testLockMutexFn()
+{
+	testLockMutex->lock();
+	testLockMutex->unlock();
+}
+
+static void testLockLightFn()
+{
+	testLockLight->lock();
+	testLockLight->unlock();
+}
+
+// Hold the lock while switching to the other fiber, which then has to block for it.
+static void testLockMutexContended()
+{
+	testLockMutex->lock();
+	zth::yield(nullptr, true);
+	testLockMutex->unlock();
+}
+
+static void testLockLightContended()
+{
+	testLockLight->lock();
+	zth::yield(nullptr, true);
+	testLockLight->unlock();
+}
+
+static void testLockContender(void (*f)())
+{
+	while(!testLockStop)
+		f();
+}
+
+static void testLockInit(void (*contender)() = nullptr)
+{
+	testLockMutex = new zth::Mutex();
+	testLockLight = new zth::LightMutex();
+	testLockStop = false;
+	testLockGate = new zth::Gate(2);
+	if(contender)
+		zth::fiber(testLockContender, contender) << zth::passOnExit(*testLockGate);
+	else
+		testLockGate->pass();
+}
+
+static void testLockCleanup()
+{
+	testLockStop = true;
+	testLockGate->wait();
+
+	delete testLockGate;
+	delete testLockLight;
+	delete testLockMutex;
+	testLockGate = nullptr;
+	testLockLight = nullptr;
+	testLockMutex = nullptr;
+}
+
+class TestTimer : public zth::TimedWaitable {
+public:
+	using zth::TimedWaitable::setTimeout;
+};
+
+static std::vector<TestTimer>* testTimers = nullptr;
+static size_t testTimerNext = 0;
+static zth::SortedList<zth::TimedWaitable>* testTimerList = nullptr;
+static zth::TimerWheel<zth::TimedWaitable>* testTimerWheel = nullptr;
+static zth::Timestamp testTimerNow;
+
+static zth::Timestamp testTimerTimeout()
+{
+	// Spread the timers over the next 10 s, like a bunch of connection timeouts.
+	return testTimerNow + zth::TimeInterval((double)(rand() % 10000) * 1e-3);
+}
+
+template <typename Q>
+static void testTimerRearm(Q& q, zth::Timestamp const& timeout)
+{
+	TestTimer& t = (*testTimers)[testTimerNext];
+	if(++testTimerNext == testTimers->size())
+		testTimerNext = 0;
+
+	q.erase(t);
+	t.setTimeout(timeout);
+	q.insert(t);
+}
+
+void testTimerRearmList()
+{
+	testTimerRearm(*testTimerList, testTimerTimeout());
+}
+
+void testTimerRearmWheel()
+{
+	testTimerRearm(*testTimerWheel, testTimerTimeout());
+}
+
+// Like testTimerRearmList(), but without rand() and floating point, such that only the
+// Timestamp arithmetic and comparisons of the SortedList remain.
+void testTimerRearmListFixed()
+{
+	testTimerRearm(
+		*testTimerList,
+		testTimerNow
+			+ zth::TimeInterval(
+				(time_t)(testTimerNext % 10U),
+				(long)(testTimerNext * 7919U % 1000U) * 1000000L));
+}
+
+static zth::Timestamp testTimeNow;
+static zth::Timestamp testTimeStart;
+static zth::Timestamp testTimeEnd;
+static zth::TimeInterval testTimeTotal;
+
+// The bookkeeping of Fiber::run() around a context switch.
+void testTimeAccounting()
+{
+	testTimeNow += zth::TimeInterval(0, 1500);
+	zth::TimeInterval dt = testTimeNow - testTimeStart;
+	testTimeTotal += dt;
+	testTimeStart = testTimeNow;
+	if(testTimeEnd < testTimeNow)
+		testTimeEnd = testTimeNow + zth::Config::MinTimeslice();
+}
+
+static void testTimerInit(size_t count)
+{
+	testTimerNow = zth::Timestamp::now();
+	testTimers = new std::vector<TestTimer>(count);
+	testTimerNext = 0;
+	testTimerList = new zth::SortedList<zth::TimedWaitable>();
+	testTimerWheel = new zth::TimerWheel<zth::TimedWaitable>();
+}
+
+static void testTimerFill(bool wheel)
+{
+	for(size_t i = 0; i < testTimers->size(); i++) {
+		(*testTimers)[i].setTimeout(testTimerTimeout());
+		if(wheel)
+			testTimerWheel->insert((*testTimers)[i]);
+		else
+			testTimerList->insert((*testTimers)[i]);
+	}
+}
+
+static void testTimerCleanup()
+{
+	testTimerList->clear();
+	testTimerWheel->clear();
+	delete testTimerList;
+	delete testTimerWheel;
+	delete testTimers;
+	testTimerList = nullptr;
+	testTimerWheel = nullptr;
+	testTimers = nullptr;
+}
+
+#if defined(ZTH_HAVE_EPOLL) && !defined(ZTH_HAVE_LIBZMQ)
+// Compare against PollPoller, which only exists without ZeroMQ.
+static constexpr size_t testPollActive = 4;
+static int testPollPipe[2][2] = {{-1, -1}, {-1, -1}};
+static std::vector<zth::PollableFd>* testPollFds = nullptr;
+static zth::PollerServerBase* testPollServer = nullptr;
+
+void testPoll()
+{
+	testPollServer->poll(0);
+}
+
+static size_t testPollMaxIdle()
+{
+	struct rlimit rl = {};
+	if(getrlimit(RLIMIT_NOFILE, &rl))
+		return 0;
+
+	// Try to get as many fds as we are allowed to.
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rl);
+	getrlimit(RLIMIT_NOFILE, &rl);
+
+	return rl.rlim_cur > 256 ? (size_t)rl.rlim_cur - 256U : 0;
+}
+
+static void testPollInit(size_t idle)
+{
+	for(int i = 0; i < 2; i++)
+		if(pipe(testPollPipe[i]))
+			zth::abort("Cannot create pipe");
+
+	// The second pipe is always readable.
+	if(write(testPollPipe[1][1], "1", 1) != 1)
+		zth::abort("Cannot write to pipe");
+
+	testPollFds = new std::vector<zth::PollableFd>();
+	testPollFds->reserve(idle + testPollActive);
+
+	for(size_t i = 0; i < idle + testPollActive; i++) {
+		int fd = dup(testPollPipe[i < idle ? 0 : 1][0]);
+		if(fd < 0)
+			zth::abort("Cannot dup fd");
+
+		testPollFds->push_back(zth::PollableFd(fd, zth::Pollable::PollIn));
+	}
+}
+
+static void testPollServerInit(zth::PollerServerBase* server)
+{
+	testPollServer = server;
+
+	for(size_t i = 0; i < testPollFds->size(); i++)
+		if(server->add((*testPollFds)[i]))
+			zth::abort("Cannot add fd");
+}
+
+static void testPollServerCleanup()
+{
+	for(size_t i = 0; i < testPollFds->size(); i++)
+		testPollServer->remove((*testPollFds)[i]);
+
+	delete testPollServer;
+	testPollServer = nullptr;
+}
+
+static void testPollCleanup()
+{
+	for(size_t i = 0; i < testPollFds->size(); i++)
+		close((*testPollFds)[i].fd);
+
+	delete testPollFds;
+	testPollFds = nullptr;
+
+	for(int i = 0; i < 2; i++)
+		for(int j = 0; j < 2; j++)
+			close(testPollPipe[i][j]);
+}
+#endif // ZTH_HAVE_EPOLL && !ZTH_HAVE_LIBZMQ
+
+#ifdef ZTH_HAVE_POLLER
+static int testIoPipe[2][2] = {{-1, -1}, {-1, -1}};
+static bool testIoEchoRunning = false;
+
+static void testIoEcho()
+{
+	char c = 0;
+	while(zth::io::read(testIoPipe[0][0], &c, 1) == 1)
+		if(zth::io::write(testIoPipe[1][1], &c, 1) != 1)
+			break;
+
+	testIoEchoRunning = false;
+}
+
+void testIo()
+{
+	char c = 1;
+	if(zth::io::write(testIoPipe[0][1], &c, 1) != 1
+	   || zth::io::read(testIoPipe[1][0], &c, 1) != 1)
+		zth::abort("Cannot echo");
+}
+
+void testIoReady()
+{
+	// No other fiber involved; data and buffer space are available right away.
+	char c = 1;
+	if(zth::io::write(testIoPipe[1][1], &c, 1) != 1
+	   || zth::io::read(testIoPipe[1][0], &c, 1) != 1)
+		zth::abort("Cannot loop back");
+}
+
+static void testIoInit()
+{
+	for(int i = 0; i < 2; i++)
+		if(pipe(testIoPipe[i]))
+			zth::abort("Cannot create pipe");
+
+	testIoEchoRunning = true;
+	zth::fiber(testIoEcho);
+}
+
+static void testIoReadyInit()
+{
+	if(pipe(testIoPipe[1]))
+		zth::abort("Cannot create pipe");
+}
+
+static void testIoReadyCleanup()
+{
+	close(testIoPipe[1][0]);
+	close(testIoPipe[1][1]);
+}
+
+static void testIoCleanup()
+{
+	// Let the echo fiber terminate.
+	close(testIoPipe[0][1]);
+	while(testIoEchoRunning)
+		zth::yield(nullptr, true);
+
+	close(testIoPipe[0][0]);
+	close(testIoPipe[1][0]);
+	close(testIoPipe[1][1]);
+}
+#endif // ZTH_HAVE_POLLER
+
+#ifdef ZTH_HAVE_POLLER
+static int testIdleFdPipe[2] = {-1, -1};
+static bool testIdleFdReaderRunning = false;
+
+static void testIdleFdReader()
+{
+	// Just keep an fd registered at the Waiter.
+	char c = 0;
+	zth::io::read(testIdleFdPipe[0], &c, 1);
+	testIdleFdReaderRunning = false;
+}
+
+static void testIdleFdInit()
+{
+	if(pipe(testIdleFdPipe))
+		zth::abort("Cannot create pipe");
+
+	testIdleFdReaderRunning = true;
+	zth::fiber(testIdleFdReader);
+	zth::yield(nullptr, true);
+}
+
+static void testIdleFdCleanup()
+{
+	close(testIdleFdPipe[1]);
+	while(testIdleFdReaderRunning)
+		zth::yield(nullptr, true);
+
+	close(testIdleFdPipe[0]);
+}
+#endif // ZTH_HAVE_POLLER
+
+static bool testSharedStop = false;
+static int testSharedRunning = 0;
+
+static void testSharedFiber(size_t depth)
+{
+	if(depth > 0) {
+		// Put some data on the stack, which is copied when the stack is shared.
+		volatile char buf[256];
+		buf[0] = 0;
+		testSharedFiber(depth > sizeof(buf) ? depth - sizeof(buf) : 0);
+		(void)buf[0];
+		return;
+	}
+
+	while(!testSharedStop)
+		zth::yield(nullptr, true);
+}
+
+static void testSharedEntry(size_t depth)
+{
+	testSharedFiber(depth);
+	testSharedRunning--;
+}
+
+static void testSharedInit(bool shared, size_t depth)
+{
+	testSharedStop = false;
+
+	for(int i = 0; i < 2; i++) {
+		testSharedRunning++;
+		zth::fiber(testSharedEntry, depth) << zth::setStackShared(shared);
+	}
+
+	zth::yield(nullptr, true);
+}
+
+static void testSharedCleanup()
+{
+	testSharedStop = true;
+	while(testSharedRunning > 0)
+		zth::yield(nullptr, true);
+}
+
+#ifdef ZTH_OS_LINUX
+static int testIdleBlocked = 0;
+
+static void testIdleFiber(zth::Signal* signal)
+{
+	testIdleBlocked++;
+	signal->wait();
+	testIdleBlocked--;
+}
+
+static size_t testResident()
+{
+	unsigned long size = 0;
+	unsigned long resident = 0;
+
+	FILE* f = fopen("/proc/self/statm", "r");
+	if(!f)
+		return 0;
+
+	if(fscanf(f, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+
+	fclose(f);
+	return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+#endif // ZTH_OS_LINUX
+
 /////////////////////////////////////////////////
 // Tester
 
@@ -256,6 +891,466 @@ static void runTest(char const* set, char const* name, void (*test)(), bool cali
 		calibration = -fsm.result();
 }
 
+// Measure how late nap() returns. This is not an average execution time, so it does not
+// use runTest().
+static void runJitter(char const* set, char const* name, bool periodic)
+{
+	static size_t const count = 1000;
+	zth::TimeInterval const interval(0, 300000L);
+
+	zth::yield();
+
+	double sum = 0;
+	double max = 0;
+	zth::PeriodicWakeUp w(interval);
+	std::clock_t cpu = std::clock();
+	zth::Timestamp start = zth::Timestamp::now();
+
+	for(size_t i = 0; i < count; i++) {
+		zth::Timestamp deadline;
+		if(periodic) {
+			deadline = w.t() + interval;
+			w();
+		} else {
+			deadline = zth::Timestamp::now() + interval;
+			zth::nap(interval);
+		}
+
+		double late = (zth::Timestamp::now() - deadline).s();
+		sum += late;
+		max = std::max(max, late);
+	}
+
+	double wall = (zth::Timestamp::now() - start).s();
+	double load = (double)(std::clock() - cpu) / (double)CLOCKS_PER_SEC / wall;
+
+	zth::string description = zth::format("[%-10s]  %s", set, name);
+	printf("%-50s: %s    (mean lateness, max %s, %3u%% CPU)\n", description.c_str(),
+	       preciseTime(sum / (double)count).c_str(), preciseTime(max).c_str(),
+	       (unsigned)(load * 100.0 + 0.5));
+}
+
+static bool testWakeupStop = false;
+static int testWakeupBusy = 0;
+static bool testWakeupRan = false;
+static zth::Timestamp testWakeupSignalled;
+static double testWakeupSum = 0;
+static double testWakeupMax = 0;
+
+static void testWakeupBusyFiber()
+{
+	testWakeupBusy++;
+	while(!testWakeupStop)
+		zth::yield(nullptr, true);
+	testWakeupBusy--;
+}
+
+static void testWakeupFiber(zth::Signal* signal)
+{
+	while(true) {
+		signal->wait();
+		if(testWakeupStop)
+			break;
+
+		double late = (zth::Timestamp::now() - testWakeupSignalled).s();
+		testWakeupSum += late;
+		testWakeupMax = std::max(testWakeupMax, late);
+		testWakeupRan = true;
+	}
+}
+
+// Measure the time from signalling a fiber till it runs, while many other fibers are busy.
+// This is not an average execution time, so it does not use runTest().
+static void runWakeup(char const* set, char const* name, unsigned int priority)
+{
+	static size_t const count = 1000;
+	static int const busy = 1000;
+
+	zth::yield();
+
+	testWakeupStop = false;
+	testWakeupSum = 0;
+	testWakeupMax = 0;
+
+	zth::Signal signal;
+	for(int i = 0; i < busy; i++)
+		zth::fiber(testWakeupBusyFiber);
+	zth::fiber(testWakeupFiber, &signal) << zth::setPriority(priority);
+
+	while(testWakeupBusy < busy)
+		zth::yield(nullptr, true);
+
+	for(size_t i = 0; i < count; i++) {
+		testWakeupRan = false;
+		testWakeupSignalled = zth::Timestamp::now();
+		signal.signal();
+		while(!testWakeupRan)
+			zth::yield(nullptr, true);
+	}
+
+	testWakeupStop = true;
+	signal.signal();
+	while(testWakeupBusy > 0)
+		zth::yield(nullptr, true);
+
+	// Let the Worker clean up the fibers.
+	zth::yield(nullptr, true);
+
+	zth::string description = zth::format("[%-10s]  %s", set, name);
+	printf("%-50s: %s    (mean latency, max %s)\n", description.c_str(),
+	       preciseTime(testWakeupSum / (double)count).c_str(),
+	       preciseTime(testWakeupMax).c_str());
+}
+
+static bool testFairStop = false;
+
+static void testFairFiber(zth::TimeInterval const* work)
+{
+	while(!testFairStop) {
+		zth::Timestamp end = zth::Timestamp::now() + *work;
+		while(zth::Timestamp::now() < end)
+			;
+		zth::yield();
+	}
+}
+
+// Measure the CPU share of a tenant with one fiber, while another tenant runs many fibers. This
+// is not an execution time, so it does not use runTest().
+static void runFairShare(char const* set, char const* name, bool grouped)
+{
+	static int const many = 10;
+	static zth::TimeInterval const work(20e-6);
+
+	zth::FiberGroup greedy("greedy");
+	zth::FiberGroup modest("modest");
+	zth::Gate gate(many + 2);
+	testFairStop = false;
+
+	for(int i = 0; i < many; i++) {
+		zth::Fiber& f = zth::fiber(testFairFiber, &work) << zth::passOnExit(gate);
+		if(grouped)
+			f << zth::setFiberGroup(greedy);
+	}
+
+	zth::Fiber& f = zth::fiber(testFairFiber, &work) << zth::passOnExit(gate);
+	if(grouped)
+		f << zth::setFiberGroup(modest);
+	zth::TimeInterval t0 = f.totalTime();
+
+	zth::mnap(500);
+	double share = (f.totalTime() - t0).s() / 0.5;
+	testFairStop = true;
+	gate.wait();
+
+	zth::string description = zth::format("[%-10s]  %s", set, name);
+	printf("%-50s: %8.1f %%    (CPU share, %d greedy fibers, %u throttles)\n",
+	       description.c_str(), share * 100.0, many, greedy.throttled());
+}
+
+static unsigned long testFairSwitches = 0;
+
+static void testFairSwitchFiber()
+{
+	while(!testFairStop) {
+		testFairSwitches++;
+		zth::yield(nullptr, true);
+	}
+}
+
+// Measure the cost of a context switch when all runnable fibers are in a different group.
+static void runFairSwitch(char const* set, char const* name, int groups)
+{
+	zth::FiberGroup* group = new zth::FiberGroup[groups];
+	zth::Gate gate((size_t)groups + 1U);
+	testFairStop = false;
+
+	for(int i = 0; i < groups; i++)
+		zth::fiber(testFairSwitchFiber) << zth::setFiberGroup(group[i])
+						<< zth::passOnExit(gate);
+
+	zth::yield();
+	testFairSwitches = 0;
+	zth::Timestamp start = zth::Timestamp::now();
+	zth::mnap(200);
+	double dt = start.passed().s();
+	unsigned long switches = testFairSwitches;
+	testFairStop = true;
+	gate.wait();
+	delete[] group;
+
+	zth::string description = zth::format("[%-10s]  %s", set, name);
+	printf("%-50s: %s    (per yield(), %d groups)\n", description.c_str(),
+	       preciseTime(dt / (double)switches).c_str(), groups);
+}
+
+static zth::Mailbox<int>* testPingPongRequest = nullptr;
+static zth::Mailbox<int>* testPingPongResponse = nullptr;
+static zth::Gate* testPingPongGate = nullptr;
+static bool testPingPongStop = false;
+
+static void testPingPongServer()
+{
+	while(true) {
+		int req = testPingPongRequest->take();
+		if(req < 0)
+			break;
+
+		testPingPongResponse->put(req);
+	}
+}
+
+static void testPingPongBusy()
+{
+	while(!testPingPongStop)
+		zth::yield(nullptr, true);
+}
+
+static void testPingPongInit(bool handoff, int busy)
+{
+	testPingPongRequest = new zth::Mailbox<int>();
+	testPingPongResponse = new zth::Mailbox<int>();
+	testPingPongRequest->setHandoff(handoff);
+	testPingPongResponse->setHandoff(handoff);
+	testPingPongGate = new zth::Gate((size_t)busy + 2U);
+	testPingPongStop = false;
+
+	zth::fiber(testPingPongServer) << zth::passOnExit(*testPingPongGate);
+	for(int i = 0; i < busy; i++)
+		zth::fiber(testPingPongBusy) << zth::passOnExit(*testPingPongGate);
+}
+
+static void testPingPong()
+{
+	testPingPongRequest->put(1);
+	testPingPongResponse->take();
+}
+
+static void testPingPongCleanup()
+{
+	testPingPongStop = true;
+	testPingPongRequest->put(-1);
+	testPingPongGate->wait();
+
+	delete testPingPongGate;
+	delete testPingPongResponse;
+	delete testPingPongRequest;
+	testPingPongGate = nullptr;
+	testPingPongResponse = testPingPongRequest = nullptr;
+}
+
+static void testSemTimeoutFiber(zth::Semaphore* sem, zth::Timestamp timeout)
+{
+	sem->acquire(1, timeout);
+}
+
+// Measure how long it takes to handle the timeouts of many fibers that wait for the same
+// Semaphore. The last waiter times out first. This is not the execution time of a single
+// operation, so it does not use runTest().
+static void runSemTimeout(char const* set, char const* name, int count)
+{
+	zth::Semaphore sem;
+	zth::Gate gate((size_t)count + 1U);
+	zth::Timestamp timeout = zth::Timestamp::now() + zth::TimeInterval(0.5);
+
+	for(int i = 0; i < count; i++) {
+		zth::TimeInterval later(0, (long)(count - i));
+		zth::fiber(testSemTimeoutFiber, &sem, timeout + later) << zth::passOnExit(gate);
+	}
+
+	gate.wait();
+	double dt = (zth::Timestamp::now() - timeout).s();
+
+	zth::string description = zth::format("[%-10s]  %s", set, name);
+	printf("%-50s: %s    (per timeout, %d waiters)\n", description.c_str(),
+	       preciseTime(dt / (double)count).c_str(), count);
+}
+
+static int const testChannelItems = 200000;
+
+static void testMailboxProducer(zth::Mailbox<int>* mb)
+{
+	for(int i = 0; i < testChannelItems; i++)
+		mb->put(i);
+}
+
+static void testChannelProducer(zth::Channel<int, 64>* ch, size_t batch)
+{
+	int buf[64];
+	for(int i = 0; i < testChannelItems; i += (int)batch) {
+		for(size_t j = 0; j < batch; j++)
+			buf[j] = i + (int)j;
+		ch->put_n(buf, batch);
+	}
+	ch->close();
+}
+
+// Measure the throughput of a producer and consumer fiber, which pass items via a Mailbox, or
+// via a Channel in batches. This is not the execution time of a single operation, so it does not
+// use runTest().
+static void runChannel(char const* set, char const* name, size_t batch)
+{
+	zth::yield();
+
+	zth::Gate gate(2);
+	zth::Timestamp start = zth::Timestamp::now();
+	int taken = 0;
+
+	if(!batch) {
+		zth::Mailbox<int> mb;
+		zth::fiber(testMailboxProducer, &mb) << zth::passOnExit(gate);
+		for(; taken < testChannelItems; taken++)
+			mb.take();
+		gate.wait();
+	} else {
+		zth::Channel<int, 64> ch;
+		zth::fiber(testChannelProducer, &ch, batch) << zth::passOnExit(gate);
+		int buf[64];
+		size_t n = 0;
+		while((n = ch.take_up_to(buf, batch)) > 0)
+			taken += (int)n;
+		gate.wait();
+	}
+
+	double dt = (zth::Timestamp::now() - start).s();
+	zth::string description = zth::format("[%-10s]  %s", set, name);
+	printf("%-50s: %8.2f M items/s    (%d items)\n", description.c_str(),
+	       (double)taken / dt * 1e-6, taken);
+}
+
+static int const testRwFibers = 8;
+static int const testRwOps = 10000;
+
+struct TestRw {
+	zth::Mutex* mutex;
+	zth::SharedMutex* shared;
+	int writePercent;
+};
+
+// Access a cache, which yields while holding the lock, like it would when the data is not
+// immediately available.
+static void testRwFiber(TestRw* t, unsigned int seed)
+{
+	for(int i = 0; i < testRwOps; i++) {
+		seed = seed * 1103515245U + 12345U;
+		bool write = (int)((seed >> 16U) % 100U) < t->writePercent;
+
+		if(t->mutex) {
+			zth::Locked l{*t->mutex};
+			zth::yield(nullptr, true);
+		} else if(write) {
+			zth::UniqueLocked l{*t->shared};
+			zth::yield(nullptr, true);
+		} else {
+			zth::SharedLocked l{*t->shared};
+			zth::yield(nullptr, true);
+		}
+	}
+}
+
+// Measure the throughput of fibers that read and write a shared cache, protected by a Mutex or a
+// SharedMutex.  Like runChannel(), it does not use runTest().
+static void runRw(
+	char const* set, char const* name, int writePercent, bool shared,
+	zth::SharedMutex::Policy policy = zth::SharedMutex::PreferWriters)
+{
+	zth::yield();
+
+	zth::Mutex mutex;
+	zth::SharedMutex sharedMutex("SharedMutex", policy);
+	TestRw t = {shared ? nullptr : &mutex, &sharedMutex, writePercent};
+
+	zth::Gate gate(testRwFibers + 1);
+	zth::Timestamp start = zth::Timestamp::now();
+	for(int i = 0; i < testRwFibers; i++)
+		zth::fiber(testRwFiber, &t, (unsigned int)i + 1U) << zth::passOnExit(gate);
+	gate.wait();
+
+	double dt = (zth::Timestamp::now() - start).s();
+	int ops = testRwFibers * testRwOps;
+	zth::string description = zth::format("[%-10s]  %s, %d%% writes", set, name, writePercent);
+	printf("%-50s: %8.2f M ops/s    (%d fibers)\n", description.c_str(),
+	       (double)ops / dt * 1e-6, testRwFibers);
+}
+
+static std::atomic<bool> testJitterDone;
+static double testJitterSum;
+static double testJitterMax;
+static int const testJitterCount = 1000;
+
+static void testJitterFiber()
+{
+	testJitterSum = 0;
+	testJitterMax = 0;
+
+	zth::Timestamp t = zth::Timestamp::now();
+	for(int i = 0; i < testJitterCount; i++) {
+		t += zth::TimeInterval(1e-3);
+		zth::nap(t);
+		double late = t.passed().s();
+		testJitterSum += late;
+		testJitterMax = std::max(testJitterMax, late);
+	}
+
+	testJitterDone = true;
+}
+
+// Measure how late a fiber in another Worker thread wakes up from a nap, depending on how the
+// thread is started. This is not an execution time, so it does not use runTest().
+static void runThreadJitter(char const* set, char const* name, zth::WorkerThreadAttr const& attr)
+{
+	zth::string description = zth::format("[%-10s]  %s", set, name);
+
+	testJitterDone = false;
+	int res = zth::startWorkerThread(&testJitterFiber, attr);
+	if(res) {
+		printf("%-50s: skipped; %s\n", description.c_str(), zth::err(res).c_str());
+		return;
+	}
+
+	while(!testJitterDone)
+		zth::mnap(10);
+
+	printf("%-50s: %s    (mean latency, max %s)\n", description.c_str(),
+	       preciseTime(testJitterSum / (double)testJitterCount).c_str(),
+	       preciseTime(testJitterMax).c_str());
+}
+
+#ifdef ZTH_OS_LINUX
+// Measure the resident memory of fibers that are blocked. This is not an execution time, so it
+// does not use runTest().
+static void runIdleMemory(char const* set, char const* name, bool shared)
+{
+	static int const count = 10000;
+	zth::Signal signal;
+
+	zth::yield();
+#  ifdef __GLIBC__
+	// Return the memory that previous tests freed to the OS.
+	malloc_trim(0);
+#  endif
+	size_t before = testResident();
+
+	for(int i = 0; i < count; i++)
+		zth::fiber(testIdleFiber, &signal) << zth::setStackShared(shared);
+
+	while(testIdleBlocked < count)
+		zth::yield(nullptr, true);
+
+	size_t after = testResident();
+
+	signal.signalAll();
+	while(testIdleBlocked > 0)
+		zth::yield(nullptr, true);
+
+	// Let the Worker clean up the fibers.
+	zth::yield(nullptr, true);
+
+	zth::string description = zth::format("[%-10s]  %s", set, name);
+	printf("%-50s: %8u bytes    (per fiber, %d idle fibers)\n", description.c_str(),
+	       (unsigned)((after - before) / (size_t)count), count);
+}
+#endif // ZTH_OS_LINUX
+
 static void run_testset(char const* testset)
 {
 	bool all = strcmp("all", testset) == 0;
@@ -263,29 +1358,172 @@ static void run_testset(char const* testset)
 
 	set = "now";
 	if(all || strcmp(set, testset) == 0) {
-		runTest(set, "Timestamp::now()", &testNow);
+		zth::string clock =
+			zth::format("Timestamp::now(), %s", clockName(zth::Config::Clock));
+		runTest(set, clock.c_str(), &testNow);
+		runTest(set, "Timestamp::now(ClockMonotonic)", &testNowMonotonic);
+		runTest(set, "Timestamp::now(ClockTsc)", &testNowTsc);
+
+		zth::string coarse = zth::format(
+			"Timestamp::now(ClockCoarse), %s",
+			zth::Timestamp::resolution(zth::Config::ClockCoarse).str().c_str());
+		runTest(set, coarse.c_str(), &testNowCoarse);
 	}
 
 	set = "context";
 	if(all || strcmp(set, testset) == 0) {
 		testContextInit();
-		runTest(set, "2 context_switch()s", &testContext);
+		runTest(set, zth::format("2 context_switch()s, %s", contextApproach).c_str(),
+			&testContext);
 		testContextCleanup();
 	}
 
 	set = "yield";
 	if(all || strcmp(set, testset) == 0) {
-		runTest(set, "single-fiber yield()", &testYield1);
+		runTest(set,
+			zth::Config::TimesliceTick ? "single-fiber yield(), tick"
+						   : "single-fiber yield()",
+			&testYield1);
 		runTest(set, "single-fiber yield() always", &testYield1Always);
 		testYieldInit();
-		runTest(set, "yield() to fiber and back", &testYield);
+		runTest(set, zth::format("yield() to fiber and back, %s", contextApproach).c_str(),
+			&testYield);
+		testYieldCleanup();
+#ifdef ZTH_HAVE_POLLER
+		testIdleFdInit();
+		testYieldInit();
+		runTest(set, "yield() to fiber and back, polling fd", &testYield);
 		testYieldCleanup();
+		testIdleFdCleanup();
+#endif
+	}
+
+	set = "prio";
+	if(all || strcmp(set, testset) == 0) {
+		runWakeup(set, "wakeup-to-run, 1000 busy, same prio", zth::Config::DefaultPriority);
+		if(zth::Config::DefaultPriority + 1 < zth::Config::PriorityLevels)
+			runWakeup(
+				set, "wakeup-to-run, 1000 busy, high prio",
+				zth::Config::DefaultPriority + 1);
+	}
+
+	set = "fair";
+	if(all || strcmp(set, testset) == 0) {
+		runFairShare(set, "1-fiber tenant, no groups", false);
+		runFairShare(set, "1-fiber tenant, FiberGroup", true);
+		for(int groups = 10; groups <= 1000; groups *= 10)
+			runFairSwitch(
+				set, zth::format("yield() between %d groups", groups).c_str(),
+				groups);
+	}
+
+	set = "list";
+	if(all || strcmp(set, testset) == 0) {
+		for(int count = 100; count <= 10000; count *= 10)
+			runSemTimeout(
+				set, zth::format("Semaphore timeout, %d waiters", count).c_str(),
+				count);
+	}
+
+	set = "lock";
+	if(all || strcmp(set, testset) == 0) {
+		printf("%-50s: %8u bytes\n",
+		       zth::format("[%-10s]  %s", set, "sizeof(Mutex)").c_str(),
+		       (unsigned)sizeof(zth::Mutex));
+		printf("%-50s: %8u bytes\n",
+		       zth::format("[%-10s]  %s", set, "sizeof(LightMutex)").c_str(),
+		       (unsigned)sizeof(zth::LightMutex));
+
+		testLockInit();
+		runTest(set, "Mutex lock/unlock", &testLockMutexFn);
+		runTest(set, "LightMutex lock/unlock", &testLockLightFn);
+		testLockCleanup();
+
+		testLockInit(&testLockMutexContended);
+		runTest(set, "Mutex lock/unlock, contended", &testLockMutexContended);
+		testLockCleanup();
+
+		testLockInit(&testLockLightContended);
+		runTest(set, "LightMutex lock/unlock, contended", &testLockLightContended);
+		testLockCleanup();
+	}
+
+	set = "handoff";
+	if(all || strcmp(set, testset) == 0) {
+		for(int busy = 0; busy <= 4; busy += 4) {
+			zth::string name = zth::format("Mailbox ping-pong, %d busy, ", busy);
+
+			testPingPongInit(false, busy);
+			runTest(set, (name + "queued").c_str(), &testPingPong);
+			testPingPongCleanup();
+
+			testPingPongInit(true, busy);
+			runTest(set, (name + "handoff").c_str(), &testPingPong);
+			testPingPongCleanup();
+		}
+	}
+
+	set = "channel";
+	if(all || strcmp(set, testset) == 0) {
+		runChannel(set, "Mailbox put/take", 0);
+		runChannel(set, "Channel<64> put_n/take_up_to(1)", 1);
+		runChannel(set, "Channel<64> put_n/take_up_to(8)", 8);
+		runChannel(set, "Channel<64> put_n/take_up_to(64)", 64);
+	}
+
+	set = "rwlock";
+	if(all || strcmp(set, testset) == 0) {
+		static int const writePercents[] = {1, 10, 50};
+		for(size_t i = 0; i < sizeof(writePercents) / sizeof(writePercents[0]); i++) {
+			int w = writePercents[i];
+			runRw(set, "Mutex", w, false);
+			runRw(set, "SharedMutex, writers", w, true);
+			runRw(set, "SharedMutex, readers", w, true, zth::SharedMutex::PreferReaders);
+		}
+	}
+
+	set = "thread";
+	if(all || strcmp(set, testset) == 0) {
+		zth::WorkerThreadAttr attr;
+		attr.name = "zth-jitter";
+		runThreadJitter(set, "1 ms nap, floating thread", attr);
+
+		// Pin to another CPU than the one we are running on, if there is one.
+		int cpu = (int)std::thread::hardware_concurrency() - 1;
+		attr.cpus = &cpu;
+		attr.cpuCount = 1;
+		runThreadJitter(set, "1 ms nap, pinned thread", attr);
+
+		attr.fifoPriority = 10;
+		runThreadJitter(set, "1 ms nap, pinned SCHED_FIFO thread", attr);
 	}
 
 	set = "fiber";
 	if(all || strcmp(set, testset) == 0) {
 		runTest(set, "currentFiber()", &testCurrentFiber);
 		runTest(set, "create and cleanup fiber", &testFiberCreate);
+		runTest(set, "create and cleanup 16 fibers", &testFiberCreateBatch);
+	}
+
+	set = "stack";
+	if(all || strcmp(set, testset) == 0) {
+		testSharedInit(false, 0);
+		runTest(set, "2 fibers yield() and back, own stacks", &testYield);
+		testSharedCleanup();
+#ifdef ZTH_HAVE_STACK_SHARED
+		testSharedInit(true, 0);
+		runTest(set, "2 fibers yield() and back, shared stack", &testYield);
+		testSharedCleanup();
+		testSharedInit(true, 0x1000);
+		runTest(set, "2 fibers yield() and back, shared, +4 KiB", &testYield);
+		testSharedCleanup();
+#endif
+#ifdef ZTH_OS_LINUX
+		runIdleMemory(set, "idle fiber, own stack", false);
+#  ifdef ZTH_HAVE_STACK_SHARED
+		runIdleMemory(set, "idle fiber, shared stack", true);
+#  endif
+#endif
 	}
 
 	set = "nap";
@@ -293,6 +1531,138 @@ static void run_testset(char const* testset)
 		runTest(set, "nap(0)", &testNap0);
 		runTest(set, "nap(100 ms)", &testNap100ms);
 	}
+
+	set = "group";
+	if(all || strcmp(set, testset) == 0) {
+		unsigned int workers =
+			std::min(8U, std::max(2U, std::thread::hardware_concurrency()));
+
+		runTest(set, "16 fibers on isolated worker", &testGroupIsolated);
+		testGroupInit(workers);
+		runTest(set, zth::format("16 stealable fibers on %u workers", workers).c_str(),
+			&testGroupShared);
+		testGroupCleanup();
+	}
+
+	set = "mt";
+	if(all || strcmp(set, testset) == 0) {
+		unsigned int threads =
+			std::min(8U, std::max(2U, std::thread::hardware_concurrency()));
+
+		for(unsigned int t = 1; t <= threads; t *= 2) {
+			testMtInit(t - 1);
+			runTest(set, zth::format("mt::Mutex lock/unlock, %u thread(s)", t).c_str(),
+				&testMtMutex);
+			testMtCleanup();
+		}
+	}
+
+	set = "time";
+	if(all || strcmp(set, testset) == 0) {
+		zth::string repr = ZTH_TIME_NS ? "int64_t ns" : "timespec";
+
+		testTimeNow = testTimeStart = zth::Timestamp::now();
+		runTest(set, ("context switch accounting, " + repr).c_str(), &testTimeAccounting);
+
+		testTimerInit(1000);
+		testTimerFill(false);
+		runTest(set, ("re-arm 1 of 1000 list timers, " + repr).c_str(),
+			&testTimerRearmListFixed);
+		testTimerCleanup();
+	}
+
+	set = "timer";
+	if(all || strcmp(set, testset) == 0) {
+		for(size_t count = 1000; count <= 100000; count *= 10) {
+			zth::string name = zth::format("re-arm 1 of %u timers, ", (unsigned)count);
+
+			testTimerInit(count);
+			testTimerFill(false);
+			runTest(set, (name + "SortedList").c_str(), &testTimerRearmList);
+			testTimerList->clear();
+			testTimerFill(true);
+			runTest(set, (name + "TimerWheel").c_str(), &testTimerRearmWheel);
+			testTimerCleanup();
+		}
+	}
+
+#if defined(ZTH_HAVE_EPOLL) && !defined(ZTH_HAVE_LIBZMQ)
+	set = "poll";
+	if(all || strcmp(set, testset) == 0) {
+		static size_t const counts[] = {10, 1000, 50000};
+		size_t maxIdle = testPollMaxIdle();
+
+		for(size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+			size_t idle = std::min(counts[c], maxIdle);
+			zth::string name = zth::format(
+				"poll(0) %u idle + %u active fds, ", (unsigned)idle,
+				(unsigned)testPollActive);
+
+			testPollInit(idle);
+			testPollServerInit(new zth::PollPoller());
+			runTest(set, (name + "PollPoller").c_str(), &testPoll);
+			testPollServerCleanup();
+			testPollServerInit(new zth::EpollPoller());
+			runTest(set, (name + "EpollPoller").c_str(), &testPoll);
+			testPollServerCleanup();
+			testPollCleanup();
+		}
+	}
+#endif
+
+#ifdef ZTH_HAVE_POLLER
+	set = "io";
+	if(all || strcmp(set, testset) == 0) {
+		testIoInit();
+		runTest(set, "zth::io pipe round trip, default poller", &testIo);
+		testIoCleanup();
+
+		testIoReadyInit();
+		runTest(set, "zth::io write+read, data ready", &testIoReady);
+		testIoReadyCleanup();
+
+#  ifdef ZTH_HAVE_IO_URING
+		zth::UringPoller uring;
+		if(uring.valid()) {
+			zth::currentWorker().waiter().setPoller(&uring);
+			testIoInit();
+			runTest(set, "zth::io pipe round trip, io_uring", &testIo);
+			testIoCleanup();
+			zth::currentWorker().waiter().setPoller();
+		}
+#  endif
+	}
+#endif
+
+	set = "jitter";
+	if(all || strcmp(set, testset) == 0) {
+		runJitter(set, "nap(300 us)", false);
+		runJitter(set, "PeriodicWakeUp(300 us)", true);
+#ifdef ZTH_HAVE_POLLER
+		testIdleFdInit();
+		runJitter(set, "nap(300 us), polling fd", false);
+		runJitter(set, "PeriodicWakeUp(300 us), polling fd", true);
+		testIdleFdCleanup();
+
+#  ifdef ZTH_HAVE_IO_URING
+		zth::UringPoller uring;
+		if(uring.valid()) {
+			zth::currentWorker().waiter().setPoller(&uring);
+			testIdleFdInit();
+			runJitter(set, "nap(300 us), polling fd, io_uring", false);
+			testIdleFdCleanup();
+			zth::currentWorker().waiter().setPoller();
+		}
+#  endif
+#endif
+	}
+
+	set = "post";
+	if(all || strcmp(set, testset) == 0) {
+		testPostInit();
+		runTest(set, "post() to sleeping worker from thread", &testPost);
+		testPostCleanup();
+	}
 }
 
 // Specify on the command line the test set name(s) to be executed.  When none
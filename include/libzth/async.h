@@ -158,7 +158,8 @@ struct FiberManipulator {};
 /*!
  * \brief Change the stack size of a fiber returned by #zth_async.
  *
- * This is a manipulator that calls #zth::Fiber::setStackSize().
+ * This is a manipulator that calls #zth::Fiber::setStackSize(), and
+ * #zth::Fiber::setStackReserve() when \c reserve is non-zero.
  * Example:
  * \code
  * void foo() { ... }
@@ -174,9 +175,11 @@ struct FiberManipulator {};
  */
 struct setStackSize : public FiberManipulator {
 	size_t stack;
+	size_t reserve;
 
-	constexpr explicit setStackSize(size_t s) noexcept
+	constexpr explicit setStackSize(size_t s, size_t r = 0) noexcept
 		: stack(s)
+		, reserve(r)
 	{}
 };
 
@@ -189,6 +192,120 @@ TypedFiber<R>& operator<<(TypedFiber<R>& fiber, setStackSize const& m)
 			zth_throw(errno_exception(res));
 	}
 
+	if(m.reserve) {
+		int res = fiber.setStackReserve(m.reserve);
+		if(res)
+			zth_throw(errno_exception(res));
+	}
+
+	return fiber;
+}
+
+/*!
+ * \brief Let a fiber returned by #zth_async run on the stack that is shared by its Worker.
+ * \details This is a manipulator that calls #zth::Fiber::setStackShared().
+ * \see zth::setStackSize() for an example
+ * \ingroup zth_api_cpp_fiber
+ */
+struct setStackShared : public FiberManipulator {
+	bool shared;
+
+	constexpr explicit setStackShared(bool s = true) noexcept
+		: shared(s)
+	{}
+};
+
+template <typename R>
+TypedFiber<R>& operator<<(TypedFiber<R>& fiber, setStackShared const& m)
+{
+	int res = fiber.setStackShared(m.shared);
+	if(res)
+		zth_throw(errno_exception(res));
+
+	return fiber;
+}
+
+/*!
+ * \brief Change the priority of a fiber returned by #zth_async.
+ * \details This is a manipulator that calls #zth::Worker::setPriority().
+ * \see zth::setStackSize() for an example
+ * \ingroup zth_api_cpp_fiber
+ */
+struct setPriority : public FiberManipulator {
+	unsigned int priority;
+
+	constexpr explicit setPriority(unsigned int p) noexcept
+		: priority(p)
+	{}
+};
+
+static inline Fiber& operator<<(Fiber& fiber, setPriority const& m)
+{
+	int res = currentWorker().setPriority(fiber, m.priority);
+	if(res)
+		zth_throw(errno_exception(res));
+
+	return fiber;
+}
+
+template <typename R>
+TypedFiber<R>& operator<<(TypedFiber<R>& fiber, setPriority const& m)
+{
+	static_cast<Fiber&>(fiber) << m;
+	return fiber;
+}
+
+/*!
+ * \brief Set the deadline of a fiber returned by #zth_async.
+ * \details This is a manipulator that calls #zth::Worker::setDeadline().
+ * \see zth::setStackSize() for an example
+ * \ingroup zth_api_cpp_fiber
+ */
+struct setDeadline : public FiberManipulator {
+	Timestamp deadline;
+
+	explicit setDeadline(Timestamp const& t) noexcept
+		: deadline(t)
+	{}
+};
+
+static inline Fiber& operator<<(Fiber& fiber, setDeadline const& m)
+{
+	currentWorker().setDeadline(fiber, m.deadline);
+	return fiber;
+}
+
+template <typename R>
+TypedFiber<R>& operator<<(TypedFiber<R>& fiber, setDeadline const& m)
+{
+	static_cast<Fiber&>(fiber) << m;
+	return fiber;
+}
+
+/*!
+ * \brief Add a fiber returned by #zth_async to a #zth::FiberGroup.
+ * \details This is a manipulator that calls #zth::Worker::setFiberGroup().
+ * \see zth::setStackSize() for an example
+ * \ingroup zth_api_cpp_fiber
+ */
+struct setFiberGroup : public FiberManipulator {
+	FiberGroup* group;
+
+	constexpr explicit setFiberGroup(FiberGroup& g) noexcept
+		: group(&g)
+	{}
+};
+
+static inline Fiber& operator<<(Fiber& fiber, setFiberGroup const& m)
+{
+	currentWorker().setFiberGroup(fiber, m.group);
+	return fiber;
+}
+
+template <typename R>
+TypedFiber<R>& operator<<(TypedFiber<R>& fiber, setFiberGroup const& m)
+{
+	static_cast<Fiber&>(fiber) << m;
 	return fiber;
 }
 
@@ -290,6 +407,39 @@ TypedFiber<R>& operator<<(TypedFiber<R>& fiber, passOnExit const& m)
 	return fiber;
 }
 
+/*!
+ * \brief Allows the fiber to be started by another Worker of the same #zth::WorkerGroup.
+ *
+ * This is a manipulator that calls #zth::Worker::share().  Use it for fibers that are
+ * independent of the Worker that creates them, such as fiber-per-request handlers.  Only the
+ * start of the fiber can be moved; once it ran, it stays on the Worker that started it.
+ * Example:
+ * \code
+ * void handle(int fd) { ... }
+ *
+ * void server() {
+ *     while(true)
+ *         zth::fiber(handle, accept(...)) << zth::stealable();
+ * }
+ * \endcode
+ *
+ * \ingroup zth_api_cpp_fiber
+ */
+struct stealable : public FiberManipulator {};
+
+static inline Fiber& operator<<(Fiber& fiber, stealable const&)
+{
+	currentWorker().share(fiber);
+	return fiber;
+}
+
+template <typename R>
+TypedFiber<R>& operator<<(TypedFiber<R>& fiber, stealable const& m)
+{
+	static_cast<Fiber&>(fiber) << m;
+	return fiber;
+}
+
 /*!
  * \brief Forces the fiber to have a future that outlives the fiber.
  *
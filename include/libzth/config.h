@@ -28,7 +28,7 @@
 namespace zth {
 
 struct Env {
-	enum { EnableDebugPrint, DoPerfEvent, PerfSyscall, CheckTimesliceOverrun };
+	enum { EnableDebugPrint, DoPerfEvent, PerfSyscall, CheckTimesliceOverrun, UseIoUring };
 };
 
 bool config(int env /* one of Env::* */, bool whenUnset);
@@ -138,24 +138,211 @@ struct DefaultConfig {
 
 	/*! \brief Default fiber stack size in bytes. */
 	static size_t const DefaultFiberStackSize = 0x20000;
+	/*!
+	 * \brief Default address space to reserve for a fiber stack.
+	 *
+	 * When larger than the fiber's stack size, the stack is mapped with this size without
+	 * reserving memory for it, and memory is committed only when the fiber touches it.  A
+	 * stack overflow hits a guard page, which is reported.  See #zth::Fiber::setStackReserve().
+	 */
+	static size_t const DefaultFiberStackReserve = 0;
 	/*! \brief When \c true, enable stack guards. */
 	static bool const EnableStackGuard = Debug;
 	/*! \brief When \c true, enable stack watermark to detect maximum stack usage. */
 	static bool const EnableStackWaterMark = Debug;
+	/*!
+	 * \brief Maximum number of stacks a Worker keeps for reuse by new fibers.
+	 *
+	 * The stack of a finished fiber is kept, including its guards, and handed out again
+	 * to a new fiber that requests a stack of the same size, rounded up to full pages.  Set
+	 * to 0 to allocate and free the stack of every fiber.
+	 */
+	static size_t const StackCacheHigh = 16;
+	/*!
+	 * \brief Number of cached stacks that keep their memory.
+	 *
+	 * When the Worker is idle, the OS may reclaim the memory of the other (least recently
+	 * used) stacks in the cache, until they are reused.
+	 */
+	static size_t const StackCacheLow = 4;
+	/*!
+	 * \brief Size of the stack that fibers of a Worker share.
+	 *
+	 * This is the maximum stack size of a fiber that runs on the shared stack.
+	 * See #zth::Fiber::setStackShared().
+	 */
+	static size_t const SharedStackSize = 0x100000;
 	/*! \brief Take POSIX signal into account when doing a context switch. */
 	static bool const ContextSignals = false;
 
+	/*! \brief Clock sources for #zth::Timestamp::now(). */
+	enum ClockSource {
+		/*! \brief \c clock_gettime(CLOCK_MONOTONIC). */
+		ClockMonotonic,
+		/*!
+		 * \brief The invariant time-stamp counter of x86-64 CPUs.
+		 *
+		 * It is calibrated against, and regularly synchronized with, #ClockMonotonic.
+		 * When the CPU does not have an invariant TSC, #ClockMonotonic is used instead.
+		 */
+		ClockTsc,
+		/*!
+		 * \brief \c CLOCK_MONOTONIC_COARSE, where available.
+		 *
+		 * It is the cheapest to read, but it is only updated every scheduler tick of the
+		 * OS, which is typically 1-4 ms, and it may lag even more after the CPU was idle.
+		 * Time slices and timeouts are rounded accordingly.
+		 */
+		ClockCoarse,
+	};
+	/*! \brief The clock used by #zth::Timestamp::now(), and therefore by the scheduler. */
+	static ClockSource const Clock = ClockMonotonic;
+
 	/*! \brief Minimum time slice before zth::yield() actually yields. */
 	constexpr static struct timespec MinTimeslice()
 	{
 		ZTH_CONSTEXPR_RETURN(struct timespec, 0, 100000)
 	}
+	/*!
+	 * \brief Let a helper thread end the time slices, instead of reading the clock at every
+	 *	zth::yield().
+	 *
+	 * The thread advances #zth::timeslice_tick every half #MinTimeslice(), while any Worker
+	 * is busy.  zth::yield() without explicit timestamp then only checks whether this counter
+	 * advanced twice since the fiber got scheduled.  A time slice is therefore between half
+	 * and one #MinTimeslice().  Without thread support, the clock is read as usual.
+	 */
+	static bool const TimesliceTick = false;
+	/*!
+	 * \brief Timer slack of the Worker threads, or 0 to keep the default of the OS.
+	 *
+	 * Linux lets a sleeping thread wake up later than requested, by 50 us by default, to
+	 * combine wakeups.  A lower slack makes #zth::nap() more precise, at the cost of more
+	 * wakeups of the CPU.  Only supported on Linux.  By default, the slack of the thread is
+	 * left alone; set it to for example 1 us for precise control loops.
+	 */
+	constexpr static struct timespec TimerSlack()
+	{
+		ZTH_CONSTEXPR_RETURN(struct timespec, 0, 0)
+	}
+	/*!
+	 * \brief Time before a timeout at which the #zth::Waiter stops sleeping, and spins.
+	 *
+	 * Even with a low #TimerSlack(), the OS wakes up a thread somewhat late.  Spinning for the
+	 * last part makes timeouts more precise, at the cost of CPU time.  The default of 0 sleeps
+	 * till the timeout.  About 50 us brings the mean lateness of a #zth::nap() down to about
+	 * 10 us on a typical Linux machine, but triples the CPU load of a periodic fiber.
+	 */
+	constexpr static struct timespec WaiterSpin()
+	{
+		ZTH_CONSTEXPR_RETURN(struct timespec, 0, 0)
+	}
 	/*! \brief Print an overrun reported when this timeslice is exceeded. */
 	constexpr static struct timespec TimesliceOverrunReportThreshold()
 	{
 		ZTH_CONSTEXPR_RETURN(struct timespec, 0, 10000000)
 	}
 
+	/*!
+	 * \brief Number of fiber priority levels; at most 31.
+	 *
+	 * A Worker has a round-robin run queue per level, and always runs a fiber of the
+	 * highest non-empty one.  The default of 1 disables priorities, which keeps the scheduler
+	 * as cheap as a single run queue.  For example, set to 8 to use them.
+	 * \see #zth::Worker::setPriority()
+	 */
+	static unsigned int const PriorityLevels = 1;
+	/*!
+	 * \brief Priority of new fibers, and of the #zth::Waiter.
+	 *
+	 * As the Waiter handles timeouts and polling, fibers with a higher priority should not
+	 * keep running without blocking.
+	 */
+	static unsigned int const DefaultPriority = PriorityLevels / 2;
+	/*!
+	 * \brief Let a fiber that holds a #zth::Mutex inherit the priority of the fibers that wait
+	 *	for it.
+	 *
+	 * This only has effect when there are multiple #PriorityLevels.  It is off by default, as
+	 * it makes locking and unlocking a contended Mutex more expensive.
+	 */
+	static bool const PriorityInheritance = false;
+	/*! \brief Number of wait queues of #zth::wait_on() per Worker; a power of 2. */
+	static size_t const WaitOnBuckets = 64;
+	/*!
+	 * \brief Maximum number of direct handoffs in a row, before the run queue gets its turn.
+	 * \see #zth::Worker::handoff()
+	 */
+	static unsigned int const HandoffLimit = 16;
+	/*!
+	 * \brief Period over which the quota of a #zth::FiberGroup is accounted.
+	 * \see #zth::FiberGroup::setQuota()
+	 */
+	constexpr static struct timespec FairSharePeriod()
+	{
+		ZTH_CONSTEXPR_RETURN(struct timespec, 0, 100000000)
+	}
+
+	/*! \brief Maximum number of Workers that can join one #zth::WorkerGroup. */
+	static size_t const WorkerGroupMaxSize = 64;
+	/*! \brief Capacity of the per-Worker queue of a #zth::WorkerGroup; a power of 2. */
+	static size_t const WorkerGroupQueueSize = 256;
+	/*! \brief A busy Worker takes back one of its shared fibers every N schedules. */
+	static unsigned int const WorkerGroupOwnerInterval = 16;
+	/*!
+	 * \brief Interval at which an idle Worker checks its #zth::WorkerGroup for work.
+	 *
+	 * This is only used when the Worker cannot be woken up by the group, which is when the
+	 * platform does not have an \c eventfd or pipe to interrupt its sleep.
+	 */
+	constexpr static struct timespec WorkerGroupIdlePoll()
+	{
+		ZTH_CONSTEXPR_RETURN(struct timespec, 0, 100000)
+	}
+
+	/*!
+	 * \brief Let the #zth::Waiter use a #zth::TimerWheel, instead of a sorted list.
+	 *
+	 * This makes starting and cancelling timers O(1), which pays off when there are
+	 * many sleeping fibers.
+	 */
+	static bool const WaiterTimerWheel = false;
+	/*! \brief Tick resolution of the #zth::TimerWheel. */
+	constexpr static struct timespec TimerWheelTick()
+	{
+		ZTH_CONSTEXPR_RETURN(struct timespec, 0, 1000000)
+	}
+
+	/*!
+	 * \brief Scheduling rounds between non-blocking polls by the #zth::Waiter of a busy Worker.
+	 *
+	 * While other fibers are runnable, the Waiter only polls once in a while.  Every such
+	 * poll that does not return an event doubles the number of rounds till the next one, up
+	 * to #WaiterPollMaxRounds.  A poll with events resets it.  Set both to 1 to poll every
+	 * round.
+	 */
+	static unsigned int const WaiterPollMinRounds = 1;
+	/*! \brief Upper bound of the back-off of #WaiterPollMinRounds. */
+	static unsigned int const WaiterPollMaxRounds = 64;
+	/*! \brief Maximum time between non-blocking polls by the #zth::Waiter of a busy Worker. */
+	constexpr static struct timespec WaiterPollMaxInterval()
+	{
+		ZTH_CONSTEXPR_RETURN(struct timespec, 0, 1000000)
+	}
+
+	/*! \brief Number of file descriptors for which #zth::io caches their capabilities. */
+	static size_t const IoFdCacheSize = 4096;
+
+	/*!
+	 * \brief Let the #zth::Waiter use io_uring for polling and #zth::io, when available.
+	 *
+	 * When the kernel does not support it, the default poller is used instead.  Can be
+	 * overridden by the \c ZTH_CONFIG_USE_IO_URING environment variable.
+	 */
+	static bool const UseIoUring = false;
+	/*! \brief Number of submission queue entries of the io_uring of a #zth::Waiter. */
+	static unsigned int const IoUringEntries = 256;
+
 	/*! \brief Check time slice overrun at every context switch. */
 	static bool const CheckTimesliceOverrun = Debug;
 	/*! \brief Save names for all #zth::Synchronizer instances. */
@@ -72,15 +72,21 @@ struct ContextAttr {
 
 	constexpr explicit ContextAttr(
 		Entry entry_ = nullptr, EntryArg arg_ = EntryArg(),
-		size_t stackSize_ = Config::DefaultFiberStackSize) noexcept
+		size_t stackSize_ = Config::DefaultFiberStackSize,
+		size_t stackReserve_ = Config::DefaultFiberStackReserve,
+		bool stackShared_ = false) noexcept
 		: entry(entry_)
 		, arg(arg_)
 		, stackSize(stackSize_)
+		, stackReserve(stackReserve_)
+		, stackShared(stackShared_)
 	{}
 
 	Entry entry;
 	EntryArg arg;
 	size_t stackSize;
+	size_t stackReserve;
+	bool stackShared;
 };
 
 /*!
@@ -113,6 +119,30 @@ void context_switch(Context* from, Context* to) noexcept;
 void context_destroy(Context* context) noexcept;
 size_t context_stack_usage(Context* context) noexcept;
 
+/*!
+ * \brief Statistics of the stack cache of the current thread.
+ * \see #zth::stack_cache_stats()
+ * \ingroup zth_api_cpp_stack
+ */
+struct StackCacheStats {
+	/*! \brief Number of stacks that were reused from the cache. */
+	size_t hits;
+	/*! \brief Number of stacks that had to be allocated. */
+	size_t misses;
+	/*! \brief Number of stacks that were freed, as the cache was full. */
+	size_t evictions;
+	/*! \brief Number of cached stacks of which the memory was handed back to the OS. */
+	size_t releases;
+	/*! \brief Number of stacks currently in the cache. */
+	size_t cached;
+};
+
+StackCacheStats stack_cache_stats() noexcept;
+void stack_cache_trim() noexcept;
+void stack_cache_flush() noexcept;
+
+bool stack_shared_contains(void const* p) noexcept;
+
 void stack_watermark_init(void* stack, size_t size) noexcept;
 size_t stack_watermark_size(void* stack) noexcept;
 size_t stack_watermark_maxused(void* stack) noexcept;
@@ -67,15 +67,15 @@ public:
 		// executed on the fiber stack, but on the MSP.
 		size += MINSIGSTKSZ;
 #  endif
-		if(Config::EnableStackGuard) {
 #  if defined(ZTH_HAVE_MMAN)
+		if(impl().stackGuarded())
 			// Both ends of the stack are guarded using mprotect().
 			size += impl().pageSize() * 2U;
 #  elif defined(ZTH_ARM_DO_STACK_GUARD)
+		if(Config::EnableStackGuard)
 			// Only the end of the stack is protected using MPU.
 			size += impl().pageSize();
 #  endif
-		}
 
 		return size;
 	}
@@ -35,6 +35,9 @@
 #    ifndef MAP_STACK
 #      define MAP_STACK 0
 #    endif
+#    ifndef MAP_NORESERVE
+#      define MAP_NORESERVE 0
+#    endif
 #  endif
 
 #  ifdef ZTH_HAVE_VALGRIND
@@ -42,10 +45,14 @@
 #  endif
 
 #  ifdef ZTH_ENABLE_ASAN
+#    include <sanitizer/asan_interface.h>
 #    include <sanitizer/common_interface_defs.h>
 #  endif
 
 namespace zth {
+
+int stack_overflow_init() noexcept;
+
 namespace impl {
 
 /*!
@@ -70,6 +77,8 @@ class ContextBase {
 protected:
 	constexpr explicit ContextBase(ContextAttr const& attr) noexcept
 		: m_attr(attr)
+		, m_sharedSp()
+		, m_sharedSaved()
 #  ifdef ZTH_ENABLE_ASAN
 		, m_alive(true)
 #  endif
@@ -137,7 +146,22 @@ public:
 	{
 		int res = 0;
 
-		m_stack = Stack(attr().stackSize);
+#  ifdef ZTH_ENABLE_ASAN
+		m_alive = true;
+#  endif
+
+		if(m_stack.p) {
+			// Recycled context, or one on a shared stack. The stack and its guards are
+			// still in place.
+			if(impl().stackShared())
+				return 0;
+			if(!impl().stackReserved())
+				stack_watermark_init(m_stackUsable.p, m_stackUsable.size);
+			impl().valgrindRegister();
+			return 0;
+		}
+
+		m_stack = Stack(impl().stackReserved() ? attr().stackReserve : attr().stackSize);
 		m_stackUsable = Stack();
 
 		if(attr().stackSize == 0)
@@ -165,12 +189,76 @@ public:
 	 */
 	void destroy() noexcept
 	{
+		if(impl().stackShared()) {
+			// The stack is not ours.
+			if(m_sharedSave.p)
+				deallocate(m_sharedSave.p, m_sharedSave.size);
+			m_sharedSave = Stack();
+			m_sharedSaved = 0;
+			m_stackUsable = m_stack = Stack();
+			return;
+		}
+
 		impl().stackGuardDeinit();
 		impl().valgrindDeregister();
+#  ifdef ZTH_ENABLE_ASAN
+		// Do not leave the redzones of the frames behind, as the memory may be reused by
+		// another stack.
+		if(m_stackUsable.p)
+			ASAN_UNPOISON_MEMORY_REGION(m_stackUsable.p, m_stackUsable.size);
+#  endif
 		impl().deinitStack(m_stack);
 		m_stackUsable = m_stack = Stack();
 	}
 
+	/*!
+	 * \brief Prepare a context that has finished for reuse by a next #create().
+	 *
+	 * Unlike #destroy(), the stack and its guards are kept.
+	 *
+	 * \return \c true when the context can be reused, otherwise it should be destroyed
+	 */
+	bool recycle() noexcept
+	{
+		if(!m_stack.p || impl().stackShared())
+			return false;
+
+		impl().valgrindDeregister();
+#  ifdef ZTH_ENABLE_ASAN
+		// Frames of the finished fiber may have left poisoned redzones behind.
+		ASAN_UNPOISON_MEMORY_REGION(m_stackUsable.p, m_stackUsable.size);
+#  endif
+#  ifdef ZTH_HAVE_MMAN
+		if(impl().stackReserved()) {
+			// Shrink the stack to its normal size, in case it has grown.
+			size_t const ps = impl().pageSize();
+			size_t keep = (attr().stackSize + ps - 1U) & ~(ps - 1U);
+			if(keep < m_stackUsable.size)
+				madvise(m_stackUsable.p, m_stackUsable.size - keep, MADV_DONTNEED);
+		}
+#  endif
+		return true;
+	}
+
+	/*!
+	 * \brief Let the OS reclaim the memory of the stack of a recycled context.
+	 *
+	 * The mapping and guards are kept. The pages are faulted in again when reused.
+	 */
+	void releaseStack() noexcept
+	{
+#  ifdef ZTH_HAVE_MMAN
+		if(!m_stackUsable.p)
+			return;
+
+#    ifdef MADV_FREE
+		madvise(m_stackUsable.p, m_stackUsable.size, MADV_FREE);
+#    else
+		madvise(m_stackUsable.p, m_stackUsable.size, MADV_DONTNEED);
+#    endif
+#  endif
+	}
+
 	/*!
 	 * \brief Allocate and initialize stack.
 	 */
@@ -194,7 +282,9 @@ public:
 		usable = stack;
 		impl().stackAlign(usable);
 
-		stack_watermark_init(usable.p, usable.size);
+		if(!impl().stackReserved())
+			// Initializing the watermark would commit the whole reservation.
+			stack_watermark_init(usable.p, usable.size);
 		return 0;
 	}
 
@@ -206,6 +296,147 @@ public:
 		impl().deallocStack(stack);
 	}
 
+	/*!
+	 * \brief Check if the stack is a lazily committed reservation.
+	 * \see #zth::Fiber::setStackReserve()
+	 */
+	bool stackReserved() const noexcept
+	{
+		return attr().stackSize > 0 && attr().stackReserve > attr().stackSize;
+	}
+
+	/*!
+	 * \brief Check if the context runs on the shared stack of its Worker.
+	 * \see #zth::Fiber::setStackShared()
+	 */
+	bool stackShared() const noexcept
+	{
+		return attr().stackShared;
+	}
+
+	/*!
+	 * \brief Let this context run on the given shared stack.
+	 *
+	 * The stack is owned by another context.  Call #create() only when the stack is not in use
+	 * by another context.
+	 */
+	void stackShare(Stack const& stack, Stack const& usable) noexcept
+	{
+		zth_assert(impl().stackShared());
+		m_stack = stack;
+		m_stackUsable = usable;
+	}
+
+	/*!
+	 * \brief Return the stack pointer of a suspended context, or \c nullptr when unknown.
+	 */
+	void* stackPointer() const noexcept
+	{
+		return nullptr;
+	}
+
+	/*!
+	 * \brief Record the stack pointer of a context on a shared stack, which is about to suspend.
+	 *
+	 * The given \p sp is only used to check if the context has been suspended before; the
+	 * frames are saved from #stackPointer().
+	 */
+	void stackSuspend(void* sp) noexcept
+	{
+		m_sharedSp = static_cast<char*>(sp);
+	}
+
+	/*!
+	 * \brief Check if the context on a shared stack has been suspended before.
+	 *
+	 * If not, it has not been created yet.
+	 */
+	bool stackSuspended() const noexcept
+	{
+		return m_sharedSp != nullptr;
+	}
+
+	/*!
+	 * \brief Copy the used part of the shared stack of a suspended context to its own buffer.
+	 * \return 0 on success, otherwise an errno
+	 */
+	int stackSave() noexcept
+	{
+		zth_assert(impl().stackShared());
+		zth_assert(impl().stackSuspended());
+
+		char* top = m_stackUsable.p + m_stackUsable.size;
+		char* sp = static_cast<char*>(impl().stackPointer());
+		if(unlikely(!sp))
+			// See ZTH_HAVE_STACK_SHARED.
+			return ENOTSUP;
+		if(sp < m_stackUsable.p)
+			sp = m_stackUsable.p;
+
+		size_t size = (size_t)(top - sp);
+		if(size > m_sharedSave.size || size < m_sharedSave.size / 4U) {
+			// Keep the buffer proportional to the stack depth.
+			size_t capacity = (size + 63U) & ~(size_t)63U;
+			char* p = allocate_noexcept<char>(capacity);
+			if(unlikely(!p))
+				return ENOMEM;
+
+			if(m_sharedSave.p)
+				deallocate(m_sharedSave.p, m_sharedSave.size);
+			m_sharedSave = Stack(p, capacity);
+		}
+
+#  ifdef ZTH_ENABLE_ASAN
+		// Drop the redzones of the frames, as the stack is going to be reused.
+		ASAN_UNPOISON_MEMORY_REGION(sp, size);
+#  endif
+		memcpy(m_sharedSave.p, sp, size);
+		m_sharedSaved = size;
+		return 0;
+	}
+
+	/*!
+	 * \brief Copy the frames, saved by #stackSave(), back to the shared stack.
+	 */
+	void stackRestore() noexcept
+	{
+		zth_assert(impl().stackShared());
+		memcpy(m_stackUsable.p + m_stackUsable.size - m_sharedSaved, m_sharedSave.p,
+		       m_sharedSaved);
+	}
+
+	/*!
+	 * \brief Return the number of bytes of the shared stack saved by #stackSave().
+	 */
+	size_t stackSaved() const noexcept
+	{
+		return m_sharedSaved;
+	}
+
+	/*!
+	 * \brief Check if the stack has a guard page at both ends.
+	 */
+	bool stackGuarded() const noexcept
+	{
+#  ifdef ZTH_HAVE_MMAN
+		return Config::EnableStackGuard || impl().stackReserved();
+#  else
+		return false;
+#  endif
+	}
+
+	/*!
+	 * \brief Check if the given address is within the guard page below the stack.
+	 */
+	bool stackOverflow(void const* addr) const noexcept
+	{
+		if(!m_stackUsable.p || !impl().stackGuarded())
+			return false;
+
+		char const* a = static_cast<char const*>(addr);
+		return a < m_stackUsable.p && a >= m_stackUsable.p - impl().pageSize();
+	}
+
 	/*!
 	 * \brief Get system's page size.
 	 */
@@ -245,11 +476,9 @@ public:
 		size += MINSIGSTKSZ;
 #  endif
 
-#  ifdef ZTH_HAVE_MMAN
-		if(Config::EnableStackGuard)
+		if(impl().stackGuarded())
 			// Both ends of the stack are guarded using mprotect().
 			size += impl().pageSize() * 2;
-#  endif
 
 		return size;
 	}
@@ -266,10 +495,14 @@ public:
 		void* p = nullptr;
 
 #  ifdef ZTH_HAVE_MMAN
+		// Pages are committed when touched, but without MAP_NORESERVE, the
+		// whole size is accounted for when the system does not overcommit.
 		// NOLINTNEXTLINE(hicpp-signed-bitwise,cppcoreguidelines-pro-type-cstyle-cast)
 		p =
 			mmap(nullptr, size, PROT_READ | PROT_WRITE,
-			     MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+			     MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK
+				     | (impl().stackReserved() ? MAP_NORESERVE : 0),
+			     -1, 0);
 
 		if(unlikely(p == MAP_FAILED))
 			return nullptr;
@@ -322,14 +555,12 @@ public:
 		uintptr_t stack_new = ((uintptr_t)(stack_old + ps - 1U) & ~(ps - 1U));
 		stack.size = (stack.size - (stack_new - stack_old)) & ~(ps - 1U);
 
-#  ifdef ZTH_HAVE_MMAN
-		if(Config::EnableStackGuard) {
+		if(impl().stackGuarded()) {
 			// Do not use the pages at both sides.
 			zth_assert(stack.size > ps * 2U);
 			stack_new += ps;
 			stack.size -= ps * 2U;
 		}
-#  endif
 
 		zth_assert(stack.size > 0);
 		stack.p = reinterpret_cast<char*>(stack_new); // NOLINT
@@ -370,7 +601,7 @@ public:
 	int stackGuardInit() noexcept
 	{
 #  ifdef ZTH_HAVE_MMAN
-		if(Config::EnableStackGuard) {
+		if(impl().stackGuarded()) {
 			if(!m_stackUsable.p)
 				return 0;
 
@@ -380,6 +611,10 @@ public:
 				return errno;
 			if(unlikely(mprotect(m_stackUsable.p + m_stackUsable.size, ps, PROT_NONE)))
 				return errno;
+
+			if(impl().stackReserved())
+				// Report hitting the guard, instead of just crashing.
+				return stack_overflow_init();
 		}
 #  endif
 		return 0;
@@ -518,6 +753,12 @@ private:
 	Stack m_stack;
 	/*! \brief Actually used stack memory, within #m_stack. */
 	Stack m_stackUsable;
+	/*! \brief Stack pointer when last suspended, when running on a shared stack. */
+	char* m_sharedSp;
+	/*! \brief Buffer that holds the frames while another context uses the shared stack. */
+	Stack m_sharedSave;
+	/*! \brief Number of bytes in #m_sharedSave. */
+	size_t m_sharedSaved;
 #  ifdef ZTH_USE_VALGRIND
 	/*! \brief valgrind ID of this context's stack. */
 	unsigned int m_valgrind_stack_id;
@@ -548,6 +789,8 @@ extern "C" void context_entry(zth::Context* context) noexcept __attribute__((nor
 #    include "libzth/context/sjlj.h"
 #  elif defined(ZTH_CONTEXT_UCONTEXT)
 #    include "libzth/context/ucontext.h"
+#  elif defined(ZTH_CONTEXT_NATIVE)
+#    include "libzth/context/native.h"
 #  elif defined(ZTH_CONTEXT_WINFIBER)
 #    include "libzth/context/winfiber.h"
 #  else
@@ -0,0 +1,261 @@
+#ifndef ZTH_CONTEXT_NATIVE_H
+#define ZTH_CONTEXT_NATIVE_H
+/*
+ * SPDX-FileCopyrightText: 2019-2026 Jochem Rutgers
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef ZTH_CONTEXT_CONTEXT_H
+#  error This file must be included by libzth/context/context.h.
+#endif
+
+#ifdef __cplusplus
+
+#  include <csignal>
+#  include <cstring>
+
+#  if !defined(__x86_64__) && !defined(__aarch64__)
+#    error Native context switching is only implemented for x86-64 and AArch64.
+#  endif
+
+#  if defined(__x86_64__) && defined(__CET__) && (__CET__ & 1)
+#    define ZTH_CONTEXT_NATIVE_LANDING "endbr64\n\t"
+#  elif defined(__aarch64__) && defined(__ARM_FEATURE_BTI_DEFAULT) \
+	  && __ARM_FEATURE_BTI_DEFAULT
+#    define ZTH_CONTEXT_NATIVE_LANDING "bti j\n\t"
+#  else
+#    define ZTH_CONTEXT_NATIVE_LANDING
+#  endif
+
+#  ifdef __AVX512F__
+#    define ZTH_CONTEXT_NATIVE_CLOBBER_AVX512                                                   \
+	    , "xmm16", "xmm17", "xmm18", "xmm19", "xmm20", "xmm21", "xmm22", "xmm23", "xmm24",   \
+		    "xmm25", "xmm26", "xmm27", "xmm28", "xmm29", "xmm30", "xmm31", "k1", "k2", \
+		    "k3", "k4", "k5", "k6", "k7"
+#  else
+#    define ZTH_CONTEXT_NATIVE_CLOBBER_AVX512
+#  endif
+
+namespace zth {
+
+/*!
+ * \brief Context switching by a few lines of assembly.
+ *
+ * A context switch is a function call, so only the callee-saved registers have to be saved.
+ * The inline assembly below clobbers all other registers, such that the compiler only saves
+ * what the caller actually uses.  The frame pointer, resume address, an argument slot, and the
+ * floating-point control registers are pushed on the stack of the context, after which only the
+ * stack pointer has to be switched.
+ *
+ * A new context starts at #context_trampoline(), which gets the context as first argument, and
+ * the context that switched to it as second.
+ */
+class Context : public impl::ContextArch<Context> {
+	ZTH_CLASS_NEW_DELETE(Context)
+public:
+	typedef impl::ContextArch<Context> base;
+
+	constexpr explicit Context(ContextAttr const& attr) noexcept
+		: base(attr)
+		, m_sp()
+		, m_mask()
+	{}
+
+private:
+	static void context_trampoline(Context* context, Context* from) noexcept
+	{
+#  ifdef ZTH_ENABLE_ASAN
+		void const* oldstack = nullptr;
+		size_t oldsize = 0;
+		__sanitizer_finish_switch_fiber(nullptr, &oldstack, &oldsize);
+
+		if(!from->stack()) {
+			// We came from the Worker, which runs on the thread's stack.
+			Stack& workerStack = currentWorker().workerStack();
+			if(unlikely(!workerStack))
+				workerStack = Stack((void*)oldstack, oldsize);
+		}
+#  else
+		(void)from;
+#  endif
+
+		context_entry(context);
+	}
+
+public:
+	// cppcheck-suppress duplInheritedMember
+	int create() noexcept
+	{
+		int res = base::create();
+		if(unlikely(res))
+			return res;
+
+		if(Config::ContextSignals)
+			if(unlikely((res = pthread_sigmask(0, nullptr, &m_mask))))
+				return res;
+
+		if(unlikely(!stack()))
+			// Stackless fiber only saves current context; nothing to do.
+			return 0;
+
+		Stack const& stack_ = stackUsable();
+		uintptr_t top =
+			reinterpret_cast<uintptr_t>(stack_.p + stack_.size) & ~(uintptr_t)15U;
+		void** sp_ = reinterpret_cast<void**>(top); // NOLINT
+
+		// Mimic the frame as pushed by context_switch(), such that switching to this
+		// context jumps to context_trampoline(this).
+#  if defined(__x86_64__)
+		uint32_t fpc[2] = {};
+		__asm__ volatile("stmxcsr %0\n\t"
+				 "fnstcw %1\n\t"
+				 : "=m"(fpc[0]), "=m"(fpc[1]));
+
+		*--sp_ = nullptr; // return address of context_trampoline()
+		*--sp_ = this;
+		*--sp_ = reinterpret_cast<void*>(&context_trampoline);
+		--sp_;
+		memcpy(sp_, fpc, sizeof(void*));
+#  elif defined(__aarch64__)
+		uint64_t fpcr = 0;
+		__asm__ volatile("mrs %0, fpcr\n\t" : "=r"(fpcr));
+
+		*--sp_ = this;
+		*--sp_ = reinterpret_cast<void*>(fpcr);
+		*--sp_ = reinterpret_cast<void*>(&context_trampoline);
+		*--sp_ = nullptr; // frame pointer
+#  endif
+
+		m_sp = sp_;
+		return 0;
+	}
+
+	// cppcheck-suppress duplInheritedMember
+	void* stackPointer() const noexcept
+	{
+		return m_sp;
+	}
+
+	// cppcheck-suppress duplInheritedMember
+	void context_switch(Context& to) noexcept
+	{
+		if(Config::ContextSignals)
+			pthread_sigmask(SIG_SETMASK, &to.m_mask, &m_mask);
+
+#  ifdef ZTH_ENABLE_ASAN
+		zth_assert(to.alive());
+		void* fake_stack = nullptr;
+
+		Stack const* stack = &to.stackUsable();
+		if(unlikely(!*stack))
+			stack = &currentWorker().workerStack();
+
+		__sanitizer_start_switch_fiber(
+			alive() ? &fake_stack : nullptr, stack->p, stack->size);
+#  endif
+
+		switch_sp(&m_sp, this, &to.m_sp);
+
+#  ifdef ZTH_ENABLE_ASAN
+		__sanitizer_finish_switch_fiber(fake_stack, nullptr, nullptr);
+#  endif
+	}
+
+private:
+	/*!
+	 * \brief Save the current context to \p save, and resume the one at \p load.
+	 * \param from passed as second argument to #context_trampoline()
+	 */
+	__attribute__((always_inline)) static void
+	switch_sp(void** save, Context* from, void** load) noexcept
+	{
+#  if defined(__x86_64__)
+		__asm__ volatile(
+			// Skip the red zone, which may be in use by the caller.
+			"leaq -128(%%rsp), %%rsp\n\t"
+			"pushq %%rbp\n\t"
+			"pushq %%rbp\n\t" // argument slot; unused
+			"leaq 1f(%%rip), %%rax\n\t"
+			"pushq %%rax\n\t"
+			"pushq $0\n\t"
+			"stmxcsr (%%rsp)\n\t"
+			"fnstcw 4(%%rsp)\n\t"
+			"movq %%rsp, (%0)\n\t"
+			"movq %%rsp, %%rcx\n\t"
+			// Switch.
+			"movq (%2), %%rsp\n\t"
+			// Loading the control registers is slow, and they hardly ever change.
+			"movq (%%rsp), %%rax\n\t"
+			"cmpq (%%rcx), %%rax\n\t"
+			"je 2f\n\t"
+			"ldmxcsr (%%rsp)\n\t"
+			"fldcw 4(%%rsp)\n\t"
+			"2:\n\t"
+			"leaq 8(%%rsp), %%rsp\n\t"
+			"popq %%rax\n\t"
+			"popq %%rdi\n\t"
+			"jmpq *%%rax\n\t"
+			// Resume.
+			"1:\n\t" ZTH_CONTEXT_NATIVE_LANDING
+			"popq %%rbp\n\t"
+			"leaq 128(%%rsp), %%rsp\n\t"
+			: "+D"(save), "+S"(from), "+d"(load)
+			:
+			: "rax", "rbx", "rcx", "r8", "r9", "r10", "r11", "r12", "r13", "r14",
+			  "r15", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+			  "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15",
+			  "st", "st(1)", "st(2)", "st(3)", "st(4)", "st(5)", "st(6)", "st(7)",
+			  "mm0", "mm1", "mm2", "mm3", "mm4", "mm5", "mm6", "mm7", "memory",
+			  "cc" ZTH_CONTEXT_NATIVE_CLOBBER_AVX512);
+#  elif defined(__aarch64__)
+		register void** save_ __asm__("x3") = save;
+		register Context* from_ __asm__("x1") = from;
+		register void** load_ __asm__("x2") = load;
+
+		__asm__ volatile(
+			"sub sp, sp, #32\n\t"
+			"adr x16, 1f\n\t"
+			"mrs x15, fpcr\n\t"
+			"stp x29, x16, [sp]\n\t"
+			"str x15, [sp, #16]\n\t"
+			"mov x17, sp\n\t"
+			"str x17, [%0]\n\t"
+			// Switch.
+			"ldr x17, [%2]\n\t"
+			"mov sp, x17\n\t"
+			"ldp x29, x16, [sp]\n\t"
+			"ldp x17, x0, [sp, #16]\n\t"
+			// Writing the control register is slow, and it hardly ever changes.
+			"cmp x17, x15\n\t"
+			"b.eq 2f\n\t"
+			"msr fpcr, x17\n\t"
+			"2:\n\t"
+			"add sp, sp, #32\n\t"
+			"br x16\n\t"
+			// Resume.
+			"1:\n\t" ZTH_CONTEXT_NATIVE_LANDING
+			: "+r"(save_), "+r"(from_), "+r"(load_)
+			:
+			: "x0", "x4", "x5", "x6", "x7", "x8", "x9", "x10", "x11", "x12", "x13",
+			  "x14", "x15", "x16", "x17", "x19", "x20", "x21", "x22", "x23", "x24",
+			  "x25", "x26", "x27", "x28", "x30", "v0", "v1", "v2", "v3", "v4", "v5",
+			  "v6", "v7", "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15", "v16",
+			  "v17", "v18", "v19", "v20", "v21", "v22", "v23", "v24", "v25", "v26",
+			  "v27", "v28", "v29", "v30", "v31", "memory", "cc");
+#  endif
+	}
+
+private:
+	/*! \brief Saved stack pointer, while not running. */
+	void* m_sp;
+	/*! \brief Saved signal mask, when #zth::Config::ContextSignals is set. */
+	sigset_t m_mask;
+};
+
+} // namespace zth
+
+#  undef ZTH_CONTEXT_NATIVE_LANDING
+#  undef ZTH_CONTEXT_NATIVE_CLOBBER_AVX512
+#endif // __cplusplus
+#endif // ZTH_CONTEXT_NATIVE_H
@@ -23,6 +23,7 @@
 #  include <libzth/sync.h>
 
 #  include <coroutine>
+#  include <optional>
 
 namespace zth {
 namespace coro {
@@ -171,6 +172,42 @@ static inline decltype(auto) awaitable(zth::Mailbox<T>& mailbox) noexcept
 	return impl{mailbox};
 }
 
+/*!
+ * \brief Awaits a value from a channel.
+ *
+ * The result is \c std::nullopt when the channel is closed and empty.
+ */
+template <typename T, size_t N>
+static inline decltype(auto) awaitable(zth::Channel<T, N>& channel) noexcept
+{
+	struct impl {
+		zth::Channel<T, N>& channel;
+
+		char const* id_str() const noexcept
+		{
+			return channel.id_str();
+		}
+
+		bool await_ready() const noexcept
+		{
+			return true;
+		}
+
+		void await_suspend(std::coroutine_handle<> UNUSED_PAR(h)) noexcept {}
+
+		std::optional<T> await_resume() const
+		{
+			T value{};
+			if(!channel.take(value))
+				return std::nullopt;
+
+			return value;
+		}
+	};
+
+	return impl{channel};
+}
+
 static inline decltype(auto) awaitable(zth::Gate& gate) noexcept
 {
 	struct impl {
@@ -37,6 +37,177 @@
 
 namespace zth {
 
+/*!
+ * \brief Counter that a helper thread advances every half #zth::Config::MinTimeslice().
+ *
+ * It only advances while a Worker is busy, and it is 0 when the helper thread is not running.
+ * \see #zth::Config::TimesliceTick
+ */
+ZTH_EXPORT extern unsigned int timeslice_tick;
+
+/*!
+ * \brief A group of fibers that share the CPU time of their Worker.
+ *
+ * Groups with runnable fibers share the time of the Worker in proportion to their weight, like
+ * the virtual runtime of Linux' CFS.  Within a priority level, the groups together take one turn
+ * in the round-robin of the fibers without a group.  Such a turn goes to the group that is
+ * furthest behind.  A quota also limits the fraction of every #zth::Config::FairSharePeriod() a
+ * group gets, while others are runnable.
+ *
+ * All fibers of a group must run on the same Worker, and the group must outlive them.
+ *
+ * \see #zth::Worker::setFiberGroup()
+ * \ingroup zth_api_cpp_fiber
+ */
+class FiberGroup : public UniqueID<FiberGroup> {
+	ZTH_CLASS_NEW_DELETE(FiberGroup)
+	ZTH_CLASS_NOCOPY(FiberGroup)
+public:
+	explicit FiberGroup(char const* name = "zth::FiberGroup", unsigned int weight = 1)
+		: UniqueID(name)
+		, m_weight(weight ? weight : 1U)
+		, m_quota()
+		, m_vruntime()
+		, m_throttled()
+		, m_members()
+	{
+		for(size_t l = 0; l < sizeof(m_run) / sizeof(m_run[0]); l++)
+			m_run[l].group = this;
+	}
+
+	virtual ~FiberGroup() noexcept override
+	{
+		zth_assert(!m_members);
+	}
+
+	unsigned int weight() const noexcept
+	{
+		return m_weight;
+	}
+
+	/*!
+	 * \brief Set the relative share of this group.
+	 * \return 0 on success, otherwise an errno
+	 */
+	int setWeight(unsigned int weight) noexcept
+	{
+		if(!weight)
+			return EINVAL;
+
+		m_weight = weight;
+		return 0;
+	}
+
+	double quota() const noexcept
+	{
+		return m_quota;
+	}
+
+	/*!
+	 * \brief Set the fraction of every #zth::Config::FairSharePeriod() this group may use.
+	 * \param share between 0 and 1, where 0 disables the quota
+	 * \return 0 on success, otherwise an errno
+	 */
+	int setQuota(double share) noexcept
+	{
+		if(!(share >= 0 && share <= 1))
+			return EINVAL;
+
+		m_quota = share;
+		return 0;
+	}
+
+	/*! \brief Return the total time the fibers of this group have run. */
+	TimeInterval const& totalTime() const noexcept
+	{
+		return m_totalTime;
+	}
+
+	/*!
+	 * \brief Return how often the Worker passed over this group, as it got its share or used
+	 *	up its quota.
+	 */
+	unsigned int throttled() const noexcept
+	{
+		return m_throttled;
+	}
+
+	/*! \brief Return the number of fibers in this group. */
+	size_t size() const noexcept
+	{
+		return m_members;
+	}
+
+	/*! \brief Return the run time of this group, scaled by its weight. */
+	double vruntime() const noexcept
+	{
+		return m_vruntime;
+	}
+
+private:
+	void charge(TimeInterval const& dt) noexcept
+	{
+		m_totalTime += dt;
+		m_periodTime += dt;
+		m_vruntime += dt.s() / (double)m_weight;
+	}
+
+	/*!
+	 * \brief Check if the group used up its quota of the current period.
+	 * \details A new period starts when the previous one has ended.
+	 */
+	bool overQuota(Timestamp const& now) noexcept
+	{
+		if(m_quota <= 0)
+			return false;
+
+		if(m_periodEnd.isNull() || m_periodEnd < now) {
+			m_periodEnd = now + TimeInterval(Config::FairSharePeriod());
+			m_periodTime = TimeInterval();
+			return false;
+		}
+
+		return m_periodTime.s() > m_quota * TimeInterval(Config::FairSharePeriod()).s();
+	}
+
+	/*! \brief The runnable fibers of a group within one priority level of a RunQueue. */
+	struct Run : public Listable {
+		Run() noexcept
+			: group()
+			, vruntime()
+			, throttled()
+		{}
+
+		string str() const
+		{
+			return format("%s vruntime %g s", group->id_str(), vruntime);
+		}
+
+		FiberGroup* group;
+		List<Fiber> fibers;
+		// The vruntime of the group when this Run was sorted into the RunQueue.
+		double vruntime;
+		// Set when waiting for the next period of the quota.
+		bool throttled;
+	};
+
+private:
+	unsigned int m_weight;
+	double m_quota;
+	double m_vruntime;
+	TimeInterval m_totalTime;
+	TimeInterval m_periodTime;
+	Timestamp m_periodEnd;
+	unsigned int m_throttled;
+	// Number of fibers in this group.
+	size_t m_members;
+	Run m_run[Config::PriorityLevels];
+
+	friend class Fiber;
+	friend class RunQueue;
+	friend class Worker;
+};
+
 /*!
  * \brief The fiber.
  *
@@ -79,9 +250,18 @@ public:
 		, m_entry(entry)
 		, m_entryArg(arg)
 		, m_stackSize(Config::DefaultFiberStackSize)
+		, m_stackReserve(Config::DefaultFiberStackReserve)
+		, m_stackShared()
 		, m_context()
 		, m_fls()
 		, m_timeslice(Config::MinTimeslice())
+		, m_tick()
+		, m_priority(Config::DefaultPriority)
+		, m_inherited()
+		, m_runLevel(Config::PriorityLevels + 1U)
+		, m_locks()
+		, m_deadlineMisses()
+		, m_group()
 		, m_dtMax(Config::CheckTimesliceOverrun
 				  ? TimeInterval(Config::TimesliceOverrunReportThreshold())
 				  : TimeInterval())
@@ -97,6 +277,9 @@ public:
 		m_exit.once(*this);
 		m_cleanup.once(*this);
 
+		if(m_group)
+			m_group->m_members--;
+
 		if(state() > Uninitialized && state() < Dead)
 			kill();
 
@@ -127,6 +310,73 @@ public:
 		return m_stackSize;
 	}
 
+	/*!
+	 * \brief Reserve address space for the stack, such that it can grow beyond #stackSize().
+	 *
+	 * When \p size is larger than #stackSize(), the stack is mapped lazily: memory is only
+	 * committed when the fiber touches it.  Pages beyond #stackSize() are returned to the OS
+	 * when the stack is reused for another fiber.  Overflowing the reservation is reported.
+	 */
+	int setStackReserve(size_t size) noexcept
+	{
+		if(state() != New)
+			return EPERM;
+
+		m_stackReserve = size;
+		return 0;
+	}
+
+	size_t stackReserve() const noexcept
+	{
+		return m_stackReserve;
+	}
+
+	/*!
+	 * \brief Let the fiber run on the stack that is shared by the fibers of its Worker.
+	 *
+	 * Instead of having a stack of its own, the used part of the shared stack is copied to a
+	 * buffer of the fiber's size when another fiber on the shared stack is resumed, and
+	 * copied back when this fiber is resumed.  This saves memory for many fibers that are
+	 * mostly idle, at the cost of slower context switches.
+	 *
+	 * As the stack is reused, objects on it are only valid while the fiber runs.  So, the
+	 * fiber must not pass pointers to its stack to other fibers.  It may block by
+	 * #zth::yield(), #zth::nap(), #zth::suspend(), and untimed waits for a #zth::Mutex,
+	 * #zth::Semaphore, #zth::Signal, #zth::Future, or #zth::Gate, but not by other
+	 * functions of the #zth::Waiter, such as timed waits, #zth::waitUntil(), and #zth::io.
+	 *
+	 * The stack size is #zth::Config::SharedStackSize, regardless of #setStackSize().
+	 *
+	 * A shared stack is only supported by the native context switch implementation.
+	 *
+	 * \return 0 on success, \c ENOTSUP when not supported, otherwise an errno
+	 */
+	int setStackShared(bool shared = true) noexcept
+	{
+		if(state() != New)
+			return EPERM;
+
+#  ifndef ZTH_HAVE_STACK_SHARED
+		if(shared)
+			return ENOTSUP;
+#  endif
+
+		m_stackShared = shared;
+		return 0;
+	}
+
+	bool stackShared() const noexcept
+	{
+		return m_stackShared;
+	}
+
+	/*!
+	 * \brief Return the used stack size.
+	 *
+	 * This is the high water mark of the stack, or the committed memory of a stack with a
+	 * reservation (see #setStackReserve()).  For a fiber on the shared stack, it is the size
+	 * of its saved frames.  It is 0 when it cannot be determined.
+	 */
 	size_t stackUsage() const
 	{
 		return context_stack_usage(context());
@@ -167,6 +417,50 @@ public:
 		return m_totalTime;
 	}
 
+	/*!
+	 * \brief Return the priority, as set by #zth::Worker::setPriority().
+	 * \details A higher value is more urgent.
+	 */
+	unsigned int priority() const noexcept
+	{
+		return m_priority;
+	}
+
+	/*!
+	 * \brief Return the priority the fiber is scheduled with.
+	 * \details This includes the priority inherited from fibers that wait for a #zth::Mutex
+	 *	this fiber holds.
+	 */
+	unsigned int effectivePriority() const noexcept
+	{
+		return m_inherited > m_priority ? m_inherited : m_priority;
+	}
+
+	/*!
+	 * \brief Return the absolute deadline of the current job of this fiber.
+	 * \return the deadline, or a null timestamp when there is none
+	 * \see #zth::Worker::setDeadline()
+	 */
+	Timestamp const& deadline() const noexcept
+	{
+		return m_deadline;
+	}
+
+	/*! \brief Return the number of deadlines that passed before the fiber set the next one. */
+	unsigned int deadlineMisses() const noexcept
+	{
+		return m_deadlineMisses;
+	}
+
+	/*!
+	 * \brief Return the group this fiber shares the CPU time with, if any.
+	 * \see #zth::Worker::setFiberGroup()
+	 */
+	FiberGroup* fiberGroup() const noexcept
+	{
+		return m_group;
+	}
+
 	typedef Hook<Fiber&> Hook_type;
 
 	void atExit(Hook_type::function_type f, Hook_type::arg_type arg = Hook_type::arg_type())
@@ -188,7 +482,7 @@ public:
 
 		zth_dbg(fiber, "[%s] Init", id_str());
 
-		ContextAttr attr(&fiberEntry, this, m_stackSize);
+		ContextAttr attr(&fiberEntry, this, m_stackSize, m_stackReserve, m_stackShared);
 		int res = context_create(m_context, attr);
 		if(res) {
 			// Oops.
@@ -224,6 +518,8 @@ again:
 			// Update administration of the current fiber.
 			TimeInterval dt = now - from.m_startRun;
 			from.m_totalTime += dt;
+			if(unlikely(from.m_group))
+				from.chargeGroup(now);
 
 			if(from.state() == Running)
 				from.setState(Ready, now);
@@ -241,8 +537,12 @@ again:
 
 			// Hand over to this.
 			m_startRun = now;
+			if(unlikely(m_group))
+				m_groupCharged = now;
 			setState(Running, now);
 			m_stateEnd = now + m_timeslice;
+			if(Config::TimesliceTick)
+				m_tick = __atomic_load_n(&timeslice_tick, __ATOMIC_RELAXED);
 
 			zth_dbg(fiber, "Switch from %s to %s after %s", from.id_str(), id_str(),
 				dt.str().c_str());
@@ -256,7 +556,11 @@ again:
 
 		case Running:
 			zth_assert(&from == this);
-			// No switch required.
+			// No switch required. Nobody else wants to run, so start a new time slice,
+			// instead of getting here at every yield().
+			m_stateEnd = now + m_timeslice;
+			if(Config::TimesliceTick)
+				m_tick = __atomic_load_n(&timeslice_tick, __ATOMIC_RELAXED);
 			return EAGAIN;
 
 		case Dead:
@@ -277,6 +581,20 @@ again:
 		return state() != Running || m_stateEnd < now;
 	}
 
+	/*!
+	 * \brief Like #allowYield(), but based on #zth::timeslice_tick.
+	 * \details Falls back to reading the clock when the tick is not running.
+	 * \see #zth::Config::TimesliceTick
+	 */
+	bool allowYieldTick() const noexcept
+	{
+		unsigned int tick = __atomic_load_n(&timeslice_tick, __ATOMIC_RELAXED);
+		if(unlikely(!tick))
+			return allowYield();
+
+		return state() != Running || tick - m_tick >= 2U;
+	}
+
 	void kill() noexcept
 	{
 		if(state() == Dead)
@@ -431,8 +749,23 @@ protected:
 
 		zth_perf_event(*this, m_state, t);
 
-		if(state == Dead && hookDead)
-			hookDead(*this);
+		if(state == Dead) {
+			// A Mutex would still refer to this fiber as its owner.
+			zth_assert(m_locks == 0);
+
+			if(hookDead)
+				hookDead(*this);
+		}
+	}
+
+	void leaveGroup() noexcept;
+
+	/*! \brief Charge the time since the previous charge to the group of this fiber. */
+	void chargeGroup(Timestamp const& now) noexcept
+	{
+		zth_assert(m_group);
+		m_group->charge(now - m_groupCharged);
+		m_groupCharged = now;
 	}
 
 	static void fiberEntry(void* that) noexcept
@@ -457,6 +790,11 @@ protected:
 		}
 
 		zth_dbg(fiber, "[%s] Exit", id_str());
+
+		// Leave before anyone is notified, such that the group may be destructed then.
+		if(unlikely(m_group))
+			leaveGroup();
+
 		m_exit.once(*this);
 
 		kill();
@@ -468,15 +806,31 @@ private:
 	Entry m_entry;
 	EntryArg m_entryArg;
 	size_t m_stackSize;
+	size_t m_stackReserve;
+	bool m_stackShared;
 	Context* m_context;
 	void* m_fls;
 	TimeInterval m_totalTime;
 	Timestamp m_startRun;
 	Timestamp m_stateEnd;
 	TimeInterval m_timeslice;
+	unsigned int m_tick;
+	unsigned int m_priority;
+	unsigned int m_inherited;
+	// Run queue level, or RunQueue::NotQueued.
+	unsigned int m_runLevel;
+	// Number of held Mutexes, for priority inheritance.
+	unsigned int m_locks;
+	Timestamp m_deadline;
+	unsigned int m_deadlineMisses;
+	FiberGroup* m_group;
+	Timestamp m_groupCharged;
 	TimeInterval m_dtMax;
 	Hook_type m_exit;
 	Hook_type m_cleanup;
+
+	friend class Worker;
+	friend class RunQueue;
 };
 
 /*!
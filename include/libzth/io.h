@@ -23,12 +23,17 @@
 
 #if defined(ZTH_HAVE_POLLER)
 #  if !defined(ZTH_OS_WINDOWS)
+#    include <sys/socket.h>
+
 #    if defined(__cplusplus)
 namespace zth {
 namespace io {
 
 ZTH_EXPORT ssize_t read(int fd, void* buf, size_t count);
 ZTH_EXPORT ssize_t write(int fd, void const* buf, size_t count);
+ZTH_EXPORT int accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen);
+ZTH_EXPORT ssize_t recv(int sockfd, void* buf, size_t len, int flags);
+ZTH_EXPORT ssize_t send(int sockfd, void const* buf, size_t len, int flags);
 
 } // namespace io
 } // namespace zth
@@ -53,9 +58,42 @@ EXTERN_C ZTH_EXPORT ZTH_INLINE ssize_t zth_write(int fd, void const* buf, size_t
 	return zth::io::write(fd, buf, count);
 }
 
+/*!
+ * \copydoc zth::io::accept()
+ * \details This is a C-wrapper for zth::io::accept().
+ * \ingroup zth_api_c_io
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen)
+{
+	return zth::io::accept(sockfd, addr, addrlen);
+}
+
+/*!
+ * \copydoc zth::io::recv()
+ * \details This is a C-wrapper for zth::io::recv().
+ * \ingroup zth_api_c_io
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE ssize_t zth_recv(int sockfd, void* buf, size_t len, int flags)
+{
+	return zth::io::recv(sockfd, buf, len, flags);
+}
+
+/*!
+ * \copydoc zth::io::send()
+ * \details This is a C-wrapper for zth::io::send().
+ * \ingroup zth_api_c_io
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE ssize_t zth_send(int sockfd, void const* buf, size_t len, int flags)
+{
+	return zth::io::send(sockfd, buf, len, flags);
+}
+
 #    else  // !__cplusplus
 ZTH_EXPORT ssize_t zth_read(int fd, void* buf, size_t count);
 ZTH_EXPORT ssize_t zth_write(int fd, void const* buf, size_t count);
+ZTH_EXPORT int zth_accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen);
+ZTH_EXPORT ssize_t zth_recv(int sockfd, void* buf, size_t len, int flags);
+ZTH_EXPORT ssize_t zth_send(int sockfd, void const* buf, size_t len, int flags);
 #    endif // __cplusplus
 #  endif   // !ZTH_OS_WINDOWS
 #endif	   // ZTH_HAVE_POLLER
@@ -26,6 +26,9 @@ class List;
 template <typename T = Listable, typename Compare = std::less<T> /**/>
 class SortedList;
 
+template <typename T>
+class TimerWheel;
+
 class Listable {
 public:
 	typedef void* user_type;
@@ -34,12 +37,14 @@ public:
 		: prev()
 		, next()
 		, user()
+		, owner()
 	{}
 
 	constexpr Listable(Listable const& UNUSED_PAR(e)) noexcept
 		: prev()
 		, next()
 		, user()
+		, owner()
 	{}
 
 	Listable& operator=(Listable const& UNUSED_PAR(rhs)) noexcept
@@ -51,6 +56,7 @@ public:
 
 #  if __cplusplus >= 201103L
 	Listable(Listable&& l) noexcept
+		: owner()
 	{
 		*this = std::move(l);
 	}
@@ -62,6 +68,8 @@ public:
 		zth_assert(!l.prev);
 		zth_assert(!next);
 		zth_assert(!l.next);
+		zth_assert(!owner);
+		zth_assert(!l.owner);
 		return *this;
 	}
 #  endif // C++11
@@ -79,11 +87,15 @@ private:
 		user_type user;	    // For List
 		uint_fast8_t level; // for SortedList
 	};
+	// The List this element is in, if any.
+	void const* owner;
 
 	template <typename T>
 	friend class List;
 	template <typename T, typename Compare>
 	friend class SortedList;
+	template <typename T>
+	friend class TimerWheel;
 };
 
 template <typename T = Listable>
@@ -215,12 +227,12 @@ public:
 	constexpr List() noexcept
 		: m_head()
 		, m_tail()
+		, m_size()
 	{}
 
 	~List() noexcept
 	{
-		if(Config::EnableAssert)
-			clear();
+		clear();
 	}
 
 	type& back() const noexcept
@@ -245,8 +257,11 @@ public:
 	{
 		zth_assert(elem.prev == nullptr);
 		zth_assert(elem.next == nullptr);
+		zth_assert(!elem.owner);
 
 		elem.user = user_type();
+		elem.owner = this;
+		m_size++;
 
 		if(m_tail == nullptr) {
 			zth_assert(m_head == nullptr);
@@ -279,6 +294,8 @@ public:
 		if(Config::EnableAssert)
 			elem->prev = elem->next = nullptr;
 
+		elem->owner = nullptr;
+		m_size--;
 		return elem->user;
 	}
 
@@ -304,6 +321,10 @@ public:
 	{
 		zth_assert(elem.prev == nullptr);
 		zth_assert(elem.next == nullptr);
+		zth_assert(!elem.owner);
+
+		elem.owner = this;
+		m_size++;
 
 		if(m_head == nullptr) {
 			zth_assert(m_tail == nullptr);
@@ -336,22 +357,23 @@ public:
 		if(Config::EnableAssert)
 			elem->prev = elem->next = nullptr;
 
+		elem->owner = nullptr;
+		m_size--;
 		return elem->user;
 	}
 
 	bool empty() const noexcept
 	{
 		zth_assert(m_head != nullptr || m_tail == nullptr);
+		zth_assert((m_head == nullptr) == (m_size == 0));
 		return m_head == nullptr;
 	}
 
 	void clear() noexcept
 	{
-		if(Config::EnableAssert)
-			while(!empty())
-				pop_front();
-		else
-			m_head = m_tail = nullptr;
+		// The elements have to forget their owner anyway, so just pop them all.
+		while(!empty())
+			pop_front();
 	}
 
 	iterator begin() const noexcept
@@ -372,18 +394,12 @@ public:
 
 	bool contains(elem_type const& elem) const noexcept
 	{
-		for(iterator it = begin(); it != end(); ++it)
-			if(it.get() == &elem)
-				return true;
-		return false;
+		return elem.owner == this;
 	}
 
 	size_t size() const noexcept
 	{
-		size_t res = 0;
-		for(iterator it = begin(); it != end(); ++it)
-			res++;
-		return res;
+		return m_size;
 	}
 
 	iterator insert(iterator const& pos, elem_type& elem) noexcept
@@ -395,11 +411,14 @@ public:
 			push_front(elem);
 			return begin();
 		} else {
+			zth_assert(!elem.owner);
 			elem_type* before = pos.get();
 			elem.next = before;
 			elem.prev = before->prev;
 			before->prev = elem.prev->next = &elem;
 			elem.user = user_type();
+			elem.owner = this;
+			m_size++;
 			return iterator(m_head, &elem);
 		}
 	}
@@ -432,6 +451,8 @@ public:
 			elem.next->prev = elem.prev;
 			if(Config::EnableAssert)
 				elem.next = elem.prev = nullptr;
+			elem.owner = nullptr;
+			m_size--;
 			return elem.user;
 		}
 	}
@@ -446,6 +467,7 @@ public:
 private:
 	elem_type* m_head;
 	elem_type* m_tail;
+	size_t m_size;
 };
 
 template <typename T, typename Compare>
@@ -28,6 +28,11 @@
 #  define ZTH_THREADS 1
 #endif
 
+#ifndef ZTH_TIME_NS
+// Store zth::Timestamp and zth::TimeInterval as int64_t nanoseconds, instead of struct timespec.
+#  define ZTH_TIME_NS 0
+#endif
+
 
 
 //////////////////////////////////////////////////
@@ -300,7 +305,13 @@ ZTH_EXPORT void foo();
 #  define ZTH_HAVE_PTHREAD
 // #  define ZTH_HAVE_LIBUNWIND
 #  define ZTH_HAVE_POLL
+#  define ZTH_HAVE_EPOLL
 #  define ZTH_HAVE_MMAN
+#  ifdef __has_include
+#    if __has_include(<linux/io_uring.h>)
+#      define ZTH_HAVE_IO_URING
+#    endif
+#  endif
 #elif defined(__APPLE__)
 #  include <TargetConditionals.h>
 #  ifdef TARGET_OS_MAC
@@ -376,11 +387,20 @@ ZTH_EXPORT void foo();
 // We have the following approaches. If one of them is already defined, it is
 // used as preferred one, if compatible.
 //
+// - ZTH_CONTEXT_NATIVE
 // - ZTH_CONTEXT_SIGALTSTACK
 // - ZTH_CONTEXT_SJLJ
 // - ZTH_CONTEXT_UCONTEXT
 // - ZTH_CONTEXT_WINFIBER
 
+#if defined(ZTH_OS_LINUX) && (defined(__x86_64__) || defined(__aarch64__))
+#  define ZTH_HAVE_CONTEXT_NATIVE
+#endif
+
+#ifndef ZTH_HAVE_CONTEXT_NATIVE
+#  undef ZTH_CONTEXT_NATIVE
+#endif
+
 #ifdef ZTH_OS_WINDOWS
 #  ifndef ZTH_CONTEXT_WINFIBER
 #    define ZTH_CONTEXT_WINFIBER
@@ -401,26 +421,39 @@ ZTH_EXPORT void foo();
 #  undef ZTH_CONTEXT_SIGALTSTACK
 #  undef ZTH_CONTEXT_UCONTEXT
 #  undef ZTH_CONTEXT_WINFIBER
-#elif defined(ZTH_HAVE_VALGRIND)
-// Valgrind does not handle sigaltstack very well.
-#  ifndef ZTH_CONTEXT_UCONTEXT
-#    define ZTH_CONTEXT_UCONTEXT
-#  endif
-#  undef ZTH_CONTEXT_SIGALTSTACK
-#  undef ZTH_CONTEXT_SJLJ
-#  undef ZTH_CONTEXT_WINFIBER
+#  undef ZTH_CONTEXT_NATIVE
 #else
-// Default approach is ucontext.
+// Default approach is native on x86-64, otherwise ucontext.
 #  undef ZTH_CONTEXT_SJLJ
 #  undef ZTH_CONTEXT_WINFIBER
-#  if defined(ZTH_CONTEXT_UCONTEXT)
+#  if defined(ZTH_HAVE_VALGRIND) || defined(ZTH_ENABLE_ASAN)
+// Valgrind and ASan do not handle sigaltstack very well.
 #    undef ZTH_CONTEXT_SIGALTSTACK
-#  elif !defined(ZTH_CONTEXT_SIGALTSTACK) || defined(ZTH_ENABLE_ASAN)
+#  endif
+#  if defined(ZTH_CONTEXT_UCONTEXT)
 #    undef ZTH_CONTEXT_SIGALTSTACK
+#    undef ZTH_CONTEXT_NATIVE
+#  elif defined(ZTH_CONTEXT_SIGALTSTACK)
+#    undef ZTH_CONTEXT_NATIVE
+#  elif defined(ZTH_CONTEXT_NATIVE)
+// Explicitly requested, and implemented for this architecture.
+#  elif defined(ZTH_HAVE_VALGRIND)
+// Valgrind is known to work with ucontext.
+#    define ZTH_CONTEXT_UCONTEXT
+#  elif defined(ZTH_HAVE_CONTEXT_NATIVE) && defined(__x86_64__)
+// The AArch64 implementation is opt-in, by passing -DZTH_CONTEXT=native to CMake.
+#    define ZTH_CONTEXT_NATIVE
+#  else
 #    define ZTH_CONTEXT_UCONTEXT
 #  endif
 #endif
 
+#ifdef ZTH_CONTEXT_NATIVE
+// Saving the frames of a shared stack requires the stack pointer of a suspended context, which
+// only the native context knows.
+#  define ZTH_HAVE_STACK_SHARED
+#endif
+
 #ifdef ZTH_CONTEXT_WINFIBER
 #  ifndef WINVER
 #    define WINVER 0x0501
@@ -360,7 +360,8 @@ perf_logv(char const* fmt, va_list args)
  */
 inline void perf_syscall(char const* syscall, Timestamp const& t = Timestamp())
 {
-	if(Config::EnablePerfEvent && zth_config(PerfSyscall))
+	// Do not read the clock when perf is not recording.
+	if(Config::EnablePerfEvent && unlikely(perf_eventBuffer) && zth_config(PerfSyscall))
 		zth_perf_event(currentFiberID(), syscall, t.isNull() ? Timestamp::now() : t);
 }
 
@@ -32,6 +32,7 @@
 #  include <libzth/worker.h>
 
 #  include <bitset>
+#  include <limits>
 #  include <memory>
 #  include <stdexcept>
 #  include <vector>
@@ -51,6 +52,16 @@
 #    include <poll.h>
 #  endif
 
+#  ifdef ZTH_HAVE_EPOLL
+#    include <sys/epoll.h>
+#  endif
+
+#  ifdef ZTH_HAVE_IO_URING
+#    include <sys/socket.h>
+struct io_uring_sqe;
+struct io_uring_cqe;
+#  endif
+
 namespace zth {
 
 //////////////////////////////////////////////
@@ -263,6 +274,8 @@ public:
 	virtual void event(Pollable& p) noexcept = 0;
 };
 
+class UringPoller;
+
 /*!
  * \brief Abstract base class of a Poller server.
  * \ingroup zth_api_cpp_poller
@@ -283,6 +296,19 @@ public:
 	 */
 	virtual int poll(int timeout_ms) noexcept = 0;
 
+	/*!
+	 * \brief Poll with a precise timeout.
+	 *
+	 * A null \p timeout does not block, and an infinite one blocks until a Pollable got an
+	 * event.  By default, the timeout is rounded up to whole milliseconds.
+	 *
+	 * \return 0 when a Pollable returned an event, otherwise an errno
+	 */
+	virtual int poll(TimeInterval const& timeout) noexcept
+	{
+		return poll(timeoutMs(timeout));
+	}
+
 	/*!
 	 * \brief Move all registered Pollables to another server.
 	 * \return 0 on success, otherwise an errno
@@ -310,6 +336,76 @@ public:
 	virtual int remove(Pollable& p, Client* client) noexcept = 0;
 
 	using PollerInterface::remove;
+
+	/*!
+	 * \brief Return the UringPoller, when this server is one.
+	 *
+	 * #zth::io uses it to submit I/O, instead of polling for readiness.
+	 */
+	virtual UringPoller* uring() noexcept
+	{
+		return nullptr;
+	}
+
+	/*!
+	 * \brief Return the number of events that were forwarded by this server.
+	 *
+	 * The counter only increases.  Compare it before and after a #poll() to check if the
+	 * poll returned any event.
+	 */
+	size_t events() const noexcept
+	{
+		return m_events;
+	}
+
+protected:
+	PollerServerBase() noexcept
+		: m_events()
+	{}
+
+	/*!
+	 * \brief Count an event.
+	 *
+	 * To be called by the implementation for every Pollable that got an event.
+	 */
+	void countEvent() noexcept
+	{
+		m_events++;
+	}
+
+	/*!
+	 * \brief Convert a timeout to milliseconds, as accepted by \c poll().
+	 *
+	 * It is rounded up, such that the poll does not return before the timeout.
+	 */
+	static int timeoutMs(TimeInterval const& timeout) noexcept
+	{
+		if(timeout.hasPassed())
+			return 0;
+		if(timeout.isInfinite())
+			return -1;
+
+		struct timespec const& ts = timeout.ts();
+		if(ts.tv_sec >= (time_t)(std::numeric_limits<int>::max() / 1000 - 1))
+			return std::numeric_limits<int>::max();
+
+		return (int)ts.tv_sec * 1000 + (int)((ts.tv_nsec + 999999L) / 1000000L);
+	}
+
+	/*!
+	 * \brief Convert a timeout in milliseconds, as accepted by \c poll(), to a TimeInterval.
+	 */
+	static TimeInterval timeoutInterval(int timeout_ms) noexcept
+	{
+		if(timeout_ms < 0)
+			return TimeInterval::infinity();
+
+		return TimeInterval(timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L);
+	}
+
+private:
+	/*! \brief Number of events, see #events(). */
+	size_t m_events;
 };
 
 
@@ -541,6 +637,22 @@ public:
 		return doPoll(timeout_ms, m_pollItems);
 	}
 
+	virtual int poll(TimeInterval const& timeout) noexcept override
+	{
+		int res = 0;
+
+		if((res = mirror()))
+			return res;
+
+		if(m_metaItems.empty()) {
+			return EINVAL;
+		}
+
+		zth_dbg(io, "[%s] polling %u items for %s", this->id_str(),
+			(unsigned)m_metaItems.size(), timeout.str().c_str());
+		return doPoll(timeout, m_pollItems);
+	}
+
 
 protected:
 	typedef PollItem_ PollItem;
@@ -563,6 +675,7 @@ protected:
 		m.pollable->revents = revents;
 
 		if(revents.any()) {
+			this->countEvent();
 			zth_dbg(io, "[%s] pollable %p got event 0x%lx", this->id_str(), m.pollable,
 				revents.to_ulong());
 			if(m.client)
@@ -594,6 +707,16 @@ private:
 	 */
 	virtual int doPoll(int timeout_ms, PollItemList& items) noexcept = 0;
 
+	/*!
+	 * \brief Do the actual poll, with a precise timeout.
+	 *
+	 * By default, the timeout is rounded up to whole milliseconds.
+	 */
+	virtual int doPoll(TimeInterval const& timeout, PollItemList& items) noexcept
+	{
+		return doPoll(this->timeoutMs(timeout), items);
+	}
+
 	/*!
 	 * \brief Make sure all PollItems are initialized.
 	 * \return 0 on success, otherwise an errno
@@ -662,6 +785,7 @@ public:
 private:
 	virtual int init(Pollable const& p, zmq_pollitem_t& item) noexcept override;
 	virtual int doPoll(int timeout_ms, base::PollItemList& items) noexcept override;
+	using base::doPoll;
 };
 
 typedef ZmqPoller DefaultPollerServer;
@@ -684,9 +808,18 @@ public:
 private:
 	virtual int init(Pollable const& p, struct pollfd& item) noexcept override;
 	virtual int doPoll(int timeout_ms, base::PollItemList& items) noexcept override;
+#    ifdef ZTH_OS_LINUX
+	virtual int doPoll(TimeInterval const& timeout, base::PollItemList& items) noexcept
+		override;
+#    else
+	using base::doPoll;
+#    endif
+	int dispatch(int res, base::PollItemList& items) noexcept;
 };
 
+#    ifndef ZTH_HAVE_EPOLL
 typedef PollPoller DefaultPollerServer;
+#    endif
 
 #  else
 // No poller available.
@@ -707,11 +840,202 @@ public:
 protected:
 	int init(Pollable const& p, int& item) noexcept final;
 	int doPoll(int timeout_ms, base::PollItemList& items) noexcept final;
+	using base::doPoll;
 };
 
 typedef NoPoller DefaultPollerServer;
 #  endif // No poller
 
+#  ifdef ZTH_HAVE_EPOLL
+/*!
+ * \brief A PollerServer that uses Linux's \c epoll.
+ *
+ * Pollables are registered in the kernel when they are added, and stay
+ * registered until they are removed.  Therefore, a #poll() only costs
+ * time for the Pollables that actually got an event, instead of for all
+ * registered ones.  This pays off when many file descriptors are idle.
+ *
+ * Multiple Pollables may refer to the same file descriptor.  ZeroMQ
+ * sockets are not supported.  File descriptors that cannot be used with
+ * \c epoll, like regular files, are always ready, just like \c poll()
+ * would report them.
+ *
+ * \ingroup zth_api_cpp_poller
+ */
+class EpollPoller : public PollerServerBase {
+	ZTH_CLASS_NEW_DELETE(EpollPoller)
+public:
+	typedef PollerServerBase base;
+	using base::Client;
+
+	/*!
+	 * \brief Trigger mode of the registered file descriptors.
+	 *
+	 * When edge-triggered, an event is reported once, until the file
+	 * descriptor becomes ready again.  Only use it when all Pollables are
+	 * added by the application, which reads or writes until \c EAGAIN.
+	 */
+	enum Trigger { LevelTriggered, EdgeTriggered };
+
+	explicit EpollPoller(Trigger trigger = LevelTriggered);
+	virtual ~EpollPoller() noexcept override;
+
+	virtual int migrateTo(PollerServerBase& p) noexcept override;
+	virtual void reserve(size_t more) override;
+
+	virtual int add(Pollable& p, Client* client) noexcept override;
+	virtual int add(Pollable& p) noexcept override;
+	virtual int remove(Pollable& p, Client* client) noexcept override;
+	virtual int remove(Pollable& p) noexcept override;
+	void clear() noexcept;
+
+	virtual bool empty() const noexcept override;
+	size_t size() const noexcept;
+
+	virtual int poll(int timeout_ms) noexcept override;
+	virtual int poll(TimeInterval const& timeout) noexcept override;
+
+private:
+	/*! \brief A Pollable with the client it belongs to. */
+	struct Registration {
+		Pollable* pollable;
+		Client* client;
+	};
+
+	/*! \brief All Registrations of one file descriptor. */
+	struct Entry {
+		ZTH_CLASS_NEW_DELETE(Entry)
+	public:
+		int fd;
+		/*! \brief The events as registered in the kernel. */
+		uint32_t events;
+		/*! \brief Set when the fd is registered in the kernel. */
+		bool registered;
+		/*! \brief Set when the fd cannot be used with \c epoll. */
+		bool alwaysReady;
+		small_vector<Registration, 1> registrations;
+	};
+
+	int update(Entry& e) noexcept;
+	void dispatch(Entry& e, uint32_t events) noexcept;
+
+private:
+	/*! \brief The \c epoll descriptor. */
+	int m_epfd;
+	Trigger m_trigger;
+	/*! \brief Number of registered Pollables. */
+	size_t m_count;
+	/*! \brief Entries, indexed by file descriptor. */
+	vector_type<Entry*>::type m_fds;
+	/*! \brief Entries that are not registered in the kernel, but are always ready. */
+	vector_type<Entry*>::type m_alwaysReady;
+	/*! \brief Buffer for \c epoll_wait(). */
+	vector_type<struct epoll_event>::type m_events;
+};
+
+#    ifndef ZTH_HAVE_LIBZMQ
+typedef EpollPoller DefaultPollerServer;
+#    endif
+#  endif // ZTH_HAVE_EPOLL
+
+#  ifdef ZTH_HAVE_IO_URING
+/*!
+ * \brief A PollerServer that uses Linux's io_uring.
+ *
+ * Besides polling Pollables, it performs #zth::io operations on behalf of the
+ * calling fiber, which is suspended until the operation completes.  All
+ * submissions are passed to the kernel in batch by the #zth::Waiter, which
+ * also reaps the completions, without a syscall when nothing needs to be
+ * submitted or waited for.
+ *
+ * When io_uring is not supported by the kernel, #valid() returns \c false.
+ * Set \c zth::Config::UseIoUring to let the #zth::Waiter use this poller by
+ * default; it falls back to the #zth::DefaultPollerServer when io_uring is
+ * not available.  ZeroMQ sockets are not supported.
+ *
+ * \ingroup zth_api_cpp_poller
+ */
+class UringPoller : public PollerServerBase {
+	ZTH_CLASS_NEW_DELETE(UringPoller)
+public:
+	typedef PollerServerBase base;
+	using base::Client;
+
+	explicit UringPoller(unsigned int entries = Config::IoUringEntries);
+	virtual ~UringPoller() noexcept override;
+
+	bool valid() const noexcept;
+
+	virtual int migrateTo(PollerServerBase& p) noexcept override;
+	virtual void reserve(size_t more) override;
+
+	virtual int add(Pollable& p, Client* client) noexcept override;
+	virtual int add(Pollable& p) noexcept override;
+	virtual int remove(Pollable& p, Client* client) noexcept override;
+	virtual int remove(Pollable& p) noexcept override;
+	void clear() noexcept;
+
+	virtual bool empty() const noexcept override;
+	size_t size() const noexcept;
+
+	virtual int poll(int timeout_ms) noexcept override;
+	virtual int poll(TimeInterval const& timeout) noexcept override;
+
+	virtual UringPoller* uring() noexcept override
+	{
+		return this;
+	}
+
+	ssize_t read(int fd, void* buf, size_t count) noexcept;
+	ssize_t write(int fd, void const* buf, size_t count) noexcept;
+	int accept(int fd, struct sockaddr* addr, socklen_t* addrlen) noexcept;
+	ssize_t recv(int fd, void* buf, size_t len, int flags) noexcept;
+	ssize_t send(int fd, void const* buf, size_t len, int flags) noexcept;
+
+private:
+	struct Request;
+	struct PollRequest;
+	struct IoRequest;
+
+	struct io_uring_sqe* sqe() noexcept;
+	struct io_uring_sqe* sqeWait() noexcept;
+	int enter(unsigned int minComplete, TimeInterval const& timeout) noexcept;
+	void reap() noexcept;
+	void arm(PollRequest& r) noexcept;
+	void cancel(PollRequest& r) noexcept;
+	ssize_t io(IoRequest& r) noexcept;
+
+private:
+	/*! \brief The io_uring descriptor. */
+	int m_fd;
+
+	/*! \brief The mapped submission and completion rings. */
+	void* m_ring;
+	size_t m_ringSize;
+	struct io_uring_sqe* m_sqes;
+	size_t m_sqesSize;
+
+	unsigned int* m_sqHead;
+	unsigned int* m_sqTail;
+	unsigned int m_sqMask;
+	unsigned int m_sqEntries;
+	/*! \brief Our copy of the submission tail, which is published by #enter(). */
+	unsigned int m_sqLocalTail;
+
+	unsigned int* m_cqHead;
+	unsigned int* m_cqTail;
+	unsigned int m_cqMask;
+	struct io_uring_cqe* m_cqes;
+
+	/*! \brief Registered Pollables. */
+	vector_type<PollRequest*>::type m_polls;
+	/*! \brief Removed Pollables, of which the kernel did not complete the poll yet. */
+	List<PollRequest> m_cancelled;
+	/*! \brief Number of I/O operations in flight. */
+	size_t m_io;
+};
+#  endif // ZTH_HAVE_IO_URING
+
 /*!
  * \typedef DefaultPollerServer
  * \brief The poller server, by default instantiated by the #zth::Waiter.
@@ -274,11 +274,15 @@ class SynchronizerBase : public RefCounted, public UniqueID<SynchronizerBase> {
 protected:
 	explicit SynchronizerBase(cow_string const& name = "Synchronizer")
 		: UniqueID(Config::NamedSynchronizer ? name.str() : string())
+		, m_handoff()
+		, m_woken()
 	{}
 
 #  if __cplusplus >= 201103L
 	explicit SynchronizerBase(cow_string&& name)
 		: UniqueID(Config::NamedSynchronizer ? std::move(name).str() : string())
+		, m_handoff()
+		, m_woken()
 	{}
 #  endif
 
@@ -288,6 +292,24 @@ public:
 		zth_dbg(sync, "[%s] Destruct", id_str());
 	}
 
+	/*!
+	 * \brief Let a wakeup switch directly to the woken fiber.
+	 *
+	 * Normally, a woken fiber is appended to the run queue, and runs after the fibers that
+	 * are already in there.  In handoff mode, #zth::Mailbox::put(), #zth::Signal::signal(),
+	 * and #zth::Future::set() switch to it immediately, which saves a round through the run
+	 * queue per request/response.  #zth::Worker::handoff() decides when not to switch.
+	 */
+	void setHandoff(bool enable = true) noexcept
+	{
+		m_handoff = enable;
+	}
+
+	bool handoff() const noexcept
+	{
+		return m_handoff;
+	}
+
 protected:
 	typedef List<> queue_type;
 
@@ -298,7 +320,7 @@ protected:
 		return queue(q).push_back(item);
 	}
 
-	void block(size_t q = 0)
+	void block(size_t q = 0, queue_type::user_type user = queue_type::user_type())
 	{
 		Worker& w = currentWorker();
 		Fiber* f = w.currentFiber();
@@ -307,7 +329,7 @@ protected:
 
 		zth_dbg(sync, "[%s] Block %s", id_str(), f->id_str());
 		w.release(*f);
-		enqueue(*f, q);
+		enqueue(*f, q).user() = user;
 		f->nap(Timestamp::null());
 		w.schedule();
 	}
@@ -318,6 +340,7 @@ protected:
 	 */
 	bool unblock(Fiber& f, size_t q = 0, bool prio = false) noexcept
 	{
+		m_woken = nullptr;
 		queue_type& queue_ = queue(q);
 		if(!queue_.contains(f))
 			return false;
@@ -328,6 +351,7 @@ protected:
 
 	Listable* unblockFirst(size_t q = 0, bool prio = false) noexcept
 	{
+		m_woken = nullptr;
 		queue_type& queue_ = queue(q);
 		if(queue_.empty())
 			return nullptr;
@@ -339,6 +363,7 @@ protected:
 
 	bool unblockAll(size_t q = 0, bool prio = false) noexcept
 	{
+		m_woken = nullptr;
 		queue_type& queue_ = queue(q);
 		if(queue_.empty())
 			return false;
@@ -364,6 +389,22 @@ protected:
 		zth_dbg(sync, "[%s] Unblock %s", id_str(), f.id_str());
 		f.wakeup();
 		w.add(&f, prio);
+
+		if(!m_woken)
+			m_woken = &f;
+	}
+
+	/*!
+	 * \brief Switch to the fiber that was woken by the last #unblock(), if in handoff mode.
+	 * \details Call this as the last step of an operation, as this object may be gone when
+	 *	it returns.
+	 */
+	void handoffWoken() noexcept
+	{
+		Fiber* f = m_woken;
+		m_woken = nullptr;
+		if(f && m_handoff)
+			currentWorker().handoff(*f);
 	}
 
 	class AlarmClock : public TimedWaitable {
@@ -412,13 +453,14 @@ protected:
 	 * \return \c true if unblocked by request, \c false when unblocked by timeout.
 	 */
 	bool
-	blockUntil(Timestamp const& timeout, Timestamp const& now = Timestamp::now(), size_t q = 0)
+	blockUntil(Timestamp const& timeout, Timestamp const& now = Timestamp::now(), size_t q = 0,
+		   queue_type::user_type user = queue_type::user_type())
 	{
 		if(timeout <= now)
 			// Immediate timeout.
 			return true;
 
-		return block_(timeout, now, q);
+		return block_(timeout, now, q, user);
 	}
 
 	/*!
@@ -440,7 +482,9 @@ private:
 	 * \brief Block, with timeout.
 	 * \return \c true if unblocked by request, \c false when unblocked by timeout.
 	 */
-	bool block_(Timestamp const& timeout, Timestamp const& now, size_t q = 0)
+	bool block_(
+		Timestamp const& timeout, Timestamp const& now, size_t q = 0,
+		queue_type::user_type user = queue_type::user_type())
 	{
 		Worker& w = currentWorker();
 		Fiber* f = w.currentFiber();
@@ -449,7 +493,7 @@ private:
 
 		zth_dbg(sync, "[%s] Block %s with timeout", id_str(), f->id_str());
 		w.release(*f);
-		queue(q).push_back(*f);
+		enqueue(*f, q).user() = user;
 		f->nap(Timestamp::null());
 
 		AlarmClock a(*this, q, *f, timeout);
@@ -459,6 +503,11 @@ private:
 		w.waiter().unscheduleTask(a);
 		return !a.rang();
 	}
+
+private:
+	bool m_handoff;
+	// The first fiber woken by the last unblock call.
+	Fiber* m_woken;
 };
 
 template <size_t Size = 1>
@@ -498,8 +547,176 @@ private:
 	queue_type m_queue[Size];
 };
 
+/*!
+ * \brief The wait queues of #zth::wait_on(), keyed by address.
+ *
+ * Every Worker has one, see #zth::Worker::waitOnTable().  A blocked fiber is queued in the
+ * bucket of its address, with the address as user data of the queue.
+ */
+class WaitOnTable : public Synchronizer<Config::WaitOnBuckets> {
+	ZTH_CLASS_NEW_DELETE(WaitOnTable)
+public:
+	typedef Synchronizer<Config::WaitOnBuckets> base;
+
+	WaitOnTable()
+		: base("wait_on")
+	{}
+
+	virtual ~WaitOnTable() noexcept override is_default
+
+	void wait(void const* addr)
+	{
+		block(bucket(addr), const_cast<void*>(addr));
+	}
+
+	/*!
+	 * \brief Wait, with timeout.
+	 * \return \c true when notified, \c false on timeout
+	 */
+	bool wait(void const* addr, Timestamp const& timeout, Timestamp const& now)
+	{
+		if(timeout <= now)
+			return false;
+
+		return blockUntil(timeout, now, bucket(addr), const_cast<void*>(addr));
+	}
+
+	/*!
+	 * \brief Wake up to \p count fibers that wait for \p addr.
+	 * \return the number of fibers woken up
+	 */
+	size_t notify(void const* addr, size_t count) noexcept
+	{
+		size_t q = bucket(addr);
+		queue_type& queue_ = queue(q);
+		size_t woken = 0;
+
+		for(queue_type::iterator it = queue_.begin(); woken < count && it != queue_.end();) {
+			if(it.user() != addr) {
+				++it;
+				continue;
+			}
+
+			Listable& item = *it;
+			queue_type::user_type user = it.user();
+			it = queue_.erase(it);
+			wakeup(item, user, false, q);
+			woken++;
+		}
+
+		return woken;
+	}
+
+protected:
+	virtual void
+	wakeup(Listable& item, queue_type::user_type UNUSED_PAR(user), bool prio,
+	       size_t q) noexcept override
+	{
+		// The user data is the address, which the base class does not expect.
+		base::wakeup(item, queue_type::user_type(), prio, q);
+	}
+
+private:
+	static size_t bucket(void const* addr) noexcept
+	{
+		static_assert((Config::WaitOnBuckets & (Config::WaitOnBuckets - 1U)) == 0, "");
+		// Fibonacci hashing; the low bits of an address are mostly zero.
+		uint64_t h = (uint64_t)(uintptr_t)addr * 0x9e3779b97f4a7c15ULL;
+		return (size_t)(h >> 32U) & (Config::WaitOnBuckets - 1U);
+	}
+};
+
+inline WaitOnTable& Worker::waitOnTable()
+{
+	if(unlikely(!m_waitOn))
+		m_waitOn = new WaitOnTable();
+
+	return *m_waitOn;
+}
+
+namespace impl {
+template <typename T>
+struct wait_on_type {
+	typedef T type;
+};
+} // namespace impl
+
+/*!
+ * \brief Block the current fiber on \p addr, as long as it holds \p expected.
+ *
+ * This is like a futex: any variable can be used to block on, without a #zth::Synchronizer.
+ * Another fiber changes the variable, and calls #zth::notify_one() or #zth::notify_all().
+ * Fibers may wake up spuriously, so check the variable again after returning.
+ *
+ * The wait queues are per Worker, so the waiting and notifying fibers should run on the same
+ * Worker.
+ *
+ * \return 0 when notified, \c EAGAIN when \p addr does not hold \p expected
+ * \ingroup zth_api_cpp_sync
+ */
+template <typename T>
+int wait_on(T const* addr, typename impl::wait_on_type<T>::type const& expected)
+{
+	zth_assert(addr);
+	if(*addr != expected)
+		return EAGAIN;
+
+	currentWorker().waitOnTable().wait(addr);
+	return 0;
+}
+
+/*!
+ * \brief Block the current fiber on \p addr, as long as it holds \p expected, until the
+ *	given \p timeout.
+ * \return 0 when notified, \c EAGAIN when \p addr does not hold \p expected, or
+ *	\c ETIMEDOUT
+ * \ingroup zth_api_cpp_sync
+ */
+template <typename T>
+int wait_on(
+	T const* addr, typename impl::wait_on_type<T>::type const& expected,
+	Timestamp const& timeout, Timestamp const& now = Timestamp::now())
+{
+	zth_assert(addr);
+	if(*addr != expected)
+		return EAGAIN;
+
+	return currentWorker().waitOnTable().wait(addr, timeout, now) ? 0 : ETIMEDOUT;
+}
+
+template <typename T>
+int wait_on(
+	T const* addr, typename impl::wait_on_type<T>::type const& expected,
+	TimeInterval const& timeout, Timestamp const& now = Timestamp::now())
+{
+	return wait_on(addr, expected, now + timeout, now);
+}
+
+/*!
+ * \brief Wake up one fiber that waits in #zth::wait_on() for \p addr.
+ * \return \c true when a fiber was woken up
+ * \ingroup zth_api_cpp_sync
+ */
+inline bool notify_one(void const* addr) noexcept
+{
+	return currentWorker().waitOnTable().notify(addr, 1) > 0;
+}
+
+/*!
+ * \brief Wake up all fibers that wait in #zth::wait_on() for \p addr.
+ * \return the number of fibers woken up
+ * \ingroup zth_api_cpp_sync
+ */
+inline size_t notify_all(void const* addr) noexcept
+{
+	return currentWorker().waitOnTable().notify(addr, std::numeric_limits<size_t>::max());
+}
+
 /*!
  * \brief Fiber-aware mutex.
+ *
+ * A fiber must unlock the mutex before it exits.
+ *
  * \ingroup zth_api_cpp_sync
  */
 class Mutex : public Synchronizer<> {
@@ -508,12 +725,16 @@ public:
 	explicit Mutex(cow_string const& name = "Mutex")
 		: Synchronizer(name)
 		, m_locked()
+		, m_owner()
+		, m_waitPriority()
 	{}
 
 #  if __cplusplus >= 201103L
 	explicit Mutex(cow_string&& name)
 		: Synchronizer(std::move(name))
 		, m_locked()
+		, m_owner()
+		, m_waitPriority()
 	{}
 #  endif
 
@@ -521,29 +742,30 @@ public:
 
 	void lock()
 	{
-		while(unlikely(m_locked))
+		while(unlikely(m_locked)) {
+			inherit();
 			block();
-		m_locked = true;
-		zth_dbg(sync, "[%s] Locked", id_str());
+		}
+		locked();
 	}
 
 	bool trylock() noexcept
 	{
 		if(m_locked)
 			return false;
-		m_locked = true;
-		zth_dbg(sync, "[%s] Locked", id_str());
+		locked();
 		return true;
 	}
 
 	bool trylock(Timestamp const& timeout)
 	{
-		while(unlikely(m_locked))
+		while(unlikely(m_locked)) {
+			inherit();
 			if(!blockUntil(timeout))
 				return false;
+		}
 
-		m_locked = true;
-		zth_dbg(sync, "[%s] Locked", id_str());
+		locked();
 		return true;
 	}
 
@@ -552,11 +774,91 @@ public:
 		zth_assert(m_locked);
 		zth_dbg(sync, "[%s] Unlocked", id_str());
 		m_locked = false;
-		unblockFirst();
+
+		if(RunQueue::Levels > 1 && Config::PriorityInheritance) {
+			if(m_owner) {
+				currentWorker().mutexUnlocked(*m_owner);
+				m_owner = nullptr;
+			}
+			unblockHighest();
+		} else {
+			unblockFirst();
+		}
+	}
+
+private:
+	void locked() noexcept
+	{
+		m_locked = true;
+		zth_dbg(sync, "[%s] Locked", id_str());
+
+		if(RunQueue::Levels > 1 && Config::PriorityInheritance) {
+			Worker* w = Worker::instance();
+			m_owner = w ? w->currentFiber() : nullptr;
+			if(m_owner)
+				w->mutexLocked(*m_owner);
+		}
+	}
+
+	void inherit() noexcept
+	{
+		if(RunQueue::Levels == 1 || !Config::PriorityInheritance)
+			return;
+
+		Worker& w = currentWorker();
+		Fiber* f = w.currentFiber();
+		if(!f)
+			return;
+
+		unsigned int priority = f->effectivePriority();
+		if(priority > m_waitPriority)
+			m_waitPriority = priority;
+
+		if(m_owner)
+			w.inheritPriority(*m_owner, priority);
+	}
+
+	void unblockHighest() noexcept
+	{
+		queue_type& q = queue(0);
+		if(q.empty()) {
+			m_waitPriority = 0;
+			return;
+		}
+
+		// Only search the queue when a waiter has a higher priority than the first one.
+		if(m_waitPriority <= static_cast<Fiber&>(q.front()).effectivePriority()) {
+			unblockFirst();
+			if(q.empty())
+				m_waitPriority = 0;
+			return;
+		}
+
+		Fiber* highest = nullptr;
+		unsigned int next = 0;
+
+		for(queue_type::iterator it = q.begin(); it != q.end(); ++it) {
+			Fiber& f = static_cast<Fiber&>(*it);
+			unsigned int priority = f.effectivePriority();
+			if(!highest || priority > highest->effectivePriority()) {
+				if(highest)
+					next = highest->effectivePriority();
+				highest = &f;
+			} else if(priority > next) {
+				next = priority;
+			}
+		}
+
+		unblock(*highest);
+		m_waitPriority = next;
 	}
 
 private:
 	bool m_locked;
+	// The fiber that holds the lock, when tracked for priority inheritance.
+	Fiber* m_owner;
+	// Highest priority of the fibers that blocked since the queue was empty.
+	unsigned int m_waitPriority;
 };
 
 /*!
@@ -608,720 +910,2234 @@ private:
 };
 
 /*!
- * \brief Fiber-aware semaphore.
+ * \brief Fiber-aware mutex of a single word.
+ *
+ * In contrast to #zth::Mutex, this is not a #zth::Synchronizer, but it blocks via
+ * #zth::wait_on().  It is as large as an \c unsigned \c int, and (un)locking it without
+ * contention does not leave the inlined fast path.  It does not do priority inheritance.
+ *
+ * Like #zth::wait_on(), it can only be used by fibers of the same Worker.
+ *
  * \ingroup zth_api_cpp_sync
  */
-class Semaphore : public Synchronizer<> {
-	ZTH_CLASS_NEW_DELETE(Semaphore)
+class LightMutex {
 public:
-	typedef unsigned int count_type;
-
-	explicit Semaphore(count_type init = 0, cow_string const& name = "Semaphore")
-		: Synchronizer(name)
-		, m_count(init)
-		, m_unblockAll()
-	{}
-
-#  if __cplusplus >= 201103L
-	Semaphore(count_type init, cow_string&& name)
-		: Synchronizer(std::move(name))
-		, m_count(init)
-		, m_unblockAll()
+	constexpr LightMutex() noexcept
+		: m_state()
 	{}
-#  endif
-
-	virtual ~Semaphore() noexcept override is_default
 
-	void acquire(count_type count = 1)
+	void lock()
 	{
-		while(m_count < count) {
-			if(count > 1)
-				m_unblockAll = true;
-
-			block();
-		}
+		if(likely(m_state == Unlocked))
+			m_state = Locked;
+		else
+			lock_slow();
+	}
 
-		m_count -= count;
-		zth_dbg(sync, "[%s] Acquired %u", id_str(), count);
+	bool trylock() noexcept
+	{
+		if(m_state != Unlocked)
+			return false;
 
-		if(m_count > 0 && !m_unblockAll) {
-			// There is more to acquire. Wake the next in line.
-			unblockFirst();
-		}
+		m_state = Locked;
+		return true;
 	}
 
-	void release(count_type count = 1) noexcept
+	void unlock() noexcept
 	{
-		zth_assert(m_count + count >= m_count); // ...otherwise it wrapped around, which is
-							// probably not want you wanted...
-
-		if(unlikely(m_count + count < m_count))
-			// wrapped around, saturate
-			m_count = std::numeric_limits<count_type>::max();
-		else
-			m_count += count;
+		zth_assert(m_state != Unlocked);
 
-		zth_dbg(sync, "[%s] Released %u", id_str(), count);
+		bool contended = m_state == Contended;
+		m_state = Unlocked;
+		if(unlikely(contended))
+			notify_one(&m_state);
+	}
 
-		if(likely(m_count > 0)) {
-			if(!m_unblockAll) {
-				// As some fibers may be waiting for just one unit, and others for
-				// multiple, let them all try to acquire what they need.
-				unblockFirst();
-			} else if(!unblockAll()) {
-				// Nobody was waiting anymore.
-				m_unblockAll = false;
-			}
-		}
+	bool locked() const noexcept
+	{
+		return m_state != Unlocked;
 	}
 
-	count_type value() const noexcept
+private:
+	void lock_slow()
 	{
-		return m_count;
+		// We do not know if there are other waiters, so keep it contended when we get it.
+		// The unlock() may wake up one fiber too many, which is harmless.
+		while(m_state != Unlocked) {
+			m_state = Contended;
+			wait_on(&m_state, (unsigned int)Contended);
+		}
+
+		m_state = Contended;
 	}
 
 private:
-	count_type m_count;
-	bool m_unblockAll;
+	enum { Unlocked = 0, Locked = 1, Contended = 2 };
+	unsigned int m_state;
 };
 
 /*!
- * \brief Fiber-aware signal.
+ * \brief Fiber-aware reader/writer lock.
+ *
+ * Any number of fibers can hold it shared (see #lock_shared()), or one fiber can hold it
+ * exclusively (see #lock()).  When the lock is released, it is passed to the waiting fibers
+ * directly: either the first waiting writer, or all waiting readers at once.
+ *
+ * The #Policy decides who goes first.  With \c PreferWriters, a reader does not get the lock
+ * while a writer is waiting, which means that taking a shared lock recursively may deadlock.
+ *
  * \ingroup zth_api_cpp_sync
  */
-class Signal : public Synchronizer<> {
-	ZTH_CLASS_NEW_DELETE(Signal)
+class SharedMutex : public Synchronizer<2> {
+	ZTH_CLASS_NEW_DELETE(SharedMutex)
 public:
-	explicit Signal(cow_string const& name = "Signal")
+	enum Policy {
+		/*! \brief Readers get the lock whenever no writer holds it. Writers may starve. */
+		PreferReaders,
+		/*! \brief Readers wait while a writer is waiting. Readers may starve. */
+		PreferWriters,
+	};
+
+	explicit SharedMutex(
+		cow_string const& name = "SharedMutex", Policy policy = PreferWriters)
 		: Synchronizer(name)
-		, m_signalled()
+		, m_policy(policy)
+		, m_readers()
+		, m_writer()
 	{}
 
 #  if __cplusplus >= 201103L
-	explicit Signal(cow_string&& name)
+	explicit SharedMutex(cow_string&& name, Policy policy = PreferWriters)
 		: Synchronizer(std::move(name))
-		, m_signalled()
+		, m_policy(policy)
+		, m_readers()
+		, m_writer()
 	{}
 #  endif
 
-	virtual ~Signal() noexcept override is_default
+	virtual ~SharedMutex() noexcept override
+	{
+		zth_assert(!locked());
+	}
 
-	void wait()
+	Policy policy() const noexcept
 	{
-		if(!m_signalled) {
-			block();
-		} else {
-			// Do a yield() here, as one might rely on the signal to block
-			// regularly when the signal is used in a loop (see daemon
-			// pattern).
-			yield();
-		}
+		return m_policy;
+	}
 
-		if(m_signalled > 0)
-			m_signalled--;
+	/*!
+	 * \brief Change the policy.
+	 * \details It applies to the next lock or unlock.
+	 */
+	void setPolicy(Policy policy) noexcept
+	{
+		m_policy = policy;
 	}
 
-	bool wait(Timestamp const& timeout, Timestamp const& now = Timestamp::now())
+	void lock()
 	{
-		if(!m_signalled) {
-			if(!blockUntil(timeout, now))
-				// Timeout.
-				return false;
-		} else
-			yield();
+		if(likely(trylock()))
+			return;
 
-		if(m_signalled > 0)
-			m_signalled--;
+		// unlock() hands the lock over to us.
+		block((size_t)Queue_Write);
+		zth_assert(m_writer);
+		zth_dbg(sync, "[%s] Locked", id_str());
+	}
 
-		// Got signalled.
+	bool trylock() noexcept
+	{
+		if(m_writer || m_readers)
+			return false;
+
+		m_writer = true;
+		zth_dbg(sync, "[%s] Locked", id_str());
 		return true;
 	}
 
-	bool wait(TimeInterval const& timeout, Timestamp const& now = Timestamp::now())
+	/*!
+	 * \brief Lock exclusively, with timeout.
+	 * \return \c true when locked, \c false on timeout
+	 */
+	bool trylock(Timestamp const& timeout, Timestamp const& now = Timestamp::now())
 	{
-		return wait(now + timeout, now);
+		if(trylock())
+			return true;
+
+		if(timeout <= now || !blockUntil(timeout, now, (size_t)Queue_Write)) {
+			// Readers may have been waiting for us only.
+			admit();
+			return false;
+		}
+
+		zth_assert(m_writer);
+		zth_dbg(sync, "[%s] Locked", id_str());
+		return true;
 	}
 
-	void signal(bool queue = true, bool queueEveryTime = false) noexcept
+	bool trylock(TimeInterval const& timeout, Timestamp const& now = Timestamp::now())
 	{
-		zth_dbg(sync, "[%s] Signal", id_str());
-		if(!unblockFirst() && queue && m_signalled >= 0) {
-			if(m_signalled == 0 || queueEveryTime)
-				m_signalled++;
-			zth_assert(m_signalled > 0); // Otherwise, it wrapped around, which is
-						     // probably not what you want.
+		return trylock(now + timeout, now);
+	}
+
+	void unlock() noexcept
+	{
+		zth_assert(m_writer);
+		zth_dbg(sync, "[%s] Unlocked", id_str());
+		m_writer = false;
+		admit();
+	}
+
+	void lock_shared()
+	{
+		if(likely(trylock_shared()))
+			return;
+
+		block((size_t)Queue_Read);
+		zth_assert(m_readers);
+		zth_dbg(sync, "[%s] Locked shared", id_str());
+	}
+
+	bool trylock_shared() noexcept
+	{
+		if(m_writer || (m_policy == PreferWriters && !queue(Queue_Write).empty()))
+			return false;
+
+		m_readers++;
+		zth_dbg(sync, "[%s] Locked shared", id_str());
+		return true;
+	}
+
+	/*!
+	 * \brief Lock shared, with timeout.
+	 * \return \c true when locked, \c false on timeout
+	 */
+	bool trylock_shared(Timestamp const& timeout, Timestamp const& now = Timestamp::now())
+	{
+		if(trylock_shared())
+			return true;
+
+		if(timeout <= now || !blockUntil(timeout, now, (size_t)Queue_Read))
+			return false;
+
+		zth_assert(m_readers);
+		zth_dbg(sync, "[%s] Locked shared", id_str());
+		return true;
+	}
+
+	bool trylock_shared(TimeInterval const& timeout, Timestamp const& now = Timestamp::now())
+	{
+		return trylock_shared(now + timeout, now);
+	}
+
+	void unlock_shared() noexcept
+	{
+		zth_assert(m_readers > 0);
+		zth_dbg(sync, "[%s] Unlocked shared", id_str());
+		if(--m_readers == 0)
+			admit();
+	}
+
+	/*!
+	 * \brief Return if the lock is held, either shared or exclusively.
+	 */
+	bool locked() const noexcept
+	{
+		return m_writer || m_readers;
+	}
+
+	/*!
+	 * \brief Return the number of fibers that hold the lock shared.
+	 */
+	size_t readers() const noexcept
+	{
+		return m_readers;
+	}
+
+private:
+	/*!
+	 * \brief Pass the lock to the waiting fibers, when they can have it now.
+	 */
+	void admit() noexcept
+	{
+		if(m_writer)
+			return;
+
+		bool writers = !queue(Queue_Write).empty();
+		bool readers = !queue(Queue_Read).empty();
+
+		if(writers && !m_readers && (m_policy == PreferWriters || !readers)) {
+			m_writer = true;
+			unblockFirst(Queue_Write);
+		} else if(readers && (!writers || m_policy == PreferReaders)) {
+			// Let all of them in at once.
+			m_readers += queue(Queue_Read).size();
+			unblockAll(Queue_Read);
+		} else {
+			return;
+		}
+
+		handoffWoken();
+	}
+
+private:
+	enum { Queue_Write = 0, Queue_Read = 1 };
+
+	Policy m_policy;
+	size_t m_readers;
+	bool m_writer;
+};
+
+/*!
+ * \brief #zth::SharedMutex RAII, that locks and unlocks the mutex shared.
+ * \ingroup zth_api_cpp_sync
+ */
+class SharedLocked {
+	ZTH_CLASS_NEW_DELETE(SharedLocked)
+public:
+	explicit SharedLocked(SharedMutex& mutex)
+		: m_mutex(&mutex)
+	{
+		m_mutex->lock_shared();
+	}
+
+	~SharedLocked()
+	{
+		if(m_mutex)
+			m_mutex->unlock_shared();
+	}
+
+#  if __cplusplus >= 201103L
+	SharedLocked(SharedLocked const&) = delete;
+	SharedLocked& operator=(SharedLocked const&) = delete;
+
+	SharedLocked(SharedLocked&& l) noexcept
+		: m_mutex{}
+	{
+		*this = std::move(l);
+	}
+
+	SharedLocked& operator=(SharedLocked&& l) noexcept
+	{
+		if(m_mutex)
+			m_mutex->unlock_shared();
+
+		m_mutex = l.m_mutex;
+		l.m_mutex = nullptr;
+		return *this;
+	}
+#  else	 // Pre C++11
+private:
+	SharedLocked(SharedLocked const&);
+	SharedLocked& operator=(SharedLocked const&);
+#  endif // Pre C++11
+
+private:
+	SharedMutex* m_mutex;
+};
+
+/*!
+ * \brief #zth::SharedMutex RAII, that locks and unlocks the mutex exclusively.
+ * \ingroup zth_api_cpp_sync
+ */
+class UniqueLocked {
+	ZTH_CLASS_NEW_DELETE(UniqueLocked)
+public:
+	explicit UniqueLocked(SharedMutex& mutex)
+		: m_mutex(&mutex)
+	{
+		m_mutex->lock();
+	}
+
+	~UniqueLocked()
+	{
+		if(m_mutex)
+			m_mutex->unlock();
+	}
+
+#  if __cplusplus >= 201103L
+	UniqueLocked(UniqueLocked const&) = delete;
+	UniqueLocked& operator=(UniqueLocked const&) = delete;
+
+	UniqueLocked(UniqueLocked&& l) noexcept
+		: m_mutex{}
+	{
+		*this = std::move(l);
+	}
+
+	UniqueLocked& operator=(UniqueLocked&& l) noexcept
+	{
+		if(m_mutex)
+			m_mutex->unlock();
+
+		m_mutex = l.m_mutex;
+		l.m_mutex = nullptr;
+		return *this;
+	}
+#  else	 // Pre C++11
+private:
+	UniqueLocked(UniqueLocked const&);
+	UniqueLocked& operator=(UniqueLocked const&);
+#  endif // Pre C++11
+
+private:
+	SharedMutex* m_mutex;
+};
+
+/*!
+ * \brief Fiber-aware semaphore.
+ * \ingroup zth_api_cpp_sync
+ */
+class Semaphore : public Synchronizer<> {
+	ZTH_CLASS_NEW_DELETE(Semaphore)
+public:
+	typedef unsigned int count_type;
+
+	explicit Semaphore(count_type init = 0, cow_string const& name = "Semaphore")
+		: Synchronizer(name)
+		, m_count(init)
+		, m_unblockAll()
+	{}
+
+#  if __cplusplus >= 201103L
+	Semaphore(count_type init, cow_string&& name)
+		: Synchronizer(std::move(name))
+		, m_count(init)
+		, m_unblockAll()
+	{}
+#  endif
+
+	virtual ~Semaphore() noexcept override is_default
+
+	void acquire(count_type count = 1)
+	{
+		while(m_count < count) {
+			if(count > 1)
+				m_unblockAll = true;
+
+			block();
+		}
+
+		acquired(count);
+	}
+
+	/*!
+	 * \brief Acquire, with timeout.
+	 * \return \c true when acquired, \c false on timeout
+	 */
+	bool acquire(count_type count, Timestamp const& timeout, Timestamp now = Timestamp::now())
+	{
+		while(m_count < count) {
+			if(count > 1)
+				m_unblockAll = true;
+
+			if(timeout <= now || !blockUntil(timeout, now))
+				return false;
+
+			now = Timestamp::now();
+		}
+
+		acquired(count);
+		return true;
+	}
+
+	bool acquire(count_type count, TimeInterval const& timeout,
+		     Timestamp const& now = Timestamp::now())
+	{
+		return acquire(count, now + timeout, now);
+	}
+
+	void release(count_type count = 1) noexcept
+	{
+		zth_assert(m_count + count >= m_count); // ...otherwise it wrapped around, which is
+							// probably not want you wanted...
+
+		if(unlikely(m_count + count < m_count))
+			// wrapped around, saturate
+			m_count = std::numeric_limits<count_type>::max();
+		else
+			m_count += count;
+
+		zth_dbg(sync, "[%s] Released %u", id_str(), count);
+
+		if(likely(m_count > 0)) {
+			if(!m_unblockAll) {
+				// As some fibers may be waiting for just one unit, and others for
+				// multiple, let them all try to acquire what they need.
+				unblockFirst();
+			} else if(!unblockAll()) {
+				// Nobody was waiting anymore.
+				m_unblockAll = false;
+			}
+		}
+	}
+
+	count_type value() const noexcept
+	{
+		return m_count;
+	}
+
+private:
+	void acquired(count_type count) noexcept
+	{
+		m_count -= count;
+		zth_dbg(sync, "[%s] Acquired %u", id_str(), count);
+
+		if(m_count > 0 && !m_unblockAll) {
+			// There is more to acquire. Wake the next in line.
+			unblockFirst();
 		}
 	}
 
-	void signalAll(bool queue = true) noexcept
+private:
+	count_type m_count;
+	bool m_unblockAll;
+};
+
+/*!
+ * \brief Fiber-aware signal.
+ * \ingroup zth_api_cpp_sync
+ */
+class Signal : public Synchronizer<> {
+	ZTH_CLASS_NEW_DELETE(Signal)
+public:
+	explicit Signal(cow_string const& name = "Signal")
+		: Synchronizer(name)
+		, m_signalled()
+	{}
+
+#  if __cplusplus >= 201103L
+	explicit Signal(cow_string&& name)
+		: Synchronizer(std::move(name))
+		, m_signalled()
+	{}
+#  endif
+
+	virtual ~Signal() noexcept override is_default
+
+	void wait()
+	{
+		if(!m_signalled) {
+			block();
+		} else {
+			// Do a yield() here, as one might rely on the signal to block
+			// regularly when the signal is used in a loop (see daemon
+			// pattern).
+			yield();
+		}
+
+		if(m_signalled > 0)
+			m_signalled--;
+	}
+
+	bool wait(Timestamp const& timeout, Timestamp const& now = Timestamp::now())
+	{
+		if(!m_signalled) {
+			if(!blockUntil(timeout, now))
+				// Timeout.
+				return false;
+		} else
+			yield();
+
+		if(m_signalled > 0)
+			m_signalled--;
+
+		// Got signalled.
+		return true;
+	}
+
+	bool wait(TimeInterval const& timeout, Timestamp const& now = Timestamp::now())
+	{
+		return wait(now + timeout, now);
+	}
+
+	void signal(bool queue = true, bool queueEveryTime = false) noexcept
+	{
+		zth_dbg(sync, "[%s] Signal", id_str());
+		if(!unblockFirst() && queue && m_signalled >= 0) {
+			if(m_signalled == 0 || queueEveryTime)
+				m_signalled++;
+			zth_assert(m_signalled > 0); // Otherwise, it wrapped around, which is
+						     // probably not what you want.
+		}
+
+		handoffWoken();
+	}
+
+	void signalAll(bool queue = true) noexcept
+	{
+		zth_dbg(sync, "[%s] Signal all", id_str());
+		unblockAll();
+		if(queue)
+			m_signalled = -1;
+
+		handoffWoken();
+	}
+
+	void reset() noexcept
+	{
+		m_signalled = 0;
+	}
+
+private:
+	int m_signalled;
+};
+
+template <typename T>
+class Optional {
+	ZTH_CLASS_NEW_DELETE(Optional)
+public:
+	typedef T type;
+
+	// cppcheck-suppress[uninitMemberVar,noExplicitConstructor]
+	Optional() noexcept
+		: m_valid()
+	{
+		init();
+	}
+
+	~Optional() noexcept
+	{
+		deinit();
+	}
+
+	bool valid() const noexcept
+	{
+		return m_valid
+#  ifdef ZTH_FUTURE_EXCEPTION
+		       || m_exception
+#  endif // ZTH_FUTURE_EXCEPTION
+			;
+	}
+
+	operator bool() const noexcept
+	{
+		return valid();
+	}
+
+	void reset() noexcept
+	{
+		unuse();
+	}
+
+	// cppcheck-suppress[uninitMemberVar,noExplicitConstructor]
+	Optional(type const& value)
+		: m_valid()
+	{
+		init();
+		set(value);
+	}
+
+	void set(type const& value = type()) noexcept
+	{
+		unuse();
+		use();
+		new(m_data) type(value);
+		m_valid = true;
+	}
+
+	Optional& operator=(type const& value) noexcept
+	{
+		set(value);
+		return *this;
+	}
+
+#  if __cplusplus >= 201103L
+	// cppcheck-suppress[uninitMemberVar,noExplicitConstructor]
+	Optional(type&& value) noexcept
+		: m_valid{true}
+	{
+		use();
+		new(m_data) type{std::move(value)};
+	}
+
+	void set(type&& value) noexcept
+	{
+		unuse();
+		use();
+		new(m_data) type{std::move(value)};
+		m_valid = true;
+	}
+
+	Optional& operator=(type&& value) noexcept
+	{
+		set(std::move(value));
+		return *this;
+	}
+#  endif // C++11
+
+#  ifdef ZTH_FUTURE_EXCEPTION
+	// cppcheck-suppress uninitMemberVar
+	Optional(std::exception_ptr exc) noexcept
+		: m_valid()
+		, m_exception(exc)
+	{
+		init();
+	}
+
+	void set(std::exception_ptr exception) noexcept
+	{
+		unuse();
+		m_exception = std::move(exception);
+	}
+
+	Optional& operator=(std::exception_ptr value) noexcept
+	{
+		set(value);
+		return *this;
+	}
+
+	type& value() LREF_QUALIFIED
+	{
+		zth_assert(valid());
+
+		if(m_exception)
+			std::rethrow_exception(m_exception);
+
+		void* p = m_data;
+		return *static_cast<type*>(p);
+	}
+
+	type const& value() const LREF_QUALIFIED
+	{
+		zth_assert(valid());
+
+		if(m_exception)
+			std::rethrow_exception(m_exception);
+
+		void const* p = m_data;
+		return *static_cast<type const*>(p);
+	}
+
+	std::exception_ptr exception() const noexcept
+	{
+		return m_exception;
+	}
+
+#    if __cplusplus >= 201103L
+	type&& value() &&
+	{
+		zth_assert(valid());
+
+		if(m_exception)
+			std::rethrow_exception(m_exception);
+
+		void* p = m_data;
+		return std::move(*static_cast<type*>(p));
+	}
+#    endif // C++11
+#  else	   // !ZTH_FUTURE_EXCEPTION
+	type& value() LREF_QUALIFIED noexcept
+	{
+		zth_assert(valid());
+
+		void* p = m_data;
+		return *static_cast<type*>(p);
+	}
+
+	type const& value() const LREF_QUALIFIED noexcept
+	{
+		zth_assert(valid());
+
+		void const* p = m_data;
+		return *static_cast<type const*>(p);
+	}
+
+#    if __cplusplus >= 201103L
+	type&& value() && noexcept
+	{
+		zth_assert(valid());
+
+		void* p = m_data;
+		return std::move(*static_cast<type*>(p));
+	}
+#    endif // C++11
+#  endif   // !ZTH_FUTURE_EXCEPTION
+
+private:
+	void init() noexcept
+	{
+#  ifdef ZTH_USE_VALGRIND
+		VALGRIND_MAKE_MEM_NOACCESS(m_data, sizeof(m_data));
+#  endif
+	}
+
+	void use() noexcept
+	{
+#  ifdef ZTH_USE_VALGRIND
+		VALGRIND_MAKE_MEM_UNDEFINED(m_data, sizeof(m_data));
+#  endif
+	}
+
+	void unuse() noexcept
+	{
+#  ifdef ZTH_FUTURE_EXCEPTION
+		if(m_exception)
+			m_exception = nullptr;
+#  endif // ZTH_FUTURE_EXCEPTION
+
+		if(m_valid) {
+			value().~type();
+			m_valid = false;
+#  ifdef ZTH_USE_VALGRIND
+			VALGRIND_MAKE_MEM_NOACCESS(m_data, sizeof(m_data));
+#  endif
+		}
+	}
+
+	void deinit() noexcept
+	{
+		if(m_valid) {
+			value().~type();
+#  ifdef ZTH_USE_VALGRIND
+			VALGRIND_MAKE_MEM_UNDEFINED(m_data, sizeof(m_data));
+#  endif
+		}
+	}
+
+private:
+	alignas(type) char m_data[sizeof(type)];
+	bool m_valid;
+#  ifdef ZTH_FUTURE_EXCEPTION
+	std::exception_ptr m_exception;
+#  endif // ZTH_FUTURE_EXCEPTION
+};
+
+template <>
+class Optional<void> {
+	ZTH_CLASS_NEW_DELETE(Optional)
+public:
+	typedef void type;
+
+	// cppcheck-suppress noExplicitConstructor
+	Optional(bool set = false) noexcept
+		: m_set(set)
+	{}
+
+	bool valid() const noexcept
+	{
+		return m_set
+#  ifdef ZTH_FUTURE_EXCEPTION
+		       || m_exception
+#  endif // ZTH_FUTURE_EXCEPTION
+			;
+	}
+
+	void reset() noexcept
+	{
+		m_set = false;
+#  ifdef ZTH_FUTURE_EXCEPTION
+		m_exception = nullptr;
+#  endif // ZTH_FUTURE_EXCEPTION
+	}
+
+	void set() noexcept
+	{
+		m_set = true;
+	}
+
+#  ifdef ZTH_FUTURE_EXCEPTION
+	Optional(std::exception_ptr exc) noexcept
+		: m_exception(exc)
+		, m_set()
+	{}
+
+	void set(std::exception_ptr exception) noexcept
+	{
+		m_exception = std::move(exception);
+	}
+
+	void value() const
+	{
+		zth_assert(valid());
+
+		if(m_exception)
+			std::rethrow_exception(m_exception);
+	}
+
+	std::exception_ptr exception() const noexcept
+	{
+		return m_exception;
+	}
+#  else	 // !ZTH_FUTURE_EXCEPTION
+	void value() noexcept
+	{
+		zth_assert(valid());
+	}
+#  endif // !ZTH_FUTURE_EXCEPTION
+
+private:
+#  ifdef ZTH_FUTURE_EXCEPTION
+	std::exception_ptr m_exception;
+#  endif // ZTH_FUTURE_EXCEPTION
+	bool m_set;
+};
+
+/*!
+ * \brief Fiber-aware future.
+ * \ingroup zth_api_cpp_sync
+ */
+template <typename T = void>
+class Future : public Synchronizer<> {
+	ZTH_CLASS_NEW_DELETE(Future)
+public:
+	typedef T type;
+	typedef type& indirection_type;
+	typedef type* member_type;
+
+	explicit Future(cow_string const& name = "Future")
+		: Synchronizer(name)
+	{}
+
+#  if __cplusplus >= 201103L
+	explicit Future(cow_string&& name)
+		: Synchronizer{std::move(name)}
+	{}
+#  endif
+
+	virtual ~Future() noexcept override is_default
+
+	bool valid() const noexcept
+	{
+		return m_value.valid();
+	}
+
+	operator bool() const noexcept
+	{
+		return valid();
+	}
+
+	void wait()
+	{
+		if(!valid())
+			block();
+	}
+
+	void set(type const& value = type()) noexcept
+	{
+		set_prepare();
+		m_value.set(value);
+		set_finalize();
+	}
+
+	Future& operator=(type const& value) noexcept
+	{
+		set(value);
+		return *this;
+	}
+
+#  if __cplusplus >= 201103L
+	void set(type&& value) noexcept
+	{
+		set_prepare();
+		m_value.set(std::move(value));
+		set_finalize();
+	}
+
+	Future& operator=(type&& value) noexcept
+	{
+		set(std::move(value));
+		return *this;
+	}
+#  endif
+
+#  ifdef ZTH_FUTURE_EXCEPTION
+	void set(std::exception_ptr exception) noexcept
+	{
+		set_prepare();
+		m_value.set(std::move(exception));
+		set_finalize();
+	}
+
+	Future& operator=(std::exception_ptr value) noexcept
+	{
+		set(std::move(value));
+		return *this;
+	}
+
+	std::exception_ptr exception() const noexcept
+	{
+		return m_value.exception();
+	}
+#  endif // ZTH_FUTURE_EXCEPTION
+
+	type& value() LREF_QUALIFIED
+	{
+		wait();
+		return m_value.value();
+	}
+
+	indirection_type operator*() LREF_QUALIFIED
+	{
+		return value();
+	}
+
+	member_type operator->()
+	{
+		return &value();
+	}
+
+#  if __cplusplus >= 201103L
+	type&& value() &&
+	{
+		wait();
+		return m_value.value();
+	}
+
+	type&& operator*() &&
+	{
+		return value();
+	}
+#  endif
+
+private:
+	void set_prepare() noexcept
+	{
+		zth_assert(!valid());
+	}
+
+	void set_finalize() noexcept
+	{
+		zth_dbg(sync, "[%s] Set", id_str());
+		unblockAll();
+		handoffWoken();
+	}
+
+private:
+	Optional<type> m_value;
+};
+
+template <>
+// cppcheck-suppress noConstructor
+class Future<void> : public Synchronizer<> {
+	ZTH_CLASS_NEW_DELETE(Future)
+public:
+	typedef void type;
+	typedef void indirection_type;
+	typedef void member_type;
+
+	explicit Future(cow_string const& name = "Future")
+		: Synchronizer(name)
+	{}
+
+#  if __cplusplus >= 201103L
+	explicit Future(cow_string&& name)
+		: Synchronizer(std::move(name))
+	{}
+#  endif
+
+	virtual ~Future() noexcept override is_default
+
+	bool valid() const noexcept
+	{
+		return m_value.valid();
+	}
+
+	operator bool() const noexcept
+	{
+		return valid();
+	}
+
+	void wait()
+	{
+		if(!valid())
+			block();
+	}
+
+	void set() noexcept
+	{
+		set_prepare();
+		m_value.set();
+		set_finalize();
+	}
+
+#  ifdef ZTH_FUTURE_EXCEPTION
+	void set(std::exception_ptr exception) noexcept
+	{
+		set_prepare();
+		m_value.set(std::move(exception));
+		set_finalize();
+	}
+
+	Future& operator=(std::exception_ptr value) noexcept
+	{
+		set(std::move(value));
+		return *this;
+	}
+
+	std::exception_ptr exception() const noexcept
+	{
+		return m_value.exception();
+	}
+#  endif // ZTH_FUTURE_EXCEPTION
+
+	void value()
+	{
+		wait();
+		m_value.value();
+	}
+
+	indirection_type operator*()
+	{
+		value();
+	}
+
+	member_type operator->()
+	{
+		value();
+	}
+
+private:
+	void set_prepare() noexcept
+	{
+		zth_assert(!valid());
+	}
+
+	void set_finalize() noexcept
+	{
+		zth_dbg(sync, "[%s] Set", id_str());
+		unblockAll();
+		handoffWoken();
+	}
+
+private:
+	Optional<void> m_value;
+};
+
+ZTH_STRUCTURED_BINDING_FORWARDING_NS(Future)
+
+/*!
+ * \brief Fiber-aware mailbox.
+ * \ingroup zth_api_cpp_sync
+ */
+template <typename T>
+class Mailbox : public Synchronizer<2> {
+	ZTH_CLASS_NEW_DELETE(Mailbox)
+protected:
+	enum { Queue_Put = 0, Queue_Take = 1 };
+
+public:
+	typedef T type;
+	typedef void* assigned_type;
+
+	explicit Mailbox(cow_string const& name = "Mailbox")
+		: Synchronizer(name)
+		, m_assigned()
+	{}
+
+#  if __cplusplus >= 201103L
+	explicit Mailbox(cow_string&& name)
+		: Synchronizer{std::move(name)}
+		, m_assigned()
+	{}
+#  endif // C++11
+
+	virtual ~Mailbox() noexcept override is_default
+
+	bool valid() const noexcept
+	{
+		return m_value.valid();
+	}
+
+	operator bool() const noexcept
+	{
+		return valid();
+	}
+
+	bool can_put() const noexcept
+	{
+		return !valid();
+	}
+
+	bool can_take() const noexcept
+	{
+		return valid(static_cast<Listable*>(&currentFiber()));
+	}
+
+protected:
+	bool valid(assigned_type assigned) const noexcept
+	{
+		return valid() && (!m_assigned || m_assigned == assigned);
+	}
+
+public:
+	void wait()
+	{
+		wait(static_cast<Listable*>(&currentFiber()));
+	}
+
+protected:
+	virtual void wait(assigned_type assigned)
+	{
+		while(!valid(assigned))
+			block((size_t)Queue_Take);
+	}
+
+public:
+	void wait_empty()
+	{
+		while(valid())
+			block((size_t)Queue_Put);
+	}
+
+	void put(type const& value)
+	{
+		put_prepare();
+		m_value.set(value);
+		put_finalize();
+	}
+
+	Mailbox& operator=(type const& value)
+	{
+		put(value);
+		return *this;
+	}
+
+#  if __cplusplus >= 201103L
+	void put(type&& value)
+	{
+		put_prepare();
+		m_value.set(std::move(value));
+		put_finalize();
+	}
+
+	Mailbox& operator=(type&& value)
+	{
+		put(std::move(value));
+		return *this;
+	}
+#  endif
+
+#  ifdef ZTH_FUTURE_EXCEPTION
+	void put(std::exception_ptr exception)
+	{
+		put_prepare();
+		m_value.set(std::move(exception));
+		put_finalize();
+	}
+
+	Mailbox& operator=(std::exception_ptr value)
+	{
+		put(std::move(value));
+		return *this;
+	}
+
+	std::exception_ptr exception() const noexcept
+	{
+		return m_value.exception();
+	}
+#  endif // ZTH_FUTURE_EXCEPTION
+
+	type take()
+	{
+		return take(static_cast<Listable*>(&zth::currentFiber()));
+	}
+
+protected:
+	type take(assigned_type assigned)
+	{
+		take_prepare(assigned);
+
+#  ifdef ZTH_FUTURE_EXCEPTION
+		std::exception_ptr exc = m_value.exception();
+		if(exc) {
+			take_finalize();
+			std::rethrow_exception(exc);
+		}
+#  endif // ZTH_FUTURE_EXCEPTION
+
+		type v = m_value.value();
+		take_finalize();
+		return v;
+	}
+
+	virtual void
+	wakeup(Listable& item, queue_type::user_type user, bool prio, size_t q) noexcept final
+	{
+		if(q == Queue_Take)
+			m_assigned = wakeup(item, user, prio);
+		else
+			base::wakeup(item, user, prio, q);
+	}
+
+	virtual assigned_type wakeup(Listable& item, queue_type::user_type user, bool prio) noexcept
+	{
+		base::wakeup(item, user, prio, Queue_Take);
+		return &item;
+	}
+
+private:
+	void put_prepare()
+	{
+		wait_empty();
+	}
+
+	void put_finalize() noexcept
+	{
+		zth_dbg(sync, "[%s] Put", id_str());
+		unblockFirst(Queue_Take);
+		handoffWoken();
+	}
+
+	void take_prepare(assigned_type assigned)
 	{
-		zth_dbg(sync, "[%s] Signal all", id_str());
-		unblockAll();
-		if(queue)
-			m_signalled = -1;
+		wait(assigned);
 	}
 
-	void reset() noexcept
+	void take_finalize() noexcept
 	{
-		m_signalled = 0;
+		zth_dbg(sync, "[%s] Take", id_str());
+		m_value.reset();
+		unblockFirst(Queue_Put);
 	}
 
 private:
-	int m_signalled;
+	Optional<type> m_value;
+	assigned_type m_assigned;
 };
 
-template <typename T>
-class Optional {
-	ZTH_CLASS_NEW_DELETE(Optional)
+/*!
+ * \brief Fiber-aware bounded FIFO channel.
+ *
+ * In contrast to #zth::Mailbox, a channel buffers up to \p N values.  Therefore, producers and
+ * consumers do not have to switch context for every value.  #put_n() and #take_up_to() move
+ * many values at once.
+ *
+ * After #close(), puts fail, and takes fail once the buffered values have been taken.  This
+ * ends all consumers of a fan-out pipeline.
+ *
+ * \p T must be default constructible.
+ *
+ * \ingroup zth_api_cpp_sync
+ */
+template <typename T, size_t N = 16>
+class Channel : public Synchronizer<2> {
+	ZTH_CLASS_NEW_DELETE(Channel)
+
+protected:
+	enum { Queue_Put = 0, Queue_Take = 1 };
+
 public:
 	typedef T type;
 
-	// cppcheck-suppress[uninitMemberVar,noExplicitConstructor]
-	Optional() noexcept
-		: m_valid()
-	{
-		init();
-	}
-
-	~Optional() noexcept
-	{
-		deinit();
-	}
+	explicit Channel(cow_string const& name = "Channel")
+		: Synchronizer(name)
+		, m_head()
+		, m_size()
+		, m_closed()
+	{}
 
-	bool valid() const noexcept
-	{
-		return m_valid
-#  ifdef ZTH_FUTURE_EXCEPTION
-		       || m_exception
-#  endif // ZTH_FUTURE_EXCEPTION
-			;
-	}
+#  if __cplusplus >= 201103L
+	explicit Channel(cow_string&& name)
+		: Synchronizer{std::move(name)}
+		, m_head()
+		, m_size()
+		, m_closed()
+	{}
+#  endif // C++11
 
-	operator bool() const noexcept
-	{
-		return valid();
-	}
+	virtual ~Channel() noexcept override is_default
 
-	void reset() noexcept
+	static size_t capacity() noexcept
 	{
-		unuse();
+		return N;
 	}
 
-	// cppcheck-suppress[uninitMemberVar,noExplicitConstructor]
-	Optional(type const& value)
-		: m_valid()
+	size_t size() const noexcept
 	{
-		init();
-		set(value);
+		return m_size;
 	}
 
-	void set(type const& value = type()) noexcept
+	bool empty() const noexcept
 	{
-		unuse();
-		use();
-		new(m_data) type(value);
-		m_valid = true;
+		return m_size == 0;
 	}
 
-	Optional& operator=(type const& value) noexcept
+	bool full() const noexcept
 	{
-		set(value);
-		return *this;
+		return m_size == N;
 	}
 
-#  if __cplusplus >= 201103L
-	// cppcheck-suppress[uninitMemberVar,noExplicitConstructor]
-	Optional(type&& value) noexcept
-		: m_valid{true}
+	bool closed() const noexcept
 	{
-		use();
-		new(m_data) type{std::move(value)};
+		return m_closed;
 	}
 
-	void set(type&& value) noexcept
+	bool can_put() const noexcept
 	{
-		unuse();
-		use();
-		new(m_data) type{std::move(value)};
-		m_valid = true;
+		return !full() && !closed();
 	}
 
-	Optional& operator=(type&& value) noexcept
+	bool can_take() const noexcept
 	{
-		set(std::move(value));
-		return *this;
+		return !empty();
 	}
-#  endif // C++11
 
-#  ifdef ZTH_FUTURE_EXCEPTION
-	// cppcheck-suppress uninitMemberVar
-	Optional(std::exception_ptr exc) noexcept
-		: m_valid()
-		, m_exception(exc)
+	/*!
+	 * \brief Close the channel, and unblock all fibers that wait for it.
+	 */
+	void close() noexcept
 	{
-		init();
+		zth_dbg(sync, "[%s] Close", id_str());
+		m_closed = true;
+		unblockAll(Queue_Put);
+		unblockAll(Queue_Take);
 	}
 
-	void set(std::exception_ptr exception) noexcept
+	/*!
+	 * \brief Put a value, and wait for room when the channel is full.
+	 * \return \c false when the channel is closed
+	 */
+	bool put(type const& value)
 	{
-		unuse();
-		m_exception = std::move(exception);
-	}
+		if(!wait_put())
+			return false;
 
-	Optional& operator=(std::exception_ptr value) noexcept
-	{
-		set(value);
-		return *this;
+		push(value);
+		put_finalize(1);
+		return true;
 	}
 
-	type& value() LREF_QUALIFIED
+	/*! \brief Put a value, if there is room. */
+	bool try_put(type const& value)
 	{
-		zth_assert(valid());
-
-		if(m_exception)
-			std::rethrow_exception(m_exception);
+		if(!can_put())
+			return false;
 
-		void* p = m_data;
-		return *static_cast<type*>(p);
+		push(value);
+		put_finalize(1);
+		return true;
 	}
 
-	type const& value() const LREF_QUALIFIED
+	/*! \brief Put a value, and wait for room until the given \p timeout. */
+	bool try_put(type const& value, Timestamp const& timeout)
 	{
-		zth_assert(valid());
-
-		if(m_exception)
-			std::rethrow_exception(m_exception);
+		if(!wait_put(&timeout))
+			return false;
 
-		void const* p = m_data;
-		return *static_cast<type const*>(p);
+		push(value);
+		put_finalize(1);
+		return true;
 	}
 
-	std::exception_ptr exception() const noexcept
+	bool try_put(type const& value, TimeInterval const& timeout)
 	{
-		return m_exception;
+		return try_put(value, Timestamp::now() + timeout);
 	}
 
-#    if __cplusplus >= 201103L
-	type&& value() &&
+#  if __cplusplus >= 201103L
+	bool put(type&& value)
 	{
-		zth_assert(valid());
-
-		if(m_exception)
-			std::rethrow_exception(m_exception);
+		if(!wait_put())
+			return false;
 
-		void* p = m_data;
-		return std::move(*static_cast<type*>(p));
+		push(std::move(value));
+		put_finalize(1);
+		return true;
 	}
-#    endif // C++11
-#  else	   // !ZTH_FUTURE_EXCEPTION
-	type& value() LREF_QUALIFIED noexcept
+#  endif
+
+	/*!
+	 * \brief Put \p count values, and wait for room when the channel is full.
+	 *
+	 * As many values as fit are put at once, before waking up consumers.
+	 *
+	 * \return the number of values put, which is less than \p count when the channel is closed
+	 */
+	size_t put_n(type const* values, size_t count)
 	{
-		zth_assert(valid());
+		zth_assert(values || !count);
 
-		void* p = m_data;
-		return *static_cast<type*>(p);
-	}
+		size_t done = 0;
+		while(done < count && wait_put()) {
+			size_t n = 0;
+			for(; done < count && !full(); n++)
+				push(values[done++]);
 
-	type const& value() const LREF_QUALIFIED noexcept
-	{
-		zth_assert(valid());
+			put_finalize(n);
+		}
 
-		void const* p = m_data;
-		return *static_cast<type const*>(p);
+		return done;
 	}
 
-#    if __cplusplus >= 201103L
-	type&& value() && noexcept
+	/*!
+	 * \brief Take a value, and wait for one when the channel is empty.
+	 * \return \c false when the channel is closed and empty
+	 */
+	bool take(type& value)
 	{
-		zth_assert(valid());
+		if(!wait_take())
+			return false;
 
-		void* p = m_data;
-		return std::move(*static_cast<type*>(p));
+		pop(value);
+		take_finalize(1);
+		return true;
 	}
-#    endif // C++11
-#  endif   // !ZTH_FUTURE_EXCEPTION
 
-private:
-	void init() noexcept
+	/*! \brief Take a value, if there is one. */
+	bool try_take(type& value)
 	{
-#  ifdef ZTH_USE_VALGRIND
-		VALGRIND_MAKE_MEM_NOACCESS(m_data, sizeof(m_data));
-#  endif
-	}
+		if(!can_take())
+			return false;
 
-	void use() noexcept
-	{
-#  ifdef ZTH_USE_VALGRIND
-		VALGRIND_MAKE_MEM_UNDEFINED(m_data, sizeof(m_data));
-#  endif
+		pop(value);
+		take_finalize(1);
+		return true;
 	}
 
-	void unuse() noexcept
+	/*! \brief Take a value, and wait for one until the given \p timeout. */
+	bool try_take(type& value, Timestamp const& timeout)
 	{
-#  ifdef ZTH_FUTURE_EXCEPTION
-		if(m_exception)
-			m_exception = nullptr;
-#  endif // ZTH_FUTURE_EXCEPTION
+		if(!wait_take(&timeout))
+			return false;
 
-		if(m_valid) {
-			value().~type();
-			m_valid = false;
-#  ifdef ZTH_USE_VALGRIND
-			VALGRIND_MAKE_MEM_NOACCESS(m_data, sizeof(m_data));
-#  endif
-		}
+		pop(value);
+		take_finalize(1);
+		return true;
 	}
 
-	void deinit() noexcept
+	bool try_take(type& value, TimeInterval const& timeout)
 	{
-		if(m_valid) {
-			value().~type();
-#  ifdef ZTH_USE_VALGRIND
-			VALGRIND_MAKE_MEM_UNDEFINED(m_data, sizeof(m_data));
-#  endif
-		}
+		return try_take(value, Timestamp::now() + timeout);
 	}
 
-private:
-	alignas(type) char m_data[sizeof(type)];
-	bool m_valid;
-#  ifdef ZTH_FUTURE_EXCEPTION
-	std::exception_ptr m_exception;
-#  endif // ZTH_FUTURE_EXCEPTION
-};
+	/*!
+	 * \brief Take up to \p count values, and wait for at least one when the channel is empty.
+	 * \return the number of values taken, which is 0 when the channel is closed and empty
+	 */
+	size_t take_up_to(type* values, size_t count)
+	{
+		zth_assert(values || !count);
 
-template <>
-class Optional<void> {
-	ZTH_CLASS_NEW_DELETE(Optional)
-public:
-	typedef void type;
+		if(!count || !wait_take())
+			return 0;
 
-	// cppcheck-suppress noExplicitConstructor
-	Optional(bool set = false) noexcept
-		: m_set(set)
-	{}
+		size_t n = 0;
+		for(; n < count && !empty(); n++)
+			pop(values[n]);
 
-	bool valid() const noexcept
-	{
-		return m_set
-#  ifdef ZTH_FUTURE_EXCEPTION
-		       || m_exception
-#  endif // ZTH_FUTURE_EXCEPTION
-			;
+		take_finalize(n);
+		return n;
 	}
 
-	void reset() noexcept
-	{
-		m_set = false;
-#  ifdef ZTH_FUTURE_EXCEPTION
-		m_exception = nullptr;
-#  endif // ZTH_FUTURE_EXCEPTION
-	}
+private:
+	bool wait_put(Timestamp const* timeout = nullptr)
+	{
+		while(full() && !closed()) {
+			if(!timeout) {
+				block((size_t)Queue_Put);
+			} else {
+				Timestamp now = Timestamp::now();
+				if(*timeout <= now || !blockUntil(*timeout, now, (size_t)Queue_Put))
+					return false;
+			}
+		}
 
-	void set() noexcept
-	{
-		m_set = true;
+		return !closed();
 	}
 
-#  ifdef ZTH_FUTURE_EXCEPTION
-	Optional(std::exception_ptr exc) noexcept
-		: m_exception(exc)
-		, m_set()
-	{}
+	bool wait_take(Timestamp const* timeout = nullptr)
+	{
+		while(empty() && !closed()) {
+			if(!timeout) {
+				block((size_t)Queue_Take);
+			} else {
+				Timestamp now = Timestamp::now();
+				if(*timeout <= now || !blockUntil(*timeout, now, (size_t)Queue_Take))
+					return false;
+			}
+		}
 
-	void set(std::exception_ptr exception) noexcept
+		return !empty();
+	}
+
+	void push(type const& value)
 	{
-		m_exception = std::move(exception);
+		zth_assert(!full());
+		m_buffer[(m_head + m_size) % N] = value;
+		m_size++;
 	}
 
-	void value() const
+#  if __cplusplus >= 201103L
+	void push(type&& value)
 	{
-		zth_assert(valid());
+		zth_assert(!full());
+		m_buffer[(m_head + m_size) % N] = std::move(value);
+		m_size++;
+	}
+#  endif
 
-		if(m_exception)
-			std::rethrow_exception(m_exception);
+	void pop(type& value)
+	{
+		zth_assert(!empty());
+#  if __cplusplus >= 201103L
+		value = std::move(m_buffer[m_head]);
+#  else
+		value = m_buffer[m_head];
+		m_buffer[m_head] = type();
+#  endif
+		m_head = (m_head + 1U) % N;
+		m_size--;
 	}
 
-	std::exception_ptr exception() const noexcept
+	void put_finalize(size_t count) noexcept
 	{
-		return m_exception;
+		zth_dbg(sync, "[%s] Put %u", id_str(), (unsigned int)count);
+		for(size_t i = 0; i < count && unblockFirst(Queue_Take); i++)
+			;
 	}
-#  else	 // !ZTH_FUTURE_EXCEPTION
-	void value() noexcept
+
+	void take_finalize(size_t count) noexcept
 	{
-		zth_assert(valid());
+		zth_dbg(sync, "[%s] Take %u", id_str(), (unsigned int)count);
+		for(size_t i = 0; i < count && unblockFirst(Queue_Put); i++)
+			;
 	}
-#  endif // !ZTH_FUTURE_EXCEPTION
 
 private:
-#  ifdef ZTH_FUTURE_EXCEPTION
-	std::exception_ptr m_exception;
-#  endif // ZTH_FUTURE_EXCEPTION
-	bool m_set;
+	type m_buffer[N];
+	size_t m_head;
+	size_t m_size;
+	bool m_closed;
 };
 
 /*!
- * \brief Fiber-aware future.
+ * \brief Fiber-aware barrier/gate.
  * \ingroup zth_api_cpp_sync
  */
-template <typename T = void>
-class Future : public Synchronizer<> {
-	ZTH_CLASS_NEW_DELETE(Future)
+class Gate : public Synchronizer<> {
+	ZTH_CLASS_NEW_DELETE(Gate)
 public:
-	typedef T type;
-	typedef type& indirection_type;
-	typedef type* member_type;
-
-	explicit Future(cow_string const& name = "Future")
+	explicit Gate(size_t count, cow_string const& name = "Gate")
 		: Synchronizer(name)
+		, m_count(count)
+		, m_current()
 	{}
 
 #  if __cplusplus >= 201103L
-	explicit Future(cow_string&& name)
-		: Synchronizer{std::move(name)}
+	Gate(size_t count, cow_string&& name)
+		: Synchronizer(std::move(name))
+		, m_count(count)
+		, m_current()
 	{}
 #  endif
 
-	virtual ~Future() noexcept override is_default
+	virtual ~Gate() noexcept override is_default
 
-	bool valid() const noexcept
+	bool pass() noexcept
 	{
-		return m_value.valid();
+		zth_dbg(sync, "[%s] Pass", id_str());
+		if(++m_current >= count()) {
+			m_current -= count();
+			unblockAll();
+			return true;
+		} else {
+			return false;
+		}
 	}
 
-	operator bool() const noexcept
+	void wait()
 	{
-		return valid();
+		if(!pass())
+			block();
 	}
 
-	void wait()
+	size_t count() const noexcept
 	{
-		if(!valid())
-			block();
+		return m_count;
 	}
 
-	void set(type const& value = type()) noexcept
+	size_t current() const noexcept
 	{
-		set_prepare();
-		m_value.set(value);
-		set_finalize();
+		return m_current;
 	}
 
-	Future& operator=(type const& value) noexcept
+private:
+	size_t const m_count;
+	size_t m_current;
+};
+
+
+/*!
+ * \brief Thread-safe synchronization primitives.
+ *
+ * The synchronizers in this namespace can be shared by fibers of different Workers, and they
+ * can be signaled by any thread, even by threads without a Worker.  The uncontended path only
+ * uses atomics.  When a fiber has to block, it is parked at its own Worker.  That Worker is
+ * kept alive (see #zth::Worker::keepAlive()), and woken up via #zth::Worker::post() when the
+ * fiber is unblocked by another thread.
+ *
+ * These synchronizers are more expensive than the ones in the \c zth namespace, so only use
+ * them when fibers of different Workers actually have to synchronize.  Timed waits are not
+ * supported.
+ *
+ * \ingroup zth_api_cpp_sync
+ */
+namespace mt {
+
+/*!
+ * \brief Base class of the thread-safe synchronizers.
+ *
+ * All state is kept in one atomic word.  The lowest bit is a spin lock, which protects the
+ * queue of blocked fibers.  The second bit is set when the queue is not empty.  Derived classes
+ * use the other bits.  The state may only be changed when the spin lock is not taken, except
+ * by the one holding it.
+ *
+ * Releasing the spin lock is the last access to the object.  So, a fiber that got unblocked
+ * may destruct the synchronizer right away.
+ *
+ * \ingroup zth_api_cpp_sync
+ */
+class SynchronizerBase : public UniqueID<SynchronizerBase> {
+	ZTH_CLASS_NOCOPY(SynchronizerBase)
+protected:
+	typedef unsigned int state_type;
+	typedef List<> queue_type;
+
+	enum { QueueLocked = 1U, QueueNonEmpty = 2U, StateShift = 2 };
+
+	static state_type const MaxValue = ~0U >> StateShift;
+
+	struct Blocked : public Listable {
+		Fiber* fiber;
+		Worker* worker;
+		state_type arg;
+		// Used to unblock the fiber from another thread.
+		Worker::InboxItem inbox;
+	};
+
+	explicit SynchronizerBase(cow_string const& name, state_type value = 0)
+		: UniqueID(Config::NamedSynchronizer ? name.str() : string())
+		, m_state(value << StateShift)
+	{}
+
+public:
+	virtual ~SynchronizerBase() noexcept override
 	{
-		set(value);
-		return *this;
+		zth_dbg(sync, "[%s] Destruct", id_str());
+		zth_assert(m_queue.empty());
 	}
 
-#  if __cplusplus >= 201103L
-	void set(type&& value) noexcept
+protected:
+	/*! \brief Return the current raw state. */
+	state_type load() const noexcept
 	{
-		set_prepare();
-		m_value.set(std::move(value));
-		set_finalize();
+		return __atomic_load_n(&m_state, __ATOMIC_ACQUIRE);
 	}
 
-	Future& operator=(type&& value) noexcept
+	/*! \brief Return the raw state with the given value and an unlocked, empty queue. */
+	static constexpr state_type encode(state_type value) noexcept
 	{
-		set(std::move(value));
-		return *this;
+		return value << StateShift;
 	}
-#  endif
 
-#  ifdef ZTH_FUTURE_EXCEPTION
-	void set(std::exception_ptr exception) noexcept
+	/*! \brief Return the value of the derived class from the given raw state. */
+	static constexpr state_type value(state_type raw) noexcept
 	{
-		set_prepare();
-		m_value.set(std::move(exception));
-		set_finalize();
+		return raw >> StateShift;
 	}
 
-	Future& operator=(std::exception_ptr value) noexcept
+	/*! \brief Check if there are blocked fibers in the given raw state. */
+	static constexpr bool waiting(state_type raw) noexcept
 	{
-		set(std::move(value));
-		return *this;
+		return (raw & QueueNonEmpty) != 0;
 	}
 
-	std::exception_ptr exception() const noexcept
+	/*!
+	 * \brief Try to change the value, given the \p raw state that was read before.
+	 *
+	 * This fails when the state was changed in the mean time, or when the queue is locked.
+	 * In that case, \p raw is updated with the current state.
+	 */
+	bool update(state_type& raw, state_type value) noexcept
 	{
-		return m_value.exception();
+		zth_assert(value <= MaxValue);
+
+		raw &= ~(state_type)QueueLocked;
+		if(likely(__atomic_compare_exchange_n(
+			   &m_state, &raw, (raw & QueueNonEmpty) | encode(value), false,
+			   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)))
+			return true;
+
+		if(raw & QueueLocked)
+			relax();
+
+		return false;
 	}
-#  endif // ZTH_FUTURE_EXCEPTION
 
-	type& value() LREF_QUALIFIED
+	/*!
+	 * \brief Take the spin lock of the queue.
+	 * \return the raw state, while being locked
+	 */
+	state_type lockQueue() noexcept
+	{
+		state_type raw = __atomic_load_n(&m_state, __ATOMIC_RELAXED);
+		while(true) {
+			if(unlikely(raw & QueueLocked)) {
+				relax();
+				raw = __atomic_load_n(&m_state, __ATOMIC_RELAXED);
+			} else if(likely(__atomic_compare_exchange_n(
+					  &m_state, &raw, raw | QueueLocked, true, __ATOMIC_ACQUIRE,
+					  __ATOMIC_RELAXED))) {
+				return raw | QueueLocked;
+			}
+		}
+	}
+
+	/*!
+	 * \brief Release the spin lock of the queue, and set the new value.
+	 * \details Do not touch this object after calling this function.
+	 */
+	void unlockQueue(state_type value) noexcept
 	{
-		wait();
-		return m_value.value();
+		zth_assert(value <= MaxValue);
+		zth_assert(__atomic_load_n(&m_state, __ATOMIC_RELAXED) & QueueLocked);
+
+		state_type raw = encode(value);
+		if(!m_queue.empty())
+			raw |= QueueNonEmpty;
+
+		__atomic_store_n(&m_state, raw, __ATOMIC_RELEASE);
 	}
 
-	indirection_type operator*() LREF_QUALIFIED
+	/*!
+	 * \brief Block the current fiber.
+	 *
+	 * The queue must be locked by the caller.  This function releases it, and sets the given
+	 * value.
+	 *
+	 * \param value the new value, see #unlockQueue()
+	 * \param arg an argument that is saved with the blocked fiber; see #front()
+	 */
+	void block(state_type value, state_type arg = 0)
 	{
-		return value();
+		// Any thread may call this function, so check if it has a Worker at all.
+		Worker* w = Worker::instance();
+		Fiber* f = w ? w->currentFiber() : nullptr;
+		if(unlikely(!f)) {
+			unlockQueue(value);
+			zth_throw(not_in_fiber());
+		}
+
+		Blocked b;
+		b.fiber = f;
+		b.worker = w;
+		b.arg = arg;
+		m_queue.push_back(b);
+
+		zth_dbg(sync, "[%s] Block %s", id_str(), f->id_str());
+		w->release(*f);
+		f->nap(Timestamp::null());
+		w->keepAlive();
+
+		// From now on, any thread may unblock us.
+		unlockQueue(value);
+		w->schedule();
 	}
 
-	member_type operator->()
+	/*!
+	 * \brief Return the first blocked fiber.
+	 * \details The queue must be locked by the caller.
+	 */
+	Blocked const* front() const noexcept
 	{
-		return &value();
+		return m_queue.empty() ? nullptr : static_cast<Blocked const*>(&m_queue.front());
 	}
 
-#  if __cplusplus >= 201103L
-	type&& value() &&
+	/*!
+	 * \brief Move the first blocked fiber to the given list.
+	 * \details The queue must be locked by the caller.
+	 * \return \c false when there was no blocked fiber
+	 */
+	bool dequeue(queue_type& wake) noexcept
 	{
-		wait();
-		return m_value.value();
+		if(m_queue.empty())
+			return false;
+
+		Listable& b = m_queue.front();
+		m_queue.pop_front();
+		wake.push_back(b);
+		return true;
 	}
 
-	type&& operator*() &&
+	/*!
+	 * \brief Move all blocked fibers to the given list.
+	 * \details The queue must be locked by the caller.
+	 */
+	void dequeueAll(queue_type& wake) noexcept
 	{
-		return value();
+		while(dequeue(wake))
+			;
+	}
+
+	/*!
+	 * \brief Unblock the fibers that were moved to the given list.
+	 * \details Call this after #unlockQueue().
+	 */
+	static void unblock(queue_type& wake) noexcept
+	{
+		Worker* self = Worker::instance();
+
+		while(!wake.empty()) {
+			Blocked& b = static_cast<Blocked&>(wake.front());
+			wake.pop_front();
+
+			// The fiber may continue right away, which invalidates b.
+			Fiber* f = b.fiber;
+			Worker* w = b.worker;
+
+			if(w == self) {
+				unblockLocal(f);
+			} else {
+				// The fiber stays blocked, and b valid, till w processed the item.
+				b.inbox.fiber = nullptr;
+				b.inbox.f = &unblockLocal;
+				b.inbox.arg = f;
+				w->post(b.inbox);
+			}
+		}
 	}
-#  endif
 
 private:
-	void set_prepare() noexcept
+	static void unblockLocal(void* fiber) noexcept
 	{
-		zth_assert(!valid());
+		Fiber& f = *static_cast<Fiber*>(fiber);
+		Worker& w = currentWorker();
+
+		zth_dbg(sync, "Unblock %s", f.id_str());
+		f.wakeup();
+		w.add(&f);
+		w.keepAlive(false);
 	}
 
-	void set_finalize() noexcept
+	static void relax() noexcept
 	{
-		zth_dbg(sync, "[%s] Set", id_str());
-		unblockAll();
+#  if defined(__i386__) || defined(__x86_64__)
+		__builtin_ia32_pause();
+#  elif defined(__aarch64__)
+		__asm__ volatile("yield");
+#  endif
 	}
 
 private:
-	Optional<type> m_value;
+	state_type m_state;
+	queue_type m_queue;
 };
 
-template <>
-// cppcheck-suppress noConstructor
-class Future<void> : public Synchronizer<> {
-	ZTH_CLASS_NEW_DELETE(Future)
+/*!
+ * \brief Thread-safe fiber-aware mutex.
+ * \see zth::Mutex
+ * \ingroup zth_api_cpp_sync
+ */
+class Mutex : public SynchronizerBase {
+	ZTH_CLASS_NEW_DELETE(Mutex)
 public:
-	typedef void type;
-	typedef void indirection_type;
-	typedef void member_type;
-
-	explicit Future(cow_string const& name = "Future")
-		: Synchronizer(name)
+	explicit Mutex(cow_string const& name = "mt::Mutex")
+		: SynchronizerBase(name)
 	{}
 
-#  if __cplusplus >= 201103L
-	explicit Future(cow_string&& name)
-		: Synchronizer(std::move(name))
-	{}
-#  endif
+	virtual ~Mutex() noexcept override is_default
 
-	virtual ~Future() noexcept override is_default
+	void lock()
+	{
+		state_type raw = encode(0);
+		while(unlikely(!update(raw, 1))) {
+			if(!value(raw))
+				// Changed in the mean time, but still unlocked. Retry.
+				continue;
 
-	bool valid() const noexcept
+			raw = lockQueue();
+			if(!value(raw)) {
+				unlockQueue(1);
+				break;
+			}
+
+			block(1);
+			raw = encode(0);
+		}
+
+		zth_dbg(sync, "[%s] Locked", id_str());
+	}
+
+	bool trylock() noexcept
+	{
+		state_type raw = load();
+		while(!value(raw))
+			if(update(raw, 1)) {
+				zth_dbg(sync, "[%s] Locked", id_str());
+				return true;
+			}
+
+		return false;
+	}
+
+	void unlock() noexcept
+	{
+		zth_dbg(sync, "[%s] Unlocked", id_str());
+
+		state_type raw = encode(1);
+		if(likely(update(raw, 0)))
+			return;
+
+		zth_assert(value(raw));
+
+		queue_type wake;
+		lockQueue();
+		dequeue(wake);
+		unlockQueue(0);
+		unblock(wake);
+	}
+};
+
+/*!
+ * \brief Thread-safe mutex RAII, that locks and unlocks the mutex automatically.
+ * \ingroup zth_api_cpp_sync
+ */
+class Locked {
+	ZTH_CLASS_NEW_DELETE(Locked)
+	ZTH_CLASS_NOCOPY(Locked)
+public:
+	explicit Locked(Mutex& mutex)
+		: m_mutex(mutex)
+	{
+		m_mutex.lock();
+	}
+
+	~Locked()
 	{
-		return m_value.valid();
+		m_mutex.unlock();
 	}
 
-	operator bool() const noexcept
+private:
+	Mutex& m_mutex;
+};
+
+/*!
+ * \brief Thread-safe fiber-aware semaphore.
+ *
+ * Blocked fibers are unblocked in order, but a fiber that does not have to block can take
+ * the count before the unblocked fiber does.
+ *
+ * \see zth::Semaphore
+ * \ingroup zth_api_cpp_sync
+ */
+class Semaphore : public SynchronizerBase {
+	ZTH_CLASS_NEW_DELETE(Semaphore)
+public:
+	typedef state_type count_type;
+
+	explicit Semaphore(count_type init = 0, cow_string const& name = "mt::Semaphore")
+		: SynchronizerBase(name, init)
 	{
-		return valid();
+		zth_assert(init <= max());
 	}
 
-	void wait()
+	virtual ~Semaphore() noexcept override is_default
+
+	static constexpr count_type max() noexcept
 	{
-		if(!valid())
-			block();
+		return MaxValue;
 	}
 
-	void set() noexcept
+	void acquire(count_type count = 1)
 	{
-		set_prepare();
-		m_value.set();
-		set_finalize();
+		state_type raw = load();
+		while(true) {
+			count_type v = value(raw);
+			if(v >= count) {
+				if(update(raw, v - count))
+					break;
+				continue;
+			}
+
+			raw = lockQueue();
+			v = value(raw);
+			if(v >= count) {
+				unlockQueue(v - count);
+				break;
+			}
+
+			block(v, count);
+			raw = load();
+		}
+
+		zth_dbg(sync, "[%s] Acquired %u", id_str(), count);
 	}
 
-#  ifdef ZTH_FUTURE_EXCEPTION
-	void set(std::exception_ptr exception) noexcept
+	bool tryacquire(count_type count = 1) noexcept
 	{
-		set_prepare();
-		m_value.set(std::move(exception));
-		set_finalize();
+		state_type raw = load();
+		for(count_type v = value(raw); v >= count; v = value(raw))
+			if(update(raw, v - count))
+				return true;
+
+		return false;
 	}
 
-	Future& operator=(std::exception_ptr value) noexcept
+	void release(count_type count = 1) noexcept
 	{
-		set(std::move(value));
-		return *this;
+		zth_dbg(sync, "[%s] Released %u", id_str(), count);
+
+		state_type raw = load();
+		while(!waiting(raw))
+			if(update(raw, add(value(raw), count)))
+				return;
+
+		queue_type wake;
+		count_type v = add(value(lockQueue()), count);
+
+		// Unblock the fibers in line that can get what they need.
+		count_type avail = v;
+		for(Blocked const* b = front(); b && b->arg <= avail; b = front()) {
+			avail -= b->arg;
+			dequeue(wake);
+		}
+
+		unlockQueue(v);
+		unblock(wake);
 	}
 
-	std::exception_ptr exception() const noexcept
+	count_type value() const noexcept
 	{
-		return m_value.exception();
+		return SynchronizerBase::value(load());
 	}
-#  endif // ZTH_FUTURE_EXCEPTION
 
-	void value()
+private:
+	using SynchronizerBase::value;
+
+	static count_type add(count_type v, count_type count) noexcept
 	{
-		wait();
-		m_value.value();
+		// ...otherwise it wraps around, which is probably not want you wanted...
+		zth_assert(v <= max() - count);
+
+		if(unlikely(v > max() - count))
+			// Saturate.
+			return max();
+
+		return v + count;
 	}
+};
 
-	indirection_type operator*()
+/*!
+ * \brief Thread-safe fiber-aware signal.
+ * \see zth::Signal
+ * \ingroup zth_api_cpp_sync
+ */
+class Signal : public SynchronizerBase {
+	ZTH_CLASS_NEW_DELETE(Signal)
+public:
+	explicit Signal(cow_string const& name = "mt::Signal")
+		: SynchronizerBase(name)
+	{}
+
+	virtual ~Signal() noexcept override is_default
+
+	void wait()
 	{
-		value();
+		state_type raw = load();
+		while(true) {
+			state_type v = value(raw);
+			if(v == Sticky)
+				break;
+
+			if(v > 0) {
+				if(update(raw, v - 1))
+					break;
+				continue;
+			}
+
+			raw = lockQueue();
+			if(value(raw) == 0) {
+				// Whoever unblocks us, consumes the signal on our behalf.
+				block(0);
+				return;
+			}
+
+			unlockQueue(value(raw));
+			raw = load();
+		}
+
+		// Do a yield() here, as one might rely on the signal to block regularly when
+		// the signal is used in a loop (see daemon pattern).
+		yield();
 	}
 
-	member_type operator->()
+	void signal(bool queue = true, bool queueEveryTime = false) noexcept
 	{
-		value();
+		zth_dbg(sync, "[%s] Signal", id_str());
+
+		state_type raw = load();
+		while(!waiting(raw)) {
+			state_type v = queued(value(raw), queue, queueEveryTime);
+			if(v == value(raw) || update(raw, v))
+				return;
+		}
+
+		queue_type wake;
+		raw = lockQueue();
+		if(dequeue(wake))
+			unlockQueue(value(raw));
+		else
+			unlockQueue(queued(value(raw), queue, queueEveryTime));
+
+		unblock(wake);
 	}
 
-private:
-	void set_prepare() noexcept
+	void signalAll(bool queue = true) noexcept
 	{
-		zth_assert(!valid());
+		zth_dbg(sync, "[%s] Signal all", id_str());
+
+		queue_type wake;
+		state_type raw = lockQueue();
+		dequeueAll(wake);
+		unlockQueue(queue ? (state_type)Sticky : value(raw));
+		unblock(wake);
 	}
 
-	void set_finalize() noexcept
+	void reset() noexcept
 	{
-		zth_dbg(sync, "[%s] Set", id_str());
-		unblockAll();
+		state_type raw = load();
+		while(value(raw) && !update(raw, 0))
+			;
 	}
 
 private:
-	Optional<void> m_value;
-};
+	static state_type const Sticky = MaxValue;
 
-ZTH_STRUCTURED_BINDING_FORWARDING_NS(Future)
+	static state_type queued(state_type v, bool queue, bool queueEveryTime) noexcept
+	{
+		if(!queue || v == Sticky || (v > 0 && !queueEveryTime))
+			return v;
+
+		// Otherwise, it wraps around, which is probably not what you want.
+		zth_assert(v + 1 < Sticky);
+		return v + 1 < Sticky ? v + 1 : v;
+	}
+};
 
 /*!
- * \brief Fiber-aware mailbox.
+ * \brief Thread-safe fiber-aware future.
+ *
+ * The value can be set by any thread, once.
+ *
+ * \see zth::Future
  * \ingroup zth_api_cpp_sync
  */
-template <typename T>
-class Mailbox : public Synchronizer<2> {
-	ZTH_CLASS_NEW_DELETE(Mailbox)
-protected:
-	enum { Queue_Put = 0, Queue_Take = 1 };
-
+template <typename T = void>
+class Future : public SynchronizerBase {
+	ZTH_CLASS_NEW_DELETE(Future)
 public:
 	typedef T type;
-	typedef void* assigned_type;
-
-	explicit Mailbox(cow_string const& name = "Mailbox")
-		: Synchronizer(name)
-		, m_assigned()
-	{}
 
-#  if __cplusplus >= 201103L
-	explicit Mailbox(cow_string&& name)
-		: Synchronizer{std::move(name)}
-		, m_assigned()
+	explicit Future(cow_string const& name = "mt::Future")
+		: SynchronizerBase(name)
 	{}
-#  endif // C++11
 
-	virtual ~Mailbox() noexcept override is_default
+	virtual ~Future() noexcept override is_default
 
 	bool valid() const noexcept
 	{
-		return m_value.valid();
+		return value(load()) != 0;
 	}
 
 	operator bool() const noexcept
@@ -1329,196 +3145,215 @@ public:
 		return valid();
 	}
 
-	bool can_put() const noexcept
+	void wait()
 	{
-		return !valid();
+		if(likely(valid()))
+			return;
+
+		state_type raw = lockQueue();
+		if(value(raw))
+			unlockQueue(value(raw));
+		else
+			block(0);
 	}
 
-	bool can_take() const noexcept
+	void set(type const& v = type()) noexcept
 	{
-		return valid(static_cast<Listable*>(&currentFiber()));
+		zth_assert(!valid());
+		m_value.set(v);
+		set_finalize();
 	}
 
-protected:
-	bool valid(assigned_type assigned) const noexcept
+	Future& operator=(type const& v) noexcept
 	{
-		return valid() && (!m_assigned || m_assigned == assigned);
+		set(v);
+		return *this;
 	}
 
-public:
-	void wait()
+#  if __cplusplus >= 201103L
+	void set(type&& v) noexcept
 	{
-		wait(static_cast<Listable*>(&currentFiber()));
+		zth_assert(!valid());
+		m_value.set(std::move(v));
+		set_finalize();
 	}
 
-protected:
-	virtual void wait(assigned_type assigned)
+	Future& operator=(type&& v) noexcept
 	{
-		while(!valid(assigned))
-			block((size_t)Queue_Take);
+		set(std::move(v));
+		return *this;
 	}
+#  endif
 
-public:
-	void wait_empty()
+#  ifdef ZTH_FUTURE_EXCEPTION
+	void set(std::exception_ptr exception) noexcept
 	{
-		while(valid())
-			block((size_t)Queue_Put);
+		zth_assert(!valid());
+		m_value.set(std::move(exception));
+		set_finalize();
 	}
 
-	void put(type const& value)
+	Future& operator=(std::exception_ptr v) noexcept
 	{
-		put_prepare();
-		m_value.set(value);
-		put_finalize();
+		set(std::move(v));
+		return *this;
 	}
 
-	Mailbox& operator=(type const& value)
+	std::exception_ptr exception() const noexcept
 	{
-		put(value);
-		return *this;
+		return valid() ? m_value.exception() : std::exception_ptr();
 	}
+#  endif // ZTH_FUTURE_EXCEPTION
 
-#  if __cplusplus >= 201103L
-	void put(type&& value)
+	type& value() LREF_QUALIFIED
 	{
-		put_prepare();
-		m_value.set(std::move(value));
-		put_finalize();
+		wait();
+		return m_value.value();
 	}
 
-	Mailbox& operator=(type&& value)
+	type& operator*() LREF_QUALIFIED
 	{
-		put(std::move(value));
-		return *this;
+		return value();
 	}
-#  endif
 
-#  ifdef ZTH_FUTURE_EXCEPTION
-	void put(std::exception_ptr exception)
+	type* operator->()
 	{
-		put_prepare();
-		m_value.set(std::move(exception));
-		put_finalize();
+		return &value();
 	}
 
-	Mailbox& operator=(std::exception_ptr value)
+private:
+	using SynchronizerBase::value;
+
+	void set_finalize() noexcept
 	{
-		put(std::move(value));
-		return *this;
+		zth_dbg(sync, "[%s] Set", id_str());
+
+		queue_type wake;
+		lockQueue();
+		dequeueAll(wake);
+		unlockQueue(1);
+		unblock(wake);
 	}
 
-	std::exception_ptr exception() const noexcept
+private:
+	Optional<type> m_value;
+};
+
+template <>
+class Future<void> : public SynchronizerBase {
+	ZTH_CLASS_NEW_DELETE(Future)
+public:
+	typedef void type;
+
+	explicit Future(cow_string const& name = "mt::Future")
+		: SynchronizerBase(name)
+	{}
+
+	virtual ~Future() noexcept override is_default
+
+	bool valid() const noexcept
 	{
-		return m_value.exception();
+		return value(load()) != 0;
 	}
-#  endif // ZTH_FUTURE_EXCEPTION
 
-	type take()
+	operator bool() const noexcept
 	{
-		return take(static_cast<Listable*>(&zth::currentFiber()));
+		return valid();
 	}
 
-protected:
-	type take(assigned_type assigned)
+	void wait()
 	{
-		take_prepare(assigned);
+		if(likely(valid()))
+			return;
 
-#  ifdef ZTH_FUTURE_EXCEPTION
-		std::exception_ptr exc = m_value.exception();
-		if(exc) {
-			take_finalize();
-			std::rethrow_exception(exc);
-		}
-#  endif // ZTH_FUTURE_EXCEPTION
+		state_type raw = lockQueue();
+		if(value(raw))
+			unlockQueue(value(raw));
+		else
+			block(0);
+	}
 
-		type v = m_value.value();
-		take_finalize();
-		return v;
+	void set() noexcept
+	{
+		zth_assert(!valid());
+		m_value.set();
+		set_finalize();
 	}
 
-	virtual void
-	wakeup(Listable& item, queue_type::user_type user, bool prio, size_t q) noexcept final
+#  ifdef ZTH_FUTURE_EXCEPTION
+	void set(std::exception_ptr exception) noexcept
 	{
-		if(q == Queue_Take)
-			m_assigned = wakeup(item, user, prio);
-		else
-			base::wakeup(item, user, prio, q);
+		zth_assert(!valid());
+		m_value.set(std::move(exception));
+		set_finalize();
 	}
 
-	virtual assigned_type wakeup(Listable& item, queue_type::user_type user, bool prio) noexcept
+	Future& operator=(std::exception_ptr v) noexcept
 	{
-		base::wakeup(item, user, prio, Queue_Take);
-		return &item;
+		set(std::move(v));
+		return *this;
 	}
 
-private:
-	void put_prepare()
+	std::exception_ptr exception() const noexcept
 	{
-		wait_empty();
+		return valid() ? m_value.exception() : std::exception_ptr();
 	}
+#  endif // ZTH_FUTURE_EXCEPTION
 
-	void put_finalize() noexcept
+	void value()
 	{
-		zth_dbg(sync, "[%s] Put", id_str());
-		unblockFirst(Queue_Take);
+		wait();
+		m_value.value();
 	}
 
-	void take_prepare(assigned_type assigned)
+	void operator*()
 	{
-		wait(assigned);
+		value();
 	}
 
-	void take_finalize() noexcept
+private:
+	using SynchronizerBase::value;
+
+	void set_finalize() noexcept
 	{
-		zth_dbg(sync, "[%s] Take", id_str());
-		m_value.reset();
-		unblockFirst(Queue_Put);
+		zth_dbg(sync, "[%s] Set", id_str());
+
+		queue_type wake;
+		lockQueue();
+		dequeueAll(wake);
+		unlockQueue(1);
+		unblock(wake);
 	}
 
 private:
-	Optional<type> m_value;
-	assigned_type m_assigned;
+	Optional<void> m_value;
 };
 
 /*!
- * \brief Fiber-aware barrier/gate.
+ * \brief Thread-safe fiber-aware barrier/gate.
+ * \see zth::Gate
  * \ingroup zth_api_cpp_sync
  */
-class Gate : public Synchronizer<> {
+class Gate : public SynchronizerBase {
 	ZTH_CLASS_NEW_DELETE(Gate)
 public:
-	explicit Gate(size_t count, cow_string const& name = "Gate")
-		: Synchronizer(name)
-		, m_count(count)
-		, m_current()
-	{}
-
-#  if __cplusplus >= 201103L
-	Gate(size_t count, cow_string&& name)
-		: Synchronizer(std::move(name))
-		, m_count(count)
-		, m_current()
-	{}
-#  endif
+	explicit Gate(size_t count, cow_string const& name = "mt::Gate")
+		: SynchronizerBase(name)
+		, m_count((state_type)count)
+	{
+		zth_assert(count > 0 && count <= MaxValue);
+	}
 
 	virtual ~Gate() noexcept override is_default
 
 	bool pass() noexcept
 	{
-		zth_dbg(sync, "[%s] Pass", id_str());
-		if(++m_current >= count()) {
-			m_current -= count();
-			unblockAll();
-			return true;
-		} else {
-			return false;
-		}
+		return pass_(false);
 	}
 
 	void wait()
 	{
-		if(!pass())
-			block();
+		pass_(true);
 	}
 
 	size_t count() const noexcept
@@ -1528,14 +3363,35 @@ public:
 
 	size_t current() const noexcept
 	{
-		return m_current;
+		return value(load());
 	}
 
 private:
-	size_t const m_count;
-	size_t m_current;
+	bool pass_(bool wait)
+	{
+		zth_dbg(sync, "[%s] Pass", id_str());
+
+		state_type current = value(lockQueue()) + 1;
+		if(current < m_count) {
+			if(wait)
+				block(current);
+			else
+				unlockQueue(current);
+			return false;
+		}
+
+		queue_type wake;
+		dequeueAll(wake);
+		unlockQueue(current - m_count);
+		unblock(wake);
+		return true;
+	}
+
+private:
+	state_type const m_count;
 };
 
+} // namespace mt
 } // namespace zth
 
 struct zth_mutex_t {
@@ -1621,6 +3477,160 @@ EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_mutex_unlock(zth_mutex_t* mutex) noexcept
 	return 0;
 }
 
+struct zth_rwlock_t {
+	void* p;
+};
+
+/*!
+ * \brief Initializes a reader/writer lock.
+ * \details This is a C-wrapper to create a new zth::SharedMutex.
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_rwlock_init(zth_rwlock_t* rwlock) noexcept
+{
+	if(unlikely(!rwlock || rwlock->p))
+		return EINVAL;
+
+	try {
+		rwlock->p = static_cast<void*>(new zth::SharedMutex());
+		return 0;
+	} catch(std::bad_alloc const&) {
+		return ENOMEM;
+	} catch(...) {
+	}
+	return EAGAIN;
+}
+
+/*!
+ * \brief Destroys a reader/writer lock.
+ * \details This is a C-wrapper to delete a zth::SharedMutex.
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_rwlock_destroy(zth_rwlock_t* rwlock) noexcept
+{
+	if(unlikely(!rwlock))
+		return EINVAL;
+	if(unlikely(!rwlock->p))
+		// Already destroyed.
+		return 0;
+
+	delete static_cast<zth::SharedMutex*>(rwlock->p);
+	rwlock->p = nullptr;
+	return 0;
+}
+
+/*!
+ * \brief Locks a reader/writer lock shared.
+ * \details This is a C-wrapper for zth::SharedMutex::lock_shared().
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_rwlock_rdlock(zth_rwlock_t* rwlock) noexcept
+{
+	if(unlikely(!rwlock || !rwlock->p))
+		return EINVAL;
+
+	static_cast<zth::SharedMutex*>(rwlock->p)->lock_shared();
+	return 0;
+}
+
+/*!
+ * \brief Try to lock a reader/writer lock shared.
+ * \details This is a C-wrapper for zth::SharedMutex::trylock_shared().
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_rwlock_tryrdlock(zth_rwlock_t* rwlock) noexcept
+{
+	if(unlikely(!rwlock || !rwlock->p))
+		return EINVAL;
+
+	return static_cast<zth::SharedMutex*>(rwlock->p)->trylock_shared() ? 0 : EBUSY;
+}
+
+/*!
+ * \brief Locks a reader/writer lock shared, with a timeout relative to now.
+ * \details This is a C-wrapper for zth::SharedMutex::trylock_shared(TimeInterval const&).
+ * \return 0 when locked, \c ETIMEDOUT on timeout
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int
+zth_rwlock_timedrdlock(zth_rwlock_t* rwlock, struct timespec const* timeout) noexcept
+{
+	if(unlikely(!rwlock || !rwlock->p || !timeout))
+		return EINVAL;
+
+	return static_cast<zth::SharedMutex*>(rwlock->p)->trylock_shared(
+		       zth::TimeInterval(*timeout))
+		       ? 0
+		       : ETIMEDOUT;
+}
+
+/*!
+ * \brief Locks a reader/writer lock exclusively.
+ * \details This is a C-wrapper for zth::SharedMutex::lock().
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_rwlock_wrlock(zth_rwlock_t* rwlock) noexcept
+{
+	if(unlikely(!rwlock || !rwlock->p))
+		return EINVAL;
+
+	static_cast<zth::SharedMutex*>(rwlock->p)->lock();
+	return 0;
+}
+
+/*!
+ * \brief Try to lock a reader/writer lock exclusively.
+ * \details This is a C-wrapper for zth::SharedMutex::trylock().
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_rwlock_trywrlock(zth_rwlock_t* rwlock) noexcept
+{
+	if(unlikely(!rwlock || !rwlock->p))
+		return EINVAL;
+
+	return static_cast<zth::SharedMutex*>(rwlock->p)->trylock() ? 0 : EBUSY;
+}
+
+/*!
+ * \brief Locks a reader/writer lock exclusively, with a timeout relative to now.
+ * \details This is a C-wrapper for zth::SharedMutex::trylock(TimeInterval const&).
+ * \return 0 when locked, \c ETIMEDOUT on timeout
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int
+zth_rwlock_timedwrlock(zth_rwlock_t* rwlock, struct timespec const* timeout) noexcept
+{
+	if(unlikely(!rwlock || !rwlock->p || !timeout))
+		return EINVAL;
+
+	return static_cast<zth::SharedMutex*>(rwlock->p)->trylock(zth::TimeInterval(*timeout))
+		       ? 0
+		       : ETIMEDOUT;
+}
+
+/*!
+ * \brief Unlocks a reader/writer lock, which was locked either shared or exclusively.
+ * \details This is a C-wrapper for zth::SharedMutex::unlock() and
+ *	zth::SharedMutex::unlock_shared().
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_rwlock_unlock(zth_rwlock_t* rwlock) noexcept
+{
+	if(unlikely(!rwlock || !rwlock->p))
+		return EINVAL;
+
+	zth::SharedMutex* m = static_cast<zth::SharedMutex*>(rwlock->p);
+	if(!m->locked())
+		return EPERM;
+
+	// Only one fiber can hold it exclusively, so if there are no readers, it must be us.
+	if(m->readers())
+		m->unlock_shared();
+	else
+		m->unlock();
+	return 0;
+}
+
 struct zth_sem_t {
 	void* p;
 };
@@ -2097,10 +4107,161 @@ zth_mailbox_take(zth_mailbox_t* __restrict__ mailbox, uintptr_t* __restrict__ va
 	return 0;
 }
 
+struct zth_channel_t {
+	void* p;
+};
+
+typedef zth::Channel<uintptr_t, 64> zth_channel_t_type;
+
+/*!
+ * \brief Initializes a channel.
+ * \details This is a C-wrapper to create a new zth::Channel, which buffers up to 64 values.
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_channel_init(zth_channel_t* channel) noexcept
+{
+	if(unlikely(!channel || channel->p))
+		return EINVAL;
+
+	try {
+		channel->p = static_cast<void*>(new zth_channel_t_type());
+		return 0;
+	} catch(std::bad_alloc const&) {
+		return ENOMEM;
+	} catch(...) {
+	}
+	return EAGAIN;
+}
+
+/*!
+ * \brief Destroys a channel.
+ * \details This is a C-wrapper to delete a zth::Channel.
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_channel_destroy(zth_channel_t* channel) noexcept
+{
+	if(unlikely(!channel))
+		return EINVAL;
+	if(unlikely(!channel->p))
+		// Already destroyed.
+		return 0;
+
+	delete static_cast<zth_channel_t_type*>(channel->p);
+	channel->p = nullptr;
+	return 0;
+}
+
+/*!
+ * \brief Checks if a channel contains data to take.
+ * \details This is a C-wrapper for zth::Channel::can_take().
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_channel_can_take(zth_channel_t* channel) noexcept
+{
+	if(unlikely(!channel || !channel->p))
+		return EINVAL;
+
+	return static_cast<zth_channel_t_type*>(channel->p)->can_take() ? 0 : EAGAIN;
+}
+
+/*!
+ * \brief Checks if a channel has room for data.
+ * \details This is a C-wrapper for zth::Channel::can_put().
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_channel_can_put(zth_channel_t* channel) noexcept
+{
+	if(unlikely(!channel || !channel->p))
+		return EINVAL;
+
+	return static_cast<zth_channel_t_type*>(channel->p)->can_put() ? 0 : EAGAIN;
+}
+
+/*!
+ * \brief Closes a channel.
+ * \details This is a C-wrapper for zth::Channel::close().
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_channel_close(zth_channel_t* channel) noexcept
+{
+	if(unlikely(!channel || !channel->p))
+		return EINVAL;
+
+	static_cast<zth_channel_t_type*>(channel->p)->close();
+	return 0;
+}
+
+/*!
+ * \brief Puts a value into the channel.
+ * \details This is a C-wrapper for zth::Channel::put(). It is blocking when the channel is full.
+ * \return 0 on success, \c EPIPE when the channel is closed
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_channel_put(zth_channel_t* channel, uintptr_t value) noexcept
+{
+	if(unlikely(!channel || !channel->p))
+		return EINVAL;
+
+	return static_cast<zth_channel_t_type*>(channel->p)->put(value) ? 0 : EPIPE;
+}
+
+/*!
+ * \brief Wait for and return a value from the channel.
+ * \details This is a C-wrapper for zth::Channel::take().
+ * \return 0 on success, \c EPIPE when the channel is closed and empty
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int
+zth_channel_take(zth_channel_t* __restrict__ channel, uintptr_t* __restrict__ value) noexcept
+{
+	if(unlikely(!channel || !channel->p || !value))
+		return EINVAL;
+
+	return static_cast<zth_channel_t_type*>(channel->p)->take(*value) ? 0 : EPIPE;
+}
+
+/*!
+ * \brief Puts \p count values into the channel.
+ * \details This is a C-wrapper for zth::Channel::put_n(). The number of values put is returned
+ *          via \p done, if not \c NULL.
+ * \return 0 on success, \c EPIPE when the channel was closed before all values were put
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_channel_put_n(
+	zth_channel_t* __restrict__ channel, uintptr_t const* __restrict__ values, size_t count,
+	size_t* __restrict__ done) noexcept
+{
+	if(unlikely(!channel || !channel->p || (!values && count)))
+		return EINVAL;
+
+	size_t n = static_cast<zth_channel_t_type*>(channel->p)->put_n(values, count);
+	if(done)
+		*done = n;
+	return n == count ? 0 : EPIPE;
+}
+
+/*!
+ * \brief Wait for and take up to \p count values from the channel.
+ * \details This is a C-wrapper for zth::Channel::take_up_to(). The number of values taken is
+ *          returned via \p done.
+ * \return 0 on success, \c EPIPE when the channel is closed and empty
+ * \ingroup zth_api_c_sync
+ */
+EXTERN_C ZTH_EXPORT ZTH_INLINE int zth_channel_take_up_to(
+	zth_channel_t* __restrict__ channel, uintptr_t* __restrict__ values, size_t count,
+	size_t* __restrict__ done) noexcept
+{
+	if(unlikely(!channel || !channel->p || !values || !count || !done))
+		return EINVAL;
+
+	*done = static_cast<zth_channel_t_type*>(channel->p)->take_up_to(values, count);
+	return *done ? 0 : EPIPE;
+}
 
 #else // !__cplusplus
 
 #  include <stdint.h>
+#  include <time.h>
 
 typedef struct {
 	void* p;
@@ -2112,6 +4273,20 @@ ZTH_EXPORT int zth_mutex_lock(zth_mutex_t* mutex);
 ZTH_EXPORT int zth_mutex_trylock(zth_mutex_t* mutex);
 ZTH_EXPORT int zth_mutex_unlock(zth_mutex_t* mutex);
 
+typedef struct {
+	void* p;
+} zth_rwlock_t;
+
+ZTH_EXPORT int zth_rwlock_init(zth_rwlock_t* rwlock);
+ZTH_EXPORT int zth_rwlock_destroy(zth_rwlock_t* rwlock);
+ZTH_EXPORT int zth_rwlock_rdlock(zth_rwlock_t* rwlock);
+ZTH_EXPORT int zth_rwlock_tryrdlock(zth_rwlock_t* rwlock);
+ZTH_EXPORT int zth_rwlock_timedrdlock(zth_rwlock_t* rwlock, struct timespec const* timeout);
+ZTH_EXPORT int zth_rwlock_wrlock(zth_rwlock_t* rwlock);
+ZTH_EXPORT int zth_rwlock_trywrlock(zth_rwlock_t* rwlock);
+ZTH_EXPORT int zth_rwlock_timedwrlock(zth_rwlock_t* rwlock, struct timespec const* timeout);
+ZTH_EXPORT int zth_rwlock_unlock(zth_rwlock_t* rwlock);
+
 typedef struct {
 	void* p;
 } zth_sem_t;
@@ -2164,5 +4339,23 @@ ZTH_EXPORT int zth_mailbox_can_put(zth_mailbox_t* mailbox);
 ZTH_EXPORT int zth_mailbox_put(zth_mailbox_t* mailbox, uintptr_t value);
 ZTH_EXPORT int zth_mailbox_take(zth_mailbox_t* __restrict__ mailbox, uintptr_t* __restrict__ value);
 
+typedef struct {
+	void* p;
+} zth_channel_t;
+
+ZTH_EXPORT int zth_channel_init(zth_channel_t* channel);
+ZTH_EXPORT int zth_channel_destroy(zth_channel_t* channel);
+ZTH_EXPORT int zth_channel_can_take(zth_channel_t* channel);
+ZTH_EXPORT int zth_channel_can_put(zth_channel_t* channel);
+ZTH_EXPORT int zth_channel_close(zth_channel_t* channel);
+ZTH_EXPORT int zth_channel_put(zth_channel_t* channel, uintptr_t value);
+ZTH_EXPORT int zth_channel_take(zth_channel_t* __restrict__ channel, uintptr_t* __restrict__ value);
+ZTH_EXPORT int zth_channel_put_n(
+	zth_channel_t* __restrict__ channel, uintptr_t const* __restrict__ values, size_t count,
+	size_t* __restrict__ done);
+ZTH_EXPORT int zth_channel_take_up_to(
+	zth_channel_t* __restrict__ channel, uintptr_t* __restrict__ values, size_t count,
+	size_t* __restrict__ done);
+
 #endif // !__cplusplus
 #endif // ZTH_SYNC_H
@@ -50,6 +50,11 @@ class Timestamp;
 
 /*!
  * \brief Convenient wrapper around \c struct \c timespec that contains a time interval.
+ *
+ * When \c ZTH_TIME_NS is set, the interval is stored as a signed 64-bit number of
+ * nanoseconds instead, which makes arithmetic and comparisons cheaper.  The range is then
+ * limited to about 292 years; anything beyond saturates to #infinity().
+ *
  * \ingroup zth_api_cpp_time
  */
 class TimeInterval {
@@ -58,6 +63,8 @@ private:
 	// Do not convert automatically.
 	TimeInterval(Timestamp const&);
 
+	friend class Timestamp;
+
 public:
 	static long const BILLION = 1000000000L;
 
@@ -71,18 +78,72 @@ public:
 		return TimeInterval();
 	}
 
+#  if ZTH_TIME_NS
+	constexpr TimeInterval() noexcept
+		: m_ns()
+	{}
+
+	// cppcheck-suppress noExplicitConstructor
+	constexpr TimeInterval(time_t s, long ns = 0, bool negative = false) noexcept
+		: m_ns(negative ? -to_ns(s, ns) : to_ns(s, ns))
+	{}
+
+	// cppcheck-suppress noExplicitConstructor
+	constexpr TimeInterval(struct timespec const& ts) noexcept
+		: m_ns(to_ns(ts.tv_sec, ts.tv_nsec))
+	{}
+
+	TimeInterval& operator=(TimeInterval const& t) noexcept
+	{
+		m_ns = t.m_ns;
+		return *this;
+	}
+
+	constexpr TimeInterval(TimeInterval const& t) noexcept
+		: m_ns(t.m_ns)
+	{}
+
+	// cppcheck-suppress noExplicitConstructor
+	TimeInterval(float dt)
+		: m_ns()
+	{
+		init_float<float>(dt);
+	}
+
+	// cppcheck-suppress noExplicitConstructor
+	TimeInterval(double dt)
+		: m_ns()
+	{
+		init_float<double>(dt);
+	}
+
+	// cppcheck-suppress noExplicitConstructor
+	TimeInterval(long double dt)
+		: m_ns()
+	{
+		init_float<long double>(dt);
+	}
+
+	template <typename T>
+	// cppcheck-suppress noExplicitConstructor
+	constexpr14 TimeInterval(T dt) noexcept
+		: m_ns()
+	{
+		init_int<T>(dt);
+	}
+#  else // !ZTH_TIME_NS
 	constexpr TimeInterval() noexcept
 		: m_t()
 		, m_negative()
 	{}
 
-#  if __cplusplus >= 201103L
+#    if __cplusplus >= 201103L
 	// cppcheck-suppress noExplicitConstructor
 	constexpr TimeInterval(time_t s, long ns = 0, bool negative = false) noexcept
 		: m_t{s, ns}
 		, m_negative{negative}
 	{}
-#  else
+#    else
 	// cppcheck-suppress noExplicitConstructor
 	TimeInterval(time_t s, long ns = 0, bool negative = false) noexcept
 		: m_t()
@@ -92,7 +153,7 @@ public:
 		m_t.tv_nsec = ns;
 		zth_assert(isNormal());
 	}
-#  endif
+#    endif
 
 	// cppcheck-suppress noExplicitConstructor
 	constexpr TimeInterval(struct timespec const& ts) noexcept
@@ -144,6 +205,7 @@ public:
 	{
 		init_int<T>(dt);
 	}
+#  endif // !ZTH_TIME_NS
 
 	template <typename T>
 	static constexpr14 TimeInterval from_s(T s)
@@ -177,14 +239,37 @@ public:
 	template <typename T>
 	static constexpr14 TimeInterval from_ns(T ns)
 	{
+#  if ZTH_TIME_NS
+		long long const max = (long long)std::numeric_limits<int64_t>::max();
+		if(ns > 0 && (unsigned long long)ns > (unsigned long long)max)
+			return infinity();
+		if(std::numeric_limits<T>::is_signed && (long long)ns < -max)
+			return -infinity();
+
+		TimeInterval ti;
+		ti.m_ns = (int64_t)ns;
+		return ti;
+#  else
 		T s_ = ns / (T)1000000000L;
 		if(s_ > std::numeric_limits<time_t>::max())
 			return TimeInterval(std::numeric_limits<time_t>::max(), 999999999L);
 
 		return TimeInterval((time_t)s_, (long)ns % 1000000000L);
+#  endif
 	}
 
 #  if __cplusplus >= 201103L
+#    if ZTH_TIME_NS
+	// cppcheck-suppress noExplicitConstructor
+	TimeInterval(std::chrono::nanoseconds ns)
+		: m_ns((int64_t)ns.count())
+	{}
+
+	operator std::chrono::nanoseconds() const
+	{
+		return std::chrono::nanoseconds((std::chrono::nanoseconds::rep)m_ns);
+	}
+#    else  // !ZTH_TIME_NS
 	// cppcheck-suppress noExplicitConstructor
 	TimeInterval(std::chrono::nanoseconds ns)
 	{
@@ -197,16 +282,50 @@ public:
 			(std::chrono::nanoseconds::rep)m_t.tv_sec * BILLION
 			+ (std::chrono::nanoseconds::rep)m_t.tv_nsec);
 	}
-#  endif // C++11
+#    endif // !ZTH_TIME_NS
+#  endif   // C++11
 
 private:
+#  if ZTH_TIME_NS
+	/*! \brief Convert to ns, and saturate to #infinity(). */
+	static constexpr int64_t to_ns(time_t s, long ns) noexcept
+	{
+		return (int64_t)s >= std::numeric_limits<int64_t>::max() / BILLION - 1
+			       ? std::numeric_limits<int64_t>::max()
+			       : (int64_t)s * BILLION + (int64_t)ns;
+	}
+
+	template <typename T>
+	void init_float(T dt)
+	{
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wfloat-equal"
+		zth_assert(dt == dt); // Should not be NaN
+#    pragma GCC diagnostic pop
+
+		T const max = (T)(std::numeric_limits<int64_t>::max() / BILLION - 1);
+		if(dt > max)
+			m_ns = std::numeric_limits<int64_t>::max();
+		else if(dt < -max)
+			m_ns = -std::numeric_limits<int64_t>::max();
+		else
+			m_ns = (int64_t)(dt * (T)1e9);
+	}
+
+	template <typename T>
+	constexpr14 void init_int(T dt) noexcept
+	{
+		// seconds only.
+		m_ns = dt >= 0 ? to_ns((time_t)dt, 0) : -to_ns((time_t)-dt, 0);
+	}
+#  else // !ZTH_TIME_NS
 	template <typename T>
 	void init_float(T dt)
 	{
-#  pragma GCC diagnostic push
-#  pragma GCC diagnostic ignored "-Wfloat-equal"
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wfloat-equal"
 		zth_assert(dt == dt); // Should not be NaN
-#  pragma GCC diagnostic pop
+#    pragma GCC diagnostic pop
 
 		m_negative = dt < 0;
 
@@ -231,8 +350,119 @@ private:
 		m_t.tv_sec = (time_t)(dt >= 0 ? dt : -dt);
 		m_t.tv_nsec = 0;
 	}
+#  endif // !ZTH_TIME_NS
 
 public:
+#  if ZTH_TIME_NS
+	constexpr bool isNormal() const noexcept
+	{
+		return true;
+	}
+
+	constexpr bool isNegative() const noexcept
+	{
+		return m_ns < 0;
+	}
+
+	constexpr bool isPositive() const noexcept
+	{
+		return !isNegative();
+	}
+
+	constexpr bool isNull() const noexcept
+	{
+		return m_ns == 0;
+	}
+
+	/*! \brief Check if the interval is (negative) #infinity(), to which all math saturates. */
+	constexpr bool isInfinite() const noexcept
+	{
+		return m_ns == std::numeric_limits<int64_t>::max()
+		       || m_ns == -std::numeric_limits<int64_t>::max();
+	}
+
+	constexpr bool hasPassed() const noexcept
+	{
+		return m_ns <= 0;
+	}
+
+	/*! \brief Return the absolute value of the interval. */
+	constexpr14 struct timespec ts() const noexcept
+	{
+		uint64_t a = (uint64_t)(m_ns < 0 ? -m_ns : m_ns);
+		struct timespec t = {};
+		t.tv_sec = (time_t)(a / (uint64_t)BILLION);
+		t.tv_nsec = (long)(a % (uint64_t)BILLION);
+		return t;
+	}
+
+	constexpr14 double s() const noexcept
+	{
+		return s<double>();
+	}
+
+	template <typename T>
+	constexpr14 T s() const noexcept
+	{
+		return (T)(m_ns / BILLION) + (T)(m_ns % BILLION) / (T)BILLION;
+	}
+
+	constexpr bool isAbsBiggerThan(TimeInterval const& t) const noexcept
+	{
+		return (m_ns < 0 ? -m_ns : m_ns) > (t.m_ns < 0 ? -t.m_ns : t.m_ns);
+	}
+
+	constexpr bool isBiggerThan(TimeInterval const& t) const noexcept
+	{
+		return m_ns > t.m_ns;
+	}
+
+	constexpr bool operator==(TimeInterval const& rhs) const noexcept
+	{
+		return m_ns == rhs.m_ns;
+	}
+
+	constexpr bool operator>(TimeInterval const& rhs) const noexcept
+	{
+		return m_ns > rhs.m_ns;
+	}
+
+	constexpr bool operator>=(TimeInterval const& rhs) const noexcept
+	{
+		return m_ns >= rhs.m_ns;
+	}
+
+	constexpr bool operator<(TimeInterval const& rhs) const noexcept
+	{
+		return m_ns < rhs.m_ns;
+	}
+
+	constexpr bool operator<=(TimeInterval const& rhs) const noexcept
+	{
+		return m_ns <= rhs.m_ns;
+	}
+
+	constexpr14 void add(TimeInterval const& t) noexcept
+	{
+		int64_t const max = std::numeric_limits<int64_t>::max();
+
+		if(isInfinite() || t.isInfinite()) {
+			if(!isInfinite() || t.isInfinite())
+				m_ns = t.m_ns;
+		} else if(t.m_ns > 0 && m_ns > max - t.m_ns) {
+			m_ns = max;
+		} else if(t.m_ns < 0 && m_ns < -max - t.m_ns) {
+			m_ns = -max;
+		} else {
+			m_ns += t.m_ns;
+		}
+	}
+
+	constexpr14 void sub(TimeInterval const& t) noexcept
+	{
+		add(-t);
+	}
+#  else // !ZTH_TIME_NS
 	constexpr bool isNormal() const noexcept
 	{
 		return m_t.tv_sec >= 0 && m_t.tv_nsec >= 0 && m_t.tv_nsec < BILLION;
@@ -359,6 +589,7 @@ public:
 	{
 		add(TimeInterval(t.ts().tv_sec, t.ts().tv_nsec, !t.isNegative()));
 	}
+#  endif // !ZTH_TIME_NS
 
 	template <typename T>
 	constexpr14 void mul(T x) noexcept
@@ -394,7 +625,13 @@ public:
 
 	constexpr14 TimeInterval operator-() const noexcept
 	{
+#  if ZTH_TIME_NS
+		TimeInterval ti;
+		ti.m_ns = -m_ns;
+		return ti;
+#  else
 		return TimeInterval(ts().tv_sec, ts().tv_nsec, !isNegative());
+#  endif
 	}
 
 	template <typename T>
@@ -431,22 +668,24 @@ public:
 			return res;
 		}
 
-		if(m_negative)
+		if(isNegative())
 			res = "-";
 
+		struct timespec const& t = ts();
+
 		if(Config::UseLimitedFormatSpecifiers) {
 			// Do a simplified print without float formatting support.
-			if(m_t.tv_sec >= 60)
-				res += format("%u s", (unsigned int)m_t.tv_sec);
-			else if(m_t.tv_sec > 0)
+			if(t.tv_sec >= 60)
+				res += format("%u s", (unsigned int)t.tv_sec);
+			else if(t.tv_sec > 0)
 				res +=
-					format("%u.%03u s", (unsigned int)m_t.tv_sec,
-					       (unsigned int)(m_t.tv_nsec / 1000000L));
+					format("%u.%03u s", (unsigned int)t.tv_sec,
+					       (unsigned int)(t.tv_nsec / 1000000L));
 			else
-				res += format("%u us", (unsigned int)m_t.tv_nsec / 1000U);
+				res += format("%u us", (unsigned int)t.tv_nsec / 1000U);
 		} else {
-			uint64_t d = (uint64_t)(m_t.tv_sec / 3600 / 24);
-			time_t rest = m_t.tv_sec - d * 3600 * 24;
+			uint64_t d = (uint64_t)(t.tv_sec / 3600 / 24);
+			time_t rest = t.tv_sec - d * 3600 * 24;
 			bool doPrint = d > 0;
 			if(doPrint)
 				res += format("%" PRIu64 "d:", d);
@@ -469,7 +708,7 @@ public:
 				doPrint = true;
 			}
 
-			double sec = (double)rest + (double)m_t.tv_nsec * 1e-9;
+			double sec = (double)rest + (double)t.tv_nsec * 1e-9;
 			if(doPrint) {
 				res += format("%06.3f", sec);
 			} else {
@@ -481,8 +720,12 @@ public:
 	}
 
 private:
+#  if ZTH_TIME_NS
+	int64_t m_ns;
+#  else
 	struct timespec m_t;
 	bool m_negative;
+#  endif
 };
 
 template <>
@@ -561,13 +804,48 @@ struct monotonic_clock {
 };
 #  endif // C++11
 
+/*!
+ * \brief Read the time-stamp counter, converted to the epoch of \c CLOCK_MONOTONIC.
+ * \details Falls back to \c CLOCK_MONOTONIC when the CPU has no invariant TSC.
+ * \return 0 on success, otherwise like \c clock_gettime()
+ * \see #zth::Config::ClockTsc
+ * \ingroup zth_api_cpp_time
+ */
+ZTH_EXPORT int clock_tsc(struct timespec* ts) noexcept;
+
 /*!
  * \brief Convenient wrapper around \c struct \c timespec that contains an absolute timestamp.
+ *
+ * When \c ZTH_TIME_NS is set, the timestamp is stored as a 64-bit number of nanoseconds
+ * since the epoch of \c CLOCK_MONOTONIC instead.
+ *
  * \ingroup zth_api_cpp_time
  */
 class Timestamp {
 	ZTH_CLASS_NEW_DELETE(Timestamp)
 public:
+#  if ZTH_TIME_NS
+	// null
+	constexpr Timestamp() noexcept
+		: m_ns()
+	{}
+
+	// cppcheck-suppress noExplicitConstructor
+	constexpr Timestamp(struct timespec const& ts) noexcept
+		: m_ns(TimeInterval::to_ns(ts.tv_sec, ts.tv_nsec))
+	{}
+
+	constexpr explicit Timestamp(time_t sec, long nsec = 0) noexcept
+		: m_ns(TimeInterval::to_ns(sec, nsec))
+	{}
+
+	// cppcheck-suppress noExplicitConstructor
+	Timestamp(TimeInterval const& ti)
+		: m_ns()
+	{
+		*this = now() + ti;
+	}
+#  else // !ZTH_TIME_NS
 	// null
 	constexpr Timestamp() noexcept
 		: m_t()
@@ -591,65 +869,126 @@ public:
 	{
 		*this = now() + ti;
 	}
+#  endif // !ZTH_TIME_NS
 
+	/*!
+	 * \brief Return the current time, according to #zth::Config::Clock.
+	 */
 	static Timestamp now()
 	{
-		Timestamp t;
-		int res __attribute__((unused)) = clock_gettime(CLOCK_MONOTONIC, &t.m_t);
+		return now(Config::Clock);
+	}
+
+	/*!
+	 * \brief Return the current time, according to the given clock source.
+	 *
+	 * All sources share the epoch of \c CLOCK_MONOTONIC, such that their timestamps can be
+	 * passed to \c clock_nanosleep() and friends.
+	 */
+	static Timestamp now(Config::ClockSource source)
+	{
+		struct timespec ts;
+		int res __attribute__((unused)) = 0;
+
+		switch(source) {
+		case Config::ClockTsc:
+			res = clock_tsc(&ts);
+			break;
+		case Config::ClockCoarse:
+#  ifdef CLOCK_MONOTONIC_COARSE
+			res = clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+			break;
+#  else
+			// Not available; use the precise clock instead.
+			ZTH_FALLTHROUGH
+#  endif
+		case Config::ClockMonotonic:
+		default:
+			res = clock_gettime(CLOCK_MONOTONIC, &ts);
+		}
+
 		zth_assert(res == 0);
+		Timestamp t(ts);
 		zth_assert(!t.isNull());
 		return t;
 	}
 
-	constexpr struct timespec const& ts() const noexcept
+	/*! \brief Return the granularity of the given clock source. */
+	static TimeInterval resolution(Config::ClockSource source = Config::Clock) noexcept;
+
+#  if ZTH_TIME_NS
+	constexpr14 struct timespec ts() const noexcept
 	{
-		return m_t;
+		struct timespec t = {};
+		t.tv_sec = (time_t)(m_ns / TimeInterval::BILLION);
+		t.tv_nsec = (long)(m_ns % TimeInterval::BILLION);
+		return t;
 	}
-	constexpr operator struct timespec const&() const noexcept
+	constexpr14 operator struct timespec() const noexcept
 	{
 		return ts();
 	}
 
 	constexpr bool isBefore(Timestamp const& t) const noexcept
 	{
-		return ts().tv_sec < t.ts().tv_sec
-		       || (ts().tv_sec == t.ts().tv_sec && ts().tv_nsec < t.ts().tv_nsec);
+		return m_ns < t.m_ns;
 	}
 
-	constexpr bool isAfter(Timestamp const& t) const noexcept
+	constexpr bool operator==(Timestamp const& rhs) const noexcept
 	{
-		return t.isBefore(*this);
+		return m_ns == rhs.m_ns;
 	}
 
-	bool hasPassed() const noexcept
+	constexpr14 TimeInterval timeTo(Timestamp const& t) const
 	{
-		return isBefore(now());
+		TimeInterval ti;
+		ti.m_ns = t.m_ns - m_ns;
+		return ti;
 	}
 
-	constexpr bool operator==(Timestamp const& rhs) const noexcept
+	TimeInterval passed() const
 	{
-		return ts().tv_nsec == rhs.ts().tv_nsec && ts().tv_sec == rhs.ts().tv_sec;
+		Timestamp t = now();
+		zth_assert(!isAfter(t));
+		return timeTo(t);
 	}
 
-	constexpr bool operator!=(Timestamp const& rhs) const noexcept
+	constexpr14 void add(TimeInterval const& dt) noexcept
 	{
-		return !(*this == rhs);
+		if(dt.isInfinite()) {
+			// Saturate to the earliest or latest timestamp, but not to null.
+			m_ns = dt.isNegative() ? 1 : std::numeric_limits<int64_t>::max();
+		} else if(dt.m_ns > std::numeric_limits<int64_t>::max() - m_ns) {
+			m_ns = std::numeric_limits<int64_t>::max();
+		} else {
+			m_ns += dt.m_ns;
+			zth_assert(m_ns >= 0);
+		}
 	}
-	constexpr bool operator<(Timestamp const& rhs) const noexcept
+
+	constexpr bool isNull() const noexcept
 	{
-		return this->isBefore(rhs);
+		return m_ns == 0;
 	}
-	constexpr bool operator<=(Timestamp const& rhs) const noexcept
+#  else // !ZTH_TIME_NS
+	constexpr struct timespec const& ts() const noexcept
 	{
-		return *this == rhs || this->isBefore(rhs);
+		return m_t;
 	}
-	constexpr bool operator>(Timestamp const& rhs) const noexcept
+	constexpr operator struct timespec const&() const noexcept
 	{
-		return rhs.isBefore(*this);
+		return ts();
 	}
-	constexpr bool operator>=(Timestamp const& rhs) const noexcept
+
+	constexpr bool isBefore(Timestamp const& t) const noexcept
 	{
-		return *this == rhs || rhs.isBefore(*this);
+		return ts().tv_sec < t.ts().tv_sec
+		       || (ts().tv_sec == t.ts().tv_sec && ts().tv_nsec < t.ts().tv_nsec);
+	}
+
+	constexpr bool operator==(Timestamp const& rhs) const noexcept
+	{
+		return ts().tv_nsec == rhs.ts().tv_nsec && ts().tv_sec == rhs.ts().tv_sec;
 	}
 
 	constexpr14 TimeInterval timeTo(Timestamp const& t) const
@@ -683,6 +1022,43 @@ public:
 		m_t = t.ts();
 	}
 
+	constexpr bool isNull() const noexcept
+	{
+		return m_t.tv_sec == 0 && m_t.tv_nsec == 0;
+	}
+#  endif // !ZTH_TIME_NS
+
+	constexpr bool isAfter(Timestamp const& t) const noexcept
+	{
+		return t.isBefore(*this);
+	}
+
+	bool hasPassed() const noexcept
+	{
+		return isBefore(now());
+	}
+
+	constexpr bool operator!=(Timestamp const& rhs) const noexcept
+	{
+		return !(*this == rhs);
+	}
+	constexpr bool operator<(Timestamp const& rhs) const noexcept
+	{
+		return this->isBefore(rhs);
+	}
+	constexpr bool operator<=(Timestamp const& rhs) const noexcept
+	{
+		return *this == rhs || this->isBefore(rhs);
+	}
+	constexpr bool operator>(Timestamp const& rhs) const noexcept
+	{
+		return rhs.isBefore(*this);
+	}
+	constexpr bool operator>=(Timestamp const& rhs) const noexcept
+	{
+		return *this == rhs || rhs.isBefore(*this);
+	}
+
 	constexpr14 Timestamp& operator+=(TimeInterval const& dt) noexcept
 	{
 		add(dt);
@@ -717,12 +1093,22 @@ public:
 		return Timestamp();
 	}
 
-	constexpr bool isNull() const noexcept
+#  if __cplusplus >= 201103L
+#    if ZTH_TIME_NS
+	template <typename Duration>
+	// cppcheck-suppress noExplicitConstructor
+	Timestamp(std::chrono::time_point<monotonic_clock, Duration> tp)
+		: m_ns((int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				tp.time_since_epoch())
+				.count())
+	{}
+
+	operator std::chrono::time_point<monotonic_clock>() const
 	{
-		return m_t.tv_sec == 0 && m_t.tv_nsec == 0;
+		return std::chrono::time_point<monotonic_clock>{
+			monotonic_clock::duration{(monotonic_clock::rep)m_ns}};
 	}
-
-#  if __cplusplus >= 201103L
+#    else  // !ZTH_TIME_NS
 	template <typename Duration>
 	// cppcheck-suppress noExplicitConstructor
 	Timestamp(std::chrono::time_point<monotonic_clock, Duration> tp)
@@ -739,10 +1125,15 @@ public:
 			(monotonic_clock::rep)m_t.tv_sec * TimeInterval::BILLION
 			+ (monotonic_clock::rep)m_t.tv_nsec}};
 	}
-#  endif // C++11
+#    endif // !ZTH_TIME_NS
+#  endif   // C++11
 
 private:
+#  if ZTH_TIME_NS
+	int64_t m_ns;
+#  else
 	struct timespec m_t;
+#  endif
 };
 
 #  ifdef ZTH_OS_MAC
@@ -186,7 +186,300 @@ public:
 	virtual ~PolledMemberWaiting() noexcept override is_default
 };
 
+/*!
+ * \brief Hierarchical timing wheel of #zth::TimedWaitable objects.
+ *
+ * Inserting and erasing items is O(1).  Only the items that are due within the current tick
+ * are kept in an exactly ordered #zth::SortedList.  Other items are put in a slot of one of the
+ * wheels, where every next wheel has a 64 times coarser resolution.  When time advances, the
+ * slots that are passed are redistributed over the finer wheels.
+ *
+ * The tick resolution is set by #zth::Config::TimerWheelTick().  It does not influence the
+ * accuracy of the timeouts, only how often items are redistributed.
+ *
+ * \see zth::Config::WaiterTimerWheel
+ */
+template <typename T = TimedWaitable>
+class TimerWheel {
+	ZTH_CLASS_NOCOPY(TimerWheel)
+	ZTH_CLASS_NEW_DELETE(TimerWheel)
+public:
+	typedef T type;
+	typedef Listable elem_type;
+	typedef uint64_t tick_type;
+
+	enum { SlotBits = 6, Slots = 1 << SlotBits, Levels = 8 };
+
+	TimerWheel() noexcept
+		: m_now()
+		, m_wheelSize()
+		, m_slot()
+		, m_occupied()
+		, m_overflow()
+	{}
+
+	~TimerWheel() noexcept
+	{
+		clear();
+	}
+
+	void insert(elem_type& x) noexcept
+	{
+		tick_type t = tick(static_cast<type&>(x).timeout());
+		if(t <= m_now) {
+			m_near.insert(x);
+		} else {
+			place(x, t);
+			m_wheelSize++;
+		}
+	}
+
+	void erase(elem_type& x) noexcept
+	{
+		if(inWheel(x)) {
+			unlink(x);
+			m_wheelSize--;
+		} else {
+			m_near.erase(x);
+		}
+	}
+
+	void clear() noexcept
+	{
+		for(int level = 0; level < Levels; level++)
+			for(size_t slot = 0; slot < (size_t)Slots; slot++)
+				while(m_slot[level][slot])
+					unlink(*m_slot[level][slot]);
+
+		while(m_overflow)
+			unlink(*m_overflow);
+
+		m_wheelSize = 0;
+		m_near.clear();
+	}
+
+	size_t size() const noexcept
+	{
+		return m_wheelSize + m_near.size();
+	}
+
+	bool empty() const noexcept
+	{
+		return m_wheelSize == 0 && m_near.empty();
+	}
+
+	bool contains(elem_type& x) const noexcept
+	{
+		return inWheel(x) || m_near.contains(x);
+	}
+
+	/*!
+	 * \brief Advance the wheel to \p now, and return the first item.
+	 * \return the first item, or \c nullptr when nothing is due within the current tick
+	 */
+	type* first(Timestamp const& now) noexcept
+	{
+		advance(tick(now));
+		return m_near.empty() ? nullptr : &m_near.front();
+	}
+
+	/*!
+	 * \brief Return the time when the first item may be due.
+	 *
+	 * This is exact for items that are due within the current tick.  Otherwise, it is the
+	 * start of the first slot that holds items, which is at or before the first timeout.
+	 */
+	Timestamp next() const noexcept
+	{
+		zth_assert(!empty());
+
+		if(!m_near.empty())
+			return m_near.front().timeout();
+
+		tick_type start = 0;
+		nearest(start);
+		return timestamp(start);
+	}
+
+	static tick_type tick(Timestamp const& t) noexcept
+	{
+		return ns(t.ts()) / tickNs();
+	}
+
+	static Timestamp timestamp(tick_type tick) noexcept
+	{
+		tick_type t = tick * tickNs();
+		return Timestamp((time_t)(t / 1000000000ULL), (long)(t % 1000000000ULL));
+	}
+
+protected:
+	static tick_type ns(struct timespec const& ts) noexcept
+	{
+		return (tick_type)ts.tv_sec * 1000000000ULL + (tick_type)ts.tv_nsec;
+	}
+
+	static tick_type tickNs() noexcept
+	{
+		tick_type t = ns(Config::TimerWheelTick());
+		return t > 0 ? t : 1;
+	}
+
+	bool inWheel(elem_type const& x) const noexcept
+	{
+		uintptr_t p = (uintptr_t)x.user;
+		return p == (uintptr_t)&m_overflow
+		       || (p >= (uintptr_t)&m_slot[0][0]
+			   && p < (uintptr_t)&m_slot[Levels - 1][Slots - 1] + sizeof(elem_type*));
+	}
+
+	void place(elem_type& x, tick_type t) noexcept
+	{
+		zth_assert(t > m_now);
+
+		int level = (63 - __builtin_clzll((unsigned long long)(t ^ m_now))) / SlotBits;
+
+		if(unlikely(level >= Levels)) {
+			link(x, m_overflow);
+		} else {
+			size_t slot = (size_t)(t >> (level * SlotBits)) & (Slots - 1U);
+			m_occupied[level] |= 1ULL << slot;
+			link(x, m_slot[level][slot]);
+		}
+	}
+
+	static void link(elem_type& x, elem_type*& head) noexcept
+	{
+		x.user = static_cast<void*>(&head);
+
+		if(!head) {
+			head = x.prev = x.next = &x;
+		} else {
+			x.next = head;
+			x.prev = head->prev;
+			head->prev->next = &x;
+			head->prev = &x;
+		}
+	}
+
+	void unlink(elem_type& x) noexcept
+	{
+		elem_type** head = static_cast<elem_type**>(x.user);
+
+		if(x.next == &x) {
+			*head = nullptr;
+
+			if(head != &m_overflow) {
+				size_t i = (size_t)((uintptr_t)head - (uintptr_t)&m_slot[0][0])
+					   / sizeof(elem_type*);
+				m_occupied[i / Slots] &= ~(1ULL << (i % Slots));
+			}
+		} else {
+			x.prev->next = x.next;
+			x.next->prev = x.prev;
+			if(*head == &x)
+				*head = x.next;
+		}
+
+		x.prev = x.next = nullptr;
+		x.user = nullptr;
+	}
+
+	/*!
+	 * \brief Find the first slot that holds items.
+	 * \param start is set to the first tick of that slot
+	 * \return the head of the slot, or \c nullptr when the wheel is empty
+	 */
+	elem_type** nearest(tick_type& start) const noexcept
+	{
+		for(int level = 0; level < Levels; level++) {
+			int shift = level * SlotBits;
+			size_t digit = (size_t)(m_now >> shift) & (Slots - 1U);
+			if(digit == Slots - 1U)
+				continue;
+
+			uint64_t pending = m_occupied[level] & (~0ULL << (digit + 1U));
+			if(!pending)
+				continue;
+
+			size_t slot = (size_t)__builtin_ctzll((unsigned long long)pending);
+			start = ((m_now >> (shift + SlotBits)) << (shift + SlotBits))
+				| ((tick_type)slot << shift);
+			return const_cast<elem_type**>(&m_slot[level][slot]);
+		}
+
+		if(!m_overflow)
+			return nullptr;
+
+		// Overflow items are far away. Start from the first one.
+		tick_type t = tick(static_cast<type&>(*m_overflow).timeout());
+		for(elem_type* x = m_overflow->next; x != m_overflow; x = x->next) {
+			tick_type tx = tick(static_cast<type&>(*x).timeout());
+			if(tx < t)
+				t = tx;
+		}
+
+		start = t;
+		return const_cast<elem_type**>(&m_overflow);
+	}
+
+	/*!
+	 * \brief Redistribute all slots that start at or before the given tick.
+	 */
+	void advance(tick_type t) noexcept
+	{
+		tick_type start = 0;
+		elem_type** head = nullptr;
+
+		while(m_wheelSize && (head = nearest(start)) && start <= t) {
+			// Passed a slot. Move the cursor to the start of that slot, and move its
+			// items to finer wheels.
+			m_now = start;
+
+			// Detach all items first, as overflow items may end up in the same slot.
+			elem_type* list = nullptr;
+			while(*head) {
+				elem_type* x = *head;
+				unlink(*x);
+				m_wheelSize--;
+				x->next = list;
+				list = x;
+			}
+
+			while(list) {
+				elem_type* x = list;
+				list = x->next;
+				x->next = nullptr;
+				insert(*x);
+			}
+		}
+
+		if(t > m_now)
+			m_now = t;
+	}
+
+private:
+	tick_type m_now;
+	size_t m_wheelSize;
+	elem_type* m_slot[Levels][Slots];
+	uint64_t m_occupied[Levels];
+	elem_type* m_overflow;
+	SortedList<type> m_near;
+};
+
+namespace impl {
+template <bool TimerWheel>
+struct WaiterQueue {
+	typedef SortedList<TimedWaitable> type;
+};
+
+template <>
+struct WaiterQueue<true> {
+	typedef TimerWheel<TimedWaitable> type;
+};
+} // namespace impl
+
 class PollerServerBase;
+struct Pollable;
 
 /*!
  * \brief A single fiber per Worker that manages sleeping and blocked fibers.
@@ -194,6 +487,19 @@ class PollerServerBase;
 class Waiter : public Runnable {
 	ZTH_CLASS_NEW_DELETE(Waiter)
 public:
+	/*!
+	 * \brief Statistics of the polls by the Waiter.
+	 * \see #zth::Config::WaiterPollMinRounds
+	 */
+	struct PollStats {
+		/*! \brief Number of polls. */
+		size_t polls;
+		/*! \brief Number of polls that returned at least one event. */
+		size_t hits;
+		/*! \brief Number of rounds without a poll, as the Worker was busy. */
+		size_t skipped;
+	};
+
 	explicit Waiter(Worker& worker);
 	virtual ~Waiter() noexcept override;
 
@@ -205,9 +511,22 @@ public:
 	PollerServerBase& poller();
 	void setPoller(PollerServerBase* p = nullptr);
 	void wakeup();
+	void interrupt() noexcept;
+	void idle(TimeInterval const& timeout) noexcept;
+
+	PollStats const& pollStats() const noexcept
+	{
+		return m_pollStats;
+	}
 
 protected:
 	bool polling() const;
+	bool pollDue(Timestamp const& now);
+	void polled(bool hit, Timestamp const& now) noexcept;
+	bool wakeInit() noexcept;
+	bool interruptible() const noexcept;
+	bool sleepBegin() noexcept;
+	void sleepEnd() noexcept;
 
 	virtual int fiberHook(Fiber& f) override
 	{
@@ -220,9 +539,21 @@ protected:
 
 private:
 	Worker& m_worker;
-	SortedList<TimedWaitable> m_waiting;
+	impl::WaiterQueue<Config::WaiterTimerWheel>::type m_waiting;
 	PollerServerBase* m_poller;
 	PollerServerBase* m_defaultPoller;
+	int m_wakeFd[2];
+	Pollable* m_wakePollable;
+	bool m_wakeArmed;
+	/*! \brief Set by #interrupt(), to arm the wake descriptor for the next sleeps. */
+	bool m_wakeWanted;
+	bool m_sleeping;
+	PollStats m_pollStats;
+	/*! \brief Rounds since the last poll. */
+	unsigned int m_pollRounds;
+	/*! \brief Rounds to skip before the next non-blocking poll. */
+	unsigned int m_pollBudget;
+	Timestamp m_pollLast;
 };
 
 /*!
@@ -271,11 +602,7 @@ void wakeup(TimedWaitable& w);
  * \brief Sleep until the given time stamp.
  * \ingroup zth_api_cpp_fiber
  */
-ZTH_EXPORT inline void nap(Timestamp const& sleepUntil)
-{
-	TimedWaitable w(sleepUntil);
-	waitUntil(w);
-}
+ZTH_EXPORT void nap(Timestamp const& sleepUntil);
 
 /*!
  * \brief Sleep for the given time interval.
@@ -353,6 +680,11 @@ ZTH_EXPORT inline void unap(long sleepFor_us)
  * }
  * \endcode
  *
+ * When the Worker does #zth::Worker::setEdf(), or when the calling fiber already has a
+ * deadline, every nap also sets the deadline of the fiber to the end of the next period.
+ * Then, missed periods are counted, and the fiber is scheduled by its deadline.  The deadline is
+ * cleared when the PeriodicWakeUp is destructed by the same fiber.
+ *
  * \ingroup zth_api_cpp_fiber
  */
 class PeriodicWakeUp {
@@ -361,8 +693,15 @@ public:
 	explicit PeriodicWakeUp(TimeInterval const& interval)
 		: m_interval(interval)
 		, m_t(Timestamp::now())
+		, m_fiber()
 	{}
 
+	~PeriodicWakeUp()
+	{
+		if(unlikely(m_fiber))
+			clearDeadline();
+	}
+
 	Timestamp const& t() const noexcept
 	{
 		return m_t;
@@ -396,9 +735,15 @@ public:
 		nap();
 	}
 
+private:
+	void setDeadline(Timestamp const& now);
+	void clearDeadline();
+
 private:
 	TimeInterval m_interval;
 	Timestamp m_t;
+	/*! \brief The fiber of which #setDeadline() set the deadline. */
+	Fiber* m_fiber;
 };
 
 } // namespace zth
@@ -25,8 +25,372 @@
 namespace zth {
 
 void sigchld_check();
+void timeslice_tick_start() noexcept;
+void timeslice_tick_stop() noexcept;
 
 class Worker;
+class WorkerGroup;
+class WaitOnTable;
+void wait_on_deinit(WaitOnTable* table) noexcept;
+
+/*!
+ * \brief The runnable fibers of a Worker, with a round-robin queue per priority level.
+ *
+ * A bitmap of the non-empty levels makes finding the highest priority fiber O(1).  When
+ * earliest-deadline-first scheduling is enabled, fibers with a deadline are kept in a queue
+ * sorted by deadline, which goes before all levels.
+ *
+ * The fibers of a #zth::FiberGroup are kept in a queue of the group per level.  The groups of a
+ * level are sorted by their virtual runtime.  Together, they take as many turns in a row in the
+ * round-robin of the level as they have fibers in it.
+ *
+ * \see #zth::Config::PriorityLevels
+ */
+class RunQueue {
+	ZTH_CLASS_NEW_DELETE(RunQueue)
+	ZTH_CLASS_NOCOPY(RunQueue)
+public:
+	static unsigned int const Levels = Config::PriorityLevels;
+	static_assert(Levels >= 1 && Levels <= 31, "");
+	static_assert(Config::DefaultPriority < Levels, "");
+	/*! \brief The level of the deadline queue. */
+	static unsigned int const DeadlineLevel = Levels;
+	/*! \brief The level of a fiber that is not in a run queue. */
+	static unsigned int const NotQueued = Levels + 1U;
+
+	RunQueue() noexcept
+		: m_groupFibers()
+		, m_groupsRan()
+		, m_levels()
+		, m_edf()
+	{}
+
+	bool empty() const noexcept
+	{
+		return m_levels == 0;
+	}
+
+	/*! \brief Return the first fiber of the highest non-empty level. */
+	Fiber& front() const noexcept
+	{
+		unsigned int l = top();
+		return l == DeadlineLevel ? m_deadlines.front() : first(l);
+	}
+
+	/*! \brief Return the last fiber of the lowest non-empty level. */
+	Fiber& back() const noexcept
+	{
+		zth_assert(!empty());
+		unsigned int l = (unsigned int)__builtin_ctz(m_levels);
+		// The deadline queue has no back; any other fiber than its front will do.
+		if(l == DeadlineLevel)
+			return m_deadlines.front();
+
+		// Same for the groups.
+		Listable& e = m_queue[l].back();
+		return likely(!isGroups(e)) ? static_cast<Fiber&>(e) : groupsFront(l);
+	}
+
+	/*! \brief Return the highest non-empty level. */
+	unsigned int top() const noexcept
+	{
+		zth_assert(!empty());
+		return 31U - (unsigned int)__builtin_clz(m_levels);
+	}
+
+	/*!
+	 * \brief Return the fiber to run next.
+	 * \details Like #front(), but when it is the turn of the groups, it picks the fiber of the
+	 *	#zth::FiberGroup that is furthest behind.
+	 */
+	Fiber& next(Timestamp const& now) noexcept
+	{
+		unsigned int l = top();
+		if(l == DeadlineLevel)
+			return m_deadlines.front();
+
+		Listable& e = m_queue[l].front();
+		if(likely(!isGroups(e)))
+			return static_cast<Fiber&>(e);
+
+		return fair(l, now);
+	}
+
+	/*! \brief Return the first fiber of the highest non-empty level below \p l, if any. */
+	Fiber* below(unsigned int l) const noexcept
+	{
+		unsigned int mask = m_levels & ((1U << l) - 1U);
+		if(!mask)
+			return nullptr;
+
+		return &first(31U - (unsigned int)__builtin_clz(mask));
+	}
+
+	void push_back(Fiber& fiber) noexcept
+	{
+		if(unlikely(enqueueDeadline(fiber)))
+			return;
+
+		List<>& q = level(fiber);
+		if(unlikely(fiber.m_group))
+			groupRun(fiber).fibers.push_back(fiber);
+		else
+			q.push_back(fiber);
+	}
+
+	void push_front(Fiber& fiber) noexcept
+	{
+		if(unlikely(enqueueDeadline(fiber)))
+			return;
+
+		List<>& q = level(fiber);
+		if(unlikely(fiber.m_group)) {
+			groupRun(fiber).fibers.push_front(fiber);
+			// Let the groups go first.
+			Listable& groups = m_groupsTurn[fiber.m_runLevel];
+			q.erase(groups);
+			q.push_front(groups);
+			m_groupsRan[fiber.m_runLevel] = 0;
+		} else {
+			q.push_front(fiber);
+		}
+	}
+
+	void erase(Fiber& fiber) noexcept
+	{
+		unsigned int l = fiber.m_runLevel;
+		zth_assert(queued(fiber));
+
+		if(unlikely(l == DeadlineLevel)) {
+			m_deadlines.erase(fiber);
+			if(m_deadlines.empty())
+				m_levels &= ~(1U << l);
+		} else {
+			if(unlikely(fiber.m_group))
+				groupErase(fiber);
+			else
+				m_queue[l].erase(fiber);
+
+			if(m_queue[l].empty())
+				m_levels &= ~(1U << l);
+		}
+
+		fiber.m_runLevel = NotQueued;
+	}
+
+	/*! \brief Check if the fiber is in a run queue, assuming it is this one. */
+	static bool queued(Fiber const& fiber) noexcept
+	{
+		return fiber.m_runLevel != NotQueued;
+	}
+
+	bool contains(Fiber& fiber) const noexcept
+	{
+		if(!queued(fiber))
+			return false;
+		if(fiber.m_runLevel == DeadlineLevel)
+			return m_deadlines.contains(fiber);
+		if(fiber.m_group)
+			return fiber.m_group->m_run[fiber.m_runLevel].fibers.contains(fiber);
+		return m_queue[fiber.m_runLevel].contains(fiber);
+	}
+
+	/*! \brief Move the fiber to the back of its level, as it is about to run. */
+	void rotate(Fiber& fiber) noexcept
+	{
+		zth_assert(queued(fiber));
+		unsigned int l = fiber.m_runLevel;
+		if(unlikely(l == DeadlineLevel))
+			// Stays sorted by deadline.
+			return;
+
+		List<>& q = m_queue[l];
+		if(unlikely(fiber.m_group)) {
+			List<Fiber>& g = fiber.m_group->m_run[l].fibers;
+			g.rotate(*++g.cyclic(fiber));
+
+			if(++m_groupsRan[l] >= m_groupFibers[l]) {
+				// End of the turn of the groups.
+				m_groupsRan[l] = 0;
+				q.rotate(*++q.cyclic(m_groupsTurn[l]));
+			}
+		} else {
+			q.rotate(*++q.cyclic(fiber));
+		}
+	}
+
+	/*!
+	 * \brief Return the queue of a level.
+	 * \details It contains the fibers without a group, and the turn of the groups, see
+	 *	#isGroups().
+	 */
+	List<> const& operator[](unsigned int l) const noexcept
+	{
+		zth_assert(l < Levels);
+		return m_queue[l];
+	}
+
+	/*! \brief Check if the element of a level queue is the turn of the groups. */
+	bool isGroups(Listable const& e) const noexcept
+	{
+		return &e >= &m_groupsTurn[0] && &e < &m_groupsTurn[Levels];
+	}
+
+	/*! \brief Return the number of fibers in the deadline queue. */
+	size_t deadlines() const noexcept
+	{
+		return m_deadlines.size();
+	}
+
+	bool edf() const noexcept
+	{
+		return m_edf;
+	}
+
+	/*! \brief Enable earliest-deadline-first scheduling, and requeue all fibers accordingly. */
+	void setEdf(bool enable) noexcept
+	{
+		if(enable == m_edf)
+			return;
+
+		m_edf = enable;
+
+		List<Fiber> all;
+		while(!empty()) {
+			Fiber& f = front();
+			erase(f);
+			all.push_back(f);
+		}
+
+		while(!all.empty()) {
+			Fiber& f = all.front();
+			all.pop_front();
+			push_back(f);
+		}
+	}
+
+private:
+	List<>& level(Fiber& fiber) noexcept
+	{
+		zth_assert(!queued(fiber));
+		unsigned int l = Levels > 1 ? fiber.effectivePriority() : 0;
+		zth_assert(l < Levels);
+		fiber.m_runLevel = l;
+		m_levels |= 1U << l;
+		return m_queue[l];
+	}
+
+	bool enqueueDeadline(Fiber& fiber) noexcept
+	{
+		if(likely(!m_edf) || fiber.deadline().isNull())
+			return false;
+
+		zth_assert(!queued(fiber));
+		fiber.m_runLevel = DeadlineLevel;
+		m_levels |= 1U << DeadlineLevel;
+		m_deadlines.insert(fiber);
+		return true;
+	}
+
+	/*! \brief Return the first fiber of a non-empty level. */
+	Fiber& first(unsigned int l) const noexcept
+	{
+		Listable& e = m_queue[l].front();
+		return likely(!isGroups(e)) ? static_cast<Fiber&>(e) : groupsFront(l);
+	}
+
+	/*! \brief Return the first fiber of the group that is furthest behind. */
+	Fiber& groupsFront(unsigned int l) const noexcept
+	{
+		FiberGroup::Run& run =
+			!m_groups[l].empty() ? m_groups[l].front() : m_throttled[l].front();
+		return run.fibers.front();
+	}
+
+	/*!
+	 * \brief Return the Run of the group of \p fiber at its level, to which the fiber is
+	 *	about to be added.
+	 * \details The Run is sorted in when the fiber is the first one.
+	 */
+	FiberGroup::Run& groupRun(Fiber& fiber) noexcept
+	{
+		unsigned int l = fiber.m_runLevel;
+		FiberGroup& group = *fiber.m_group;
+		FiberGroup::Run& run = group.m_run[l];
+		m_groupFibers[l]++;
+		if(!run.fibers.empty())
+			return run;
+
+		SortedList<FiberGroup::Run, LessVruntime>& groups = m_groups[l];
+
+		// Do not let a group catch up on the time it was not runnable.
+		if(!groups.empty() && group.m_vruntime < groups.front().vruntime)
+			group.m_vruntime = groups.front().vruntime;
+
+		if(groups.empty() && m_throttled[l].empty())
+			m_queue[l].push_back(m_groupsTurn[l]);
+
+		run.vruntime = group.m_vruntime;
+		run.throttled = false;
+		groups.insert(run);
+		return run;
+	}
+
+	void groupErase(Fiber& fiber) noexcept
+	{
+		unsigned int l = fiber.m_runLevel;
+		FiberGroup::Run& run = fiber.m_group->m_run[l];
+		run.fibers.erase(fiber);
+		m_groupFibers[l]--;
+		if(!run.fibers.empty())
+			return;
+
+		if(run.throttled)
+			m_throttled[l].erase(run);
+		else
+			m_groups[l].erase(run);
+
+		if(m_groups[l].empty() && m_throttled[l].empty()) {
+			m_queue[l].erase(m_groupsTurn[l]);
+			m_groupsRan[l] = 0;
+		}
+	}
+
+	Fiber& fair(unsigned int l, Timestamp const& now) noexcept;
+	void unthrottle() noexcept;
+
+	struct EarlierDeadline {
+		bool operator()(Fiber const& a, Fiber const& b) const noexcept
+		{
+			return a.deadline() < b.deadline();
+		}
+	};
+
+	struct LessVruntime {
+		bool operator()(FiberGroup::Run const& a, FiberGroup::Run const& b) const noexcept
+		{
+			return a.vruntime < b.vruntime;
+		}
+	};
+
+private:
+	List<> m_queue[Levels];
+	SortedList<Fiber, EarlierDeadline> m_deadlines;
+	// Groups with fibers in the queue, which may run.
+	SortedList<FiberGroup::Run, LessVruntime> m_groups[Levels];
+	// Groups with fibers in the queue, which used up their quota.
+	List<FiberGroup::Run> m_throttled[Levels];
+	// The element in m_queue that represents all groups of a level.
+	Listable m_groupsTurn[Levels];
+	// Number of fibers of all groups of a level.
+	size_t m_groupFibers[Levels];
+	// Number of fibers of the groups that ran in the current turn of a level.
+	size_t m_groupsRan[Levels];
+	// When the first of m_throttled gets a new period.
+	Timestamp m_unthrottle;
+	unsigned int m_levels;
+	bool m_edf;
+};
 
 /*!
  * \brief The class that manages the fibers within this thread.
@@ -41,6 +405,15 @@ public:
 		, m_workerFiber(&dummyWorkerEntry)
 		, m_waiter(*this)
 		, m_disableContextSwitch()
+		, m_group()
+		, m_groupSlot()
+		, m_groupTick()
+		, m_inbox()
+		, m_inboxDraining()
+		, m_keepAlive()
+		, m_deadlineMisses()
+		, m_handoffs()
+		, m_waitOn()
 	{
 		zth_init();
 
@@ -67,6 +440,9 @@ public:
 		if((res = waiter().run()))
 			goto error;
 
+		if(Config::TimesliceTick)
+			timeslice_tick_start();
+
 		return;
 
 error:
@@ -77,6 +453,11 @@ error:
 	{
 		zth_dbg(worker, "[%s] Destruct", id_str());
 
+		if(m_group)
+			groupLeave();
+
+		inboxDrain(false);
+
 		while(!m_suspendedQueue.empty()) {
 			Fiber& f = m_suspendedQueue.front();
 			resume(f);
@@ -87,6 +468,10 @@ error:
 			cleanup(m_runnableQueue.front());
 		}
 
+		if(Config::TimesliceTick)
+			timeslice_tick_stop();
+
+		wait_on_deinit(m_waitOn);
 		perf_deinit();
 		context_deinit();
 	}
@@ -101,6 +486,12 @@ error:
 		return m_waiter;
 	}
 
+	/*!
+	 * \brief Return the wait queues of #zth::wait_on(), which are created on first use.
+	 * \details This is defined in libzth/sync.h.
+	 */
+	WaitOnTable& waitOnTable();
+
 	void add(Fiber* fiber, bool front = false) noexcept
 	{
 		zth_assert(fiber);
@@ -158,6 +549,46 @@ error:
 		return m_disableContextSwitch == 0;
 	}
 
+	/*!
+	 * \brief Keep the Worker running, even when it is out of work.
+	 *
+	 * While enabled, #run() does not return when there is nothing to do, but the Worker
+	 * sleeps until it gets a #post().  Calls can be nested; every enable must be matched by a
+	 * disable.
+	 */
+	void keepAlive(bool enable = true) noexcept
+	{
+		if(enable) {
+			if(m_keepAlive++ == 0)
+				m_waiter.wakeup();
+		} else {
+			zth_assert(m_keepAlive > 0);
+			m_keepAlive--;
+		}
+	}
+
+	bool keptAlive() const noexcept
+	{
+		return m_keepAlive > 0;
+	}
+
+	/*!
+	 * \brief A fiber or callback that is posted to a Worker.
+	 * \see #post(InboxItem&)
+	 */
+	struct InboxItem {
+		InboxItem* next;
+		Fiber* fiber;
+		void (*f)(void*);
+		void* arg;
+		// When set, the Worker does not delete the item after processing it.
+		bool external;
+	};
+
+	int post(Fiber& fiber) noexcept;
+	int post(void (*f)(void*), void* arg = nullptr) noexcept;
+	void post(InboxItem& item) noexcept;
+
 	void release(Fiber& fiber) noexcept
 	{
 		if(unlikely(fiber.state() == Fiber::Suspended)) {
@@ -178,6 +609,12 @@ error:
 			// Don't switch, immediately continue.
 			return true;
 
+		if(unlikely(__atomic_load_n(&m_inbox, __ATOMIC_RELAXED)))
+			inboxDrain();
+
+		if(unlikely(m_group))
+			groupSchedule();
+
 		if(preferFiber)
 			zth_dbg(worker, "[%s] Schedule to %s", id_str(), preferFiber->id_str());
 		else
@@ -196,13 +633,28 @@ error:
 			preferFiber = &m_workerFiber;
 		}
 
+		if(unlikely(m_runnableQueue.edf()) && !preferFiber && m_currentFiber
+		   && m_currentFiber->m_runLevel == RunQueue::DeadlineLevel) {
+			// Fibers with a deadline outrank the Waiter. Give it a turn at the end of
+			// every time slice anyway, such that timers still expire.
+			Fiber* w = m_waiter.fiber();
+			if(w && RunQueue::queued(*w) && w->m_runLevel != RunQueue::DeadlineLevel)
+				preferFiber = w;
+		}
+
 		Fiber* nextFiber = preferFiber;
 		bool didSchedule = false;
 reschedule:
 		if(likely(!nextFiber)) {
+			m_handoffs = 0;
+
+			if(unlikely(m_currentFiber && m_currentFiber->m_group))
+				// Let the group of the current fiber compete with what it has used.
+				m_currentFiber->chargeGroup(now);
+
 			if(likely(!m_runnableQueue.empty()))
 				// Use first of the queue.
-				nextFiber = &m_runnableQueue.front();
+				nextFiber = &m_runnableQueue.next(now);
 			else
 				// No fiber to switch to.
 				nextFiber = &m_workerFiber;
@@ -214,7 +666,7 @@ reschedule:
 			m_currentFiber = nextFiber;
 
 			if(unlikely(nextFiber != &m_workerFiber))
-				m_runnableQueue.rotate(*++m_runnableQueue.cyclic(*nextFiber));
+				m_runnableQueue.rotate(*nextFiber);
 
 			int res =
 				nextFiber->run(likely(prevFiber) ? *prevFiber : m_workerFiber, now);
@@ -298,14 +750,215 @@ reschedule:
 		}
 	}
 
-	void resume(Fiber& fiber) noexcept
+	void resume(Fiber& fiber, bool front = false) noexcept
 	{
 		if(fiber.state() != Fiber::Suspended)
 			return;
 
 		release(fiber);
 		fiber.resume();
-		add(&fiber);
+		add(&fiber, front);
+	}
+
+	/*!
+	 * \brief Change the priority of a fiber of this Worker.
+	 *
+	 * The Worker only runs a fiber when no fiber of a higher priority is runnable.  Fibers of
+	 * the same priority are scheduled round-robin.
+	 *
+	 * \return 0 on success, otherwise an errno
+	 * \see #zth::Config::PriorityLevels
+	 */
+	int setPriority(Fiber& fiber, unsigned int priority) noexcept
+	{
+		if(priority >= RunQueue::Levels)
+			return EINVAL;
+
+		zth_dbg(worker, "[%s] Set priority of %s to %u", id_str(), fiber.id_str(),
+			priority);
+		reprioritize(fiber, priority, fiber.m_inherited);
+		return 0;
+	}
+
+	/*!
+	 * \brief Let \p fiber run with at least the given priority, until it releases all its
+	 *	#zth::Mutex locks.
+	 */
+	void inheritPriority(Fiber& fiber, unsigned int priority) noexcept
+	{
+		if(priority <= fiber.effectivePriority())
+			return;
+
+		zth_dbg(worker, "[%s] %s inherits priority %u", id_str(), fiber.id_str(),
+			priority);
+		reprioritize(fiber, fiber.m_priority, priority);
+	}
+
+	void mutexLocked(Fiber& fiber) noexcept
+	{
+		fiber.m_locks++;
+	}
+
+	void mutexUnlocked(Fiber& fiber) noexcept
+	{
+		zth_assert(fiber.m_locks > 0);
+		if(--fiber.m_locks == 0 && unlikely(fiber.m_inherited))
+			reprioritize(fiber, fiber.m_priority, 0);
+	}
+
+	/*!
+	 * \brief Check if a fiber of a higher priority, or with an earlier deadline, than the
+	 *	current one is runnable.
+	 */
+	bool higherPriorityRunnable() const noexcept
+	{
+		if((RunQueue::Levels == 1 && !m_runnableQueue.edf()) || !m_currentFiber
+		   || m_runnableQueue.empty())
+			return false;
+
+		unsigned int top = m_runnableQueue.top();
+		unsigned int l = m_currentFiber->m_runLevel;
+		return top > l
+		       || (top == RunQueue::DeadlineLevel && l == top
+			   && &m_runnableQueue.front() != m_currentFiber);
+	}
+
+	/*!
+	 * \brief Enable earliest-deadline-first scheduling.
+	 *
+	 * When enabled, runnable fibers with a deadline run before all others, the one with the
+	 * earliest deadline first.  When disabled, deadlines are only used to count misses.
+	 *
+	 * \see #setDeadline()
+	 */
+	void setEdf(bool enable = true) noexcept
+	{
+		zth_dbg(worker, "[%s] %s earliest-deadline-first scheduling", id_str(),
+			enable ? "Enable" : "Disable");
+		m_runnableQueue.setEdf(enable);
+	}
+
+	bool edf() const noexcept
+	{
+		return m_runnableQueue.edf();
+	}
+
+	/*!
+	 * \brief Set the absolute deadline of the current job of a fiber of this Worker.
+	 *
+	 * This marks the end of the previous job.  If its deadline passed before \p now, it
+	 * counts as a miss, which is also recorded in the perf output.  Pass
+	 * #zth::Timestamp::null() to clear the deadline.  #zth::PeriodicWakeUp sets the deadline
+	 * to the end of the next period.
+	 *
+	 * \see #setEdf()
+	 */
+	void setDeadline(
+		Fiber& fiber, Timestamp const& deadline, Timestamp const& now = Timestamp::now())
+	{
+		if(unlikely(!fiber.m_deadline.isNull() && fiber.m_deadline < now)) {
+			fiber.m_deadlineMisses++;
+			m_deadlineMisses++;
+			zth_dbg(worker, "[%s] %s missed its deadline by %s", id_str(),
+				fiber.id_str(), (now - fiber.m_deadline).str().c_str());
+			zth_perf_event(fiber, now, "deadline miss %u", fiber.m_deadlineMisses);
+		}
+
+		if(m_runnableQueue.edf() && RunQueue::queued(fiber)) {
+			m_runnableQueue.erase(fiber);
+			fiber.m_deadline = deadline;
+			m_runnableQueue.push_back(fiber);
+		} else {
+			fiber.m_deadline = deadline;
+		}
+	}
+
+	/*! \brief Return the total number of deadline misses of the fibers of this Worker. */
+	unsigned int deadlineMisses() const noexcept
+	{
+		return m_deadlineMisses;
+	}
+
+	/*!
+	 * \brief Move a fiber of this Worker to the given group, or to none.
+	 * \see #zth::FiberGroup
+	 */
+	void setFiberGroup(Fiber& fiber, FiberGroup* group) noexcept
+	{
+		if(fiber.m_group == group)
+			return;
+
+		zth_dbg(worker, "[%s] Move %s to %s", id_str(), fiber.id_str(),
+			group ? group->id_str() : "no group");
+
+		bool queued = RunQueue::queued(fiber);
+		if(queued)
+			m_runnableQueue.erase(fiber);
+
+		if(fiber.m_group)
+			fiber.m_group->m_members--;
+
+		fiber.m_group = group;
+		fiber.m_groupCharged = Timestamp::now();
+
+		if(group)
+			group->m_members++;
+
+		if(queued)
+			m_runnableQueue.push_back(fiber);
+	}
+
+	/*!
+	 * \brief Switch directly to a fiber that has just been woken up.
+	 *
+	 * This is a #schedule() to \p fiber, as done by synchronizers in handoff mode.  To
+	 * prevent starvation, it does not switch when \p fiber would overtake a fiber with a
+	 * higher priority or an earlier deadline, or after #zth::Config::HandoffLimit handoffs
+	 * without a regular #schedule() in between.  It does not switch either from a callback
+	 * that was posted to this Worker, as that may run within #schedule().
+	 *
+	 * \return \c true when switched to \p fiber
+	 * \see #zth::SynchronizerBase::setHandoff()
+	 */
+	bool handoff(Fiber& fiber, Timestamp const& now = Timestamp::now())
+	{
+		if(!m_currentFiber || &fiber == m_currentFiber || !RunQueue::queued(fiber)
+		   || m_handoffs >= Config::HandoffLimit || m_inboxDraining)
+			return false;
+
+		if(fiber.m_runLevel == RunQueue::DeadlineLevel) {
+			// Do not overtake a fiber with an earlier deadline.
+			if(&m_runnableQueue.front() != &fiber)
+				return false;
+		} else if(fiber.m_runLevel < m_runnableQueue.top()) {
+			// Do not overtake a fiber with a higher priority.
+			return false;
+		}
+
+		m_handoffs++;
+		zth_dbg(worker, "[%s] Handoff to %s", id_str(), fiber.id_str());
+		return schedule(&fiber, now);
+	}
+
+	/*!
+	 * \brief Switch to a runnable fiber with a lower priority than the current one.
+	 *
+	 * #schedule() does not do that, as long as the current fiber is runnable.  Use this
+	 * when the current fiber stays runnable, but it has nothing to do for now.
+	 *
+	 * \return \c true when another fiber has been scheduled
+	 */
+	bool scheduleLower(Timestamp const& now = Timestamp::now())
+	{
+		if((RunQueue::Levels == 1 && !m_runnableQueue.edf()) || !m_currentFiber
+		   || !RunQueue::queued(*m_currentFiber))
+			return false;
+
+		Fiber* lower = m_runnableQueue.below(m_currentFiber->m_runLevel);
+		if(!lower)
+			return false;
+
+		return schedule(lower, now);
 	}
 
 	Timestamp const& runEnd() const noexcept
@@ -323,9 +976,21 @@ reschedule:
 			m_end = Timestamp::now() + duration;
 		}
 
-		while(!m_runnableQueue.empty()
-		      && (runEnd().isNull() || Timestamp::now() < runEnd())) {
-			schedule();
+		for(Timestamp now = Timestamp::now(); runEnd().isNull() || now < runEnd();
+		    now = Timestamp::now()) {
+			if(unlikely(m_runnableQueue.empty())) {
+				if(inboxPending()) {
+					inboxDrain();
+					continue;
+				}
+
+				// Out of work. Within a group, wait for something to steal.
+				if(!m_group || !groupIdle())
+					break;
+				continue;
+			}
+
+			schedule(nullptr, now);
 			zth_assert(!currentFiber());
 		}
 
@@ -345,6 +1010,43 @@ reschedule:
 		return m_load;
 	}
 
+	/*!
+	 * \brief Return the #zth::WorkerGroup this Worker is member of.
+	 * \return the group, or \c nullptr when not joined any
+	 */
+	WorkerGroup* group() const noexcept
+	{
+		return m_group;
+	}
+
+	/*!
+	 * \brief Allow the given fiber to be stolen by other Workers in the group.
+	 *
+	 * The fiber must just have been hatched by this Worker. It is removed from the runnable
+	 * queue and handed to the #zth::WorkerGroup upon the next #schedule(). By then, the fiber
+	 * must only be referenced by this Worker; otherwise it just stays here.
+	 *
+	 * When this Worker is not member of a group, or the fiber is in a #zth::FiberGroup, nothing
+	 * happens.
+	 *
+	 * \see #zth::stealable
+	 */
+	void share(Fiber& fiber) noexcept
+	{
+		if(!m_group || fiber.state() != Fiber::New || fiber.fiberGroup())
+			return;
+
+		release(fiber);
+		m_sharedQueue.push_back(fiber);
+		zth_dbg(worker, "[%s] Share %s", id_str(), fiber.id_str());
+	}
+
+	/*!
+	 * \brief Take a shared fiber from the group, and add it to the runnable queue.
+	 * \return \c true when a fiber was added
+	 */
+	bool groupTake() noexcept;
+
 protected:
 	static void dummyWorkerEntry(void*)
 	{
@@ -364,10 +1066,21 @@ protected:
 		zth_dbg(list, "[%s] Run queue:", id_str());
 		if(m_runnableQueue.empty())
 			zth_dbg(list, "[%s]   <empty>", id_str());
-		else
-			for(decltype(m_runnableQueue.begin()) it = m_runnableQueue.begin();
-			    it != m_runnableQueue.end(); ++it)
-				zth_dbg(list, "[%s]   %s", id_str(), it->str().c_str());
+		else if(m_runnableQueue.deadlines())
+			zth_dbg(list, "[%s]   %u with deadline", id_str(),
+				(unsigned int)m_runnableQueue.deadlines());
+
+		if(!m_runnableQueue.empty())
+			for(unsigned int l = RunQueue::Levels; l > 0; l--) {
+				List<> const& q = m_runnableQueue[l - 1];
+				for(decltype(q.begin()) it = q.begin(); it != q.end(); ++it)
+					if(m_runnableQueue.isGroups(*it))
+						zth_dbg(list, "[%s]   %u: <groups>", id_str(),
+							l - 1);
+					else
+						zth_dbg(list, "[%s]   %u: %s", id_str(), l - 1,
+							static_cast<Fiber&>(*it).str().c_str());
+			}
 
 		zth_dbg(list, "[%s] Suspended queue:", id_str());
 		if(m_suspendedQueue.empty())
@@ -384,11 +1097,42 @@ protected:
 		return m_stack;
 	}
 
+	void reprioritize(Fiber& fiber, unsigned int priority, unsigned int inherited) noexcept
+	{
+		bool queued = RunQueue::queued(fiber);
+		if(queued)
+			m_runnableQueue.erase(fiber);
+
+		fiber.m_priority = priority;
+		fiber.m_inherited = inherited;
+
+		if(queued)
+			m_runnableQueue.push_back(fiber);
+	}
+
 	friend class Context;
+	friend class WorkerGroup;
+	friend class Waiter;
+
+	bool inboxPending() const noexcept
+	{
+		return __atomic_load_n(&m_inbox, __ATOMIC_SEQ_CST) != nullptr;
+	}
+
+	int inboxPush(InboxItem* item) noexcept;
+	void inboxDrain(bool process = true) noexcept;
+	void adopt(Fiber& fiber, bool foreign) noexcept;
+
+	void groupSchedule() noexcept;
+	bool groupIdle() noexcept;
+	void groupPublish() noexcept;
+	void groupLeave() noexcept;
+	bool groupSleepBegin() noexcept;
+	void groupSleepEnd() noexcept;
 
 private:
 	Fiber* m_currentFiber;
-	List<Fiber> m_runnableQueue;
+	RunQueue m_runnableQueue;
 	List<Fiber> m_suspendedQueue;
 	Fiber m_workerFiber;
 	Waiter m_waiter;
@@ -396,6 +1140,18 @@ private:
 	int m_disableContextSwitch;
 	Load_type m_load;
 	Stack m_stack;
+	WorkerGroup* m_group;
+	size_t m_groupSlot;
+	unsigned int m_groupTick;
+	List<Fiber> m_sharedQueue;
+	InboxItem* m_inbox;
+	// Set while inboxDrain() runs the posted callbacks, which may be within schedule().
+	bool m_inboxDraining;
+	int m_keepAlive;
+	unsigned int m_deadlineMisses;
+	// Number of handoff()s since the last regular schedule().
+	unsigned int m_handoffs;
+	WaitOnTable* m_waitOn;
 
 	friend void worker_global_init();
 };
@@ -450,19 +1206,38 @@ inline void getContext(Worker** worker, Fiber** fiber) noexcept
  * \param now the current time stamp
  * \ingroup zth_api_cpp_fiber
  */
-ZTH_EXPORT inline void
-yield(Fiber* preferFiber = nullptr, bool alwaysYield = false,
-      Timestamp const& now = Timestamp::now())
+ZTH_EXPORT inline void yield(Fiber* preferFiber, bool alwaysYield, Timestamp const& now)
 {
 	Fiber const& f = currentFiber();
 
 	perf_syscall("yield()", now);
-	if(unlikely(!alwaysYield && !f.allowYield(now)))
+	if(unlikely(!alwaysYield && !f.allowYield(now))
+	   && likely(!currentWorker().higherPriorityRunnable()))
 		return;
 
 	currentWorker().schedule(preferFiber, now);
 }
 
+/*!
+ * \copydoc yield(Fiber*, bool, Timestamp const&)
+ * \details When #zth::Config::TimesliceTick is set, the clock is only read when the time slice
+ *	has ended.
+ */
+ZTH_EXPORT inline void yield(Fiber* preferFiber = nullptr, bool alwaysYield = false)
+{
+	if(Config::TimesliceTick && likely(!alwaysYield)) {
+		if(likely(!currentFiber().allowYieldTick())
+		   && likely(!currentWorker().higherPriorityRunnable())) {
+			perf_syscall("yield()");
+			return;
+		}
+
+		alwaysYield = true;
+	}
+
+	yield(preferFiber, alwaysYield, Timestamp::now());
+}
+
 /*!
  * \brief Force a context switch.
  *
@@ -493,7 +1268,131 @@ inline void resume(Fiber& fiber)
 	worker->resume(fiber);
 }
 
+/*!
+ * \brief A group of Workers that balance new fibers among each other.
+ *
+ * Fibers that are marked #zth::stealable are handed by their Worker to a lock-free queue
+ * within the group. The owning Worker takes them back once in a while, but idle Workers of
+ * the same group steal them first.  Only fibers that did not run yet are moved to another
+ * Worker; once started, a fiber stays where it is. Therefore, a stealable fiber must not use
+ * any synchronization primitive or other state of the Worker that created it.
+ *
+ * \note The group balances the start of new fibers only. Fibers that are suspended, such as
+ *       a Ready fiber that yielded or a fiber that waits for I/O, are never migrated, because
+ *       the scheduler frames on their stack refer to the Worker that runs them. A Worker that
+ *       is loaded by long-running fibers keeps that load, even when the others are idle. Split
+ *       such work into new stealable fibers instead.
+ *
+ * Every Worker thread should #join() the group, and then #zth::Worker::run(), which keeps
+ * running and stealing until the group is stopped.  The group must outlive all its members.
+ *
+ * \ingroup zth_api_cpp_fiber
+ */
+class WorkerGroup : public UniqueID<WorkerGroup> {
+	ZTH_CLASS_NEW_DELETE(WorkerGroup)
+	ZTH_CLASS_NOCOPY(WorkerGroup)
+public:
+	explicit WorkerGroup(char const* name = "zth::WorkerGroup");
+	virtual ~WorkerGroup() noexcept override;
+
+	int join(Worker& worker = currentWorker()) noexcept;
+	void leave(Worker& worker = currentWorker()) noexcept;
+	void stop() noexcept;
+
+	/*!
+	 * \brief Check if #stop() was called.
+	 */
+	bool stopped() const noexcept
+	{
+		return __atomic_load_n(&m_stop, __ATOMIC_ACQUIRE);
+	}
+
+	/*!
+	 * \brief Return the number of Workers that joined the group.
+	 */
+	size_t size() const noexcept
+	{
+		return __atomic_load_n(&m_size, __ATOMIC_ACQUIRE);
+	}
+
+	/*!
+	 * \brief Return the number of fibers that were moved to another Worker.
+	 */
+	uint64_t steals() const noexcept
+	{
+		return __atomic_load_n(&m_steals, __ATOMIC_RELAXED);
+	}
+
+protected:
+	friend class Worker;
+
+	bool push(size_t slot, Fiber& fiber) noexcept;
+	Fiber* take(size_t slot) noexcept;
+	Fiber* steal(size_t thief) noexcept;
+	bool empty(size_t slot) const noexcept;
+	bool sleep(size_t slot) noexcept;
+	void awake(size_t slot) noexcept;
+	void wake(size_t waker, size_t count = 1) noexcept;
+
+private:
+	/*!
+	 * \brief Per-Worker fixed-size work-stealing deque.
+	 *
+	 * This is a Chase-Lev deque. The owner pushes and takes at the bottom, thieves take from
+	 * the top.
+	 */
+	struct Slot {
+		Worker* worker;
+		// Number of threads that are about to interrupt the sleep of #worker.
+		int waking;
+		int64_t top;
+		int64_t bottom;
+		Fiber* queue[Config::WorkerGroupQueueSize];
+	};
+
+	Slot* m_slots;
+	size_t m_size;
+	bool m_stop;
+	uint64_t m_steals;
+	// Bit mask of the slots of which the Worker sleeps, waiting to be woken by #wake().
+	uint64_t m_sleeping;
+};
+
+/*!
+ * \brief Attributes of a thread started by #zth::startWorkerThread().
+ * \ingroup zth_api_cpp_fiber
+ */
+struct WorkerThreadAttr {
+	WorkerThreadAttr() noexcept
+		: stack()
+		, name()
+		, cpus()
+		, cpuCount()
+		, fifoPriority()
+	{}
+
+	/*! \brief Stack size of the fiber, or 0 for the default. */
+	size_t stack;
+	/*! \brief Name of the fiber and the thread, or \c nullptr. */
+	char const* name;
+	/*!
+	 * \brief CPUs the thread is pinned to, or \c nullptr to let it float.
+	 *
+	 * As the thread then first touches all memory it allocates, such as the fiber stacks,
+	 * the kernel maps that memory on the NUMA node of these CPUs.  Only supported on Linux.
+	 */
+	int const* cpus;
+	/*! \brief Number of elements in #cpus. */
+	size_t cpuCount;
+	/*!
+	 * \brief Run the thread with \c SCHED_FIFO at this priority, or 0 to inherit the policy.
+	 * \details This usually requires \c CAP_SYS_NICE.
+	 */
+	int fifoPriority;
+};
+
 int startWorkerThread(void (*f)(), size_t stack = 0, char const* name = nullptr);
+int startWorkerThread(void (*f)(), WorkerThreadAttr const& attr);
 int execlp(char const* file, char const* arg, ... /*, nullptr */);
 int execvp(char const* file, char* const arg[]);
 
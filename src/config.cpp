@@ -56,6 +56,10 @@ bool config(int env, bool whenUnset)
 		static bool const e = config("ZTH_CONFIG_CHECK_TIMESLICE_OVERRUN", whenUnset);
 		return e;
 	}
+	case Env::UseIoUring: {
+		static bool const e = config("ZTH_CONFIG_USE_IO_URING", whenUnset);
+		return e;
+	}
 	default:
 		return whenUnset;
 	}
@@ -16,6 +16,502 @@
 
 
 
+////////////////////////////////////////////////////////////
+// Stack cache
+
+namespace zth {
+
+namespace {
+/*!
+ * \brief Contexts of finished fibers, of which the stack can be reused.
+ *
+ * The contexts are ordered from least to most recently cached.  The stacks of
+ * the first \c released ones have been handed back to the OS.
+ */
+struct StackCache {
+	Context* contexts[Config::StackCacheHigh > 0 ? Config::StackCacheHigh : 1];
+	size_t count;
+	size_t released;
+	bool enabled;
+	StackCacheStats stats;
+};
+} // namespace
+
+ZTH_TLS_STATIC(StackCache, stack_cache, {})
+
+static size_t stack_cache_class(size_t size) noexcept
+{
+	size_t const page = Context::pageSize();
+	return (size + page - 1U) & ~(page - 1U);
+}
+
+/*!
+ * \brief Check if stacks created with the given attributes have the same layout.
+ */
+static bool stack_cache_match(ContextAttr const& a, ContextAttr const& b) noexcept
+{
+	if(stack_cache_class(a.stackSize) != stack_cache_class(b.stackSize))
+		return false;
+
+	bool reserved = a.stackReserve > a.stackSize;
+	if(reserved != (b.stackReserve > b.stackSize))
+		return false;
+
+	return !reserved || stack_cache_class(a.stackReserve) == stack_cache_class(b.stackReserve);
+}
+
+/*!
+ * \brief Take a context with a stack for the given attributes from the cache.
+ * \return the context, or \c nullptr when there is none
+ */
+static Context* stack_cache_take(ContextAttr const& attr) noexcept
+{
+	StackCache& cache = ZTH_TLS_GET(stack_cache);
+	if(!cache.enabled || attr.stackSize == 0 || attr.stackShared)
+		return nullptr;
+
+	// Prefer the most recently used stack, which is probably still in the CPU's cache.
+	for(size_t i = cache.count; i > 0; i--) {
+		Context* context = cache.contexts[i - 1U];
+		if(!stack_cache_match(context->attr(), attr))
+			continue;
+
+		for(size_t j = i; j < cache.count; j++)
+			cache.contexts[j - 1U] = cache.contexts[j];
+
+		cache.count--;
+		if(cache.released >= i)
+			cache.released--;
+
+		cache.stats.hits++;
+		return context;
+	}
+
+	cache.stats.misses++;
+	return nullptr;
+}
+
+/*!
+ * \brief Put the context of a finished fiber in the cache.
+ * \return \c true when cached, otherwise the context should be destroyed
+ */
+static bool stack_cache_put(Context* context) noexcept
+{
+	StackCache& cache = ZTH_TLS_GET(stack_cache);
+	if(!cache.enabled || !context->stack())
+		return false;
+
+	if(cache.count >= Config::StackCacheHigh) {
+		cache.stats.evictions++;
+		return false;
+	}
+
+	if(!context->recycle())
+		return false;
+
+	cache.contexts[cache.count++] = context;
+	return true;
+}
+
+/*!
+ * \brief Let the OS reclaim the memory of the stacks in the cache above the low watermark.
+ *
+ * The #zth::Waiter calls this function when the Worker is about to sleep.  The least recently
+ * used stacks are released first.
+ *
+ * \see #zth::Config::StackCacheLow
+ * \ingroup zth_api_cpp_stack
+ */
+void stack_cache_trim() noexcept
+{
+	StackCache& cache = ZTH_TLS_GET(stack_cache);
+
+	while(cache.count - cache.released > Config::StackCacheLow) {
+		cache.contexts[cache.released++]->releaseStack();
+		cache.stats.releases++;
+	}
+}
+
+/*!
+ * \brief Return the statistics of the stack cache of the current thread.
+ * \ingroup zth_api_cpp_stack
+ */
+StackCacheStats stack_cache_stats() noexcept
+{
+	StackCache const& cache = ZTH_TLS_GET(stack_cache);
+	StackCacheStats stats = cache.stats;
+	stats.cached = cache.count;
+	return stats;
+}
+
+/*!
+ * \brief Free all stacks in the cache of the current thread.
+ * \ingroup zth_api_cpp_stack
+ */
+void stack_cache_flush() noexcept
+{
+	StackCache& cache = ZTH_TLS_GET(stack_cache);
+
+	while(cache.count > 0) {
+		Context* context = cache.contexts[--cache.count];
+		context->destroy();
+		delete context;
+	}
+
+	cache.released = 0;
+}
+
+} // namespace zth
+
+
+
+////////////////////////////////////////////////////////////
+// Shared stacks
+
+namespace zth {
+
+namespace {
+/*!
+ * \brief The stack that is shared by fibers of a Worker.
+ *
+ * Only one context has its frames on the shared stack: the \c owner.  The frames of
+ * the others are saved in their own buffer, and copied back before they are resumed.
+ */
+struct SharedStack {
+	/*! \brief Context that is never run, but provides the stack memory. */
+	Context* host;
+	/*! \brief Context that swaps the frames, while the owner is running. */
+	Context* switcher;
+	/*! \brief Context of which the frames are on the stack. */
+	Context* owner;
+	/*! \brief Context that the switcher should swap in and resume. */
+	Context* pending;
+};
+} // namespace
+
+ZTH_TLS_STATIC(SharedStack, shared_stack, {})
+
+static size_t const shared_stack_switcher_size = 0x10000;
+
+/*!
+ * \brief Return an address below the frame of the caller.
+ */
+static __attribute__((noinline)) void* shared_stack_sp() noexcept
+{
+	return __builtin_frame_address(0);
+}
+
+/*!
+ * \brief Put the frames of the given context on the shared stack.
+ *
+ * The frames of the current owner are saved first.  This must not run on the shared stack.
+ */
+static void shared_stack_swap(SharedStack& s, Context* context) noexcept
+{
+	int res = 0;
+
+	if(s.owner && unlikely((res = s.owner->stackSave())))
+		zth_abort("Cannot save shared stack; %s", err(res).c_str());
+
+	s.owner = context;
+
+	if(!context->stackSuspended()) {
+		// First run; initialize the context on the stack.
+		if(unlikely((res = context->create())))
+			zth_abort("Cannot create context on shared stack; %s", err(res).c_str());
+	} else {
+		context->stackRestore();
+	}
+}
+
+/*!
+ * \brief Entry of the switcher, which runs on its own stack.
+ */
+static void shared_stack_switcher(void* UNUSED_PAR(arg)) noexcept
+{
+	while(true) {
+		SharedStack& s = ZTH_TLS_GET(shared_stack);
+		Context* to = s.pending;
+		s.pending = nullptr;
+
+		shared_stack_swap(s, to);
+		s.switcher->context_switch(*to);
+		s.switcher->stackGuard();
+	}
+}
+
+/*!
+ * \brief Create the shared stack of the current thread, if it does not exist yet.
+ * \return 0 on success, otherwise an errno
+ */
+static int shared_stack_init(SharedStack& s) noexcept
+{
+	if(likely(s.switcher))
+		return 0;
+
+#ifdef ZTH_CONTEXT_WINFIBER
+	// Windows fibers always have their own stack.
+	return ENOSYS;
+#endif
+
+	int res = 0;
+	if(!s.host && (res = context_create(s.host, ContextAttr(nullptr, nullptr,
+								   Config::SharedStackSize))))
+		return res;
+
+	if((res = context_create(
+		    s.switcher, ContextAttr(&shared_stack_switcher, nullptr,
+					    shared_stack_switcher_size))))
+		return res;
+
+	zth_dbg(context, "[%s] Shared stack %p-%p", currentWorker().id_str(),
+		s.host->stackUsable().p, s.host->stackUsable().p + s.host->stackUsable().size - 1U);
+	return 0;
+}
+
+/*!
+ * \brief Release the shared stack of the current thread.
+ */
+static void shared_stack_deinit() noexcept
+{
+	SharedStack& s = ZTH_TLS_GET(shared_stack);
+	context_destroy(s.switcher);
+	context_destroy(s.host);
+	s = SharedStack();
+}
+
+/*!
+ * \brief Let the given context use the shared stack of the current thread.
+ *
+ * The context is created when it runs for the first time.
+ */
+static int shared_stack_attach(Context* context) noexcept
+{
+	SharedStack& s = ZTH_TLS_GET(shared_stack);
+
+	int res = shared_stack_init(s);
+	if(res)
+		return res;
+
+	context->stackShare(s.host->stack(), s.host->stackUsable());
+	return 0;
+}
+
+/*!
+ * \brief Forget the frames of the given context, which is destroyed.
+ */
+static void shared_stack_detach(Context* context) noexcept
+{
+	SharedStack& s = ZTH_TLS_GET(shared_stack);
+	if(s.owner != context)
+		return;
+
+	s.owner = nullptr;
+
+#ifdef ZTH_ENABLE_ASAN
+	Stack const& stack = s.host->stackUsable();
+	ASAN_UNPOISON_MEMORY_REGION(stack.p, stack.size);
+#endif
+}
+
+/*!
+ * \brief Context switch, where at least one of the contexts runs on the shared stack.
+ */
+static void shared_stack_switch(Context* from, Context* to) noexcept
+{
+	SharedStack& s = ZTH_TLS_GET(shared_stack);
+
+	if(from->stackShared())
+		from->stackSuspend(shared_stack_sp());
+
+	if(to->stackShared() && s.owner != to) {
+		if(from->stackShared()) {
+			// We are running on the shared stack. Let the switcher swap it.
+			zth_assert(s.owner == from);
+			s.pending = to;
+			to = s.switcher;
+		} else {
+			shared_stack_swap(s, to);
+		}
+	}
+
+	from->context_switch(*to);
+}
+
+/*!
+ * \brief Check if the given pointer is within the shared stack of the current Worker.
+ *
+ * Objects on the shared stack are only valid while their fiber is running.
+ *
+ * \see #zth::Fiber::setStackShared()
+ * \ingroup zth_api_cpp_stack
+ */
+bool stack_shared_contains(void const* p) noexcept
+{
+	SharedStack const& s = ZTH_TLS_GET(shared_stack);
+	if(!s.host)
+		return false;
+
+	Stack const& stack = s.host->stackUsable();
+	char const* p_ = static_cast<char const*>(p);
+	return p_ >= stack.p && p_ < stack.p + stack.size;
+}
+
+} // namespace zth
+
+
+
+////////////////////////////////////////////////////////////
+// Stack reservations
+
+namespace zth {
+
+#ifdef ZTH_HAVE_MMAN
+/*!
+ * \brief Return the number of bytes of the given stack that are in memory.
+ */
+static size_t stack_resident(Stack const& stack) noexcept
+{
+	if(!stack.p)
+		return 0;
+
+	size_t const ps = Context::pageSize();
+	size_t res = 0;
+	unsigned char vec[256];
+
+	for(size_t offset = 0; offset < stack.size; offset += sizeof(vec) * ps) {
+		size_t len = stack.size - offset;
+		if(len > sizeof(vec) * ps)
+			len = sizeof(vec) * ps;
+
+		if(mincore(stack.p + offset, len, vec))
+			return 0;
+
+		for(size_t i = 0; i < (len + ps - 1U) / ps; i++)
+			if(vec[i] & 1U)
+				res += ps;
+	}
+
+	return res;
+}
+#endif
+
+#ifdef ZTH_OS_LINUX
+static struct sigaction stack_overflow_oldact;
+static int stack_overflow_res;
+ZTH_TLS_STATIC(bool, stack_overflow_thread, false)
+ZTH_TLS_STATIC(void*, stack_overflow_altstack, nullptr)
+
+static size_t const stack_overflow_altstack_size = 0x10000;
+
+/*!
+ * \brief \c SIGSEGV handler, which reports hitting the guard page of a reserved stack.
+ *
+ * It runs on an alternate signal stack, as the fiber's stack is exhausted.  Other faults
+ * are passed on to the previous handler.
+ */
+static void stack_overflow_handler(int sig, siginfo_t* info, void* uc)
+{
+	Worker* worker = Worker::instance();
+	Fiber* fiber = worker ? worker->currentFiber() : nullptr;
+	Context* context = fiber ? fiber->context() : nullptr;
+
+	if(context && context->stackOverflow(info->si_addr))
+		zth_abort("Stack overflow of %s; reserved 0x%x bytes", fiber->id_str(),
+			  (unsigned int)context->attr().stackReserve);
+
+	if(stack_overflow_oldact.sa_flags & SA_SIGINFO) {
+		stack_overflow_oldact.sa_sigaction(sig, info, uc);
+	} else if(stack_overflow_oldact.sa_handler != SIG_DFL
+		  && stack_overflow_oldact.sa_handler != SIG_IGN) {
+		stack_overflow_oldact.sa_handler(sig);
+	} else {
+		// Restore the default action, and let the fault happen again.
+		sigaction(sig, &stack_overflow_oldact, nullptr);
+	}
+}
+
+static void stack_overflow_install() noexcept
+{
+	struct sigaction sa = {};
+	sa.sa_sigaction = &stack_overflow_handler;
+	sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+	sigemptyset(&sa.sa_mask);
+
+	if(sigaction(SIGSEGV, &sa, &stack_overflow_oldact))
+		stack_overflow_res = errno;
+}
+#endif
+
+/*!
+ * \brief Prepare the current thread to report overflows of reserved stacks.
+ *
+ * This installs a \c SIGSEGV handler, and an alternate signal stack for the
+ * current thread, when it does not have one yet.
+ *
+ * \return 0 on success, otherwise an errno
+ */
+int stack_overflow_init() noexcept
+{
+#ifdef ZTH_OS_LINUX
+	if(likely(ZTH_TLS_GET(stack_overflow_thread)))
+		return 0;
+
+	stack_t ss = {};
+	if(sigaltstack(nullptr, &ss))
+		return errno;
+
+	if(ss.ss_flags & SS_DISABLE) {
+		void* p = mmap(nullptr, stack_overflow_altstack_size, PROT_READ | PROT_WRITE,
+			       MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+		if(p == MAP_FAILED)
+			return errno;
+
+		ss.ss_sp = p;
+		ss.ss_size = stack_overflow_altstack_size;
+		ss.ss_flags = 0;
+		if(sigaltstack(&ss, nullptr)) {
+			int res = errno;
+			munmap(p, stack_overflow_altstack_size);
+			return res;
+		}
+
+		ZTH_TLS_SET(stack_overflow_altstack, p);
+	}
+
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	pthread_once(&once, &stack_overflow_install);
+	if(stack_overflow_res)
+		return stack_overflow_res;
+
+	ZTH_TLS_SET(stack_overflow_thread, true);
+#endif
+	return 0;
+}
+
+/*!
+ * \brief Release the alternate signal stack of the current thread.
+ */
+static void stack_overflow_deinit() noexcept
+{
+#ifdef ZTH_OS_LINUX
+	void* p = ZTH_TLS_GET(stack_overflow_altstack);
+	if(p) {
+		stack_t ss = {};
+		ss.ss_flags = SS_DISABLE;
+		sigaltstack(&ss, nullptr);
+		munmap(p, stack_overflow_altstack_size);
+		ZTH_TLS_SET(stack_overflow_altstack, nullptr);
+	}
+
+	ZTH_TLS_SET(stack_overflow_thread, false);
+#endif
+}
+
+} // namespace zth
+
+
+
 ////////////////////////////////////////////////////////////
 // context functions
 
@@ -29,6 +525,11 @@ namespace zth {
 int context_init() noexcept
 {
 	zth_dbg(context, "[%s] Initialize", currentWorker().id_str());
+
+	StackCache& cache = ZTH_TLS_GET(stack_cache);
+	cache.stats = StackCacheStats();
+	cache.enabled = Config::StackCacheHigh > 0;
+
 	return Context::init();
 }
 
@@ -40,6 +541,10 @@ int context_init() noexcept
 void context_deinit() noexcept
 {
 	zth_dbg(context, "[%s] Deinit", currentWorker().id_str());
+	shared_stack_deinit();
+	stack_cache_flush();
+	ZTH_TLS_GET(stack_cache).enabled = false;
+	stack_overflow_deinit();
 	Context::deinit();
 }
 
@@ -54,18 +559,23 @@ void context_deinit() noexcept
  */
 int context_create(Context*& context, ContextAttr const& attr) noexcept
 {
-	try {
-		context = new Context(attr);
-	} catch(std::bad_alloc const&) {
-		zth_dbg(context, "[%s] Cannot create context; %s", currentWorker().id_str(),
-			err(ENOMEM).c_str());
-		return ENOMEM;
-	} catch(...) {
-		// Should not be thrown by new...
-		return EAGAIN;
+	if((context = stack_cache_take(attr))) {
+		zth_dbg(context, "[%s] Reuse context %p", currentWorker().id_str(), context);
+		context->attr() = attr;
+	} else {
+		try {
+			context = new Context(attr);
+		} catch(std::bad_alloc const&) {
+			zth_dbg(context, "[%s] Cannot create context; %s", currentWorker().id_str(),
+				err(ENOMEM).c_str());
+			return ENOMEM;
+		} catch(...) {
+			// Should not be thrown by new...
+			return EAGAIN;
+		}
 	}
 
-	int res = context->create();
+	int res = attr.stackShared ? shared_stack_attach(context) : context->create();
 	if(res) {
 		delete context;
 		context = nullptr;
@@ -97,6 +607,13 @@ void context_destroy(Context* context) noexcept
 	if(!context)
 		return;
 
+	if(context->stackShared())
+		shared_stack_detach(context);
+	else if(stack_cache_put(context)) {
+		zth_dbg(context, "[%s] Cached context %p", currentWorker().id_str(), context);
+		return;
+	}
+
 	context->destroy();
 	delete context;
 	// NOLINTNEXTLINE(clang-analyzer-cplusplus.NewDelete)
@@ -115,7 +632,10 @@ void context_switch(Context* from, Context* to) noexcept
 	zth_assert(to);
 
 	// cppcheck-suppress nullPointerRedundantCheck
-	from->context_switch(*to);
+	if(unlikely(from->stackShared() || to->stackShared()))
+		shared_stack_switch(from, to);
+	else
+		from->context_switch(*to);
 
 	// Got back from somewhere else.
 	from->stackGuard();
@@ -123,11 +643,25 @@ void context_switch(Context* from, Context* to) noexcept
 
 /*!
  * \brief Return the high water mark of the stack of the given context.
- * \details This does not take any #zth::stack_switch() calls into account.
+ *
+ * For a stack with a reservation, the committed memory is returned instead.  For a
+ * context on the shared stack, it is the size of its frames when it was saved last.
+ * This does not take any #zth::stack_switch() calls into account.
  */
 size_t context_stack_usage(Context* context) noexcept
 {
-	if(!Config::EnableStackWaterMark || !context)
+	if(!context)
+		return 0;
+
+	if(context->stackShared())
+		return context->stackSaved();
+
+#ifdef ZTH_HAVE_MMAN
+	if(context->stackReserved())
+		return stack_resident(context->stackUsable());
+#endif
+
+	if(!Config::EnableStackWaterMark)
 		return 0;
 
 	Fiber* f = currentWorker().currentFiber();
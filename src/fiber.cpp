@@ -44,4 +44,12 @@ int Runnable::run()
 	return 0;
 }
 
+void Fiber::leaveGroup() noexcept
+{
+	Worker* w = Worker::instance();
+	zth_assert(w && w->currentFiber() == this);
+	// cppcheck-suppress nullPointerRedundantCheck
+	w->setFiberGroup(*this, nullptr);
+}
+
 } // namespace zth
@@ -13,10 +13,152 @@
 
 #if defined(ZTH_HAVE_POLLER) && !defined(ZTH_OS_WINDOWS)
 #  include <fcntl.h>
+#  include <sys/uio.h>
+
+#  if defined(ZTH_OS_LINUX) && defined(RWF_NOWAIT)
+// Do reads and writes without blocking, regardless of the fd's mode.
+#    define ZTH_IO_NOWAIT
+#  endif
 
 namespace zth {
 namespace io {
 
+/*!
+ * \brief Check if the given fd is in non-blocking mode.
+ * \return 1 when non-blocking, 0 when blocking, -1 on error with \c errno set
+ */
+static int nonblocking(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+	if(unlikely(flags == -1))
+		return -1; // with errno set
+
+	// NOLINTNEXTLINE(hicpp-signed-bitwise)
+	return (flags & O_NONBLOCK) ? 1 : 0;
+}
+
+#  ifdef ZTH_IO_NOWAIT
+/*!
+ * \brief Bitmap of fds for which \c RWF_NOWAIT is known to be unsupported.
+ *
+ * This is a property of the open file, so it is shared by all threads.  When an fd is closed
+ * and reused, a stale bit only costs performance, as the fd is polled first, as usual.
+ */
+static unsigned char nowait_unsupported[(Config::IoFdCacheSize + 7U) / 8U];
+
+static bool nowait(int fd) noexcept
+{
+	size_t i = (size_t)fd;
+	if(i >= Config::IoFdCacheSize)
+		return true;
+
+	return !(__atomic_load_n(&nowait_unsupported[i / 8U], __ATOMIC_RELAXED) & (1U << (i % 8U)));
+}
+
+static void nowait_unsupported_set(int fd) noexcept
+{
+	size_t i = (size_t)fd;
+	if(i < Config::IoFdCacheSize)
+		__atomic_fetch_or(
+			&nowait_unsupported[i / 8U], (unsigned char)(1U << (i % 8U)),
+			__ATOMIC_RELAXED);
+}
+#  endif // ZTH_IO_NOWAIT
+
+/*!
+ * \brief Try to read without blocking, regardless of the fd's mode.
+ * \return \c true when tried, which leaves the result in \p res
+ */
+static bool try_read(int fd, void* buf, size_t count, ssize_t& res)
+{
+#  ifdef ZTH_IO_NOWAIT
+	if(nowait(fd)) {
+		struct iovec iov = {buf, count};
+		res = preadv2(fd, &iov, 1, -1, RWF_NOWAIT);
+		if(res >= 0 || errno != EOPNOTSUPP)
+			return true;
+
+		nowait_unsupported_set(fd);
+	}
+#  else
+	(void)fd;
+	(void)buf;
+	(void)count;
+	(void)res;
+#  endif
+	return false;
+}
+
+/*!
+ * \brief Try to write without blocking, regardless of the fd's mode.
+ *
+ * Like a non-blocking \c write(), this may write only part of \p buf.
+ *
+ * \return \c true when tried, which leaves the result in \p res
+ */
+static bool try_write(int fd, void const* buf, size_t count, ssize_t& res)
+{
+#  ifdef ZTH_IO_NOWAIT
+	if(nowait(fd)) {
+		struct iovec iov = {const_cast<void*>(buf), count};
+		res = pwritev2(fd, &iov, 1, -1, RWF_NOWAIT);
+		if(res >= 0 || errno != EOPNOTSUPP)
+			return true;
+
+		nowait_unsupported_set(fd);
+	}
+#  else
+	(void)fd;
+	(void)buf;
+	(void)count;
+	(void)res;
+#  endif
+	return false;
+}
+
+/*!
+ * \brief Write the rest of \p buf to a blocking fd, after #try_write() wrote only \p done bytes.
+ *
+ * Instead of blocking the Worker on a large write, it waits for buffer space in between.
+ *
+ * \return the number of bytes written, which is less than \p count only on an error
+ */
+static ssize_t write_rest(int fd, void const* buf, size_t count, size_t done)
+{
+	char const* p = static_cast<char const*>(buf);
+
+	while(done < count) {
+		ssize_t res = 0;
+		if(!try_write(fd, p + done, count - done, res)) {
+			errno = zth::poll(PollableFd(fd, Pollable::PollOut), -1);
+			res = errno ? -1 : ::write(fd, p + done, count - done);
+		} else if(res < 0 && errno == EAGAIN) {
+			zth_dbg(io, "[%s] write(%d) wait for buffer space",
+				currentFiber().str().c_str(), fd);
+			errno = zth::poll(PollableFd(fd, Pollable::PollOut), -1);
+			if(!errno)
+				continue;
+		}
+
+		if(res <= 0)
+			break;
+
+		done += (size_t)res;
+	}
+
+	return (ssize_t)done;
+}
+
+#  ifdef ZTH_HAVE_IO_URING
+/*!
+ * \brief Return the io_uring of the current Worker, if it is used.
+ */
+static UringPoller* uring()
+{
+	return currentWorker().waiter().poller().uring();
+}
+#  endif
+
 /*!
  * \brief Like normal \c %read(), but forwards the \c %poll() to the #zth::Waiter in case it would
  * block. \ingroup zth_api_cpp_io
@@ -25,17 +167,33 @@ ssize_t read(int fd, void* buf, size_t count)
 {
 	perf_syscall("read()");
 
-	int flags = fcntl(fd, F_GETFL);
-	if(unlikely(flags == -1))
-		return -1; // with errno set
+	// Optimistically assume that there is data, which saves polling.
+	ssize_t res = 0;
+	bool tried = try_read(fd, buf, count, res);
+	if(tried && (res >= 0 || errno != EAGAIN))
+		return res;
 
-	// NOLINTNEXTLINE(hicpp-signed-bitwise)
-	if((flags & O_NONBLOCK)) {
+	switch(nonblocking(fd)) {
+	case -1:
+		return -1;
+	case 1:
 		zth_dbg(io, "[%s] read(%d) non-blocking", currentFiber().str().c_str(), fd);
+		if(tried) {
+			errno = EAGAIN;
+			return -1;
+		}
 		// Just do the call.
 		return ::read(fd, buf, count);
+	default:;
 	}
 
+#  ifdef ZTH_HAVE_IO_URING
+	if(UringPoller* u = uring()) {
+		zth_dbg(io, "[%s] read(%d) by io_uring", currentFiber().str().c_str(), fd);
+		return u->read(fd, buf, count);
+	}
+#  endif
+
 	errno = zth::poll(PollableFd(fd, Pollable::PollIn), -1);
 	if(errno)
 		return -1;
@@ -47,22 +205,45 @@ ssize_t read(int fd, void* buf, size_t count)
 
 /*!
  * \brief Like normal \c %write(), but forwards the \c %poll() to the #zth::Waiter in case it would
- * block. \ingroup zth_api_cpp_io
+ * block.
+ *
+ * Like a blocking \c %write(), all data is written to a blocking fd, unless an error occurs.
+ *
+ * \ingroup zth_api_cpp_io
  */
 ssize_t write(int fd, void const* buf, size_t count)
 {
 	perf_syscall("write()");
 
-	int flags = fcntl(fd, F_GETFL);
-	if(unlikely(flags == -1))
-		return -1; // with errno set
+	// Optimistically assume that there is buffer space, which saves polling.
+	ssize_t res = 0;
+	bool tried = try_write(fd, buf, count, res);
+	if(tried && res > 0 && (size_t)res < count && nonblocking(fd) == 0)
+		// A blocking write() would have written it all.
+		return write_rest(fd, buf, count, (size_t)res);
+	if(tried && (res >= 0 || errno != EAGAIN))
+		return res;
 
-	// NOLINTNEXTLINE(hicpp-signed-bitwise)
-	if((flags & O_NONBLOCK)) {
+	switch(nonblocking(fd)) {
+	case -1:
+		return -1;
+	case 1:
 		zth_dbg(io, "[%s] write(%d) non-blocking", currentFiber().str().c_str(), fd);
+		if(tried) {
+			errno = EAGAIN;
+			return -1;
+		}
 		// Just do the call.
 		return ::write(fd, buf, count);
+	default:;
+	}
+
+#  ifdef ZTH_HAVE_IO_URING
+	if(UringPoller* u = uring()) {
+		zth_dbg(io, "[%s] write(%d) by io_uring", currentFiber().str().c_str(), fd);
+		return u->write(fd, buf, count);
 	}
+#  endif
 
 	errno = zth::poll(PollableFd(fd, Pollable::PollOut), -1);
 	if(errno)
@@ -73,6 +254,126 @@ ssize_t write(int fd, void const* buf, size_t count)
 	return ::write(fd, buf, count);
 }
 
+/*!
+ * \brief Like normal \c %accept(), but forwards the \c %poll() to the #zth::Waiter in case it
+ * would block. \ingroup zth_api_cpp_io
+ */
+int accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen)
+{
+	perf_syscall("accept()");
+
+	switch(nonblocking(sockfd)) {
+	case -1:
+		return -1;
+	case 1:
+		return ::accept(sockfd, addr, addrlen);
+	default:;
+	}
+
+#  ifdef ZTH_HAVE_IO_URING
+	if(UringPoller* u = uring()) {
+		zth_dbg(io, "[%s] accept(%d) by io_uring", currentFiber().str().c_str(), sockfd);
+		return u->accept(sockfd, addr, addrlen);
+	}
+#  endif
+
+	errno = zth::poll(PollableFd(sockfd, Pollable::PollIn), -1);
+	if(errno)
+		return -1;
+
+	zth_dbg(io, "[%s] accept(%d)", currentFiber().str().c_str(), sockfd);
+	return ::accept(sockfd, addr, addrlen);
+}
+
+/*!
+ * \brief Like normal \c %recv(), but forwards the \c %poll() to the #zth::Waiter in case it would
+ * block. \ingroup zth_api_cpp_io
+ */
+ssize_t recv(int sockfd, void* buf, size_t len, int flags)
+{
+	perf_syscall("recv()");
+
+	bool tried = false;
+
+	// NOLINTNEXTLINE(hicpp-signed-bitwise)
+	if(!(flags & MSG_WAITALL)) {
+		// Optimistically assume that there is data, which saves polling.  MSG_WAITALL
+		// would return partial data when combined with MSG_DONTWAIT, so skip that.
+		// NOLINTNEXTLINE(hicpp-signed-bitwise)
+		ssize_t res = ::recv(sockfd, buf, len, flags | MSG_DONTWAIT);
+		// NOLINTNEXTLINE(hicpp-signed-bitwise)
+		if(res >= 0 || errno != EAGAIN || (flags & MSG_DONTWAIT))
+			return res;
+
+		tried = true;
+	}
+
+	switch(nonblocking(sockfd)) {
+	case -1:
+		return -1;
+	case 1:
+		if(tried) {
+			errno = EAGAIN;
+			return -1;
+		}
+		return ::recv(sockfd, buf, len, flags);
+	default:;
+	}
+
+#  ifdef ZTH_HAVE_IO_URING
+	if(UringPoller* u = uring()) {
+		zth_dbg(io, "[%s] recv(%d) by io_uring", currentFiber().str().c_str(), sockfd);
+		return u->recv(sockfd, buf, len, flags);
+	}
+#  endif
+
+	errno = zth::poll(PollableFd(sockfd, Pollable::PollIn), -1);
+	if(errno)
+		return -1;
+
+	zth_dbg(io, "[%s] recv(%d)", currentFiber().str().c_str(), sockfd);
+	return ::recv(sockfd, buf, len, flags);
+}
+
+/*!
+ * \brief Like normal \c %send(), but forwards the \c %poll() to the #zth::Waiter in case it would
+ * block. \ingroup zth_api_cpp_io
+ */
+ssize_t send(int sockfd, void const* buf, size_t len, int flags)
+{
+	perf_syscall("send()");
+
+	// Optimistically assume that there is buffer space, which saves polling.
+	// NOLINTNEXTLINE(hicpp-signed-bitwise)
+	ssize_t res = ::send(sockfd, buf, len, flags | MSG_DONTWAIT);
+	// NOLINTNEXTLINE(hicpp-signed-bitwise)
+	if(res >= 0 || errno != EAGAIN || (flags & MSG_DONTWAIT))
+		return res;
+
+	switch(nonblocking(sockfd)) {
+	case -1:
+		return -1;
+	case 1:
+		errno = EAGAIN;
+		return -1;
+	default:;
+	}
+
+#  ifdef ZTH_HAVE_IO_URING
+	if(UringPoller* u = uring()) {
+		zth_dbg(io, "[%s] send(%d) by io_uring", currentFiber().str().c_str(), sockfd);
+		return u->send(sockfd, buf, len, flags);
+	}
+#  endif
+
+	errno = zth::poll(PollableFd(sockfd, Pollable::PollOut), -1);
+	if(errno)
+		return -1;
+
+	zth_dbg(io, "[%s] send(%d)", currentFiber().str().c_str(), sockfd);
+	return ::send(sockfd, buf, len, flags);
+}
+
 } // namespace io
 } // namespace zth
 #else
@@ -6,6 +6,16 @@
 
 #include <libzth/poller.h>
 
+#ifdef ZTH_HAVE_EPOLL
+#  include <unistd.h>
+
+#  ifdef __GLIBC_PREREQ
+#    if __GLIBC_PREREQ(2, 35)
+#      define ZTH_HAVE_EPOLL_PWAIT2
+#    endif
+#  endif
+#endif
+
 namespace zth {
 
 
@@ -147,7 +157,27 @@ int PollPoller::init(Pollable const& p, struct pollfd& item) noexcept
 
 int PollPoller::doPoll(int timeout_ms, base::PollItemList& items) noexcept
 {
-	int res = ::poll(items.data(), items.size(), timeout_ms);
+	return dispatch(::poll(items.data(), items.size(), timeout_ms), items);
+}
+
+#    ifdef ZTH_OS_LINUX
+int PollPoller::doPoll(TimeInterval const& timeout, base::PollItemList& items) noexcept
+{
+	struct timespec ts = {};
+	if(!timeout.hasPassed())
+		ts = timeout.ts();
+
+	return dispatch(
+		::ppoll(items.data(), items.size(), timeout.isInfinite() ? nullptr : &ts, nullptr),
+		items);
+}
+#    endif
+
+/*!
+ * \brief Forward the result of \c poll() to the clients.
+ */
+int PollPoller::dispatch(int res, base::PollItemList& items) noexcept
+{
 	if(res < 0)
 		return errno;
 	if(res == 0)
@@ -206,6 +236,397 @@ int NoPoller::doPoll(int UNUSED_PAR(timeout_ms), base::PollItemList& UNUSED_PAR(
 
 
 
+#ifdef ZTH_HAVE_EPOLL
+//////////////////////////////////////////////
+// EpollPoller
+//
+
+EpollPoller::EpollPoller(Trigger trigger)
+	: m_epfd(epoll_create1(EPOLL_CLOEXEC))
+	, m_trigger(trigger)
+	, m_count()
+{
+	setName("zth::EpollPoller");
+
+	if(m_epfd < 0)
+		zth_dbg(io, "[%s] cannot create epoll descriptor; %s", id_str(),
+			err(errno).c_str());
+}
+
+EpollPoller::~EpollPoller() noexcept
+{
+	clear();
+
+	if(m_epfd >= 0)
+		close(m_epfd);
+}
+
+int EpollPoller::migrateTo(PollerServerBase& p) noexcept
+{
+	small_vector<Registration> all;
+
+	try {
+		all.reserve(m_count);
+		p.reserve(m_count);
+	} catch(...) {
+		return ENOMEM;
+	}
+
+	for(size_t i = 0; i < m_fds.size(); i++) {
+		Entry const* e = m_fds[i];
+		if(!e)
+			continue;
+
+		for(size_t j = 0; j < e->registrations.size(); j++)
+			all.push_back(e->registrations[j]);
+	}
+
+	for(size_t i = 0; i < all.size(); i++) {
+		int res = p.add(*all[i].pollable, all[i].client);
+		if(res) {
+			// Rollback
+			for(size_t j = i; j > 0; j--)
+				p.remove(*all[j - 1U].pollable, all[j - 1U].client);
+
+			return res;
+		}
+	}
+
+	clear();
+
+	// Really release all memory. This object is probably not used anymore.
+	vector_type<Entry*>::type().swap(m_fds);
+	vector_type<struct epoll_event>::type().swap(m_events);
+	return 0;
+}
+
+void EpollPoller::reserve(size_t UNUSED_PAR(more))
+{
+	// Entries are allocated per file descriptor when added.
+}
+
+int EpollPoller::add(Pollable& p, Client* client) noexcept
+{
+	if(m_epfd < 0)
+		return EBADF;
+
+	// Zth only has PollableFds, so casting is safe.
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-static-cast-downcast)
+	PollableFd const& pfd = static_cast<PollableFd const&>(p);
+
+#  ifdef ZTH_HAVE_LIBZMQ
+	if(pfd.socket)
+		return ENOTSUP;
+#  endif
+
+	if(pfd.fd < 0)
+		return EBADF;
+
+	size_t fd = (size_t)pfd.fd;
+	Entry* e = nullptr;
+
+	try {
+		if(fd >= m_fds.size())
+			m_fds.resize(fd + 1U);
+
+		e = m_fds[fd];
+		if(!e) {
+			e = new Entry();
+			e->fd = pfd.fd;
+			e->events = 0;
+			e->registered = false;
+			e->alwaysReady = false;
+			m_fds[fd] = e;
+		}
+
+		Registration r = {&p, client};
+		e->registrations.push_back(r);
+
+		// Make sure a dispatch does not need to allocate.
+		if(m_events.size() < std::min<size_t>(m_count + 1U, 256U))
+			m_events.resize(std::min<size_t>(m_count * 2U + 1U, 256U));
+	} catch(...) {
+		if(e && e->registrations.empty()) {
+			m_fds[fd] = nullptr;
+			delete e;
+		}
+		return ENOMEM;
+	}
+
+	int res = update(*e);
+	if(res) {
+		// Rollback.
+		e->registrations.pop_back();
+		update(*e);
+		return res;
+	}
+
+	p.revents.reset();
+	m_count++;
+
+	if(client)
+		zth_dbg(io, "[%s] added pollable %p for fd %d for client %s", id_str(), &p,
+			pfd.fd, client->id_str());
+	else
+		zth_dbg(io, "[%s] added pollable %p for fd %d", id_str(), &p, pfd.fd);
+
+	currentWorker().waiter().wakeup();
+	return 0;
+}
+
+int EpollPoller::add(Pollable& p) noexcept
+{
+	return add(p, nullptr);
+}
+
+// cppcheck-suppress[constParameter,constParameterPointer]
+int EpollPoller::remove(Pollable& p, Client* client) noexcept
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-static-cast-downcast)
+	PollableFd const& pfd = static_cast<PollableFd const&>(p);
+
+	if(pfd.fd < 0 || (size_t)pfd.fd >= m_fds.size())
+		return ESRCH;
+
+	Entry* e = m_fds[(size_t)pfd.fd];
+	if(!e)
+		return ESRCH;
+
+	small_vector<Registration, 1>& rs = e->registrations;
+
+	size_t i;
+	for(i = rs.size(); i > 0; i--)
+		if(rs[i - 1U].pollable == &p && rs[i - 1U].client == client)
+			break;
+
+	if(i == 0U)
+		return ESRCH;
+
+	rs[i - 1U] = rs.back();
+	rs.pop_back();
+	m_count--;
+
+	// Unregistering or lowering the event mask cannot fail in a way we can handle.
+	update(*e);
+
+	zth_dbg(io, "[%s] removed pollable %p", id_str(), &p);
+	return 0;
+}
+
+int EpollPoller::remove(Pollable& p) noexcept
+{
+	return remove(p, nullptr);
+}
+
+/*!
+ * \brief Remove all Pollables.
+ */
+void EpollPoller::clear() noexcept
+{
+	for(size_t i = 0; i < m_fds.size(); i++) {
+		Entry* e = m_fds[i];
+		if(!e)
+			continue;
+
+		e->registrations.clear();
+		update(*e);
+	}
+
+	zth_assert(m_alwaysReady.empty());
+	m_count = 0;
+}
+
+bool EpollPoller::empty() const noexcept
+{
+	return m_count == 0;
+}
+
+/*!
+ * \brief Return the number of registered Pollables.
+ */
+size_t EpollPoller::size() const noexcept
+{
+	return m_count;
+}
+
+/*!
+ * \brief Synchronize the kernel's registration with the Entry's Registrations.
+ *
+ * When the Entry does not have Registrations anymore, it is deleted.
+ *
+ * \return 0 on success, otherwise an errno
+ */
+int EpollPoller::update(Entry& e) noexcept
+{
+	if(e.registrations.empty()) {
+		if(e.registered) {
+			struct epoll_event ev = {};
+			epoll_ctl(m_epfd, EPOLL_CTL_DEL, e.fd, &ev);
+		}
+
+		if(e.alwaysReady) {
+			for(size_t i = 0; i < m_alwaysReady.size(); i++)
+				if(m_alwaysReady[i] == &e) {
+					m_alwaysReady[i] = m_alwaysReady.back();
+					m_alwaysReady.pop_back();
+					break;
+				}
+		}
+
+		m_fds[(size_t)e.fd] = nullptr;
+		delete &e;
+		return 0;
+	}
+
+	if(e.alwaysReady)
+		return 0;
+
+	uint32_t events = m_trigger == EdgeTriggered ? (uint32_t)EPOLLET : 0U;
+	for(size_t i = 0; i < e.registrations.size(); i++) {
+		Pollable::Events const& pe = e.registrations[i].pollable->events;
+		if(pe.test(Pollable::PollInIndex))
+			events |= EPOLLIN;
+		if(pe.test(Pollable::PollOutIndex))
+			events |= EPOLLOUT;
+		if(pe.test(Pollable::PollPriIndex))
+			events |= EPOLLPRI;
+	}
+
+	if(e.registered && events == e.events)
+		return 0;
+
+	struct epoll_event ev = {};
+	ev.events = events;
+	ev.data.ptr = &e;
+
+	int op = e.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	int res = epoll_ctl(m_epfd, op, e.fd, &ev);
+
+	if(res && errno == ENOENT && op == EPOLL_CTL_MOD) {
+		// The fd was closed and reused, which dropped the old registration.
+		op = EPOLL_CTL_ADD;
+		res = epoll_ctl(m_epfd, op, e.fd, &ev);
+	}
+
+	if(res && errno == EPERM && op == EPOLL_CTL_ADD) {
+		// Regular files and such are not supported by epoll, but poll() says they
+		// are always ready.
+		try {
+			m_alwaysReady.push_back(&e);
+		} catch(...) {
+			return ENOMEM;
+		}
+
+		e.alwaysReady = true;
+		return 0;
+	}
+
+	if(res)
+		return errno;
+
+	e.registered = true;
+	e.events = events;
+	return 0;
+}
+
+/*!
+ * \brief Forward the events of an Entry to all its Registrations.
+ */
+void EpollPoller::dispatch(Entry& e, uint32_t events) noexcept
+{
+	Pollable::Events revents = 0;
+
+	if(events & EPOLLIN)
+		revents |= Pollable::PollIn;
+	if(events & EPOLLOUT)
+		revents |= Pollable::PollOut;
+	if(events & EPOLLERR)
+		revents |= Pollable::PollErr;
+	if(events & EPOLLPRI)
+		revents |= Pollable::PollPri;
+	if(events & EPOLLHUP)
+		revents |= Pollable::PollHup;
+
+	Pollable::Events const always = Pollable::PollErr | Pollable::PollHup;
+
+	for(size_t i = 0; i < e.registrations.size(); i++) {
+		Registration const& r = e.registrations[i];
+		Pollable::Events re = revents & (r.pollable->events | always);
+		r.pollable->revents = re;
+
+		if(re.any()) {
+			countEvent();
+			zth_dbg(io, "[%s] pollable %p got event 0x%lx", id_str(), r.pollable,
+				re.to_ulong());
+			if(r.client)
+				r.client->event(*r.pollable);
+		}
+	}
+}
+
+int EpollPoller::poll(int timeout_ms) noexcept
+{
+	return poll(timeoutInterval(timeout_ms));
+}
+
+#  ifdef ZTH_HAVE_EPOLL_PWAIT2
+// epoll_pwait2() was added in Linux 5.11, which may be newer than the kernel we run on.
+static bool epoll_pwait2_unsupported = false;
+#  endif
+
+int EpollPoller::poll(TimeInterval const& timeout) noexcept
+{
+	if(empty())
+		return EINVAL;
+
+	zth_dbg(io, "[%s] polling %u items for %s", id_str(), (unsigned)m_count,
+		timeout.str().c_str());
+
+	zth_assert(!m_events.empty());
+	int res = -1;
+
+#  ifdef ZTH_HAVE_EPOLL_PWAIT2
+	if(likely(!__atomic_load_n(&epoll_pwait2_unsupported, __ATOMIC_RELAXED))) {
+		struct timespec ts = {};
+		if(!timeout.hasPassed() && m_alwaysReady.empty())
+			ts = timeout.ts();
+
+		res = epoll_pwait2(
+			m_epfd, m_events.data(), (int)m_events.size(),
+			timeout.isInfinite() && m_alwaysReady.empty() ? nullptr : &ts, nullptr);
+
+		if(res < 0) {
+			if(errno != ENOSYS)
+				return errno;
+
+			__atomic_store_n(&epoll_pwait2_unsupported, true, __ATOMIC_RELAXED);
+		}
+	}
+#  endif
+
+	if(res < 0) {
+		// Fall back to millisecond precision.
+		res = epoll_wait(
+			m_epfd, m_events.data(), (int)m_events.size(),
+			m_alwaysReady.empty() ? timeoutMs(timeout) : 0);
+		if(res < 0)
+			return errno;
+	}
+
+	for(size_t i = 0; i < (size_t)res; i++) {
+		struct epoll_event const& ev = m_events[i];
+		dispatch(*static_cast<Entry*>(ev.data.ptr), ev.events);
+	}
+
+	for(size_t i = 0; i < m_alwaysReady.size(); i++)
+		dispatch(*m_alwaysReady[i], EPOLLIN | EPOLLOUT);
+
+	return 0;
+}
+#endif // ZTH_HAVE_EPOLL
+
+
+
 //////////////////////////////////////////////
 // PollerClient
 //
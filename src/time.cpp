@@ -15,6 +15,12 @@
 #  include <mach/mach_time.h>
 #endif
 
+#if defined(__x86_64__) && !defined(ZTH_OS_BAREMETAL)
+#  define ZTH_HAVE_TSC
+#  include <cpuid.h>
+#  include <x86intrin.h>
+#endif
+
 #ifdef ZTH_OS_MAC
 
 #  ifdef ZTH_CUSTOM_CLOCK_GETTIME
@@ -180,6 +186,166 @@ __attribute__((weak)) int clock_nanosleep(
 }
 #endif
 
+namespace zth {
+
+#ifdef ZTH_HAVE_TSC
+/*!
+ * \brief Nanoseconds per TSC tick, as 32.32 fixed-point value.
+ *
+ * It is 0 when the TSC is not calibrated yet, and 1 when it cannot be used.
+ */
+static uint64_t clock_tsc_mult;
+
+/*! \brief Interval in ns between synchronizations of the TSC with \c CLOCK_MONOTONIC. */
+static uint64_t const clock_tsc_sync_interval = 10000000;
+
+/*! \brief Per-thread state of #zth::clock_tsc(). */
+struct ClockTsc {
+	/*! \brief Nanoseconds per tick, as 32.32 fixed-point value. */
+	uint64_t mult;
+	/*! \brief Number of ticks till the next synchronization. */
+	uint64_t interval;
+	/*! \brief TSC at the first synchronization. */
+	uint64_t tsc0;
+	/*! \brief \c CLOCK_MONOTONIC in ns at the first synchronization. */
+	uint64_t ns0;
+	/*! \brief TSC at the last synchronization. */
+	uint64_t tsc;
+	/*! \brief \c CLOCK_MONOTONIC in ns at the last synchronization. */
+	uint64_t ns;
+	/*! \brief Last returned time, as time must never go back. */
+	uint64_t last;
+};
+
+ZTH_TLS_STATIC(ClockTsc, clock_tsc_state, {})
+
+/*!
+ * \brief Read the TSC and \c CLOCK_MONOTONIC at (about) the same time.
+ */
+static int clock_tsc_sync(uint64_t& tsc, uint64_t& ns) noexcept
+{
+	struct timespec ts = {};
+	uint64_t before = __rdtsc();
+	int res = clock_gettime(CLOCK_MONOTONIC, &ts);
+	uint64_t after = __rdtsc();
+
+	if(unlikely(res))
+		return res;
+
+	tsc = before + (after - before) / 2U;
+	ns = (uint64_t)ts.tv_sec * (uint64_t)TimeInterval::BILLION + (uint64_t)ts.tv_nsec;
+	return 0;
+}
+
+/*!
+ * \brief Determine the rate of the TSC.
+ * \return the value for #clock_tsc_mult
+ */
+static uint64_t clock_tsc_calibrate() noexcept
+{
+	unsigned int eax = 0;
+	unsigned int ebx = 0;
+	unsigned int ecx = 0;
+	unsigned int edx = 0;
+
+	// Only an invariant TSC runs at a constant rate, regardless of frequency scaling and
+	// sleep states.
+	if(!__get_cpuid(0x80000007U, &eax, &ebx, &ecx, &edx) || !(edx & (1U << 8U)))
+		return 1;
+
+	uint64_t tsc0 = 0;
+	uint64_t ns0 = 0;
+	uint64_t tsc1 = 0;
+	uint64_t ns1 = 0;
+
+	if(clock_tsc_sync(tsc0, ns0))
+		return 1;
+
+	// This is only a first estimate. Every thread refines it while running.
+	struct timespec const calibrate = {0, 1000000};
+	nanosleep(&calibrate, nullptr);
+
+	if(clock_tsc_sync(tsc1, ns1) || tsc1 <= tsc0 || ns1 - ns0 < 100000U)
+		return 1;
+
+	uint64_t mult = ((ns1 - ns0) << 32U) / (tsc1 - tsc0);
+	return mult > 1 ? mult : 1;
+}
+#endif // ZTH_HAVE_TSC
+
+int clock_tsc(struct timespec* ts) noexcept
+{
+#ifdef ZTH_HAVE_TSC
+	uint64_t mult = __atomic_load_n(&clock_tsc_mult, __ATOMIC_RELAXED);
+	if(unlikely(mult <= 1)) {
+		if(!mult) {
+			mult = clock_tsc_calibrate();
+			__atomic_store_n(&clock_tsc_mult, mult, __ATOMIC_RELAXED);
+		}
+
+		if(mult == 1)
+			return clock_gettime(CLOCK_MONOTONIC, ts);
+	}
+
+	ClockTsc& s = ZTH_TLS_GET(clock_tsc_state);
+	uint64_t tsc = __rdtsc();
+	uint64_t ns = 0;
+
+	if(likely(tsc - s.tsc < s.interval)) {
+		ns = s.ns + (((tsc - s.tsc) * s.mult) >> 32U);
+	} else {
+		// Time to synchronize with CLOCK_MONOTONIC again. This also happens when the TSC
+		// of another CPU is slightly behind after migration.
+		int res = clock_tsc_sync(tsc, ns);
+		if(unlikely(res))
+			return res;
+
+		if(!s.interval) {
+			s.mult = mult;
+			s.tsc0 = tsc;
+			s.ns0 = ns;
+		} else if(tsc > s.tsc0 && ns > s.ns0) {
+			// Refine the rate, based on the (growing) time since the first
+			// synchronization.
+			s.mult = (uint64_t)(((unsigned __int128)(ns - s.ns0) << 32U)
+					    / (tsc - s.tsc0));
+			if(unlikely(!s.mult))
+				s.mult = mult;
+		}
+
+		s.tsc = tsc;
+		s.ns = ns;
+		s.interval = std::max<uint64_t>((clock_tsc_sync_interval << 32U) / s.mult, 1);
+	}
+
+	if(unlikely(ns < s.last))
+		ns = s.last;
+	else
+		s.last = ns;
+
+	ts->tv_sec = (time_t)(ns / (uint64_t)TimeInterval::BILLION);
+	ts->tv_nsec = (long)(ns % (uint64_t)TimeInterval::BILLION);
+	return 0;
+#else  // !ZTH_HAVE_TSC
+	return clock_gettime(CLOCK_MONOTONIC, ts);
+#endif // !ZTH_HAVE_TSC
+}
+
+TimeInterval Timestamp::resolution(Config::ClockSource source) noexcept
+{
+#ifdef CLOCK_MONOTONIC_COARSE
+	struct timespec res = {};
+	if(source == Config::ClockCoarse && !clock_getres(CLOCK_MONOTONIC_COARSE, &res))
+		return TimeInterval(res);
+#else
+	(void)source;
+#endif
+
+	return TimeInterval(0, 1);
+}
+
+} // namespace zth
+
 #ifdef ZTH_OS_MAC
 namespace zth {
 zth::Timestamp startTime;
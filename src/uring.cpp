@@ -0,0 +1,683 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2026 Jochem Rutgers
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <libzth/poller.h>
+
+#ifdef ZTH_HAVE_IO_URING
+#  include <libzth/worker.h>
+
+#  include <csignal>
+#  include <cstring>
+#  include <linux/io_uring.h>
+#  include <poll.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+
+namespace zth {
+
+//////////////////////////////////////////////
+// UringPoller
+//
+
+/*!
+ * \brief Something that was submitted to the kernel.
+ *
+ * The \c user_data of the SQE points to it.
+ */
+struct UringPoller::Request {
+	enum Kind { Poll, Io };
+
+	explicit Request(Kind k) noexcept
+		: kind(k)
+	{}
+
+	Kind kind;
+};
+
+/*!
+ * \brief A poll of a registered Pollable.
+ */
+struct UringPoller::PollRequest : public Request, public Listable {
+	ZTH_CLASS_NEW_DELETE(PollRequest)
+public:
+	PollRequest(Pollable& p, Client* c) noexcept
+		: Request(Poll)
+		, pollable(&p)
+		, client(c)
+		, armed()
+	{}
+
+	Pollable* pollable;
+	Client* client;
+	/*! \brief Set while the kernel has the poll. */
+	bool armed;
+};
+
+/*!
+ * \brief An I/O operation of a fiber, which lives on the fiber's stack.
+ */
+struct UringPoller::IoRequest : public Request {
+	IoRequest() noexcept
+		: Request(Io)
+		, fiber()
+		, res()
+		, done()
+	{}
+
+	Fiber* fiber;
+	int res;
+	bool done;
+};
+
+static int io_uring_setup(unsigned int entries, struct io_uring_params* p) noexcept
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(
+	int fd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags, void* arg,
+	size_t argSize) noexcept
+{
+	return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize);
+}
+
+/*!
+ * \brief Ctor.
+ *
+ * Check #valid() to see if io_uring could be set up.
+ */
+UringPoller::UringPoller(unsigned int entries)
+	: m_fd(-1)
+	, m_ring(MAP_FAILED)
+	, m_ringSize()
+	, m_sqes(static_cast<struct io_uring_sqe*>(MAP_FAILED))
+	, m_sqesSize()
+	, m_sqHead()
+	, m_sqTail()
+	, m_sqMask()
+	, m_sqEntries()
+	, m_sqLocalTail()
+	, m_cqHead()
+	, m_cqTail()
+	, m_cqMask()
+	, m_cqes()
+	, m_io()
+{
+	setName("zth::UringPoller");
+
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+
+	m_fd = io_uring_setup(entries, &p);
+	if(m_fd < 0) {
+		zth_dbg(io, "[%s] io_uring not available; %s", id_str(), err(errno).c_str());
+		return;
+	}
+
+	// Require a kernel that does not drop completions, and supports timeouts while waiting
+	// (5.11+). All used operations exist by then.
+	unsigned int const features = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP
+				      | IORING_FEAT_RW_CUR_POS | IORING_FEAT_EXT_ARG;
+	if((p.features & features) != features) {
+		zth_dbg(io, "[%s] io_uring lacks features", id_str());
+		goto error;
+	}
+
+	m_ringSize = std::max<size_t>(
+		p.sq_off.array + p.sq_entries * sizeof(unsigned int),
+		p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe));
+	m_ring = mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+		      IORING_OFF_SQ_RING);
+	if(m_ring == MAP_FAILED)
+		goto error;
+
+	m_sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+	m_sqes = static_cast<struct io_uring_sqe*>(mmap(
+		nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+		IORING_OFF_SQES));
+	if(m_sqes == MAP_FAILED)
+		goto error;
+
+	{
+		char* ring = static_cast<char*>(m_ring);
+		m_sqHead = reinterpret_cast<unsigned int*>(ring + p.sq_off.head);
+		m_sqTail = reinterpret_cast<unsigned int*>(ring + p.sq_off.tail);
+		m_sqMask = *reinterpret_cast<unsigned int*>(ring + p.sq_off.ring_mask);
+		m_sqEntries = p.sq_entries;
+		m_sqLocalTail = *m_sqTail;
+		m_cqHead = reinterpret_cast<unsigned int*>(ring + p.cq_off.head);
+		m_cqTail = reinterpret_cast<unsigned int*>(ring + p.cq_off.tail);
+		m_cqMask = *reinterpret_cast<unsigned int*>(ring + p.cq_off.ring_mask);
+		m_cqes = reinterpret_cast<struct io_uring_cqe*>(ring + p.cq_off.cqes);
+
+		// SQEs are always used in order, so the indirection array is fixed.
+		unsigned int* array = reinterpret_cast<unsigned int*>(ring + p.sq_off.array);
+		for(unsigned int i = 0; i < m_sqEntries; i++)
+			array[i] = i;
+	}
+
+	zth_dbg(io, "[%s] created io_uring %d with %u entries", id_str(), m_fd, m_sqEntries);
+	return;
+
+error:
+	if(m_sqes != MAP_FAILED)
+		munmap(m_sqes, m_sqesSize);
+	if(m_ring != MAP_FAILED)
+		munmap(m_ring, m_ringSize);
+
+	m_sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+	m_ring = MAP_FAILED;
+	close(m_fd);
+	m_fd = -1;
+}
+
+UringPoller::~UringPoller() noexcept
+{
+	zth_assert(m_io == 0);
+
+	clear();
+
+	if(valid()) {
+		munmap(m_sqes, m_sqesSize);
+		munmap(m_ring, m_ringSize);
+		// This cancels all pending polls.
+		close(m_fd);
+	}
+
+	while(!m_cancelled.empty()) {
+		PollRequest& r = m_cancelled.front();
+		m_cancelled.pop_front();
+		delete &r;
+	}
+}
+
+/*!
+ * \brief Checks if the io_uring is usable.
+ */
+bool UringPoller::valid() const noexcept
+{
+	return m_fd >= 0;
+}
+
+int UringPoller::migrateTo(PollerServerBase& p) noexcept
+{
+	if(m_io)
+		// Cannot move I/O in progress.
+		return EBUSY;
+
+	try {
+		p.reserve(m_polls.size());
+	} catch(...) {
+		return ENOMEM;
+	}
+
+	for(size_t i = 0; i < m_polls.size(); i++) {
+		PollRequest const& r = *m_polls[i];
+
+		int res = p.add(*r.pollable, r.client);
+		if(res) {
+			// Rollback
+			for(size_t j = i; j > 0; j--)
+				p.remove(*m_polls[j - 1U]->pollable, m_polls[j - 1U]->client);
+
+			return res;
+		}
+	}
+
+	clear();
+	return 0;
+}
+
+void UringPoller::reserve(size_t more)
+{
+	m_polls.reserve(m_polls.size() + more);
+}
+
+int UringPoller::add(Pollable& p, Client* client) noexcept
+{
+	if(!valid())
+		return EBADF;
+
+#  ifdef ZTH_HAVE_LIBZMQ
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-static-cast-downcast)
+	if(static_cast<PollableFd const&>(p).socket)
+		return ENOTSUP;
+#  endif
+
+	PollRequest* r = nullptr;
+
+	try {
+		r = new PollRequest(p, client);
+		m_polls.push_back(r);
+	} catch(...) {
+		delete r;
+		return ENOMEM;
+	}
+
+	p.revents.reset();
+	arm(*r);
+
+	if(client)
+		zth_dbg(io, "[%s] added pollable %p for client %s", id_str(), &p,
+			client->id_str());
+	else
+		zth_dbg(io, "[%s] added pollable %p", id_str(), &p);
+
+	currentWorker().waiter().wakeup();
+	return 0;
+}
+
+int UringPoller::add(Pollable& p) noexcept
+{
+	return add(p, nullptr);
+}
+
+// cppcheck-suppress[constParameter,constParameterPointer]
+int UringPoller::remove(Pollable& p, Client* client) noexcept
+{
+	// Pollables are usually removed in reverse order, so start at the end.
+	for(size_t i = m_polls.size(); i > 0; i--) {
+		PollRequest* r = m_polls[i - 1U];
+		if(r->pollable != &p || r->client != client)
+			continue;
+
+		m_polls[i - 1U] = m_polls.back();
+		m_polls.pop_back();
+		cancel(*r);
+
+		zth_dbg(io, "[%s] removed pollable %p", id_str(), &p);
+		return 0;
+	}
+
+	return ESRCH;
+}
+
+int UringPoller::remove(Pollable& p) noexcept
+{
+	return remove(p, nullptr);
+}
+
+/*!
+ * \brief Remove all Pollables.
+ */
+void UringPoller::clear() noexcept
+{
+	while(!m_polls.empty()) {
+		PollRequest* r = m_polls.back();
+		m_polls.pop_back();
+		cancel(*r);
+	}
+}
+
+bool UringPoller::empty() const noexcept
+{
+	return m_polls.empty() && m_io == 0;
+}
+
+/*!
+ * \brief Return the number of registered Pollables.
+ */
+size_t UringPoller::size() const noexcept
+{
+	return m_polls.size();
+}
+
+/*!
+ * \brief Get a fresh SQE.
+ *
+ * When the submission queue is full, it is submitted first.
+ *
+ * \return the SQE, or \c nullptr when the kernel does not accept more submissions
+ */
+struct io_uring_sqe* UringPoller::sqe() noexcept
+{
+	zth_assert(valid());
+
+	if(m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) {
+		if(enter(0, TimeInterval())
+		   && m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+			return nullptr;
+	}
+
+	struct io_uring_sqe* s = &m_sqes[m_sqLocalTail & m_sqMask];
+	memset(s, 0, sizeof(*s));
+	m_sqLocalTail++;
+	return s;
+}
+
+/*!
+ * \brief Submit all queued SQEs, and wait for completions.
+ * \param minComplete the number of completions to wait for
+ * \param timeout the maximum time to wait, which may be infinite
+ * \return 0 on success, otherwise an errno
+ */
+int UringPoller::enter(unsigned int minComplete, TimeInterval const& timeout) noexcept
+{
+	__atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+	unsigned int toSubmit = m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+
+	if(toSubmit == 0 && minComplete == 0)
+		return 0;
+
+	unsigned int flags = IORING_ENTER_EXT_ARG;
+	if(minComplete)
+		flags |= IORING_ENTER_GETEVENTS;
+
+	struct __kernel_timespec ts = {};
+	struct io_uring_getevents_arg arg = {};
+	arg.sigmask_sz = _NSIG / 8;
+
+	if(minComplete && !timeout.isInfinite()) {
+		if(!timeout.hasPassed()) {
+			ts.tv_sec = (long long)timeout.ts().tv_sec;
+			ts.tv_nsec = (long long)timeout.ts().tv_nsec;
+		}
+		arg.ts = (uint64_t)(uintptr_t)&ts;
+	}
+
+	int res = io_uring_enter(m_fd, toSubmit, minComplete, flags, &arg, sizeof(arg));
+	if(res >= 0)
+		return 0;
+
+	switch(errno) {
+	case ETIME:
+		// Timeout.
+		return 0;
+	case EBUSY:
+		// Completion queue is full. Reap and retry later.
+		return EAGAIN;
+	default:
+		return errno;
+	}
+}
+
+/*!
+ * \brief Handle all completions.
+ */
+void UringPoller::reap() noexcept
+{
+	unsigned int head = *m_cqHead;
+
+	while(head != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)) {
+		struct io_uring_cqe const& cqe = m_cqes[head & m_cqMask];
+		Request* req = reinterpret_cast<Request*>((uintptr_t)cqe.user_data);
+		int res = cqe.res;
+
+		__atomic_store_n(m_cqHead, ++head, __ATOMIC_RELEASE);
+
+		if(!req)
+			// Result of a cancellation.
+			continue;
+
+		switch(req->kind) {
+		case Request::Io: {
+			IoRequest& r = *static_cast<IoRequest*>(req);
+			zth_assert(m_io > 0);
+			m_io--;
+			r.res = res;
+			r.done = true;
+			countEvent();
+			// Put it in front, like the Waiter does with fibers whose timeout
+			// passed. Otherwise, the Waiter may find itself at the front of the
+			// queue, and go to sleep while the fiber is runnable.
+			currentWorker().resume(*r.fiber, true);
+			break;
+		}
+		case Request::Poll: {
+			PollRequest& r = *static_cast<PollRequest*>(req);
+			r.armed = false;
+
+			if(!r.pollable) {
+				// Removed in the meantime.
+				m_cancelled.erase(r);
+				delete &r;
+				break;
+			}
+
+			Pollable::Events revents = 0;
+			if(res < 0)
+				revents |= Pollable::PollErr;
+			else {
+				if(res & POLLIN)
+					revents |= Pollable::PollIn;
+				if(res & POLLOUT)
+					revents |= Pollable::PollOut;
+				if(res & POLLERR)
+					revents |= Pollable::PollErr;
+				if(res & POLLPRI)
+					revents |= Pollable::PollPri;
+				if(res & POLLHUP)
+					revents |= Pollable::PollHup;
+			}
+
+			r.pollable->revents = revents;
+
+			// Polls are one-shot. Re-arm, as the Pollable is still registered.
+			arm(r);
+
+			if(revents.any()) {
+				countEvent();
+				zth_dbg(io, "[%s] pollable %p got event 0x%lx", id_str(),
+					r.pollable, revents.to_ulong());
+				if(r.client)
+					r.client->event(*r.pollable);
+			}
+			break;
+		}
+		default:
+			zth_assert(false);
+		}
+	}
+}
+
+/*!
+ * \brief Queue a poll for the given request.
+ */
+void UringPoller::arm(PollRequest& r) noexcept
+{
+	zth_assert(!r.armed);
+
+	struct io_uring_sqe* s = sqe();
+	if(unlikely(!s)) {
+		// Try again at the next poll.
+		r.pollable->revents = Pollable::PollErr;
+		return;
+	}
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-static-cast-downcast)
+	PollableFd const& pfd = static_cast<PollableFd const&>(*r.pollable);
+
+	unsigned int events = 0;
+	if(pfd.events.test(Pollable::PollInIndex))
+		events |= POLLIN;
+	if(pfd.events.test(Pollable::PollOutIndex))
+		events |= POLLOUT;
+	if(pfd.events.test(Pollable::PollPriIndex))
+		events |= POLLPRI;
+	if(pfd.events.test(Pollable::PollHupIndex))
+		events |= POLLHUP;
+
+	s->opcode = IORING_OP_POLL_ADD;
+	s->fd = pfd.fd;
+	s->poll32_events = events;
+	s->user_data = (uint64_t)(uintptr_t) static_cast<Request*>(&r);
+	r.armed = true;
+}
+
+/*!
+ * \brief Cancel the poll of the given request, and delete it when done.
+ */
+void UringPoller::cancel(PollRequest& r) noexcept
+{
+	r.pollable = nullptr;
+	r.client = nullptr;
+
+	if(!r.armed) {
+		delete &r;
+		return;
+	}
+
+	// The request is deleted when the kernel completes the poll.
+	m_cancelled.push_back(r);
+
+	struct io_uring_sqe* s = sqe();
+	if(unlikely(!s))
+		// Let the poll complete by itself, or clean up when the ring is closed.
+		return;
+
+	s->opcode = IORING_OP_POLL_REMOVE;
+	s->addr = (uint64_t)(uintptr_t) static_cast<Request*>(&r);
+	s->user_data = 0;
+}
+
+int UringPoller::poll(int timeout_ms) noexcept
+{
+	return poll(timeoutInterval(timeout_ms));
+}
+
+int UringPoller::poll(TimeInterval const& timeout) noexcept
+{
+	if(empty())
+		return EINVAL;
+	if(!valid())
+		return EBADF;
+
+	// Do not wait when there are completions already.
+	bool pending = *m_cqHead != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+
+	zth_dbg(io, "[%s] polling %u items and %u I/O operations for %s", id_str(),
+		(unsigned)m_polls.size(), (unsigned)m_io, timeout.str().c_str());
+
+	int res = enter(pending || timeout.hasPassed() ? 0U : 1U, timeout);
+	reap();
+	return res == EAGAIN ? 0 : res;
+}
+
+/*!
+ * \brief Get a free SQE for an I/O operation of the current fiber.
+ *
+ * When the rings are full, the fiber yields until the Waiter has submitted the queued SQEs
+ * and reaped the completions, such that the caller does not see a spurious \c EAGAIN.
+ */
+struct io_uring_sqe* UringPoller::sqeWait() noexcept
+{
+	struct io_uring_sqe* s = nullptr;
+	while(unlikely(!(s = sqe()))) {
+		zth_dbg(io, "[%s] rings are full; wait for the Waiter", id_str());
+		currentWorker().waiter().wakeup();
+		yield(nullptr, true);
+	}
+
+	return s;
+}
+
+/*!
+ * \brief Submit the I/O operation in the last SQE, and wait for its completion.
+ */
+ssize_t UringPoller::io(IoRequest& r) noexcept
+{
+	r.fiber = &currentFiber();
+	m_io++;
+
+	// Make sure the Waiter is going to submit it.
+	currentWorker().waiter().wakeup();
+
+	while(!r.done)
+		zth::suspend();
+
+	if(r.res < 0) {
+		errno = -r.res;
+		return -1;
+	}
+
+	return r.res;
+}
+
+/*!
+ * \brief Fiber-aware \c read(), which suspends the current fiber until completion.
+ */
+ssize_t UringPoller::read(int fd, void* buf, size_t count) noexcept
+{
+	struct io_uring_sqe* s = sqeWait();
+	IoRequest r;
+	s->opcode = IORING_OP_READ;
+	s->fd = fd;
+	s->addr = (uint64_t)(uintptr_t)buf;
+	s->len = (uint32_t)std::min<size_t>(count, std::numeric_limits<uint32_t>::max());
+	// Use the file position.
+	s->off = (uint64_t)-1;
+	s->user_data = (uint64_t)(uintptr_t) static_cast<Request*>(&r);
+	return io(r);
+}
+
+/*!
+ * \brief Fiber-aware \c write(), which suspends the current fiber until completion.
+ */
+ssize_t UringPoller::write(int fd, void const* buf, size_t count) noexcept
+{
+	struct io_uring_sqe* s = sqeWait();
+	IoRequest r;
+	s->opcode = IORING_OP_WRITE;
+	s->fd = fd;
+	s->addr = (uint64_t)(uintptr_t)buf;
+	s->len = (uint32_t)std::min<size_t>(count, std::numeric_limits<uint32_t>::max());
+	s->off = (uint64_t)-1;
+	s->user_data = (uint64_t)(uintptr_t) static_cast<Request*>(&r);
+	return io(r);
+}
+
+/*!
+ * \brief Fiber-aware \c accept(), which suspends the current fiber until completion.
+ */
+int UringPoller::accept(int fd, struct sockaddr* addr, socklen_t* addrlen) noexcept
+{
+	struct io_uring_sqe* s = sqeWait();
+	IoRequest r;
+	s->opcode = IORING_OP_ACCEPT;
+	s->fd = fd;
+	s->addr = (uint64_t)(uintptr_t)addr;
+	s->addr2 = (uint64_t)(uintptr_t)addrlen;
+	s->user_data = (uint64_t)(uintptr_t) static_cast<Request*>(&r);
+	return (int)io(r);
+}
+
+/*!
+ * \brief Fiber-aware \c recv(), which suspends the current fiber until completion.
+ */
+ssize_t UringPoller::recv(int fd, void* buf, size_t len, int flags) noexcept
+{
+	struct io_uring_sqe* s = sqeWait();
+	IoRequest r;
+	s->opcode = IORING_OP_RECV;
+	s->fd = fd;
+	s->addr = (uint64_t)(uintptr_t)buf;
+	s->len = (uint32_t)std::min<size_t>(len, std::numeric_limits<uint32_t>::max());
+	s->msg_flags = (uint32_t)flags;
+	s->user_data = (uint64_t)(uintptr_t) static_cast<Request*>(&r);
+	return io(r);
+}
+
+/*!
+ * \brief Fiber-aware \c send(), which suspends the current fiber until completion.
+ */
+ssize_t UringPoller::send(int fd, void const* buf, size_t len, int flags) noexcept
+{
+	struct io_uring_sqe* s = sqeWait();
+	IoRequest r;
+	s->opcode = IORING_OP_SEND;
+	s->fd = fd;
+	s->addr = (uint64_t)(uintptr_t)buf;
+	s->len = (uint32_t)std::min<size_t>(len, std::numeric_limits<uint32_t>::max());
+	s->msg_flags = (uint32_t)flags;
+	s->user_data = (uint64_t)(uintptr_t) static_cast<Request*>(&r);
+	return io(r);
+}
+
+} // namespace zth
+#else
+static int no_uring __attribute__((unused));
+#endif // ZTH_HAVE_IO_URING
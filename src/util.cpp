@@ -110,6 +110,12 @@ char const* banner() noexcept
 #if ZTH_THREADS
 		" threads"
 #endif
+#if ZTH_TIME_NS
+		" time-ns"
+#endif
+#ifdef ZTH_CONTEXT_NATIVE
+		" native"
+#endif
 #ifdef ZTH_CONTEXT_UCONTEXT
 		" ucontext"
 #endif
@@ -9,16 +9,81 @@
 #include <libzth/poller.h>
 #include <libzth/worker.h>
 
+#ifdef ZTH_OS_LINUX
+#  include <sys/prctl.h>
+#endif
+
+#if defined(ZTH_HAVE_POLLER) && !defined(ZTH_OS_WINDOWS) && !defined(ZTH_OS_BAREMETAL)
+#  define ZTH_HAVE_WAITER_INTERRUPT
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <unistd.h>
+#  ifdef ZTH_OS_LINUX
+#    include <sys/eventfd.h>
+#  endif
+#endif
+
 namespace zth {
 
+static inline TimedWaitable*
+waiting_first(SortedList<TimedWaitable>& q, Timestamp const& UNUSED_PAR(now)) noexcept
+{
+	return q.empty() ? nullptr : &q.front();
+}
+
+static inline TimedWaitable*
+waiting_first(TimerWheel<TimedWaitable>& q, Timestamp const& now) noexcept
+{
+	return q.first(now);
+}
+
+static inline Timestamp waiting_next(SortedList<TimedWaitable> const& q) noexcept
+{
+	return q.front().timeout();
+}
+
+static inline Timestamp waiting_next(TimerWheel<TimedWaitable> const& q) noexcept
+{
+	return q.next();
+}
+
 Waiter::Waiter(Worker& worker)
 	: m_worker(worker)
 	, m_poller()
 	, m_defaultPoller()
-{}
+	, m_wakePollable()
+	, m_wakeArmed()
+	, m_wakeWanted()
+	, m_sleeping()
+	, m_pollStats()
+	, m_pollRounds()
+	, m_pollBudget(Config::WaiterPollMinRounds)
+{
+	m_wakeFd[0] = m_wakeFd[1] = -1;
+
+#ifdef ZTH_OS_LINUX
+	// The Waiter does the sleeping of this thread.
+	struct timespec const slack = Config::TimerSlack();
+	unsigned long slack_ns =
+		(unsigned long)slack.tv_sec * 1000000000UL + (unsigned long)slack.tv_nsec;
+	if(slack_ns && prctl(PR_SET_TIMERSLACK, slack_ns, 0UL, 0UL, 0UL))
+		zth_dbg(waiter, "[%s] Cannot set timer slack; %s", id_str(), err(errno).c_str());
+#endif
+}
 
 Waiter::~Waiter() noexcept
 {
+	zth_assert(!m_wakeArmed);
+
+#ifdef ZTH_HAVE_WAITER_INTERRUPT
+	if(m_wakeFd[1] != m_wakeFd[0])
+		close(m_wakeFd[1]);
+	if(m_wakeFd[0] >= 0)
+		close(m_wakeFd[0]);
+
+	delete static_cast<PollableFd*>(m_wakePollable);
+#endif
+
 	delete m_defaultPoller;
 }
 
@@ -28,12 +93,29 @@ void waitUntil(TimedWaitable& w)
 	currentWorker().waiter().wait(w);
 }
 
+void nap(Timestamp const& sleepUntil)
+{
+	TimedWaitable w(sleepUntil);
+	if(likely(!stack_shared_contains(&w))) {
+		waitUntil(w);
+		return;
+	}
+
+	// The Waiter cannot access the shared stack while another fiber uses it.
+	TimedWaitable* w_ = new TimedWaitable(sleepUntil);
+	waitUntil(*w_);
+	delete w_;
+}
+
 void Waiter::wait(TimedWaitable& w)
 {
 	Fiber* fiber = m_worker.currentFiber();
 	if(unlikely(!fiber || fiber->state() != Fiber::Running))
 		return;
 
+	// See Fiber::setStackShared().
+	zth_assert(!stack_shared_contains(&w));
+
 	Timestamp now = Timestamp::now();
 	if(unlikely(w.poll(now))) {
 		yield(nullptr, false, now);
@@ -58,6 +140,7 @@ void scheduleTask(TimedWaitable& w)
 
 void Waiter::scheduleTask(TimedWaitable& w)
 {
+	zth_assert(!stack_shared_contains(&w));
 	m_waiting.insert(w);
 	if(fiber())
 		m_worker.resume(*fiber());
@@ -92,6 +175,25 @@ void Waiter::wakeup(TimedWaitable& w)
 	}
 }
 
+/*!
+ * \brief Create the poller that is used when none is set by #setPoller().
+ */
+static PollerServerBase* newDefaultPoller()
+{
+#ifdef ZTH_HAVE_IO_URING
+	if(zth_config(UseIoUring)) {
+		UringPoller* p = new UringPoller();
+		if(p->valid())
+			return p;
+
+		// Not supported by the kernel. Fall back to the normal one.
+		delete p;
+	}
+#endif
+
+	return new DefaultPollerServer();
+}
+
 PollerServerBase& Waiter::poller()
 {
 	if(m_poller)
@@ -99,7 +201,7 @@ PollerServerBase& Waiter::poller()
 	if(m_defaultPoller)
 		return *m_defaultPoller;
 
-	m_defaultPoller = new DefaultPollerServer();
+	m_defaultPoller = newDefaultPoller();
 	return *m_defaultPoller;
 }
 
@@ -116,12 +218,226 @@ bool Waiter::polling() const
 	return !p->empty();
 }
 
+/*!
+ * \brief Check if a non-blocking poll is due, while other fibers are runnable.
+ * \see #zth::Config::WaiterPollMinRounds
+ */
+bool Waiter::pollDue(Timestamp const& now)
+{
+	if(++m_pollRounds >= m_pollBudget)
+		return true;
+
+	if(!(now - m_pollLast < TimeInterval(Config::WaiterPollMaxInterval())))
+		return true;
+
+	m_pollStats.skipped++;
+	return false;
+}
+
+/*!
+ * \brief Administer a poll, and adapt the number of rounds till the next one.
+ */
+void Waiter::polled(bool hit, Timestamp const& now) noexcept
+{
+	m_pollStats.polls++;
+	m_pollRounds = 0;
+	m_pollLast = now;
+
+	if(hit) {
+		m_pollStats.hits++;
+		m_pollBudget = Config::WaiterPollMinRounds;
+	} else if(m_pollBudget < Config::WaiterPollMaxRounds) {
+		unsigned int budget = m_pollBudget ? m_pollBudget * 2U : 1U;
+		m_pollBudget = budget < Config::WaiterPollMaxRounds ? budget
+								    : Config::WaiterPollMaxRounds;
+	}
+}
+
 void Waiter::wakeup()
 {
 	if(fiber())
 		m_worker.resume(*fiber());
 }
 
+/*!
+ * \brief Interrupt a blocking sleep of the Waiter.
+ *
+ * This function is thread-safe. It can be called by any thread.  When the Waiter is not
+ * sleeping, nothing happens.
+ *
+ * A Worker that is neither kept alive nor member of a #zth::WorkerGroup does not arm its
+ * wake descriptor, as nobody is expected to interrupt it.  The first call marks the Waiter
+ * as interruptible from then on, but it cannot cut short a sleep that has already started.
+ */
+void Waiter::interrupt() noexcept
+{
+#ifdef ZTH_HAVE_WAITER_INTERRUPT
+	if(unlikely(!__atomic_load_n(&m_wakeWanted, __ATOMIC_RELAXED)))
+		__atomic_store_n(&m_wakeWanted, true, __ATOMIC_RELAXED);
+
+	if(!__atomic_exchange_n(&m_sleeping, false, __ATOMIC_SEQ_CST))
+		// Not sleeping, or someone else interrupted it already.
+		return;
+
+#  ifdef ZTH_OS_LINUX
+	uint64_t v = 1;
+#  else
+	char v = 0;
+#  endif
+	if(::write(m_wakeFd[1], &v, sizeof(v)) == -1) {
+		// Already signaled. Ignore.
+	}
+#endif
+}
+
+/*!
+ * \brief Create the wake descriptor, which is signaled by #interrupt().
+ * \return \c false when the Worker cannot be interrupted
+ */
+bool Waiter::wakeInit() noexcept
+{
+#ifdef ZTH_HAVE_WAITER_INTERRUPT
+	if(likely(m_wakeFd[0] >= 0))
+		return true;
+
+	// Lazy init, as most Workers will never be interrupted.
+#  ifdef ZTH_OS_LINUX
+	m_wakeFd[0] = m_wakeFd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(m_wakeFd[0] < 0)
+		return false;
+#  else
+	if(pipe(m_wakeFd))
+		return false;
+
+	for(int i = 0; i < 2; i++) {
+		fcntl(m_wakeFd[i], F_SETFL, fcntl(m_wakeFd[i], F_GETFL) | O_NONBLOCK);
+		fcntl(m_wakeFd[i], F_SETFD, FD_CLOEXEC);
+	}
+#  endif
+
+	try {
+		m_wakePollable = new PollableFd(m_wakeFd[0], Pollable::PollIn);
+	} catch(...) {
+		return false;
+	}
+
+	zth_dbg(waiter, "[%s] Created wake descriptor %d", id_str(), m_wakeFd[0]);
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*!
+ * \brief Let the thread sleep while the Worker has no fibers at all.
+ *
+ * Unlike the sleep of the Waiter fiber, it does not poll, but it only waits for
+ * #interrupt(), which a #post() or the #zth::WorkerGroup does.  When the Worker cannot be
+ * interrupted, it sleeps for \p timeout instead.
+ */
+void Waiter::idle(TimeInterval const& timeout) noexcept
+{
+#ifdef ZTH_HAVE_WAITER_INTERRUPT
+	if(wakeInit()) {
+		__atomic_store_n(&m_sleeping, true, __ATOMIC_SEQ_CST);
+
+		if(!m_worker.inboxPending()
+		   && (!m_worker.group() || m_worker.groupSleepBegin())) {
+			zth_dbg(waiter, "[%s] Idle", id_str());
+			struct pollfd p = {m_wakeFd[0], POLLIN, 0};
+			if(::poll(&p, 1, -1) == -1) {
+				// Interrupted. Just retry later.
+			}
+		}
+
+		__atomic_store_n(&m_sleeping, false, __ATOMIC_SEQ_CST);
+		if(m_worker.group())
+			m_worker.groupSleepEnd();
+
+		// Drain the descriptor.
+		char buf[16];
+		while(::read(m_wakeFd[0], buf, sizeof(buf)) > 0)
+			;
+		return;
+	}
+#endif
+
+	struct timespec ts = timeout.ts();
+	nanosleep(&ts, nullptr);
+}
+
+/*!
+ * \brief Check if anyone may #interrupt() the sleep of this Waiter.
+ */
+bool Waiter::interruptible() const noexcept
+{
+	return m_worker.keptAlive() || m_worker.group()
+	       || __atomic_load_n(&m_wakeWanted, __ATOMIC_RELAXED);
+}
+
+/*!
+ * \brief Prepare for a blocking sleep, such that it can be interrupted.
+ *
+ * When the Worker is #interruptible(), a wake descriptor is added to the poller, which is
+ * signaled by #interrupt().  Otherwise, the sleep is left as is, which saves the descriptor and
+ * the poller calls to add and remove it.
+ *
+ * \return \c false when the sleep should be skipped, as the Worker got work in the meantime
+ */
+bool Waiter::sleepBegin() noexcept
+{
+#ifdef ZTH_HAVE_WAITER_INTERRUPT
+	if(!interruptible())
+		// Nobody is going to interrupt us, except for a first post().
+		return !m_worker.inboxPending();
+
+	if(!wakeInit())
+		return true;
+
+	if(poller().add(*m_wakePollable))
+		// Cannot add; sleep without being interruptible.
+		return true;
+
+	m_wakeArmed = true;
+	__atomic_store_n(&m_sleeping, true, __ATOMIC_SEQ_CST);
+
+	if(m_worker.inboxPending()
+	   || (m_worker.group() && !m_worker.groupSleepBegin())) {
+		// Got something while preparing.
+		sleepEnd();
+		return false;
+	}
+#endif
+	return true;
+}
+
+/*!
+ * \brief Cleanup after #sleepBegin().
+ */
+void Waiter::sleepEnd() noexcept
+{
+#ifdef ZTH_HAVE_WAITER_INTERRUPT
+	if(!m_wakeArmed)
+		return;
+
+	m_wakeArmed = false;
+	__atomic_store_n(&m_sleeping, false, __ATOMIC_SEQ_CST);
+
+	if(m_worker.group())
+		m_worker.groupSleepEnd();
+
+	if(m_wakePollable->revents.test(Pollable::PollInIndex)) {
+		// Drain the descriptor.
+		char buf[16];
+		while(::read(m_wakeFd[0], buf, sizeof(buf)) > 0)
+			;
+		m_wakePollable->revents.reset();
+	}
+
+	poller().remove(*m_wakePollable);
+#endif
+}
+
 void Waiter::setPoller(PollerServerBase* p)
 {
 	if(!m_poller) {
@@ -135,7 +451,7 @@ void Waiter::setPoller(PollerServerBase* p)
 		// Replace poller by default one.
 		if(!m_defaultPoller && !m_poller->empty()) {
 			// ...but it doesn't exist yet and we need it.
-			m_defaultPoller = new DefaultPollerServer();
+			m_defaultPoller = newDefaultPoller();
 		}
 
 		if(m_defaultPoller)
@@ -150,12 +466,15 @@ void Waiter::entry()
 	zth_assert(&currentWorker() == &m_worker);
 	fiber()->setName(format("zth::Waiter of %s", m_worker.id_str()));
 
+	// Read the clock only once per round, as that is a significant part of its overhead.
+	Timestamp now = Timestamp::now();
+
 	while(true) {
-		Timestamp now = Timestamp::now();
 		m_worker.load().stop(now);
 
-		while(!m_waiting.empty() && m_waiting.front().timeout() < now) {
-			TimedWaitable& w = m_waiting.front();
+		TimedWaitable* first = nullptr;
+		while((first = waiting_first(m_waiting, now)) && first->timeout() < now) {
+			TimedWaitable& w = *first;
 			m_waiting.erase(w);
 			if(w.poll(now)) {
 				if(w.hasFiber()) {
@@ -179,11 +498,12 @@ void Waiter::entry()
 
 		m_worker.load().start(now);
 
-		if(m_waiting.empty() && !polling()) {
+		if(m_waiting.empty() && !polling() && !m_worker.keptAlive()) {
 			// No fiber is waiting. suspend() till anyone is going to nap().
 			zth_dbg(waiter, "[%s] No sleeping fibers anymore; suspend", id_str());
 			m_worker.suspend(*fiber());
-		} else if(!m_worker.schedule()) {
+		} else if(!m_worker.schedule() && !m_worker.scheduleLower()
+			  && !m_worker.groupTake()) {
 			// When true, we were not rescheduled, which means that we are the only
 			// runnable fiber. Do a real sleep, until something interesting happens in
 			// the system.
@@ -191,35 +511,75 @@ void Waiter::entry()
 			m_worker.load().stop(now);
 		}
 
+		now = Timestamp::now();
+
+		Timestamp next;
 		Timestamp const* end = nullptr;
-		if(!m_waiting.empty())
-			end = &m_waiting.front().timeout();
+		if(!m_waiting.empty()) {
+			next = waiting_next(m_waiting);
+			end = &next;
+		}
 		if(!m_worker.runEnd().isNull() && (!end || *end > m_worker.runEnd()))
 			end = &m_worker.runEnd();
 
-		if(polling()) {
-			int timeout_ms = 0;
+		Timestamp spinEnd;
+		TimeInterval const spin(Config::WaiterSpin());
+		if(doRealSleep && end && spin.isPositive()) {
+			// Wake up a bit early, and spin for the rest, as the OS may wake us late.
+			if(*end - now <= spin) {
+				doRealSleep = false;
+			} else {
+				spinEnd = *end - spin;
+				end = &spinEnd;
+			}
+		}
+
+		if(doRealSleep && !sleepBegin())
+			doRealSleep = false;
+
+		if(doRealSleep) {
+			// Do not keep more memory than needed while idle.
+			stack_cache_trim();
+
+			if(Config::TimesliceTick)
+				timeslice_tick_stop();
+		}
+
+		Timestamp idleEnd;
+		if(doRealSleep && ((m_worker.group() && !m_wakeArmed) || (!end && !polling()))) {
+			// Do not sleep too long, as other Workers may have work for us, or we cannot
+			// be interrupted when something is posted to our Worker. When armed, the
+			// group interrupts our sleep instead.
+			idleEnd = now + TimeInterval(Config::WorkerGroupIdlePoll());
+			if(!end || *end > idleEnd)
+				end = &idleEnd;
+		}
+
+		if(polling() && (doRealSleep || pollDue(now))) {
+			// Do not block by default.
+			TimeInterval timeout;
 			if(doRealSleep) {
 				if(!end) {
-					// Infinite sleep.
-					timeout_ms = -1;
+					timeout = TimeInterval::infinity();
 					zth_dbg(waiter, "[%s] Out of other work than doing poll()",
 						id_str());
 				} else {
-					TimeInterval dt = *end - Timestamp::now();
+					// Let the poller sleep as precise as it can, instead of
+					// rounding to milliseconds.
+					timeout = *end - now + Timestamp::resolution();
 					zth_dbg(waiter,
 						"[%s] Out of other work than doing poll(); timeout "
 						"is %s",
-						id_str(), dt.str().c_str());
-					timeout_ms =
-						std::max<int>(0, (int)(dt.s<float>() * 1000.0F));
+						id_str(), timeout.str().c_str());
 				}
 
 				perf_mark("blocking poll()");
 				zth_perf_event(*fiber(), Fiber::Waiting);
 			}
 
-			int res = poller().poll(timeout_ms);
+			size_t events = poller().events();
+			int res = poller().poll(timeout);
+			polled(poller().events() != events, now);
 
 			if(doRealSleep) {
 				zth_perf_event(*fiber(), fiber()->state());
@@ -229,17 +589,33 @@ void Waiter::entry()
 			if(res && res != EAGAIN)
 				zth_dbg(waiter, "[%s] poll() failed; %s", id_str(),
 					err(res).c_str());
+
+			sleepEnd();
 		} else if(doRealSleep) {
-			zth_dbg(waiter, "[%s] Out of work; suspend thread, while waiting for %s",
-				id_str(), m_waiting.front().str().c_str());
+			zth_dbg(waiter, "[%s] Out of work; suspend thread for %s", id_str(),
+				(*end - now).str().c_str());
 			perf_mark("idle system; sleep");
 			zth_perf_event(*fiber(), Fiber::Waiting);
-			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &end->ts(), nullptr);
+			Timestamp wakeup = *end;
+			if(Config::Clock != Config::ClockMonotonic)
+				// The clock may lag CLOCK_MONOTONIC. Sleep relative to it, such
+				// that we do not spin till it has passed end.
+				wakeup = Timestamp::now(Config::ClockMonotonic) + (*end - now)
+					 + Timestamp::resolution();
+			struct timespec const wakeup_ts = wakeup.ts();
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup_ts, nullptr);
 			zth_perf_event(*fiber(), fiber()->state());
 			perf_mark("wakeup");
 		}
 
 		sigchld_check();
+
+		if(doRealSleep) {
+			if(Config::TimesliceTick)
+				timeslice_tick_start();
+
+			now = Timestamp::now();
+		}
 	}
 }
 
@@ -250,18 +626,50 @@ bool PeriodicWakeUp::nap(Timestamp const& reference, Timestamp const& now)
 	m_t = reference + interval();
 	if(likely(m_t > now)) {
 		// Proper sleep till next deadline.
+		setDeadline(now);
 		zth::nap(m_t);
 		return true;
 	} else if(m_t + interval() > now) {
 		// Deadline has just passed. Don't sleep and try to catch up.
+		setDeadline(now);
 		yield();
 		return false;
 	} else {
 		// Way passed deadline. Don't sleep and skip a few cycles.
 		m_t = now;
+		setDeadline(now);
 		yield();
 		return false;
 	}
 }
 
+/*!
+ * \brief Let the next job of the current fiber finish before the period after #t() ends.
+ *
+ * This is only done when the fiber opted in, by EDF scheduling of its Worker, or by having a
+ * deadline already.
+ */
+void PeriodicWakeUp::setDeadline(Timestamp const& now)
+{
+	Worker* w = Worker::instance();
+	Fiber* f = w ? w->currentFiber() : nullptr;
+	if(unlikely(!f) || (likely(!w->edf()) && f->deadline().isNull()))
+		return;
+
+	w->setDeadline(*f, m_t + interval(), now);
+	m_fiber = f;
+}
+
+/*!
+ * \brief Remove the deadline that was set by #setDeadline() from the current fiber.
+ */
+void PeriodicWakeUp::clearDeadline()
+{
+	Worker* w = Worker::instance();
+	if(w && w->currentFiber() == m_fiber)
+		w->setDeadline(*m_fiber, Timestamp::null());
+
+	m_fiber = nullptr;
+}
+
 } // namespace zth
@@ -7,8 +7,10 @@
 #include <libzth/worker.h>
 
 #include <libzth/async.h>
+#include <libzth/sync.h>
 
 #include <csignal>
+#include <cstring>
 #include <vector>
 
 #ifndef ZTH_OS_WINDOWS
@@ -45,11 +47,47 @@ void worker_global_init()
 }
 ZTH_INIT_CALL(worker_global_init)
 
-#ifdef ZTH_USE_PTHREAD
-static void* worker_main(void* fiber)
+__attribute__((unused)) static cow_string thread_id_str() noexcept
 {
+	Worker const* w = Worker::instance();
+	if(w)
+		return w->id_str();
+
+	return format(
+		"pid %u",
+#ifdef ZTH_OS_WINDOWS
+		(unsigned int)_getpid()
+#else
+		(unsigned int)getpid()
+#endif
+	);
+}
+
+#ifdef ZTH_HAVE_PTHREAD
+namespace {
+struct WorkerThreadStart {
+	Fiber* fiber;
+	char name[16];
+};
+} // namespace
+
+static void* worker_main(void* arg)
+{
+	WorkerThreadStart* start = static_cast<WorkerThreadStart*>(arg);
+	Fiber* fiber = start->fiber;
+
+	if(start->name[0]) {
+#  ifdef ZTH_OS_MAC
+		pthread_setname_np(start->name);
+#  elif defined(ZTH_OS_LINUX)
+		pthread_setname_np(pthread_self(), start->name);
+#  endif
+	}
+
+	delete start;
+
 	Worker w;
-	w << (Fiber*)fiber;
+	w << fiber;
 	w.run();
 	return nullptr;
 }
@@ -59,33 +97,840 @@ static void* worker_main(void* fiber)
  * \brief Start a new thread, create a Worker, with one fiber, which executes \p f.
  * \ingroup zth_api_cpp_fiber
  */
-int startWorkerThread(
-	UNUSED_PAR(void (*f)()), size_t UNUSED_PAR(stack), char const* UNUSED_PAR(name))
+int startWorkerThread(void (*f)(), size_t stack, char const* name)
+{
+	WorkerThreadAttr attr;
+	attr.stack = stack;
+	attr.name = name;
+	return startWorkerThread(f, attr);
+}
+
+/*!
+ * \brief Start a new thread with the given attributes, create a Worker, with one fiber, which
+ *	executes \p f.
+ * \return 0 on success, otherwise an errno
+ * \ingroup zth_api_cpp_fiber
+ */
+int startWorkerThread(UNUSED_PAR(void (*f)()), UNUSED_PAR(WorkerThreadAttr const& attr))
 {
-#ifdef ZTH_USE_PTHREAD
+#ifdef ZTH_HAVE_PTHREAD
 	pthread_t t;
+	pthread_attr_t pattr;
 	int res = 0;
 
 	zth_dbg(thread, "[%s] starting new Worker", thread_id_str().c_str());
 
-	Fiber* fiber = new Fiber((void (*)(void*))f, nullptr);
-	if(stack)
-		if((res = fiber->setStackSize(stack)))
-			return res;
-
-	if(name)
-		fiber->setName(name);
+#  ifndef ZTH_OS_LINUX
+	if(attr.cpus && attr.cpuCount)
+		return ENOSYS;
+#  endif
 
-	if((res = pthread_create(&t, nullptr, &worker_main, (void*)fiber)))
+	if((res = pthread_attr_init(&pattr)))
 		return res;
 
-	pthread_detach(t);
-	return 0;
+#  ifdef ZTH_OS_LINUX
+	if(attr.cpus && attr.cpuCount) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for(size_t i = 0; i < attr.cpuCount; i++) {
+			if(attr.cpus[i] < 0 || attr.cpus[i] >= CPU_SETSIZE) {
+				res = EINVAL;
+				goto done;
+			}
+			CPU_SET((size_t)attr.cpus[i], &cpus);
+		}
+
+		if((res = pthread_attr_setaffinity_np(&pattr, sizeof(cpus), &cpus)))
+			goto done;
+	}
+#  endif
+
+	if(attr.fifoPriority) {
+		struct sched_param param = {};
+		param.sched_priority = attr.fifoPriority;
+		if((res = pthread_attr_setinheritsched(&pattr, PTHREAD_EXPLICIT_SCHED))
+		   || (res = pthread_attr_setschedpolicy(&pattr, SCHED_FIFO))
+		   || (res = pthread_attr_setschedparam(&pattr, &param)))
+			goto done;
+	}
+
+	{
+		Fiber* fiber = new Fiber((void (*)(void*))f, nullptr);
+		if(attr.stack && (res = fiber->setStackSize(attr.stack))) {
+			delete fiber;
+			goto done;
+		}
+
+		WorkerThreadStart* start = new WorkerThreadStart();
+		start->fiber = fiber;
+		if(attr.name) {
+			fiber->setName(attr.name);
+			// Thread names are limited to 15 characters.
+			strncpy(start->name, attr.name, sizeof(start->name) - 1U);
+		}
+
+		if((res = pthread_create(&t, &pattr, &worker_main, start))) {
+			delete start;
+			delete fiber;
+			goto done;
+		}
+
+		pthread_detach(t);
+	}
+
+done:
+	pthread_attr_destroy(&pattr);
+	return res;
 #else
 	return ENOSYS;
 #endif
 }
 
+
+
+
+////////////////////////////////////////////////////////////
+// Timeslice tick
+
+unsigned int timeslice_tick;
+
+#ifdef ZTH_HAVE_PTHREAD
+/*! \brief Number of Workers that are not sleeping. */
+static unsigned int timeslice_tick_busy;
+static bool timeslice_tick_running;
+static pthread_mutex_t timeslice_tick_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timeslice_tick_cond = PTHREAD_COND_INITIALIZER;
+
+static void* timeslice_tick_main(void* /*unused*/)
+{
+#  ifndef ZTH_OS_WINDOWS
+	// Leave all signals to the Workers.
+	sigset_t mask;
+	sigfillset(&mask);
+	pthread_sigmask(SIG_SETMASK, &mask, nullptr);
+#  endif
+
+	struct timespec const slice = Config::MinTimeslice();
+	uint64_t half = ((uint64_t)slice.tv_sec * (uint64_t)TimeInterval::BILLION
+			 + (uint64_t)slice.tv_nsec)
+			/ 2U;
+	struct timespec period = {};
+	period.tv_sec = (time_t)(half / (uint64_t)TimeInterval::BILLION);
+	period.tv_nsec = (long)(half % (uint64_t)TimeInterval::BILLION);
+
+	while(true) {
+		if(unlikely(!__atomic_load_n(&timeslice_tick_busy, __ATOMIC_ACQUIRE))) {
+			// All Workers are sleeping; so do we.
+			pthread_mutex_lock(&timeslice_tick_mutex);
+			while(!__atomic_load_n(&timeslice_tick_busy, __ATOMIC_ACQUIRE))
+				pthread_cond_wait(&timeslice_tick_cond, &timeslice_tick_mutex);
+			pthread_mutex_unlock(&timeslice_tick_mutex);
+		}
+
+		nanosleep(&period, nullptr);
+
+		// Skip 0, as that indicates that we are not running.
+		if(unlikely(!__atomic_add_fetch(&timeslice_tick, 1U, __ATOMIC_RELAXED)))
+			__atomic_add_fetch(&timeslice_tick, 1U, __ATOMIC_RELAXED);
+	}
+
+	return nullptr;
+}
+#endif // ZTH_HAVE_PTHREAD
+
+/*!
+ * \brief Register a Worker that becomes busy.
+ * \details The helper thread is started when the first Worker registers.
+ * \see #zth::Config::TimesliceTick
+ */
+void timeslice_tick_start() noexcept
+{
+#ifdef ZTH_HAVE_PTHREAD
+	if(__atomic_fetch_add(&timeslice_tick_busy, 1U, __ATOMIC_ACQ_REL))
+		// Already running.
+		return;
+
+	pthread_mutex_lock(&timeslice_tick_mutex);
+
+	if(unlikely(!timeslice_tick_running)) {
+		pthread_t t;
+		if(pthread_create(&t, nullptr, &timeslice_tick_main, nullptr)) {
+			zth_dbg(thread, "Cannot start timeslice tick; fall back to the clock");
+		} else {
+			pthread_detach(t);
+			timeslice_tick_running = true;
+			__atomic_store_n(&timeslice_tick, 1U, __ATOMIC_RELAXED);
+		}
+	}
+
+	pthread_cond_signal(&timeslice_tick_cond);
+	pthread_mutex_unlock(&timeslice_tick_mutex);
+#endif
+}
+
+/*!
+ * \brief Unregister a Worker that goes to sleep, or is destructed.
+ * \details The helper thread pauses when no Worker is busy.
+ * \see #zth::Config::TimesliceTick
+ */
+void timeslice_tick_stop() noexcept
+{
+#ifdef ZTH_HAVE_PTHREAD
+	__atomic_sub_fetch(&timeslice_tick_busy, 1U, __ATOMIC_ACQ_REL);
+#endif
+}
+
+
+
+
+////////////////////////////////////////////////////////////
+// RunQueue
+
+/*!
+ * \brief Return the first fiber of the group at level \p l that is furthest behind.
+ *
+ * The groups are sorted by the virtual runtime they had when they were sorted in.  Only groups
+ * that ran have been charged since, so the front is sorted in again until it is up to date.
+ * Groups that used up their quota wait for their next period, while the fibers without a group
+ * of the same level run.
+ */
+Fiber& RunQueue::fair(unsigned int l, Timestamp const& now) noexcept
+{
+	SortedList<FiberGroup::Run, LessVruntime>& groups = m_groups[l];
+
+	if(unlikely(!m_unthrottle.isNull()) && m_unthrottle < now)
+		unthrottle();
+
+	while(!groups.empty()) {
+		FiberGroup::Run& run = groups.front();
+		FiberGroup& group = *run.group;
+
+		if(group.m_vruntime > run.vruntime) {
+			groups.erase(run);
+			run.vruntime = group.m_vruntime;
+			groups.insert(run);
+
+			if(&groups.front() != &run) {
+				group.m_throttled++;
+				zth_dbg(worker, "Throttle %s; got its share", group.id_str());
+			}
+			continue;
+		}
+
+		if(unlikely(group.overQuota(now))) {
+			group.m_throttled++;
+			zth_dbg(worker, "Throttle %s; used up its quota", group.id_str());
+
+			groups.erase(run);
+			run.throttled = true;
+			m_throttled[l].push_back(run);
+
+			if(m_unthrottle.isNull() || group.m_periodEnd < m_unthrottle)
+				m_unthrottle = group.m_periodEnd;
+			continue;
+		}
+
+		return run.fibers.front();
+	}
+
+	List<>& q = m_queue[l];
+	if(q.size() > 1) {
+		// Skip the turn of the groups.
+		m_groupsRan[l] = 0;
+		q.rotate(*++q.cyclic(m_groupsTurn[l]));
+		return static_cast<Fiber&>(q.front());
+	}
+
+	// Nobody else is runnable, so the quota is a soft limit.
+	return m_throttled[l].front().fibers.front();
+}
+
+/*!
+ * \brief Sort the groups that used up their quota in again, as a new period has started.
+ */
+void RunQueue::unthrottle() noexcept
+{
+	m_unthrottle = Timestamp::null();
+
+	for(unsigned int l = 0; l < Levels; l++) {
+		while(!m_throttled[l].empty()) {
+			FiberGroup::Run& run = m_throttled[l].front();
+			m_throttled[l].pop_front();
+			run.throttled = false;
+			run.vruntime = run.group->m_vruntime;
+			m_groups[l].insert(run);
+		}
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////
+// WorkerGroup
+
+WorkerGroup::WorkerGroup(char const* name)
+	: UniqueID(name)
+	, m_slots(new Slot[Config::WorkerGroupMaxSize]())
+	, m_size()
+	, m_stop()
+	, m_steals()
+	, m_sleeping()
+{
+	static_assert(
+		Config::WorkerGroupMaxSize <= sizeof(m_sleeping) * 8U,
+		"WorkerGroupMaxSize does not fit in the sleeping mask");
+	static_assert(
+		Config::WorkerGroupQueueSize > 0
+			&& (Config::WorkerGroupQueueSize & (Config::WorkerGroupQueueSize - 1U))
+				   == 0,
+		"WorkerGroupQueueSize must be a power of 2");
+
+	zth_dbg(worker, "[%s] Created", id_str());
+}
+
+WorkerGroup::~WorkerGroup() noexcept
+{
+	zth_assert(size() == 0);
+	zth_dbg(worker, "[%s] Destruct; %u steals", id_str(), (unsigned int)steals());
+	delete[] m_slots;
+}
+
+/*!
+ * \brief Let the given Worker join this group.
+ * \details Call this function from the thread of the given Worker.
+ * \return 0 on success, otherwise an errno
+ */
+int WorkerGroup::join(Worker& worker) noexcept
+{
+	zth_assert(&worker == Worker::instance());
+
+	if(worker.m_group)
+		return EALREADY;
+
+	for(size_t i = 0; i < Config::WorkerGroupMaxSize; i++) {
+		Worker* expected = nullptr;
+		if(!__atomic_compare_exchange_n(
+			   &m_slots[i].worker, &expected, &worker, false, __ATOMIC_ACQ_REL,
+			   __ATOMIC_RELAXED))
+			continue;
+
+		worker.m_group = this;
+		worker.m_groupSlot = i;
+		__atomic_add_fetch(&m_size, 1, __ATOMIC_RELAXED);
+		zth_dbg(worker, "[%s] %s joined at slot %u", id_str(), worker.id_str(),
+			(unsigned int)i);
+		return 0;
+	}
+
+	return ENOSPC;
+}
+
+/*!
+ * \brief Let the given Worker leave this group.
+ *
+ * Fibers that are still queued by this Worker for the group, are put back into its own
+ * runnable queue.  Call this function from the thread of the given Worker.
+ */
+void WorkerGroup::leave(Worker& worker) noexcept
+{
+	zth_assert(&worker == Worker::instance());
+
+	if(worker.m_group != this)
+		return;
+
+	worker.groupLeave();
+}
+
+/*!
+ * \brief Stop the group.
+ *
+ * Idle Workers return from #zth::Worker::run(), instead of waiting for more fibers to steal.
+ */
+void WorkerGroup::stop() noexcept
+{
+	zth_dbg(worker, "[%s] Stop", id_str());
+	__atomic_store_n(&m_stop, true, __ATOMIC_RELEASE);
+	wake(Config::WorkerGroupMaxSize, Config::WorkerGroupMaxSize);
+}
+
+bool WorkerGroup::push(size_t slot, Fiber& fiber) noexcept
+{
+	zth_assert(slot < Config::WorkerGroupMaxSize);
+	Slot& s = m_slots[slot];
+
+	int64_t b = __atomic_load_n(&s.bottom, __ATOMIC_RELAXED);
+	int64_t t = __atomic_load_n(&s.top, __ATOMIC_ACQUIRE);
+
+	if(b - t >= (int64_t)Config::WorkerGroupQueueSize)
+		// Full.
+		return false;
+
+	__atomic_store_n(
+		&s.queue[(size_t)b & (Config::WorkerGroupQueueSize - 1U)], &fiber,
+		__ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&s.bottom, b + 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+Fiber* WorkerGroup::take(size_t slot) noexcept
+{
+	zth_assert(slot < Config::WorkerGroupMaxSize);
+	Slot& s = m_slots[slot];
+
+	int64_t b = __atomic_load_n(&s.bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&s.bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t t = __atomic_load_n(&s.top, __ATOMIC_RELAXED);
+
+	if(t > b) {
+		// Empty.
+		__atomic_store_n(&s.bottom, b + 1, __ATOMIC_RELAXED);
+		return nullptr;
+	}
+
+	Fiber* fiber = __atomic_load_n(
+		&s.queue[(size_t)b & (Config::WorkerGroupQueueSize - 1U)], __ATOMIC_RELAXED);
+
+	if(t == b) {
+		// Last one. Race against thieves.
+		if(!__atomic_compare_exchange_n(
+			   &s.top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			fiber = nullptr;
+
+		__atomic_store_n(&s.bottom, b + 1, __ATOMIC_RELAXED);
+	}
+
+	return fiber;
+}
+
+Fiber* WorkerGroup::steal(size_t thief) noexcept
+{
+	zth_assert(thief < Config::WorkerGroupMaxSize);
+
+	for(size_t i = 1; i < Config::WorkerGroupMaxSize; i++) {
+		size_t victim = (thief + i) % Config::WorkerGroupMaxSize;
+		Slot& s = m_slots[victim];
+
+		int64_t t = __atomic_load_n(&s.top, __ATOMIC_ACQUIRE);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		int64_t b = __atomic_load_n(&s.bottom, __ATOMIC_ACQUIRE);
+
+		if(t >= b)
+			continue;
+
+		Fiber* fiber = __atomic_load_n(
+			&s.queue[(size_t)t & (Config::WorkerGroupQueueSize - 1U)],
+			__ATOMIC_RELAXED);
+
+		if(!__atomic_compare_exchange_n(
+			   &s.top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			// Lost the race with the owner or another thief.
+			continue;
+
+		__atomic_add_fetch(&m_steals, 1, __ATOMIC_RELAXED);
+		return fiber;
+	}
+
+	return nullptr;
+}
+
+bool WorkerGroup::empty(size_t slot) const noexcept
+{
+	zth_assert(slot < Config::WorkerGroupMaxSize);
+	Slot const& s = m_slots[slot];
+	return __atomic_load_n(&s.bottom, __ATOMIC_RELAXED)
+	       <= __atomic_load_n(&s.top, __ATOMIC_RELAXED);
+}
+
+/*!
+ * \brief Register that the Worker of the given slot is going to sleep till #wake().
+ * \return \c false when it should not sleep, as there is work to steal
+ */
+bool WorkerGroup::sleep(size_t slot) noexcept
+{
+	zth_assert(slot < Config::WorkerGroupMaxSize);
+
+	__atomic_or_fetch(&m_sleeping, (uint64_t)1 << slot, __ATOMIC_SEQ_CST);
+
+	// A fiber that was pushed before we set our bit, is not going to wake us. Check for it.
+	bool work = stopped();
+	for(size_t i = 0; !work && i < Config::WorkerGroupMaxSize; i++)
+		work = __atomic_load_n(&m_slots[i].worker, __ATOMIC_SEQ_CST) && !empty(i);
+
+	if(work)
+		awake(slot);
+
+	return !work;
+}
+
+/*!
+ * \brief Register that the Worker of the given slot does not sleep anymore.
+ */
+void WorkerGroup::awake(size_t slot) noexcept
+{
+	zth_assert(slot < Config::WorkerGroupMaxSize);
+	__atomic_and_fetch(&m_sleeping, ~((uint64_t)1 << slot), __ATOMIC_SEQ_CST);
+}
+
+/*!
+ * \brief Interrupt the sleep of up to \p count sleeping Workers.
+ * \param waker the slot of the calling Worker, which is skipped
+ */
+void WorkerGroup::wake(size_t waker, size_t count) noexcept
+{
+	uint64_t sleeping = __atomic_load_n(&m_sleeping, __ATOMIC_SEQ_CST);
+
+	for(size_t i = 0; sleeping && count && i < Config::WorkerGroupMaxSize; i++) {
+		uint64_t bit = (uint64_t)1 << i;
+		if(!(sleeping & bit) || i == waker)
+			continue;
+
+		// Claim the wakeup, such that the Worker is only interrupted once.
+		if(!(__atomic_fetch_and(&m_sleeping, ~bit, __ATOMIC_SEQ_CST) & bit))
+			continue;
+
+		// groupLeave() waits for us, such that the Worker cannot be destructed meanwhile.
+		Slot& s = m_slots[i];
+		__atomic_add_fetch(&s.waking, 1, __ATOMIC_SEQ_CST);
+		Worker* w = __atomic_load_n(&s.worker, __ATOMIC_SEQ_CST);
+		if(w)
+			w->waiter().interrupt();
+		__atomic_sub_fetch(&s.waking, 1, __ATOMIC_SEQ_CST);
+		count--;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////
+// Worker's group administration
+
+/*!
+ * \brief Hand shared fibers over to the group.
+ *
+ * This is postponed till the next #schedule(), such that the creator of the fiber had the
+ * chance to drop its references to it.
+ */
+void Worker::groupPublish() noexcept
+{
+	zth_assert(m_group);
+
+	size_t pushed = 0;
+	while(!m_sharedQueue.empty()) {
+		Fiber& fiber = m_sharedQueue.front();
+		m_sharedQueue.pop_front();
+
+		if(fiber.state() != Fiber::New || fiber.refs() != 1) {
+			// Someone else is still interested in this fiber. Keep it here.
+			add(&fiber);
+			continue;
+		}
+
+		// Once pushed, the fiber may be stolen, executed, and cleaned up by another
+		// Worker right away. So, do not touch it afterwards.
+		zth_dbg(worker, "[%s] Publish %s to %s", id_str(), fiber.id_str(),
+			m_group->id_str());
+		// The fiber may end up at another Worker; let it disappear from our trace.
+		zth_perf_event(fiber, Fiber::Uninitialized);
+
+		if(!m_group->push(m_groupSlot, fiber)) {
+			// Queue is full. Keep it here.
+			zth_perf_event(fiber, fiber.state());
+			add(&fiber);
+		} else {
+			pushed++;
+		}
+	}
+
+	if(pushed)
+		m_group->wake(m_groupSlot, pushed);
+}
+
+/*!
+ * \brief Add a new fiber that may have been created by another thread.
+ */
+void Worker::adopt(Fiber& fiber, bool foreign) noexcept
+{
+	zth_assert(fiber.state() == Fiber::New);
+
+	if(foreign) {
+		zth_dbg(worker, "[%s] Adopt %s", id_str(), fiber.id_str());
+		// Introduce the fiber to our trace.
+		zth_perf_event(fiber);
+	}
+
+	zth_perf_event(fiber, fiber.state());
+	add(&fiber);
+}
+
+void Worker::groupSchedule() noexcept
+{
+	zth_assert(m_group);
+
+	if(unlikely(!m_sharedQueue.empty()))
+		groupPublish();
+
+	if(likely(m_group->empty(m_groupSlot)))
+		return;
+
+	// Take back our own fibers when we are about to get out of work, or once in a while
+	// to make sure they run, even when there are no thieves around.
+	if(!m_runnableQueue.empty() && &m_runnableQueue.front() != &m_runnableQueue.back()
+	   && ++m_groupTick < Config::WorkerGroupOwnerInterval)
+		return;
+
+	m_groupTick = 0;
+
+	Fiber* fiber = m_group->take(m_groupSlot);
+	if(fiber)
+		adopt(*fiber, false);
+}
+
+bool Worker::groupTake() noexcept
+{
+	if(!m_group)
+		return false;
+
+	if(unlikely(!m_sharedQueue.empty()))
+		groupPublish();
+
+	Fiber* fiber = m_group->take(m_groupSlot);
+	if(fiber) {
+		adopt(*fiber, false);
+		return true;
+	}
+
+	fiber = m_group->steal(m_groupSlot);
+	if(fiber) {
+		adopt(*fiber, true);
+		return true;
+	}
+
+	return false;
+}
+
+/*!
+ * \brief Wait for work from the group.
+ * \return \c false when the group has stopped and there is nothing to do anymore
+ */
+bool Worker::groupIdle() noexcept
+{
+	zth_assert(m_group);
+
+	if(groupTake())
+		return true;
+
+	if(m_group->stopped())
+		return false;
+
+	// Sleep till another Worker publishes a fiber, or the group is stopped.
+	m_waiter.idle(TimeInterval(Config::WorkerGroupIdlePoll()));
+	return true;
+}
+
+/*!
+ * \brief Register that the Waiter is going to sleep, until the group wakes it up.
+ * \return \c false when it should not sleep, as there is work to steal
+ */
+bool Worker::groupSleepBegin() noexcept
+{
+	zth_assert(m_group);
+	return m_group->sleep(m_groupSlot);
+}
+
+/*!
+ * \brief Cleanup after #groupSleepBegin().
+ */
+void Worker::groupSleepEnd() noexcept
+{
+	zth_assert(m_group);
+	m_group->awake(m_groupSlot);
+}
+
+void Worker::groupLeave() noexcept
+{
+	zth_assert(m_group);
+
+	while(!m_sharedQueue.empty()) {
+		Fiber& fiber = m_sharedQueue.front();
+		m_sharedQueue.pop_front();
+		add(&fiber);
+	}
+
+	Fiber* fiber = nullptr;
+	while((fiber = m_group->take(m_groupSlot)))
+		adopt(*fiber, false);
+
+	WorkerGroup* group = m_group;
+	zth_dbg(worker, "[%s] %s left", group->id_str(), id_str());
+
+	m_group = nullptr;
+	group->awake(m_groupSlot);
+	WorkerGroup::Slot& slot = group->m_slots[m_groupSlot];
+	__atomic_store_n(&slot.worker, nullptr, __ATOMIC_SEQ_CST);
+
+	// Another Worker may just be interrupting our sleep. Wait till it is done with us.
+	while(__atomic_load_n(&slot.waking, __ATOMIC_SEQ_CST))
+		;
+
+	// Do not touch the group afterwards, as it may be destructed right away.
+	__atomic_sub_fetch(&group->m_size, 1, __ATOMIC_RELEASE);
+}
+
+
+
+////////////////////////////////////////////////////////////
+// wait_on()
+
+/*!
+ * \brief Release the wait queues of #zth::wait_on() of a Worker that is destructed.
+ */
+void wait_on_deinit(WaitOnTable* table) noexcept
+{
+	delete table;
+}
+
+
+
+////////////////////////////////////////////////////////////
+// Worker's inbox
+
+int Worker::inboxPush(InboxItem* item) noexcept
+{
+	item->next = __atomic_load_n(&m_inbox, __ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(
+		&m_inbox, &item->next, item, true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		;
+
+	if(!item->next)
+		// First item in the inbox. The Worker may be sleeping.
+		m_waiter.interrupt();
+
+	return 0;
+}
+
+/*!
+ * \brief Post a new fiber to this Worker.
+ *
+ * This function is thread-safe; any thread can call it, even threads without a Worker.  The
+ * fiber must be #zth::Fiber::New and it must not have been passed to any Worker yet, so create
+ * it using \c new \c zth::Fiber(...).  The Worker takes ownership of the fiber.
+ *
+ * When the Worker is sleeping, it is woken up.  However, the very first post to a Worker that
+ * is neither kept alive nor in a #zth::WorkerGroup may have to wait till its current sleep
+ * ends.  The fiber is dropped when the Worker is destructed before it got the chance to
+ * process it.
+ *
+ * \return 0 on success, otherwise an errno
+ */
+int Worker::post(Fiber& fiber) noexcept
+{
+	zth_assert(fiber.state() == Fiber::New);
+
+	InboxItem* item = nullptr;
+	try {
+		item = new InboxItem();
+	} catch(...) {
+		return ENOMEM;
+	}
+
+	item->fiber = &fiber;
+	return inboxPush(item);
+}
+
+/*!
+ * \brief Post a callback to this Worker.
+ *
+ * This function is thread-safe; any thread can call it.  The callback is executed by the
+ * Worker, within the context of whatever fiber happens to be running. Therefore, it should
+ * be short and it must not block or yield.  Create a fiber using #post(Fiber&) otherwise.
+ *
+ * When the Worker is sleeping, it is woken up, with the same exception for the first post as
+ * #post(Fiber&).  The callback is dropped when the Worker is destructed before it got the
+ * chance to process it.
+ *
+ * \return 0 on success, otherwise an errno
+ */
+int Worker::post(void (*f)(void*), void* arg) noexcept
+{
+	zth_assert(f);
+
+	InboxItem* item = nullptr;
+	try {
+		item = new InboxItem();
+	} catch(...) {
+		return ENOMEM;
+	}
+
+	item->f = f;
+	item->arg = arg;
+	return inboxPush(item);
+}
+
+/*!
+ * \brief Post a fiber or callback to this Worker, without allocating memory.
+ *
+ * This is like #post(Fiber&) or #post(void(*)(void*),void*), but the caller provides the
+ * memory of the item, so it cannot fail.  Set either \c fiber, or \c f and \c arg.  The
+ * item must stay valid until the Worker processed it; the Worker does not touch it anymore
+ * after calling \c f, or adopting the \c fiber.
+ */
+void Worker::post(InboxItem& item) noexcept
+{
+	zth_assert(!item.fiber != !item.f);
+	item.external = true;
+	inboxPush(&item);
+}
+
+/*!
+ * \brief Process all items that were posted to this Worker.
+ * \param process when \c false, the items are dropped instead
+ */
+void Worker::inboxDrain(bool process) noexcept
+{
+	InboxItem* item = __atomic_exchange_n(&m_inbox, nullptr, __ATOMIC_ACQUIRE);
+
+	// The inbox is a stack. Reverse it to process the items in order of posting.
+	InboxItem* fifo = nullptr;
+	while(item) {
+		InboxItem* next = item->next;
+		item->next = fifo;
+		fifo = item;
+		item = next;
+	}
+
+	m_inboxDraining = true;
+
+	while(fifo) {
+		item = fifo;
+		fifo = item->next;
+
+		// The item may be gone once processed.
+		InboxItem* owned = item->external ? nullptr : item;
+
+		if(item->fiber) {
+			item->fiber->used();
+			// When not processing, the destructor cleans up the fiber.
+			adopt(*item->fiber, true);
+		} else if(process) {
+			zth_dbg(worker, "[%s] Run posted callback", id_str());
+			item->f(item->arg);
+		} else {
+			zth_dbg(worker, "[%s] Drop posted callback", id_str());
+		}
+
+		delete owned;
+	}
+
+	m_inboxDraining = false;
+
+	if(process && m_currentFiber && !m_runnableQueue.empty()
+	   && &m_runnableQueue.front() == m_currentFiber)
+		// Let the posted work go first, even if it was added at the back of the queue.
+		m_runnableQueue.rotate(*m_currentFiber);
+}
+
 /*!
  * \brief Start an external program.
  * \ingroup zth_api_cpp_fiber
@@ -129,22 +974,6 @@ int execlp(char const* file, char const* arg, ... /*, nullptr */)
 	return res;
 }
 
-__attribute__((unused)) static cow_string thread_id_str() noexcept
-{
-	Worker const* w = Worker::instance();
-	if(w)
-		return w->id_str();
-
-	return format(
-		"pid %u",
-#ifdef ZTH_OS_WINDOWS
-		(unsigned int)_getpid()
-#else
-		(unsigned int)getpid()
-#endif
-	);
-}
-
 /*!
  * \brief Start an external program.
  * \ingroup zth_api_cpp_fiber
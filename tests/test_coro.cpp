@@ -99,6 +99,27 @@ TEST(Coro, Mailbox)
 	EXPECT_THROW(c().run(), std::runtime_error);
 }
 
+TEST(Coro, Channel)
+{
+	zth::Channel<int, 2> ch;
+
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-capturing-lambda-coroutines)
+	auto c = [&]() -> zth::coro::task<int> {
+		int sum = 0;
+		while(auto v = co_await ch)
+			sum += *v;
+		co_return sum;
+	};
+
+	zth::fiber([&]() {
+		for(int i = 1; i <= 10; i++)
+			ch.put(i);
+		ch.close();
+	});
+
+	EXPECT_EQ(c().run(), 55);
+}
+
 TEST(Coro, Gate)
 {
 	zth::Gate g{2};
@@ -7,7 +7,10 @@
 #include <zth>
 
 #include <gtest/gtest.h>
+#include <fcntl.h>
+#include <sys/socket.h>
 #include <unistd.h>
+#include <vector>
 
 // NOLINTNEXTLINE(misc-unused-using-decls)
 using zth::operator""_ms;
@@ -96,8 +99,275 @@ TEST(Poller, FiberedPipeRead)
 
 	close(pipefd[0]);
 }
+
+TEST(Poller, IoReady)
+{
+	int pipefd[]{-1, -1};
+	ASSERT_EQ(pipe(pipefd), 0);
+
+	// Data and buffer space are available, so no polling is required.
+	char buf = 0;
+	EXPECT_EQ(zth::io::write(pipefd[1], "4", 1), 1);
+	EXPECT_EQ(zth::io::read(pipefd[0], &buf, 1), 1);
+	EXPECT_EQ(buf, '4');
+
+	// Non-blocking fds still return EAGAIN.
+	ASSERT_EQ(fcntl(pipefd[0], F_SETFL, fcntl(pipefd[0], F_GETFL) | O_NONBLOCK), 0);
+	EXPECT_EQ(zth::io::read(pipefd[0], &buf, 1), -1);
+	EXPECT_EQ(errno, EAGAIN);
+
+	close(pipefd[0]);
+	close(pipefd[1]);
+
+	// Regular files may not support non-blocking reads and writes.
+	FILE* f = tmpfile();
+	ASSERT_NE(f, nullptr);
+	for(int i = 0; i < 2; i++)
+		EXPECT_EQ(zth::io::write(fileno(f), "5", 1), 1);
+	ASSERT_EQ(lseek(fileno(f), 0, SEEK_SET), 0);
+	EXPECT_EQ(zth::io::read(fileno(f), &buf, 1), 1);
+	EXPECT_EQ(buf, '5');
+	fclose(f);
+
+	// Same for sockets.
+	int sv[]{-1, -1};
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+	EXPECT_EQ(zth::io::send(sv[1], "6", 1, 0), 1);
+	EXPECT_EQ(zth::io::recv(sv[0], &buf, 1, 0), 1);
+	EXPECT_EQ(buf, '6');
+
+	ASSERT_EQ(fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK), 0);
+	EXPECT_EQ(zth::io::recv(sv[0], &buf, 1, 0), -1);
+	EXPECT_EQ(errno, EAGAIN);
+
+	close(sv[0]);
+	close(sv[1]);
+}
+
+static void read_all_fiber(int fd, size_t* count)
+{
+	char buf[4096];
+	ssize_t res = 0;
+	while((res = zth::io::read(fd, buf, sizeof(buf))) > 0)
+		*count += (size_t)res;
+}
+
+TEST(Poller, IoWriteAll)
+{
+	int pipefd[]{-1, -1};
+	ASSERT_EQ(pipe(pipefd), 0);
+
+	size_t count = 0;
+	zth::Gate gate(2);
+	zth::fiber(read_all_fiber, pipefd[0], &count) << zth::passOnExit(gate);
+
+	// More than fits in the pipe, so the optimistic write is partial.  A blocking fd must
+	// still get all of it written.
+	std::vector<char> data(1 << 20, 'x');
+	EXPECT_EQ(zth::io::write(pipefd[1], data.data(), data.size()), (ssize_t)data.size());
+	close(pipefd[1]);
+
+	gate.wait();
+	EXPECT_EQ(count, data.size());
+	close(pipefd[0]);
+}
 #endif // Linux or Mac
 
+#ifdef ZTH_HAVE_EPOLL
+TEST(Poller, EpollShared)
+{
+	int pipefd[]{-1, -1};
+	ASSERT_EQ(pipe(pipefd), 0);
+
+	zth::EpollPoller s;
+	zth::PollableFd r1(pipefd[0], zth::Pollable::PollIn);
+	zth::PollableFd r2(pipefd[0], zth::Pollable::PollIn);
+	zth::PollableFd w(pipefd[1], zth::Pollable::PollOut);
+
+	EXPECT_EQ(s.add(r1), 0);
+	EXPECT_EQ(s.add(r2), 0);
+	EXPECT_EQ(s.add(w), 0);
+	EXPECT_EQ(s.size(), 3U);
+
+	EXPECT_EQ(s.poll(0), 0);
+	EXPECT_TRUE(r1.revents.none());
+	EXPECT_TRUE(r2.revents.none());
+	EXPECT_TRUE(w.revents.test(zth::Pollable::PollOutIndex));
+
+	ASSERT_EQ(write(pipefd[1], "1", 1), 1);
+	EXPECT_EQ(s.poll(0), 0);
+	EXPECT_TRUE(r1.revents.test(zth::Pollable::PollInIndex));
+	EXPECT_TRUE(r2.revents.test(zth::Pollable::PollInIndex));
+
+	EXPECT_EQ(s.remove(r1), 0);
+	EXPECT_EQ(s.remove(r1), ESRCH);
+	r2.revents.reset();
+	EXPECT_EQ(s.poll(0), 0);
+	EXPECT_TRUE(r2.revents.test(zth::Pollable::PollInIndex));
+
+	EXPECT_EQ(s.remove(r2), 0);
+	EXPECT_EQ(s.remove(w), 0);
+	EXPECT_TRUE(s.empty());
+
+	close(pipefd[0]);
+	close(pipefd[1]);
+}
+
+TEST(Poller, EpollRegularFile)
+{
+	FILE* f = tmpfile();
+	ASSERT_NE(f, nullptr);
+
+	// epoll does not support regular files, but poll() says they are always ready.
+	zth::EpollPoller s;
+	zth::PollableFd r(fileno(f), zth::Pollable::PollIn);
+	EXPECT_EQ(s.add(r), 0);
+	EXPECT_EQ(s.poll(-1), 0);
+	EXPECT_TRUE(r.revents.test(zth::Pollable::PollInIndex));
+	EXPECT_EQ(s.remove(r), 0);
+
+	fclose(f);
+}
+#endif // ZTH_HAVE_EPOLL
+
+#ifdef ZTH_HAVE_IO_URING
+TEST(Poller, Uring)
+{
+	zth::UringPoller u;
+	if(!u.valid())
+		GTEST_SKIP() << "io_uring not supported";
+
+	zth::Waiter& waiter = zth::currentWorker().waiter();
+	waiter.setPoller(&u);
+	EXPECT_EQ(waiter.poller().uring(), &u);
+
+	// zth::io now goes via the ring.
+	int pipefd[]{-1, -1};
+	ASSERT_EQ(pipe(pipefd), 0);
+	zth::fiber(write_fiber, pipefd[1]);
+
+	char buf = 0;
+	EXPECT_EQ(zth::io::read(pipefd[0], &buf, 1), 1);
+	EXPECT_EQ(buf, '3');
+
+	close(pipefd[0]);
+
+	// As does polling.
+	ASSERT_EQ(pipe(pipefd), 0);
+	EXPECT_EQ(zth::poll(zth::PollableFd(pipefd[0], zth::Pollable::PollIn), 0), EAGAIN);
+	EXPECT_EQ(zth::poll(zth::PollableFd(pipefd[0], zth::Pollable::PollIn), 100), EAGAIN);
+	ASSERT_EQ(write(pipefd[1], "1", 1), 1);
+	EXPECT_EQ(zth::poll(zth::PollableFd(pipefd[0], zth::Pollable::PollIn), -1), 0);
+	close(pipefd[0]);
+	close(pipefd[1]);
+
+	int sv[]{-1, -1};
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+	EXPECT_EQ(zth::io::send(sv[0], "45", 2, 0), 2);
+	char sbuf[2] = {};
+	EXPECT_EQ(zth::io::recv(sv[1], sbuf, sizeof(sbuf), MSG_WAITALL), 2);
+	EXPECT_EQ(sbuf[0], '4');
+	EXPECT_EQ(sbuf[1], '5');
+	close(sv[0]);
+	close(sv[1]);
+
+	waiter.setPoller();
+	EXPECT_NE(waiter.poller().uring(), &u);
+	EXPECT_TRUE(u.empty());
+}
+#endif // ZTH_HAVE_IO_URING
+
+#if defined(ZTH_HAVE_POLLER) && defined(ZTH_OS_LINUX)
+static void testPreciseTimeout(zth::PollerServerBase& s)
+{
+	int pipefd[]{-1, -1};
+	ASSERT_EQ(pipe(pipefd), 0);
+
+	zth::PollableFd r(pipefd[0], zth::Pollable::PollIn);
+	ASSERT_EQ(s.add(r), 0);
+
+	zth::TimeInterval const timeout(0, 300000L);
+	zth::TimeInterval fastest = zth::TimeInterval::infinity();
+
+	for(int i = 0; i < 10; i++) {
+		zth::Timestamp start = zth::Timestamp::now();
+		int res = s.poll(timeout);
+		zth::TimeInterval dt = zth::Timestamp::now() - start;
+
+		if(res == EINTR)
+			// Interrupted by a signal, which may be early.
+			continue;
+
+		EXPECT_EQ(res, 0);
+		EXPECT_FALSE(dt < timeout);
+		if(dt < fastest)
+			fastest = dt;
+	}
+
+	// When rounded to milliseconds, it would never be faster than that.
+	EXPECT_LT(fastest, zth::TimeInterval(0, 1000000L));
+	EXPECT_TRUE(r.revents.none());
+
+	EXPECT_EQ(s.remove(r), 0);
+	close(pipefd[0]);
+	close(pipefd[1]);
+}
+
+#  ifndef ZTH_HAVE_LIBZMQ
+TEST(Poller, PollPreciseTimeout)
+{
+	zth::PollPoller s;
+	testPreciseTimeout(s);
+}
+#  endif
+
+#  ifdef ZTH_HAVE_EPOLL
+TEST(Poller, EpollPreciseTimeout)
+{
+	zth::EpollPoller s;
+	testPreciseTimeout(s);
+}
+#  endif
+
+#  ifdef ZTH_HAVE_IO_URING
+TEST(Poller, UringPreciseTimeout)
+{
+	zth::UringPoller s;
+	if(!s.valid())
+		GTEST_SKIP() << "io_uring is not supported";
+
+	testPreciseTimeout(s);
+}
+#  endif
+
+static void nap_read_fiber(int fd)
+{
+	char buf = 0;
+	zth::io::read(fd, &buf, 1);
+}
+
+TEST(Poller, NapWhilePolling)
+{
+	int pipefd[]{-1, -1};
+	ASSERT_EQ(pipe(pipefd), 0);
+
+	// Let the Waiter poll while napping.
+	zth::fiber(nap_read_fiber, pipefd[0]);
+	zth::yield(nullptr, true);
+
+	zth::TimeInterval const timeout(0, 300000L);
+	for(int i = 0; i < 10; i++) {
+		zth::Timestamp start = zth::Timestamp::now();
+		zth::nap(timeout);
+		EXPECT_FALSE(zth::Timestamp::now() - start < timeout);
+	}
+
+	close(pipefd[1]);
+	zth::mnap(10);
+	close(pipefd[0]);
+}
+#endif // Linux
+
 #if defined(ZTH_HAVE_POLLER) && defined(ZTH_HAVE_LIBZMQ)
 static void zmq_fiber()
 {
@@ -8,6 +8,10 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+#include <thread>
+#include <vector>
+
 TEST(Sync, Mutex)
 {
 	zth::Mutex m;
@@ -22,6 +26,87 @@ TEST(Sync, Mutex)
 	*f;
 }
 
+TEST(Sync, MutexPriorityInheritance)
+{
+	unsigned int const prio = zth::Config::DefaultPriority;
+	if(!zth::Config::PriorityInheritance || prio < 3)
+		GTEST_SKIP() << "not enough priority levels";
+
+	zth::Mutex m;
+	zth::Gate gate(4);
+	std::string order;
+	bool trying = false;
+	bool done = false;
+
+	zth::fiber([&]() {
+		m.lock();
+		order += 'l';
+		while(!trying)
+			zth::outOfWork();
+
+		// Without inheritance, the medium-priority fiber would never let us get here.
+		EXPECT_EQ(zth::currentFiber().effectivePriority(), prio - 1);
+		m.unlock();
+		EXPECT_EQ(zth::currentFiber().effectivePriority(), prio - 3);
+	}) << zth::setPriority(prio - 3) << zth::passOnExit(gate);
+
+	// Let the low-priority fiber take the lock.
+	for(int i = 0; i < 1000 && order.empty(); i++)
+		zth::mnap(1);
+	EXPECT_EQ(order, "l");
+
+	zth::fiber([&]() {
+		while(!done)
+			zth::outOfWork();
+	}) << zth::setPriority(prio - 2) << zth::passOnExit(gate);
+
+	zth::fiber([&]() {
+		trying = true;
+		m.lock();
+		order += 'h';
+		m.unlock();
+		done = true;
+	}) << zth::setPriority(prio - 1) << zth::passOnExit(gate);
+
+	gate.wait();
+	EXPECT_TRUE(done);
+	EXPECT_EQ(order, "lh");
+}
+
+TEST(Sync, MutexPriorityWakeup)
+{
+	unsigned int const prio = zth::Config::DefaultPriority;
+	if(!zth::Config::PriorityInheritance || prio < 3)
+		GTEST_SKIP() << "not enough priority levels";
+
+	zth::Mutex m;
+	zth::Gate gate(4);
+	std::string order;
+	int waiting = 0;
+
+	m.lock();
+
+	char const ids[] = "abc";
+	unsigned int const prios[] = {prio - 3, prio - 1, prio - 2};
+	for(int i = 0; i < 3; i++) {
+		char id = ids[i];
+		zth::fiber([&, id]() {
+			waiting++;
+			zth::Locked l{m};
+			order += id;
+		}) << zth::setPriority(prios[i]) << zth::passOnExit(gate);
+	}
+
+	// Let the lower-priority fibers block on the mutex.
+	for(int i = 0; i < 1000 && waiting < 3; i++)
+		zth::mnap(1);
+	EXPECT_EQ(waiting, 3);
+
+	m.unlock();
+	gate.wait();
+	EXPECT_EQ(order, "bca");
+}
+
 TEST(Sync, Mutex_C)
 {
 	zth_mutex_t mutex{};
@@ -41,6 +126,212 @@ TEST(Sync, Mutex_C)
 	EXPECT_EQ(zth_mutex_destroy(&mutex), 0);
 }
 
+TEST(Sync, LightMutex)
+{
+	zth::LightMutex m;
+	EXPECT_EQ(sizeof(m), sizeof(unsigned int));
+
+	m.lock();
+	EXPECT_TRUE(m.locked());
+	EXPECT_FALSE(m.trylock());
+
+	int count = 0;
+	int inside = 0;
+	zth::Gate gate(4);
+	for(int i = 0; i < 3; i++)
+		zth::fiber([&]() {
+			for(int j = 0; j < 10; j++) {
+				m.lock();
+				EXPECT_EQ(inside++, 0);
+				zth::yield(nullptr, true);
+				count++;
+				inside--;
+				m.unlock();
+			}
+		}) << zth::passOnExit(gate);
+
+	zth::yield(nullptr, true);
+	EXPECT_EQ(count, 0);
+	m.unlock();
+	gate.wait();
+
+	EXPECT_EQ(count, 30);
+	EXPECT_FALSE(m.locked());
+	EXPECT_TRUE(m.trylock());
+	m.unlock();
+}
+
+TEST(Sync, WaitOn)
+{
+	unsigned int flag = 0;
+	EXPECT_EQ(zth::wait_on(&flag, 1), EAGAIN);
+	EXPECT_EQ(zth::wait_on(&flag, 0, zth::TimeInterval(0.001)), ETIMEDOUT);
+	EXPECT_FALSE(zth::notify_one(&flag));
+
+	// Waiters of another address, which may share the bucket, are not woken.
+	unsigned int other = 0;
+	int waiting = 0;
+	int woken = 0;
+	zth::Gate gate(5);
+	for(int i = 0; i < 3; i++)
+		zth::fiber([&]() {
+			while(flag == 0) {
+				waiting++;
+				zth::wait_on(&flag, 0);
+			}
+			woken++;
+		}) << zth::passOnExit(gate);
+
+	zth::fiber([&]() {
+		waiting++;
+		EXPECT_EQ(zth::wait_on(&other, 0), 0);
+	}) << zth::passOnExit(gate);
+
+	while(waiting < 4)
+		zth::yield(nullptr, true);
+
+	// Spurious wakeup: the flag did not change, so the fiber waits again.
+	EXPECT_TRUE(zth::notify_one(&flag));
+	while(waiting < 5)
+		zth::yield(nullptr, true);
+	EXPECT_EQ(woken, 0);
+
+	flag = 1;
+	EXPECT_EQ(zth::notify_all(&flag), 3U);
+	EXPECT_EQ(zth::notify_all(&other), 1U);
+	gate.wait();
+	EXPECT_EQ(woken, 3);
+}
+
+TEST(Sync, SharedMutex)
+{
+	zth::SharedMutex m;
+	m.lock_shared();
+	EXPECT_TRUE(m.trylock_shared());
+	EXPECT_EQ(m.readers(), 2U);
+	EXPECT_FALSE(m.trylock());
+	m.unlock_shared();
+	m.unlock_shared();
+	EXPECT_FALSE(m.locked());
+
+	// All readers that wait for the writer get the lock at once.
+	m.lock();
+	int waiting = 0;
+	int reading = 0;
+	zth::Gate gate(4);
+	for(int i = 0; i < 3; i++)
+		zth::fiber([&]() {
+			waiting++;
+			zth::SharedLocked l{m};
+			reading++;
+			while(reading < 3)
+				zth::yield(nullptr, true);
+		}) << zth::passOnExit(gate);
+
+	while(waiting < 3)
+		zth::yield(nullptr, true);
+
+	EXPECT_EQ(reading, 0);
+	m.unlock();
+	EXPECT_EQ(m.readers(), 3U);
+	EXPECT_FALSE(m.trylock());
+	gate.wait();
+	EXPECT_EQ(reading, 3);
+
+	{
+		zth::UniqueLocked l{m};
+		EXPECT_TRUE(m.locked());
+		EXPECT_EQ(m.readers(), 0U);
+	}
+	EXPECT_FALSE(m.locked());
+}
+
+TEST(Sync, SharedMutexPolicy)
+{
+	zth::SharedMutex m;
+	EXPECT_EQ(m.policy(), zth::SharedMutex::PreferWriters);
+	m.lock_shared();
+
+	bool waiting = false;
+	bool writing = false;
+	zth::Gate gate(2);
+	zth::fiber([&]() {
+		waiting = true;
+		zth::UniqueLocked l{m};
+		writing = true;
+	}) << zth::passOnExit(gate);
+
+	while(!waiting)
+		zth::yield(nullptr, true);
+
+	// A writer is waiting, so readers have to wait too.
+	EXPECT_FALSE(m.trylock_shared());
+
+	m.setPolicy(zth::SharedMutex::PreferReaders);
+	EXPECT_TRUE(m.trylock_shared());
+	m.unlock_shared();
+	EXPECT_FALSE(writing);
+
+	// The last reader passes the lock to the writer.
+	m.unlock_shared();
+	gate.wait();
+	EXPECT_TRUE(writing);
+	EXPECT_FALSE(m.locked());
+}
+
+TEST(Sync, SharedMutexTimeout)
+{
+	zth::SharedMutex m;
+	m.lock_shared();
+	EXPECT_FALSE(m.trylock(zth::TimeInterval(0.001)));
+	EXPECT_TRUE(m.trylock_shared(zth::TimeInterval(0.001)));
+	m.unlock_shared();
+
+	bool trying = false;
+	zth::Gate gate(2);
+	zth::fiber([&]() {
+		trying = true;
+		EXPECT_FALSE(m.trylock(zth::TimeInterval(0.05)));
+	}) << zth::passOnExit(gate);
+
+	while(!trying)
+		zth::yield(nullptr, true);
+
+	EXPECT_FALSE(m.trylock_shared());
+
+	// We wait for the writer, which waits for us. When it gives up, we get the lock.
+	m.lock_shared();
+	EXPECT_EQ(m.readers(), 2U);
+	m.unlock_shared();
+	m.unlock_shared();
+	gate.wait();
+	EXPECT_FALSE(m.locked());
+}
+
+TEST(Sync, SharedMutex_C)
+{
+	zth_rwlock_t rw{};
+	struct timespec ts = {0, 1000000};
+	EXPECT_EQ(zth_rwlock_init(&rw), 0);
+
+	EXPECT_EQ(zth_rwlock_rdlock(&rw), 0);
+	EXPECT_EQ(zth_rwlock_tryrdlock(&rw), 0);
+	EXPECT_EQ(zth_rwlock_trywrlock(&rw), EBUSY);
+	EXPECT_EQ(zth_rwlock_timedwrlock(&rw, &ts), ETIMEDOUT);
+	EXPECT_EQ(zth_rwlock_unlock(&rw), 0);
+	EXPECT_EQ(zth_rwlock_unlock(&rw), 0);
+	EXPECT_EQ(zth_rwlock_unlock(&rw), EPERM);
+
+	EXPECT_EQ(zth_rwlock_wrlock(&rw), 0);
+	EXPECT_EQ(zth_rwlock_tryrdlock(&rw), EBUSY);
+	EXPECT_EQ(zth_rwlock_timedrdlock(&rw, &ts), ETIMEDOUT);
+	EXPECT_EQ(zth_rwlock_unlock(&rw), 0);
+	EXPECT_EQ(zth_rwlock_timedwrlock(&rw, &ts), 0);
+	EXPECT_EQ(zth_rwlock_unlock(&rw), 0);
+
+	EXPECT_EQ(zth_rwlock_destroy(&rw), 0);
+}
+
 TEST(Sync, Semaphore)
 {
 	zth::Semaphore s;
@@ -75,6 +366,36 @@ TEST(Sync, Semaphore)
 	done.acquire(10);
 }
 
+TEST(Sync, SemaphoreTimeout)
+{
+	zth::Semaphore s;
+	EXPECT_FALSE(s.acquire(1, zth::TimeInterval(0.001)));
+
+	// Many waiters time out, while some of them get a unit.
+	static int const waiters = 100;
+	int acquired = 0;
+	int timedOut = 0;
+	zth::Gate gate(waiters + 1);
+	for(int i = 0; i < waiters; i++)
+		zth::fiber([&]() {
+			if(s.acquire(1, zth::TimeInterval(0.2)))
+				acquired++;
+			else
+				timedOut++;
+		}) << zth::passOnExit(gate);
+
+	zth::yield(nullptr, true);
+	s.release(3);
+	gate.wait();
+
+	EXPECT_EQ(acquired, 3);
+	EXPECT_EQ(timedOut, waiters - 3);
+	EXPECT_EQ(s.value(), 0U);
+
+	s.release(1);
+	EXPECT_TRUE(s.acquire(1, zth::TimeInterval(0.001)));
+}
+
 TEST(Sync, Semaphore_C)
 {
 	zth_sem_t a{};
@@ -203,3 +524,327 @@ TEST(Sync, Mailbox_C)
 
 	EXPECT_EQ(zth_mailbox_destroy(&mb), 0);
 }
+
+TEST(Sync, Handoff)
+{
+	zth::Mailbox<int> mb;
+	mb.setHandoff();
+
+	bool started = false;
+	int got = 0;
+	zth::Gate gate(2);
+	zth::fiber([&]() {
+		started = true;
+		got = mb.take();
+	}) << zth::passOnExit(gate);
+
+	while(!started)
+		zth::yield(nullptr, true);
+
+	// The consumer is blocked now, and runs before put() returns.
+	mb.put(42);
+	EXPECT_EQ(got, 42);
+	gate.wait();
+}
+
+TEST(Sync, HandoffLimit)
+{
+	// A chain of fibers, which wake each other in handoff mode.
+	static int const stages = (int)zth::Config::HandoffLimit * 2;
+	zth::Signal s[stages];
+	int reached = 0;
+	int seen = -1;
+	bool started = false;
+	zth::Gate gate(stages + 2);
+
+	for(int i = 0; i < stages; i++) {
+		s[i].setHandoff();
+		zth::fiber([&, i]() {
+			s[i].wait();
+			reached = i + 1;
+			if(i + 1 < stages)
+				s[i + 1].signal();
+		}) << zth::passOnExit(gate);
+	}
+
+	zth::fiber([&]() {
+		started = true;
+		while(reached == 0)
+			zth::yield(nullptr, true);
+		seen = reached;
+	}) << zth::passOnExit(gate);
+
+	while(!started)
+		zth::yield(nullptr, true);
+
+	s[0].signal();
+	gate.wait();
+
+	// The bystander got a turn before the chain completed.
+	EXPECT_EQ(reached, stages);
+	EXPECT_GT(seen, 0);
+	EXPECT_LT(seen, stages);
+}
+
+TEST(Sync, Channel)
+{
+	zth::Channel<int, 4> ch;
+	EXPECT_EQ(ch.capacity(), 4U);
+	EXPECT_TRUE(ch.empty());
+
+	// Wrap around the ring buffer a few times.
+	int v = 0;
+	for(int i = 0; i < 10; i++) {
+		EXPECT_TRUE(ch.put(i));
+		EXPECT_TRUE(ch.put(i + 100));
+		EXPECT_TRUE(ch.take(v));
+		EXPECT_EQ(v, i);
+		EXPECT_TRUE(ch.take(v));
+		EXPECT_EQ(v, i + 100);
+	}
+
+	for(int i = 0; i < 4; i++)
+		EXPECT_TRUE(ch.try_put(i));
+	EXPECT_TRUE(ch.full());
+	EXPECT_FALSE(ch.try_put(4));
+	EXPECT_FALSE(ch.try_put(4, zth::TimeInterval(0.001)));
+
+	for(int i = 0; i < 4; i++) {
+		EXPECT_TRUE(ch.try_take(v));
+		EXPECT_EQ(v, i);
+	}
+	EXPECT_FALSE(ch.try_take(v));
+	EXPECT_FALSE(ch.try_take(v, zth::TimeInterval(0.001)));
+
+	// Blocking producer.
+	zth::Gate gate(2);
+	zth::fiber([&]() {
+		for(int i = 0; i < 100; i++)
+			ch.put(i);
+	}) << zth::passOnExit(gate);
+
+	for(int i = 0; i < 100; i++) {
+		EXPECT_TRUE(ch.take(v));
+		EXPECT_EQ(v, i);
+	}
+
+	gate.wait();
+	EXPECT_TRUE(ch.empty());
+}
+
+TEST(Sync, ChannelBatch)
+{
+	zth::Channel<int, 16> ch;
+
+	int in[100];
+	for(int i = 0; i < 100; i++)
+		in[i] = i;
+
+	size_t put = 0;
+	zth::Gate gate(2);
+	zth::fiber([&]() {
+		put = ch.put_n(in, 100);
+		ch.close();
+	}) << zth::passOnExit(gate);
+
+	int out[100] = {};
+	size_t taken = 0;
+	size_t n = 0;
+	while((n = ch.take_up_to(&out[taken], 7)) > 0) {
+		EXPECT_LE(n, 7U);
+		taken += n;
+	}
+
+	gate.wait();
+	EXPECT_EQ(put, 100U);
+	EXPECT_EQ(taken, 100U);
+	for(int i = 0; i < 100; i++)
+		EXPECT_EQ(out[i], i);
+
+	// Closed: putting fails, taking is done.
+	EXPECT_TRUE(ch.closed());
+	EXPECT_FALSE(ch.put(1));
+	EXPECT_EQ(ch.put_n(in, 10), 0U);
+	EXPECT_EQ(ch.take_up_to(out, 10), 0U);
+}
+
+TEST(Sync, ChannelClose)
+{
+	zth::Channel<int, 8> ch;
+
+	// Fan-out: all consumers stop after close(), and together they get all values.
+	int const consumers = 3;
+	int sum[consumers] = {};
+	zth::Gate gate(consumers + 1);
+	for(int c = 0; c < consumers; c++)
+		zth::fiber([&, c]() {
+			int v = 0;
+			while(ch.take(v))
+				sum[c] += v;
+		}) << zth::passOnExit(gate);
+
+	for(int i = 1; i <= 100; i++)
+		EXPECT_TRUE(ch.put(i));
+
+	ch.close();
+	gate.wait();
+
+	EXPECT_EQ(sum[0] + sum[1] + sum[2], 5050);
+
+	// A blocked producer is released by close().
+	zth::Channel<int, 1> full;
+	EXPECT_TRUE(full.put(1));
+	bool res = true;
+	zth::Gate gate2(2);
+	zth::fiber([&]() { res = full.put(2); }) << zth::passOnExit(gate2);
+	zth::yield();
+	full.close();
+	gate2.wait();
+	EXPECT_FALSE(res);
+
+	// Values put before close() can still be taken.
+	int v = 0;
+	EXPECT_TRUE(full.take(v));
+	EXPECT_EQ(v, 1);
+	EXPECT_FALSE(full.take(v));
+}
+
+TEST(Sync, Channel_C)
+{
+	zth_channel_t ch{};
+	EXPECT_EQ(zth_channel_init(&ch), 0);
+	EXPECT_EQ(zth_channel_can_take(&ch), EAGAIN);
+	EXPECT_EQ(zth_channel_can_put(&ch), 0);
+
+	zth::fiber([&]() {
+		uintptr_t values[200];
+		for(int i = 0; i < 200; i++)
+			values[i] = (uintptr_t)i;
+
+		size_t done = 0;
+		EXPECT_EQ(zth_channel_put_n(&ch, values, 200, &done), 0);
+		EXPECT_EQ(done, 200U);
+		EXPECT_EQ(zth_channel_put(&ch, 200), 0);
+		zth_channel_close(&ch);
+	});
+
+	uintptr_t values[32];
+	uintptr_t expected = 0;
+	size_t done = 0;
+	while(zth_channel_take_up_to(&ch, values, 32, &done) == 0)
+		for(size_t i = 0; i < done; i++)
+			EXPECT_EQ(values[i], expected++);
+
+	EXPECT_EQ(expected, 201U);
+	EXPECT_EQ(zth_channel_put(&ch, 1), EPIPE);
+	EXPECT_EQ(zth_channel_take(&ch, values), EPIPE);
+	EXPECT_EQ(zth_channel_destroy(&ch), 0);
+}
+
+static std::vector<std::thread> mt_threads;
+
+static void mt_thread(void (*f)(), int threads)
+{
+	for(int i = 0; i < threads; i++)
+		mt_threads.emplace_back([f]() {
+			zth::Worker w;
+			zth::fiber([f]() { f(); });
+			w.run();
+		});
+}
+
+// Wait till the Workers are gone, such that they do not outlive the test.
+static void mt_join()
+{
+	for(auto& t : mt_threads)
+		t.join();
+
+	mt_threads.clear();
+}
+
+static zth::mt::Mutex* mt_mutex;
+static zth::mt::Gate* mt_gate;
+static int mt_counter;
+
+static void mt_mutex_worker()
+{
+	for(int i = 0; i < 1000; i++) {
+		zth::mt::Locked l{*mt_mutex};
+		mt_counter++;
+		if(i % 16 == 0)
+			zth::yield();
+	}
+
+	mt_gate->pass();
+}
+
+TEST(SyncMt, Mutex)
+{
+	zth::mt::Mutex m;
+	zth::mt::Gate g{4};
+	mt_mutex = &m;
+	mt_gate = &g;
+	mt_counter = 0;
+
+	m.lock();
+	EXPECT_FALSE(m.trylock());
+	mt_thread(&mt_mutex_worker, 3);
+	zth::mnap(10);
+	m.unlock();
+
+	g.wait();
+	EXPECT_EQ(mt_counter, 3000);
+	EXPECT_TRUE(m.trylock());
+	m.unlock();
+	mt_join();
+}
+
+static zth::mt::Future<int>* mt_future;
+static zth::mt::Semaphore* mt_semaphore;
+
+static void mt_future_worker()
+{
+	mt_semaphore->acquire(2);
+	mt_future->set(42);
+}
+
+TEST(SyncMt, FutureSemaphore)
+{
+	zth::mt::Future<int> f;
+	zth::mt::Semaphore s;
+	mt_future = &f;
+	mt_semaphore = &s;
+
+	mt_thread(&mt_future_worker, 1);
+	EXPECT_FALSE(f.valid());
+
+	s.release();
+	zth::mnap(10);
+	EXPECT_FALSE(f.valid());
+	EXPECT_EQ(s.value(), 1U);
+
+	s.release();
+	EXPECT_EQ(*f, 42);
+	EXPECT_EQ(s.value(), 0U);
+	mt_join();
+}
+
+TEST(SyncMt, Signal)
+{
+	zth::mt::Signal s;
+	zth::mt::Future<> f;
+
+	std::thread t{[&]() {
+		// This is not a fiber, so it cannot wait for the future.
+		s.signal();
+		while(!f.valid())
+			std::this_thread::yield();
+		s.signalAll();
+	}};
+
+	s.wait();
+	f.set();
+	s.wait();
+	s.wait();
+	t.join();
+}
@@ -0,0 +1,276 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2026 Jochem Rutgers
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <zth>
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <unistd.h>
+#include <vector>
+
+using zth::operator""_ms;
+
+namespace {
+class Timer : public zth::TimedWaitable {
+public:
+	explicit Timer(zth::Timestamp const& t = zth::Timestamp())
+		: zth::TimedWaitable(t)
+	{}
+
+	using zth::TimedWaitable::setTimeout;
+};
+} // namespace
+
+TEST(ListTest, Membership)
+{
+	zth::List<> l1;
+	zth::List<> l2;
+	zth::Listable a;
+	zth::Listable b;
+	zth::Listable c;
+
+	l1.push_back(a);
+	l1.push_front(b);
+	l1.insert(l1.end(), c);
+	EXPECT_EQ(l1.size(), 3U);
+	EXPECT_TRUE(l1.contains(a));
+	EXPECT_TRUE(l1.contains(c));
+	EXPECT_FALSE(l2.contains(a));
+
+	l1.erase(a);
+	l2.push_back(a);
+	EXPECT_EQ(l1.size(), 2U);
+	EXPECT_EQ(l2.size(), 1U);
+	EXPECT_FALSE(l1.contains(a));
+	EXPECT_TRUE(l2.contains(a));
+
+	l1.pop_front();
+	l1.pop_back();
+	EXPECT_TRUE(l1.empty());
+	EXPECT_EQ(l1.size(), 0U);
+	EXPECT_FALSE(l1.contains(b));
+	EXPECT_FALSE(l1.contains(c));
+
+	l2.clear();
+	EXPECT_FALSE(l2.contains(a));
+}
+
+TEST(TimerWheelTest, Basic)
+{
+	zth::TimerWheel<> q;
+	zth::Timestamp now = zth::Timestamp::now();
+
+	Timer a(now + zth::TimeInterval(0.5));
+	Timer b(now + zth::TimeInterval(10));
+	Timer c(now);
+
+	EXPECT_TRUE(q.empty());
+	q.insert(a);
+	q.insert(b);
+	q.insert(c);
+	EXPECT_EQ(q.size(), 3U);
+	EXPECT_TRUE(q.contains(a));
+	EXPECT_TRUE(q.contains(b));
+	EXPECT_TRUE(q.contains(c));
+
+	EXPECT_EQ(q.first(now), &c);
+	EXPECT_LE(q.next(), c.timeout());
+	q.erase(c);
+	EXPECT_FALSE(q.contains(c));
+
+	// The wheel may wake up early, but never late.
+	zth::Timestamp next = q.next();
+	EXPECT_LE(next, a.timeout());
+	EXPECT_GT(next, now);
+
+	q.erase(a);
+	EXPECT_EQ(q.size(), 1U);
+	EXPECT_EQ(q.first(now + zth::TimeInterval(20)), &b);
+
+	q.clear();
+	EXPECT_TRUE(q.empty());
+	EXPECT_FALSE(q.contains(b));
+}
+
+TEST(TimerWheelTest, Order)
+{
+	static size_t const count = 2000;
+	std::vector<Timer> timers(count);
+	zth::TimerWheel<> q;
+	zth::Timestamp now = zth::Timestamp::now();
+
+	srand(42);
+	for(size_t i = 0; i < count; i++) {
+		// Spread from now to about an hour from now, with many short ones.
+		double dt = (double)(rand() % 1000000) * 1e-6;
+		for(int s = rand() % 4; s > 0; s--)
+			dt *= 60.0;
+		timers[i].setTimeout(now + zth::TimeInterval(dt));
+		q.insert(timers[i]);
+	}
+
+	// Re-arm and cancel some of them.
+	for(size_t i = 0; i < count; i += 3) {
+		q.erase(timers[i]);
+		if(i % 2) {
+			timers[i].setTimeout(now + zth::TimeInterval((double)i * 1e-3));
+			q.insert(timers[i]);
+		}
+	}
+
+	size_t expected = q.size();
+	size_t popped = 0;
+	zth::Timestamp last;
+
+	while(!q.empty()) {
+		zth::TimedWaitable* w = nullptr;
+		while((w = q.first(now)) && w->timeout() <= now) {
+			EXPECT_LE(last, w->timeout());
+			last = w->timeout();
+			q.erase(*w);
+			popped++;
+		}
+
+		if(q.empty())
+			break;
+
+		// Sleep till the next (possibly early) wakeup.
+		zth::Timestamp next = q.next();
+		ASSERT_GE(next, now);
+		now = next;
+	}
+
+	EXPECT_EQ(popped, expected);
+}
+
+#if defined(ZTH_HAVE_POLLER) && (defined(ZTH_OS_LINUX) || defined(ZTH_OS_MAC))
+static bool poll_budget_got;
+
+static void poll_budget_reader(int fd)
+{
+	char c = 0;
+	poll_budget_got = zth::io::read(fd, &c, 1) == 1;
+}
+
+static void poll_budget_spinner(int rounds)
+{
+	for(int i = 0; i < rounds; i++)
+		zth::yield(nullptr, true);
+}
+
+TEST(WaiterTest, PollBudget)
+{
+	int pipefd[]{-1, -1};
+	ASSERT_EQ(pipe(pipefd), 0);
+
+	zth::Waiter& waiter = zth::currentWorker().waiter();
+	poll_budget_got = false;
+
+	// Keep an idle fd registered, while the Worker is busy.
+	zth::fiber(poll_budget_reader, pipefd[0]);
+	zth::yield(nullptr, true);
+
+	zth::Waiter::PollStats before = waiter.pollStats();
+	int const rounds = 1000;
+	zth::fiber(poll_budget_spinner, rounds);
+	poll_budget_spinner(rounds);
+
+	zth::Waiter::PollStats const& after = waiter.pollStats();
+	size_t polls = after.polls - before.polls;
+	EXPECT_GT(polls, 0U);
+	if(zth::Config::WaiterPollMaxRounds > 1) {
+		EXPECT_LT(polls, (size_t)rounds / 2U);
+	}
+	EXPECT_GT(after.skipped, before.skipped);
+
+	// Events are still picked up while busy.
+	ASSERT_EQ(write(pipefd[1], "1", 1), 1);
+	zth::fiber(poll_budget_spinner, rounds);
+	for(int i = 0; i < rounds && !poll_budget_got; i++)
+		zth::yield(nullptr, true);
+
+	EXPECT_TRUE(poll_budget_got);
+	EXPECT_GT(waiter.pollStats().hits, before.hits);
+
+	close(pipefd[0]);
+	close(pipefd[1]);
+}
+#endif
+
+TEST(ClockTest, Sources)
+{
+	zth::Config::ClockSource const sources[] = {
+		zth::Config::ClockMonotonic, zth::Config::ClockTsc, zth::Config::ClockCoarse};
+
+	for(size_t s = 0; s < sizeof(sources) / sizeof(sources[0]); s++) {
+		zth::Config::ClockSource source = sources[s];
+		zth::TimeInterval lag = zth::Timestamp::resolution(source);
+		zth::Timestamp prev = zth::Timestamp::now(source);
+
+		// Cross a few synchronizations of the TSC with CLOCK_MONOTONIC.
+		for(int i = 0; i < 5; i++) {
+			zth::Timestamp before = zth::Timestamp::now(zth::Config::ClockMonotonic);
+			zth::Timestamp t = zth::Timestamp::now(source);
+			zth::Timestamp after = zth::Timestamp::now(zth::Config::ClockMonotonic);
+
+			EXPECT_GE(t, prev) << "source " << source;
+			EXPECT_GE(t, before - lag - 10_ms) << "source " << source;
+			EXPECT_LE(t, after + 1_ms) << "source " << source;
+
+			prev = t;
+			usleep(7000);
+		}
+	}
+}
+
+TEST(TimeTest, Infinite)
+{
+	zth::TimeInterval const inf = zth::TimeInterval::infinity();
+
+	EXPECT_TRUE(inf.isInfinite());
+	EXPECT_TRUE(inf.isPositive());
+	EXPECT_TRUE((-inf).isInfinite());
+	EXPECT_TRUE((-inf).isNegative());
+	EXPECT_FALSE(zth::TimeInterval(1000).isInfinite());
+
+	if(!ZTH_TIME_NS)
+		GTEST_SKIP() << "saturation is only checked for ZTH_TIME_NS";
+
+	// Math saturates to infinity, but a large interval is not infinite yet.
+	EXPECT_EQ(inf + 1_ms, inf);
+	EXPECT_EQ(-inf - 1_ms, -inf);
+	EXPECT_FALSE(zth::TimeInterval::from_ns(std::numeric_limits<int64_t>::max() / 2 + 1)
+			     .isInfinite());
+
+	zth::Timestamp const now = zth::Timestamp::now();
+	zth::Timestamp t = now + -inf;
+	EXPECT_FALSE(t.isNull());
+	EXPECT_TRUE(t.isBefore(now));
+
+	t = now + inf;
+	EXPECT_TRUE(t.isAfter(now));
+}
+
+TEST(TimeTest, FromNs)
+{
+	if(!ZTH_TIME_NS)
+		GTEST_SKIP() << "only for ZTH_TIME_NS";
+
+	zth::TimeInterval const inf = zth::TimeInterval::infinity();
+
+	zth::TimeInterval t = zth::TimeInterval::from_ns(-1500000000LL);
+	EXPECT_TRUE(t.isNegative());
+	EXPECT_FALSE(t.isInfinite());
+	EXPECT_DOUBLE_EQ(t.s(), -1.5);
+
+	EXPECT_EQ(zth::TimeInterval::from_ns(-1), -zth::TimeInterval::from_ns(1));
+	EXPECT_EQ(zth::TimeInterval::from_ns(std::numeric_limits<long long>::min()), -inf);
+	EXPECT_EQ(zth::TimeInterval::from_ns(std::numeric_limits<int64_t>::max()), inf);
+	EXPECT_EQ(zth::TimeInterval::from_ns(std::numeric_limits<unsigned long long>::max()), inf);
+	EXPECT_FALSE(
+		zth::TimeInterval::from_ns(std::numeric_limits<int64_t>::max() - 1).isInfinite());
+}
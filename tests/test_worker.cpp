@@ -0,0 +1,606 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2026 Jochem Rutgers
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <zth>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+static zth::WorkerGroup* group_ptr;
+static std::atomic<int> group_done;
+
+static void group_worker()
+{
+	ASSERT_NE(group_ptr, nullptr);
+	EXPECT_EQ(group_ptr->join(), 0);
+}
+
+static void group_work()
+{
+	group_done++;
+}
+
+TEST(WorkerGroupTest, Steal)
+{
+	zth::WorkerGroup group;
+	group_ptr = &group;
+	group_done = 0;
+
+	EXPECT_EQ(group.join(), 0);
+	EXPECT_EQ(group.join(), EALREADY);
+
+	size_t started = 0;
+	for(int i = 0; i < 2; i++)
+		if(zth::startWorkerThread(&group_worker) == 0)
+			started++;
+
+	EXPECT_EQ(started, 2U);
+
+	while(group.size() < started + 1U)
+		zth::mnap(1);
+
+	for(int i = 0; i < 64; i++)
+		zth::fiber(group_work) << zth::stealable();
+
+	// Publish the fibers, but keep our Worker busy, such that the others have to steal them.
+	zth::yield(nullptr, true);
+	zth::Timestamp deadline = zth::Timestamp::now() + zth::TimeInterval(10);
+	while(group.steals() == 0 && zth::Timestamp::now() < deadline)
+		;
+
+	EXPECT_GT(group.steals(), 0U);
+
+	while(group_done < 64)
+		zth::outOfWork();
+
+	group.stop();
+	group.leave();
+	EXPECT_EQ(zth::currentWorker().group(), nullptr);
+
+	while(group.size() > 0)
+		zth::mnap(1);
+
+	EXPECT_EQ(group_done, 64);
+	group_ptr = nullptr;
+}
+
+TEST(WorkerGroupTest, Local)
+{
+	// Without a group, stealable fibers just run locally.
+	group_done = 0;
+
+	for(int i = 0; i < 8; i++)
+		zth::fiber(group_work) << zth::stealable();
+
+	while(group_done < 8)
+		zth::outOfWork();
+
+	EXPECT_EQ(group_done, 8);
+}
+
+#ifdef ZTH_OS_LINUX
+static std::atomic<int> thread_attr_result;
+static char thread_attr_name[16];
+
+static void thread_attr_worker()
+{
+	pthread_getname_np(pthread_self(), thread_attr_name, sizeof(thread_attr_name));
+
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	int res = pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	thread_attr_result = res ? -1 : CPU_COUNT(&cpus) == 1 && CPU_ISSET(0, &cpus) ? 1 : 2;
+}
+
+TEST(WorkerThreadTest, Attr)
+{
+	int cpu = 0;
+	zth::WorkerThreadAttr attr;
+	attr.name = "zth-test-thread-attr";
+	attr.cpus = &cpu;
+	attr.cpuCount = 1;
+
+	thread_attr_result = 0;
+	ASSERT_EQ(zth::startWorkerThread(&thread_attr_worker, attr), 0);
+
+	for(int i = 0; i < 1000 && !thread_attr_result; i++)
+		zth::mnap(1);
+
+	EXPECT_EQ(thread_attr_result, 1);
+	// Truncated to the maximum length of a thread name.
+	EXPECT_STREQ(thread_attr_name, "zth-test-thread");
+
+	cpu = -1;
+	EXPECT_EQ(zth::startWorkerThread(&thread_attr_worker, attr), EINVAL);
+}
+#endif
+
+static zth::Signal* post_signal;
+static int post_count;
+
+static void post_callback(void* arg)
+{
+	post_count += (int)(intptr_t)arg;
+	post_signal->signal();
+}
+
+static void post_fiber(void* arg)
+{
+	post_callback(arg);
+}
+
+TEST(WorkerPostTest, Callback)
+{
+	zth::Signal s;
+	post_signal = &s;
+	post_count = 0;
+
+	zth::Worker* w = &zth::currentWorker();
+	w->keepAlive();
+
+	std::thread t([w]() {
+		// The Worker is probably sleeping by now.
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		EXPECT_EQ(w->post(&post_callback, (void*)1), 0);
+	});
+
+	s.wait();
+	EXPECT_EQ(post_count, 1);
+
+	t.join();
+	w->keepAlive(false);
+	post_signal = nullptr;
+}
+
+TEST(WorkerPostTest, Fiber)
+{
+	zth::Signal s;
+	post_signal = &s;
+	post_count = 0;
+
+	zth::Worker* w = &zth::currentWorker();
+	w->keepAlive();
+
+	std::thread t([w]() {
+		for(int i = 0; i < 2; i++)
+			EXPECT_EQ(w->post(*new zth::Fiber(&post_fiber, (void*)1)), 0);
+	});
+
+	while(post_count < 2)
+		s.wait();
+
+	EXPECT_EQ(post_count, 2);
+
+	t.join();
+	w->keepAlive(false);
+	post_signal = nullptr;
+}
+
+static zth::Fiber* post_waiter;
+static int post_handoff;
+
+static void post_handoff_callback(void* UNUSED_PAR(arg))
+{
+	post_signal->signal();
+	// This may run within schedule(), so it must not switch.
+	post_handoff = zth::currentWorker().handoff(*post_waiter) ? 1 : 0;
+}
+
+TEST(WorkerPostTest, Handoff)
+{
+	zth::Signal s;
+	s.setHandoff();
+	post_signal = &s;
+	post_count = 0;
+	post_handoff = -1;
+
+	auto f = zth::fiber([&]() {
+		s.wait();
+		post_count++;
+	});
+	post_waiter = &static_cast<zth::Fiber&>(f);
+	// Let the fiber wait for the signal.
+	zth::outOfWork();
+
+	zth::Worker* w = &zth::currentWorker();
+	std::thread t([w]() { EXPECT_EQ(w->post(&post_handoff_callback, nullptr), 0); });
+
+	while(post_count == 0)
+		zth::mnap(1);
+
+	EXPECT_EQ(post_handoff, 0);
+
+	t.join();
+	post_signal = nullptr;
+	post_waiter = nullptr;
+}
+
+static void* stack_cache_local;
+static bool stack_cache_done;
+
+static void stack_cache_fiber()
+{
+	stack_cache_local = __builtin_frame_address(0);
+	stack_cache_done = true;
+}
+
+static void stack_cache_run(size_t stackSize)
+{
+	stack_cache_done = false;
+	zth::fiber(stack_cache_fiber) << zth::setStackSize(stackSize);
+
+	while(!stack_cache_done)
+		zth::outOfWork();
+
+	// Let the Worker clean up the fiber.
+	zth::outOfWork();
+}
+
+TEST(StackCacheTest, Reuse)
+{
+	zth::outOfWork();
+	zth::stack_cache_flush();
+	zth::StackCacheStats s0 = zth::stack_cache_stats();
+	EXPECT_EQ(s0.cached, 0U);
+
+	stack_cache_run(0x10000);
+	void* first = stack_cache_local;
+	zth::StackCacheStats s1 = zth::stack_cache_stats();
+	EXPECT_EQ(s1.misses, s0.misses + 1U);
+	EXPECT_EQ(s1.cached, 1U);
+
+	// Same size class; the stack is reused.
+	stack_cache_run(0x10000 - 16);
+	zth::StackCacheStats s2 = zth::stack_cache_stats();
+	EXPECT_EQ(s2.hits, s1.hits + 1U);
+	EXPECT_EQ(s2.cached, 1U);
+	EXPECT_EQ(stack_cache_local, first);
+
+	// Another size gets a new stack.
+	stack_cache_run(0x20000);
+	zth::StackCacheStats s3 = zth::stack_cache_stats();
+	EXPECT_EQ(s3.misses, s2.misses + 1U);
+	EXPECT_EQ(s3.cached, 2U);
+
+	zth::stack_cache_flush();
+	EXPECT_EQ(zth::stack_cache_stats().cached, 0U);
+}
+
+static size_t stack_reserve_idle;
+static size_t stack_reserve_deep;
+static bool stack_reserve_done;
+
+static int stack_reserve_recurse(int depth)
+{
+	volatile char buf[1024];
+	buf[0] = (char)depth;
+
+	if(depth > 0)
+		return stack_reserve_recurse(depth - 1) + buf[0];
+
+	stack_reserve_deep = zth::currentFiber().stackUsage();
+	return buf[0];
+}
+
+static void stack_reserve_fiber()
+{
+	stack_reserve_idle = zth::currentFiber().stackUsage();
+	stack_reserve_recurse(1024);
+	stack_reserve_done = true;
+}
+
+TEST(StackReserveTest, Grow)
+{
+	stack_reserve_done = false;
+	zth::fiber(stack_reserve_fiber) << zth::setStackSize(0x4000, 0x1000000);
+
+	while(!stack_reserve_done)
+		zth::outOfWork();
+
+	// Only a few pages are committed, until the fiber needs more.
+	EXPECT_GT(stack_reserve_idle, 0U);
+	EXPECT_LT(stack_reserve_idle, 0x40000U);
+	EXPECT_GT(stack_reserve_deep, 0x100000U);
+}
+
+static int stack_shared_errors;
+static int stack_shared_running;
+static size_t stack_shared_saved;
+
+static int stack_shared_recurse(int id, int depth, bool shared)
+{
+	volatile char buf[256];
+	for(size_t i = 0; i < sizeof(buf); i++)
+		buf[i] = (char)(id + depth);
+
+	int res = depth > 0 ? stack_shared_recurse(id, depth - 1, shared) : 0;
+
+	if(zth::stack_shared_contains(__builtin_frame_address(0)) != shared)
+		stack_shared_errors++;
+
+	for(int i = 0; i < 8; i++) {
+		if(i == 4)
+			zth::mnap(1);
+		else
+			zth::yield(nullptr, true);
+
+		for(size_t j = 0; j < sizeof(buf); j++)
+			if(buf[j] != (char)(id + depth))
+				stack_shared_errors++;
+	}
+
+	return res + buf[0];
+}
+
+static void stack_shared_fiber(int id, bool shared)
+{
+	stack_shared_recurse(id, id, shared);
+	if(shared)
+		stack_shared_saved =
+			std::max(stack_shared_saved, zth::currentFiber().stackUsage());
+	stack_shared_running--;
+}
+
+TEST(StackSharedTest, Switch)
+{
+#ifndef ZTH_HAVE_STACK_SHARED
+	GTEST_SKIP() << "shared stack not supported";
+#endif
+
+	stack_shared_errors = 0;
+	stack_shared_saved = 0;
+	stack_shared_running = 0;
+
+	for(int id = 0; id < 8; id++) {
+		stack_shared_running += 2;
+		zth::fiber(stack_shared_fiber, id, true) << zth::setStackShared();
+		// Mix with fibers that have a stack of their own.
+		zth::fiber(stack_shared_fiber, id, false);
+	}
+
+	while(stack_shared_running > 0)
+		zth::outOfWork();
+
+	zth::outOfWork();
+	EXPECT_EQ(stack_shared_errors, 0);
+	EXPECT_GT(stack_shared_saved, 0U);
+	EXPECT_LT(stack_shared_saved, 0x10000U);
+}
+
+static std::string priority_order;
+
+static void priority_fiber(char id)
+{
+	priority_order += id;
+}
+
+TEST(PriorityTest, Order)
+{
+	unsigned int const prio = zth::Config::DefaultPriority;
+	if(prio < 1 || prio + 1 >= zth::Config::PriorityLevels)
+		GTEST_SKIP() << "not enough priority levels";
+
+	priority_order.clear();
+	zth::fiber(priority_fiber, 'l') << zth::setPriority(prio - 1);
+	zth::fiber(priority_fiber, 'd');
+	zth::fiber(priority_fiber, 'h') << zth::setPriority(prio + 1);
+
+	// The high-priority fiber goes first, even within our time slice.
+	zth::yield();
+	EXPECT_EQ(priority_order, "h");
+
+	// The low-priority fiber does not run while we are runnable.
+	for(int i = 0; i < 10; i++)
+		zth::outOfWork();
+	EXPECT_EQ(priority_order, "hd");
+
+	// Once we sleep, it gets its turn.  Under load, the nap may have passed before.
+	for(int i = 0; i < 1000 && priority_order.size() < 3; i++)
+		zth::mnap(1);
+	EXPECT_EQ(priority_order, "hdl");
+}
+
+TEST(EdfTest, Order)
+{
+	zth::Worker& w = zth::currentWorker();
+	w.setEdf();
+
+	priority_order.clear();
+	zth::Timestamp now = zth::Timestamp::now();
+	zth::fiber(priority_fiber, 'n');
+	zth::fiber(priority_fiber, 'c') << zth::setDeadline(now + 3);
+	zth::fiber(priority_fiber, 'a') << zth::setDeadline(now + 1);
+	zth::fiber(priority_fiber, 'b') << zth::setDeadline(now + 2);
+
+	// Fibers with a deadline go first, the earliest first.
+	zth::yield();
+	EXPECT_EQ(priority_order, "abc");
+
+	for(int i = 0; i < 1000 && priority_order.size() < 4; i++)
+		zth::mnap(1);
+	EXPECT_EQ(priority_order, "abcn");
+
+	w.setEdf(false);
+}
+
+TEST(EdfTest, Miss)
+{
+	zth::Worker& w = zth::currentWorker();
+	zth::Fiber& f = zth::currentFiber();
+	unsigned int misses = f.deadlineMisses();
+	unsigned int total = w.deadlineMisses();
+
+	zth::Timestamp now = zth::Timestamp::now();
+	w.setDeadline(f, now + 1);
+	w.setDeadline(f, now + 2, now + 0.5);
+	EXPECT_EQ(f.deadlineMisses(), misses);
+
+	w.setDeadline(f, zth::Timestamp::null(), now + 3);
+	EXPECT_EQ(f.deadlineMisses(), misses + 1U);
+	EXPECT_EQ(w.deadlineMisses(), total + 1U);
+	EXPECT_TRUE(f.deadline().isNull());
+}
+
+TEST(EdfTest, PeriodicWakeUp)
+{
+	zth::Worker& w = zth::currentWorker();
+	zth::Fiber& f = zth::currentFiber();
+
+	{
+		// Without EDF, the fiber does not get a deadline.
+		zth::PeriodicWakeUp p(0.001);
+		p();
+		EXPECT_TRUE(f.deadline().isNull());
+	}
+
+	w.setEdf();
+
+	{
+		zth::PeriodicWakeUp p(0.001);
+		p();
+		EXPECT_FALSE(f.deadline().isNull());
+	}
+
+	// The deadline is gone with the PeriodicWakeUp.
+	EXPECT_TRUE(f.deadline().isNull());
+
+	w.setEdf(false);
+}
+
+static void fair_share_fiber(bool const* stop)
+{
+	while(!*stop) {
+		zth::Timestamp end = zth::Timestamp::now() + zth::TimeInterval(20e-6);
+		while(zth::Timestamp::now() < end)
+			;
+		zth::yield();
+	}
+}
+
+// Checks the choices of the scheduler, independent of how long the fibers actually run.
+struct FairShare {
+	std::vector<zth::FiberGroup*> groups;
+	int picks;
+	int limit;
+	int unfair;
+	bool stop;
+};
+
+static void fair_share_picker(FairShare* fs, zth::FiberGroup* group)
+{
+	while(!fs->stop) {
+		// A fixed amount of work, no matter how long it takes.
+		for(volatile int i = 0; i < 1000; i++)
+			;
+
+		zth::outOfWork();
+		if(fs->stop)
+			break;
+
+		// We got picked, so our group must be the one that is furthest behind.
+		for(zth::FiberGroup* g : fs->groups)
+			if(g->vruntime() < group->vruntime())
+				fs->unfair++;
+
+		if(++fs->picks >= fs->limit)
+			fs->stop = true;
+	}
+}
+
+TEST(FairShareTest, Weight)
+{
+	zth::FiberGroup light("light", 1);
+	zth::FiberGroup heavy("heavy", 3);
+	FairShare fs{{&light, &heavy}, 0, 1000, 0, false};
+	zth::Gate gate(5);
+
+	for(int i = 0; i < 2; i++) {
+		zth::fiber(fair_share_picker, &fs, &light)
+			<< zth::setFiberGroup(light) << zth::passOnExit(gate);
+		zth::fiber(fair_share_picker, &fs, &heavy)
+			<< zth::setFiberGroup(heavy) << zth::passOnExit(gate);
+	}
+
+	EXPECT_EQ(light.size(), 2U);
+	gate.wait();
+	EXPECT_EQ(light.size(), 0U);
+
+	EXPECT_EQ(fs.picks, fs.limit);
+	EXPECT_EQ(fs.unfair, 0);
+	EXPECT_GT(light.throttled(), 0U);
+
+	// The virtual runtime is the run time, scaled by the weight.
+	EXPECT_NEAR(light.vruntime(), light.totalTime().s(), 1e-6);
+	EXPECT_NEAR(heavy.vruntime() * 3, heavy.totalTime().s(), 1e-6);
+}
+
+TEST(FairShareTest, ManyGroups)
+{
+	static int const count = 20;
+	zth::FiberGroup group[count];
+	FairShare fs{{}, 0, count * 50, 0, false};
+	zth::Gate gate(count + 1);
+
+	for(int i = 0; i < count; i++)
+		fs.groups.push_back(&group[i]);
+
+	for(int i = 0; i < count; i++)
+		zth::fiber(fair_share_picker, &fs, &group[i])
+			<< zth::setFiberGroup(group[i]) << zth::passOnExit(gate);
+
+	gate.wait();
+
+	EXPECT_EQ(fs.picks, fs.limit);
+	EXPECT_EQ(fs.unfair, 0);
+	for(int i = 0; i < count; i++)
+		EXPECT_GT(group[i].vruntime(), 0);
+}
+
+TEST(FairShareTest, Yield)
+{
+	zth::FiberGroup a("a");
+	zth::FiberGroup b("b");
+	zth::Gate gate(3);
+	bool done = false;
+
+	// A fiber that yields must let the other group run.
+	zth::fiber([&]() {
+		while(!done)
+			zth::outOfWork();
+	}) << zth::setFiberGroup(a) << zth::passOnExit(gate);
+
+	zth::fiber([&]() { done = true; }) << zth::setFiberGroup(b) << zth::passOnExit(gate);
+
+	gate.wait();
+	EXPECT_TRUE(done);
+}
+
+TEST(FairShareTest, Quota)
+{
+	zth::FiberGroup group("quota");
+	EXPECT_EQ(group.setQuota(2), EINVAL);
+	EXPECT_EQ(group.setQuota(0.2), 0);
+
+	zth::Gate gate(3);
+	bool stop = false;
+	zth::fiber(fair_share_fiber, &stop) << zth::setFiberGroup(group) << zth::passOnExit(gate);
+	zth::fiber(fair_share_fiber, &stop) << zth::passOnExit(gate);
+
+	zth::Timestamp start = zth::Timestamp::now();
+	zth::mnap(300);
+	stop = true;
+	double share = group.totalTime().s() / start.passed().s();
+	gate.wait();
+
+	// Without quota, it would get about half of the time.
+	EXPECT_LT(share, 0.3);
+	EXPECT_GT(group.throttled(), 0U);
+}